@@ -0,0 +1,714 @@
+#pragma once
+// Asynchronous WebSocket client for the RoboArm firmware (header-only, C++17, POSIX).
+//
+// One I/O thread per connection. Commands are pipelined: up to
+// ClientOptions::maxInFlight of them wait for a reply on the wire, the rest
+// queue in the client. Everything queued when the thread wakes up goes out in
+// a single write (one TCP segment for small frames), and schema commands use
+// binary frames when the firmware's welcome advertises the same protocol
+// version. The firmware answers in order and without request ids, so replies
+// are matched to commands first in, first out.
+//
+//   roboarm::Client arm;
+//   if (!arm.connect("192.168.4.1", 81).get()) return 1;
+//   roboarm::proto::FrameCmd f;
+//   f.deg_n = 5;
+//   auto done = arm.send(f);          // std::future<roboarm::Reply>
+//   arm.send(roboarm::proto::StatusCmd());
+//   if (!done.get().ok) ...
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "roboarm/json.h"
+#include "roboarm/protocol.h"
+
+namespace roboarm {
+
+using Clock = std::chrono::steady_clock;
+
+// Answer to one command
+struct Reply {
+  bool ok = false;            // false for {"ok":false}, an undecodable reply or a lost connection
+  std::string err;            // firmware error code, "disconnected" or "bad_reply"
+  uint8_t id = 0;             // proto::REPLY_* for replies in the schema, 0 otherwise
+  proto::StatusReply status;  // filled when id == proto::REPLY_STATUS
+  json::Value json;           // the whole reply when it came as JSON (empty for binary)
+  std::chrono::nanoseconds rtt{0};
+};
+
+// Passed to the latency hook for every answered command (on the I/O thread)
+struct LatencySample {
+  const char *cmd;                  // "frame", "status", ... ("json" for raw commands)
+  bool binary;                      // went out as a binary frame
+  std::chrono::nanoseconds queued;  // waiting in the client for an in-flight slot
+  std::chrono::nanoseconds rtt;     // written to the socket -> reply parsed
+};
+
+struct ClientOptions {
+  size_t maxInFlight = 8;                    // commands awaiting a reply on the wire
+  bool binary = true;                        // binary frames when the firmware supports them
+  std::chrono::microseconds batchDelay{0};   // hold small writes this long to batch more (0 = off)
+  size_t batchBytes = 1400;                  // ...or until this much is queued
+  std::chrono::milliseconds connectTimeout{3000};
+};
+
+struct ClientStats {
+  uint64_t commands = 0;  // messages written (with or without reply)
+  uint64_t replies = 0;
+  uint64_t events = 0;    // unsolicited messages (see isEvent)
+  uint64_t writes = 0;    // send() calls; commands / writes = batching factor
+  uint64_t bytesOut = 0;
+  uint64_t bytesIn = 0;
+  size_t peakInFlight = 0;
+};
+
+class Client {
+ public:
+  using LatencyHook = std::function<void(const LatencySample &)>;
+  using EventHook = std::function<void(const json::Value &)>;
+
+  explicit Client(ClientOptions opts = ClientOptions()) : opts_(opts) {
+    if (opts_.maxInFlight == 0) opts_.maxInFlight = 1;
+  }
+  ~Client() { close(); }
+
+  Client(const Client &) = delete;
+  Client &operator=(const Client &) = delete;
+
+  // Resolves to true once the handshake and the welcome message are done.
+  // Commands sent before that are queued and go out right after.
+  std::future<bool> connect(const std::string &host, uint16_t port, const std::string &path = "/") {
+    close();
+    std::promise<bool> p;
+    std::future<bool> f = p.get_future();
+    if (::pipe(wake_) != 0) {
+      p.set_value(false);
+      return f;
+    }
+    for (int fd : wake_) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      done_ = false;
+      stats_ = ClientStats();
+    }
+    stop_ = false;
+    io_ = std::thread(&Client::run, this, host, port, path, std::move(p));
+    return f;
+  }
+
+  // Closes the socket; commands still waiting get "disconnected"
+  void close() {
+    if (!io_.joinable()) return;
+    stop_ = true;
+    wake();
+    io_.join();
+    for (int &fd : wake_) {
+      ::close(fd);
+      fd = -1;
+    }
+  }
+
+  bool connected() const { return connected_; }
+  bool binary() const { return binary_; }
+  // {"ready":true,"servos":5,"arms":2,...}; valid once connect() resolved true
+  const json::Value &welcome() const { return welcome_; }
+
+  // Schema command (proto::FrameCmd, proto::StatusCmd, ...). rt_frame has no
+  // reply: its future resolves ok as soon as the frame is written.
+  template <typename M>
+  std::future<Reply> send(const M &m) {
+    Pending p;
+    p.cmd = commandName<M>();
+    p.expectsReply = !std::is_same<M, proto::RtFrameCmd>::value;
+    if constexpr (std::is_same<M, proto::RtFrameCmd>::value) p.arm = m.arm;
+    p.json = proto::encodeJson(m);
+    if (opts_.binary) {
+      uint8_t buf[M::BIN_MAX];
+      size_t n = proto::encodeBin(m, buf, sizeof(buf));
+      p.bin.assign(buf, buf + n);
+    }
+    return enqueue(std::move(p));
+  }
+
+  // Any other JSON command, e.g. {"cmd":"stats"}. Set expectsReply to false
+  // for messages the firmware does not answer (stream arrays).
+  std::future<Reply> sendJson(std::string text, bool expectsReply = true) {
+    Pending p;
+    p.cmd = "json";
+    p.expectsReply = expectsReply;
+    p.json = std::move(text);
+    return enqueue(std::move(p));
+  }
+
+  // Waits until every queued command is answered (or the connection is gone)
+  void drain() {
+    std::unique_lock<std::mutex> lock(mu_);
+    drained_.wait(lock, [this] { return (queue_.empty() && inFlight_.empty()) || !io_.joinable() || done_; });
+  }
+
+  size_t inFlight() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return inFlight_.size();
+  }
+  size_t queued() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return queue_.size();
+  }
+  ClientStats stats() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return stats_;
+  }
+
+  // Hooks run on the I/O thread; keep them short. Set before connect().
+  void onLatency(LatencyHook hook) { latencyHook_ = std::move(hook); }
+  void onEvent(EventHook hook) { eventHook_ = std::move(hook); }
+
+ private:
+  struct Pending {
+    const char *cmd = "";
+    bool expectsReply = true;
+    int arm = -1;  // rt_frame only, checked before it goes out
+    std::string json;
+    std::vector<uint8_t> bin;  // empty = JSON only
+    Clock::time_point queuedAt;
+    Clock::time_point sentAt;
+    bool sentBinary = false;
+    std::promise<Reply> promise;
+  };
+
+  template <typename M> static const char *commandName() {
+    if (std::is_same<M, proto::PingCmd>::value) return "ping";
+    if (std::is_same<M, proto::HomeCmd>::value) return "home";
+    if (std::is_same<M, proto::LedCmd>::value) return "led";
+    if (std::is_same<M, proto::RgbCmd>::value) return "rgb";
+    if (std::is_same<M, proto::FrameCmd>::value) return "frame";
+    if (std::is_same<M, proto::RtFrameCmd>::value) return "rt_frame";
+    if (std::is_same<M, proto::StatusCmd>::value) return "status";
+    return "cmd";
+  }
+
+  std::future<Reply> enqueue(Pending p) {
+    std::future<Reply> f = p.promise.get_future();
+    p.queuedAt = Clock::now();
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      if (done_ || !io_.joinable()) {
+        Reply r;
+        r.err = "disconnected";
+        p.promise.set_value(std::move(r));
+        return f;
+      }
+      queue_.push_back(std::move(p));
+    }
+    wake();
+    return f;
+  }
+
+  void wake() {
+    if (wake_[1] < 0) return;
+    char c = 1;
+    ssize_t n = ::write(wake_[1], &c, 1);
+    (void)n;  // a full pipe already means "wake up"
+  }
+
+  // ---- I/O thread ----
+
+  void run(std::string host, uint16_t port, std::string path, std::promise<bool> ready) {
+    rx_.clear();
+    tx_.clear();
+    message_.clear();
+    messageOpcode_ = 0;
+    welcome_ = json::Value();
+    bool ok = open(host, port, path);
+    connected_ = ok;
+    ready.set_value(ok);
+    if (ok) pump();
+    connected_ = false;
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+    failAll("disconnected");
+  }
+
+  bool open(const std::string &host, uint16_t port, const std::string &path) {
+    Clock::time_point deadline = Clock::now() + opts_.connectTimeout;
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *res = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0) return false;
+    for (addrinfo *ai = res; ai && fd_ < 0; ai = ai->ai_next) {
+      int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+      if (fd < 0) continue;
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+      if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0 || (errno == EINPROGRESS && waitWritable(fd, deadline))) {
+        fd_ = fd;
+      } else {
+        ::close(fd);
+      }
+    }
+    freeaddrinfo(res);
+    if (fd_ < 0) return false;
+    int one = 1;
+    setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    // Handshake. The reply is only checked for 101: this client talks to
+    // its own firmware, not through proxies that could mix up upgrades.
+    uint8_t key[16];
+    for (uint8_t &b : key) b = (uint8_t)nextRandom();
+    tx_ = "GET " + path + " HTTP/1.1\r\nHost: " + host + ":" + std::to_string(port) +
+          "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Version: 13\r\nSec-WebSocket-Key: " +
+          base64(key, sizeof(key)) + "\r\n\r\n";
+    while (!tx_.empty()) {
+      if (!flushTx() || (!tx_.empty() && !waitWritable(fd_, deadline))) return false;
+    }
+    size_t end;
+    while ((end = rx_.find("\r\n\r\n")) == std::string::npos) {
+      if (!waitReadable(deadline) || !readSocket()) return false;
+    }
+    if (rx_.compare(0, 12, "HTTP/1.1 101") != 0) return false;
+    rx_.erase(0, end + 4);
+
+    // The welcome message decides between JSON and binary frames
+    while (welcome_.isNull()) {
+      if (!parseFrames()) return false;
+      if (!welcome_.isNull()) break;
+      if (!waitReadable(deadline) || !readSocket()) return false;
+    }
+    const json::Value *v = welcome_.get("proto");
+    binary_ = opts_.binary && v && v->isNumber() && (uint8_t)v->number == proto::VERSION;
+    const json::Value *arms = welcome_.get("arms");
+    arms_ = arms && arms->isNumber() ? (int)arms->number : 1;
+    return true;
+  }
+
+  static bool waitWritable(int fd, Clock::time_point deadline) {
+    pollfd p = {fd, POLLOUT, 0};
+    int ms = (int)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+    if (ms <= 0 || poll(&p, 1, ms) != 1) return false;
+    int err = 0;
+    socklen_t len = sizeof(err);
+    return getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0;
+  }
+
+  bool waitReadable(Clock::time_point deadline) {
+    pollfd p = {fd_, POLLIN, 0};
+    int ms = (int)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+    return ms > 0 && poll(&p, 1, ms) == 1;
+  }
+
+  void pump() {
+    while (!stop_) {
+      int timeoutMs = fillTx();
+      pollfd p[2] = {{fd_, (short)(POLLIN | (tx_.empty() ? 0 : POLLOUT)), 0}, {wake_[0], POLLIN, 0}};
+      int n = poll(p, 2, timeoutMs);
+      if (n < 0 && errno != EINTR) return;
+      if (p[1].revents & POLLIN) {
+        char buf[64];
+        while (::read(wake_[0], buf, sizeof(buf)) > 0) {
+        }
+      }
+      if (p[0].revents & (POLLERR | POLLHUP)) return;
+      if ((p[0].revents & POLLIN) && (!readSocket() || !parseFrames())) return;
+      if (!flushTx()) return;
+    }
+    // Polite close frame; the socket goes away right after
+    appendFrame(0x8, nullptr, 0);
+    flushTx();
+  }
+
+  // Moves queued commands onto tx_ within the in-flight limit. Returns the
+  // poll() timeout: how long a held batch may still wait, -1 for none.
+  int fillTx() {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (opts_.batchDelay.count() > 0 && !queue_.empty() && tx_.empty()) {
+      size_t bytes = 0;
+      for (const Pending &p : queue_) bytes += p.json.size();
+      Clock::duration age = Clock::now() - queue_.front().queuedAt;
+      if (bytes < opts_.batchBytes && age < opts_.batchDelay) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(opts_.batchDelay - age).count();
+        return (int)left + 1;
+      }
+    }
+    Clock::time_point now = Clock::now();
+    while (!queue_.empty()) {
+      Pending &p = queue_.front();
+      if (p.expectsReply && inFlight_.size() >= opts_.maxInFlight) break;
+      if (p.arm >= arms_) {
+        // A bad arm would get a bad_arm reply and shift every later reply
+        Reply r;
+        r.err = "bad_arm";
+        p.promise.set_value(std::move(r));
+        queue_.pop_front();
+        continue;
+      }
+      p.sentBinary = binary_ && !p.bin.empty();
+      if (p.sentBinary) appendFrame(0x2, p.bin.data(), p.bin.size());
+      else appendFrame(0x1, (const uint8_t *)p.json.data(), p.json.size());
+      p.sentAt = now;
+      stats_.commands++;
+      if (p.expectsReply) {
+        inFlight_.push_back(std::move(p));
+        if (inFlight_.size() > stats_.peakInFlight) stats_.peakInFlight = inFlight_.size();
+      } else {
+        Reply r;
+        r.ok = true;
+        p.promise.set_value(std::move(r));
+      }
+      queue_.pop_front();
+    }
+    if (queue_.empty() && inFlight_.empty()) drained_.notify_all();
+    return -1;
+  }
+
+  bool readSocket() {
+    char buf[4096];
+    for (;;) {
+      ssize_t n = recv(fd_, buf, sizeof(buf), 0);
+      if (n > 0) {
+        rx_.append(buf, (size_t)n);
+        std::lock_guard<std::mutex> lock(mu_);
+        stats_.bytesIn += (uint64_t)n;
+        continue;
+      }
+      if (n == 0) return false;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+      if (errno != EINTR) return false;
+    }
+  }
+
+  bool flushTx() {
+    if (tx_.empty()) return true;
+    size_t sent = 0;
+    while (sent < tx_.size()) {
+      ssize_t n = ::send(fd_, tx_.data() + sent, tx_.size() - sent, MSG_NOSIGNAL);
+      if (n > 0) {
+        sent += (size_t)n;
+        continue;
+      }
+      if (n < 0 && errno == EINTR) continue;
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+      return false;
+    }
+    if (sent > 0) {
+      std::lock_guard<std::mutex> lock(mu_);
+      stats_.writes++;
+      stats_.bytesOut += sent;
+    }
+    tx_.erase(0, sent);
+    return true;
+  }
+
+  // Client frames are masked (RFC 6455 5.3)
+  void appendFrame(uint8_t opcode, const uint8_t *payload, size_t len) {
+    uint8_t hdr[14];
+    size_t n = 2;
+    hdr[0] = (uint8_t)(0x80 | opcode);
+    if (len < 126) {
+      hdr[1] = (uint8_t)(0x80 | len);
+    } else if (len <= 0xFFFF) {
+      hdr[1] = 0x80 | 126;
+      hdr[2] = (uint8_t)(len >> 8);
+      hdr[3] = (uint8_t)len;
+      n = 4;
+    } else {
+      hdr[1] = 0x80 | 127;
+      for (int i = 0; i < 8; i++) hdr[2 + i] = (uint8_t)((uint64_t)len >> (8 * (7 - i)));
+      n = 10;
+    }
+    uint32_t mask = nextRandom();
+    memcpy(hdr + n, &mask, 4);
+    const uint8_t *m = hdr + n;
+    n += 4;
+    tx_.append((const char *)hdr, n);
+    size_t at = tx_.size();
+    tx_.resize(at + len);
+    for (size_t i = 0; i < len; i++) tx_[at + i] = (char)(payload[i] ^ m[i & 3]);
+  }
+
+  bool parseFrames() {
+    for (;;) {
+      const uint8_t *p = (const uint8_t *)rx_.data();
+      size_t avail = rx_.size();
+      if (avail < 2) return true;
+      bool fin = p[0] & 0x80;
+      uint8_t opcode = p[0] & 0x0F;
+      uint64_t len = p[1] & 0x7F;
+      size_t hdr = 2;
+      if (p[1] & 0x80) return false;  // servers never mask
+      if (len == 126) {
+        if (avail < 4) return true;
+        len = ((uint64_t)p[2] << 8) | p[3];
+        hdr = 4;
+      } else if (len == 127) {
+        if (avail < 10) return true;
+        len = 0;
+        for (int i = 0; i < 8; i++) len = (len << 8) | p[2 + i];
+        hdr = 10;
+      }
+      if (avail < hdr + len) return true;
+      std::string payload(rx_, hdr, (size_t)len);
+      rx_.erase(0, hdr + (size_t)len);
+
+      switch (opcode) {
+        case 0x0:
+          if (!messageOpcode_) return false;
+          message_ += payload;
+          if (fin) {
+            uint8_t op = messageOpcode_;
+            messageOpcode_ = 0;
+            std::string msg;
+            msg.swap(message_);
+            deliver(op, msg);
+          }
+          break;
+        case 0x1:
+        case 0x2:
+          if (!fin) {
+            messageOpcode_ = opcode;
+            message_ = payload;
+            break;
+          }
+          deliver(opcode, payload);
+          break;
+        case 0x8:
+          return false;
+        case 0x9:
+          appendFrame(0xA, (const uint8_t *)payload.data(), payload.size());
+          break;
+        default:
+          break;  // pong
+      }
+    }
+  }
+
+  void deliver(uint8_t opcode, const std::string &msg) {
+    Reply r;
+    if (opcode == 0x2) {
+      const uint8_t *d = (const uint8_t *)msg.data();
+      const char *err = "bad_reply";
+      r.id = proto::messageId(d, msg.size());
+      if (r.id == proto::REPLY_PONG) {
+        proto::PongReply m;
+        err = proto::decodeBin(d, msg.size(), m);
+        r.ok = !err;
+      } else if (r.id == proto::REPLY_ACK) {
+        proto::AckReply m;
+        err = proto::decodeBin(d, msg.size(), m);
+        r.ok = !err && m.ok;
+        if (!err && m.has_err) r.err = m.err;
+      } else if (r.id == proto::REPLY_STATUS) {
+        err = proto::decodeBin(d, msg.size(), r.status);
+        r.ok = !err;
+      }
+      if (err) r.err = err;
+    } else {
+      if (!json::parse(msg, r.json) || !r.json.isObject()) {
+        r.err = "bad_reply";
+      } else if (welcome_.isNull() && r.json.get("ready")) {
+        welcome_ = std::move(r.json);
+        return;
+      } else if (isEvent(r.json)) {
+        event(r.json);
+        return;
+      } else {
+        r.id = proto::replyId(r.json);
+        const json::Value *ok = r.json.get("ok");
+        const json::Value *err = r.json.get("err");
+        r.ok = !ok || (ok->isBool() && ok->boolean);
+        if (err && err->isString()) r.err = err->string;
+        if (r.id == proto::REPLY_STATUS && proto::decodeJson(r.json, r.status)) r.ok = false;
+      }
+    }
+    answer(std::move(r));
+  }
+
+  // Messages the firmware sends on its own, never as the answer to a command:
+  //   {"script":id,"result":...}  a script finished
+  //   {"ringing":true,...}        ringing_test report after the hold
+  //   {"status":true,"push":true,...}  periodic status push
+  static bool isEvent(const json::Value &v) {
+    if (v.get("script") && v.get("result")) return true;
+    if (v.get("ringing")) return true;
+    if (v.get("push")) return true;
+    return false;
+  }
+
+  void event(const json::Value &v) {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      stats_.events++;
+    }
+    if (eventHook_) eventHook_(v);
+  }
+
+  void answer(Reply r) {
+    Pending p;
+    bool unsolicited;
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      unsolicited = inFlight_.empty();
+      if (!unsolicited) {
+        p = std::move(inFlight_.front());
+        inFlight_.pop_front();
+        stats_.replies++;
+      }
+    }
+    if (unsolicited) {
+      // Nothing outstanding: pass it on as an event
+      event(r.json);
+      return;
+    }
+    Clock::time_point now = Clock::now();
+    r.rtt = now - p.sentAt;
+    if (latencyHook_) {
+      LatencySample s = {p.cmd, p.sentBinary, p.sentAt - p.queuedAt, r.rtt};
+      latencyHook_(s);
+    }
+    p.promise.set_value(std::move(r));
+  }
+
+  void failAll(const char *err) {
+    std::deque<Pending> dead;
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      done_ = true;
+      for (Pending &p : inFlight_) dead.push_back(std::move(p));
+      for (Pending &p : queue_) dead.push_back(std::move(p));
+      inFlight_.clear();
+      queue_.clear();
+    }
+    drained_.notify_all();
+    for (Pending &p : dead) {
+      Reply r;
+      r.err = err;
+      p.promise.set_value(std::move(r));
+    }
+  }
+
+  uint32_t nextRandom() {
+    // xorshift32; masking keys only have to be unpredictable to middleboxes
+    uint32_t x = rng_;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return rng_ = x;
+  }
+
+  static std::string base64(const uint8_t *data, size_t len) {
+    static const char tbl[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < len; i += 3) {
+      uint32_t v = (uint32_t)data[i] << 16;
+      if (i + 1 < len) v |= (uint32_t)data[i + 1] << 8;
+      if (i + 2 < len) v |= data[i + 2];
+      out += tbl[(v >> 18) & 63];
+      out += tbl[(v >> 12) & 63];
+      out += (i + 1 < len) ? tbl[(v >> 6) & 63] : '=';
+      out += (i + 2 < len) ? tbl[v & 63] : '=';
+    }
+    return out;
+  }
+
+  ClientOptions opts_;
+  LatencyHook latencyHook_;
+  EventHook eventHook_;
+
+  std::thread io_;
+  std::atomic<bool> stop_{false};
+  std::atomic<bool> connected_{false};
+  std::atomic<bool> binary_{false};
+  int wake_[2] = {-1, -1};
+
+  // Shared with callers
+  mutable std::mutex mu_;
+  std::condition_variable drained_;
+  std::deque<Pending> queue_;
+  std::deque<Pending> inFlight_;
+  ClientStats stats_;
+  bool done_ = false;
+
+  // I/O thread only
+  int fd_ = -1;
+  std::string rx_;
+  std::string tx_;
+  std::string message_;
+  uint8_t messageOpcode_ = 0;
+  json::Value welcome_;
+  int arms_ = 1;
+  uint32_t rng_ = (uint32_t)Clock::now().time_since_epoch().count() | 1u;
+};
+
+// Sends frames at a fixed rate from the steady clock. Deadlines are absolute
+// (start + n * period), so jitter in one tick does not shift the next; ticks
+// missed entirely are skipped rather than sent in a burst. The last
+// spinMargin before each deadline is busy-waited, since sleep_until alone
+// wakes up tens of microseconds late on a desktop kernel.
+class StreamPacer {
+ public:
+  struct Stats {
+    uint64_t sent = 0;
+    uint64_t skipped = 0;              // ticks missed because the producer or the OS was late
+    std::chrono::nanoseconds maxLate{0};  // worst send time past its deadline
+  };
+
+  StreamPacer(Client &client, double hz, std::chrono::microseconds spinMargin = std::chrono::microseconds(200))
+      : client_(client),
+        period_(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / hz))),
+        spin_(spinMargin) {}
+
+  // Calls next(tick, frame) once per period and sends the frame as rt_frame,
+  // until next returns false or the connection drops.
+  Stats run(const std::function<bool(uint64_t tick, proto::RtFrameCmd &frame)> &next) {
+    Stats s;
+    Clock::time_point start = Clock::now();
+    for (uint64_t tick = 0;; tick++) {
+      Clock::time_point deadline = start + period_ * (int64_t)tick;
+      if (deadline > Clock::now() + spin_) std::this_thread::sleep_until(deadline - spin_);
+      while (Clock::now() < deadline) {
+      }
+      proto::RtFrameCmd frame;
+      if (!next(tick, frame) || !client_.connected()) break;
+      client_.send(frame);
+      Clock::time_point now = Clock::now();
+      if (now - deadline > s.maxLate) s.maxLate = now - deadline;
+      s.sent++;
+      // Jump over ticks whose deadline has already passed
+      uint64_t behind = (uint64_t)((now - start) / period_);
+      if (behind > tick + 1) {
+        s.skipped += behind - tick - 1;
+        tick = behind - 1;
+      }
+    }
+    return s;
+  }
+
+ private:
+  Client &client_;
+  Clock::duration period_;
+  Clock::duration spin_;
+};
+
+}  // namespace roboarm
@@ -0,0 +1,318 @@
+#pragma once
+// Minimal JSON reader/writer for the RoboArm client codec (header-only, C++17).
+// Enough for the firmware's messages: objects, arrays, numbers, strings, bools.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace roboarm {
+namespace json {
+
+struct Value {
+  enum Type : uint8_t { NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT };
+
+  Type type = NUL;
+  bool boolean = false;
+  double number = 0.0;
+  std::string string;
+  std::vector<Value> items;                            // ARRAY
+  std::vector<std::pair<std::string, Value>> members;  // OBJECT, in document order
+
+  bool isNull() const { return type == NUL; }
+  bool isBool() const { return type == BOOL; }
+  bool isNumber() const { return type == NUMBER; }
+  bool isInteger() const { return type == NUMBER && std::floor(number) == number; }
+  bool isString() const { return type == STRING; }
+  bool isArray() const { return type == ARRAY; }
+  bool isObject() const { return type == OBJECT; }
+
+  // Member of an object, nullptr if absent (or not an object)
+  const Value *get(const char *key) const {
+    if (type != OBJECT) return nullptr;
+    for (const auto &m : members) {
+      if (m.first == key) return &m.second;
+    }
+    return nullptr;
+  }
+};
+
+namespace detail {
+
+class Parser {
+ public:
+  Parser(const char *p, const char *end) : p_(p), end_(end) {}
+
+  bool parse(Value &out) {
+    if (!value(out, 0)) return false;
+    skipSpace();
+    return p_ == end_;
+  }
+
+ private:
+  static const int MAX_DEPTH = 32;
+
+  void skipSpace() {
+    while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) p_++;
+  }
+
+  bool literal(const char *word) {
+    const char *q = p_;
+    for (; *word; word++, q++) {
+      if (q >= end_ || *q != *word) return false;
+    }
+    p_ = q;
+    return true;
+  }
+
+  bool value(Value &out, int depth) {
+    if (depth > MAX_DEPTH) return false;
+    skipSpace();
+    if (p_ >= end_) return false;
+    switch (*p_) {
+      case '{': return object(out, depth);
+      case '[': return array(out, depth);
+      case '"':
+        out.type = Value::STRING;
+        return string(out.string);
+      case 't':
+        out.type = Value::BOOL;
+        out.boolean = true;
+        return literal("true");
+      case 'f':
+        out.type = Value::BOOL;
+        out.boolean = false;
+        return literal("false");
+      case 'n':
+        out.type = Value::NUL;
+        return literal("null");
+      default: return number(out);
+    }
+  }
+
+  bool object(Value &out, int depth) {
+    out.type = Value::OBJECT;
+    p_++;
+    skipSpace();
+    if (p_ < end_ && *p_ == '}') {
+      p_++;
+      return true;
+    }
+    for (;;) {
+      skipSpace();
+      std::string key;
+      if (!string(key)) return false;
+      skipSpace();
+      if (p_ >= end_ || *p_++ != ':') return false;
+      out.members.emplace_back(std::move(key), Value());
+      if (!value(out.members.back().second, depth + 1)) return false;
+      skipSpace();
+      if (p_ >= end_) return false;
+      char c = *p_++;
+      if (c == '}') return true;
+      if (c != ',') return false;
+    }
+  }
+
+  bool array(Value &out, int depth) {
+    out.type = Value::ARRAY;
+    p_++;
+    skipSpace();
+    if (p_ < end_ && *p_ == ']') {
+      p_++;
+      return true;
+    }
+    for (;;) {
+      out.items.emplace_back();
+      if (!value(out.items.back(), depth + 1)) return false;
+      skipSpace();
+      if (p_ >= end_) return false;
+      char c = *p_++;
+      if (c == ']') return true;
+      if (c != ',') return false;
+    }
+  }
+
+  bool number(Value &out) {
+    // strtod needs a terminated string; numbers are short
+    char buf[64];
+    size_t n = 0;
+    while (p_ + n < end_ && n < sizeof(buf) - 1 && p_[n] && std::strchr("+-0123456789.eE", p_[n])) {
+      buf[n] = p_[n];
+      n++;
+    }
+    buf[n] = 0;
+    char *stop = nullptr;
+    out.number = std::strtod(buf, &stop);
+    if (n == 0 || stop != buf + n) return false;
+    out.type = Value::NUMBER;
+    p_ += n;
+    return true;
+  }
+
+  static void appendUtf8(std::string &s, uint32_t cp) {
+    if (cp < 0x80) {
+      s += (char)cp;
+    } else if (cp < 0x800) {
+      s += (char)(0xC0 | (cp >> 6));
+      s += (char)(0x80 | (cp & 0x3F));
+    } else {
+      s += (char)(0xE0 | (cp >> 12));
+      s += (char)(0x80 | ((cp >> 6) & 0x3F));
+      s += (char)(0x80 | (cp & 0x3F));
+    }
+  }
+
+  bool string(std::string &out) {
+    if (p_ >= end_ || *p_ != '"') return false;
+    p_++;
+    while (p_ < end_ && *p_ != '"') {
+      char c = *p_++;
+      if (c != '\\') {
+        out += c;
+        continue;
+      }
+      if (p_ >= end_) return false;
+      char e = *p_++;
+      switch (e) {
+        case 'n': out += '\n'; break;
+        case 't': out += '\t'; break;
+        case 'r': out += '\r'; break;
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'u': {
+          if (end_ - p_ < 4) return false;
+          char hex[5] = {p_[0], p_[1], p_[2], p_[3], 0};
+          char *stop = nullptr;
+          uint32_t cp = (uint32_t)std::strtoul(hex, &stop, 16);
+          if (stop != hex + 4) return false;
+          appendUtf8(out, cp);
+          p_ += 4;
+          break;
+        }
+        default: out += e; break;  // \" \\ \/
+      }
+    }
+    if (p_ >= end_) return false;
+    p_++;
+    return true;
+  }
+
+  const char *p_;
+  const char *end_;
+};
+
+}  // namespace detail
+
+inline bool parse(const char *data, size_t len, Value &out) {
+  out = Value();
+  return detail::Parser(data, data + len).parse(out);
+}
+
+inline bool parse(const std::string &text, Value &out) { return parse(text.data(), text.size(), out); }
+
+// Compact writer: key() before every value inside an object
+class Writer {
+ public:
+  Writer &beginObject() {
+    separate();
+    out_ += '{';
+    first_.push_back(true);
+    return *this;
+  }
+  Writer &endObject() {
+    out_ += '}';
+    first_.pop_back();
+    return *this;
+  }
+  Writer &beginArray() {
+    separate();
+    out_ += '[';
+    first_.push_back(true);
+    return *this;
+  }
+  Writer &endArray() {
+    out_ += ']';
+    first_.pop_back();
+    return *this;
+  }
+  Writer &key(const char *k) {
+    separate();
+    quote(k);
+    out_ += ':';
+    afterKey_ = true;
+    return *this;
+  }
+  Writer &value(bool v) {
+    separate();
+    out_ += v ? "true" : "false";
+    return *this;
+  }
+  Writer &value(double v) {
+    separate();
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.9g", v);
+    out_ += buf;
+    return *this;
+  }
+  Writer &value(float v) { return value((double)v); }
+  Writer &value(int64_t v) {
+    separate();
+    out_ += std::to_string(v);
+    return *this;
+  }
+  Writer &value(int32_t v) { return value((int64_t)v); }
+  Writer &value(uint32_t v) { return value((int64_t)v); }
+  Writer &value(int16_t v) { return value((int64_t)v); }
+  Writer &value(uint16_t v) { return value((int64_t)v); }
+  Writer &value(int8_t v) { return value((int64_t)v); }
+  Writer &value(uint8_t v) { return value((int64_t)v); }
+  Writer &value(const char *v) {
+    separate();
+    quote(v);
+    return *this;
+  }
+
+  const std::string &str() const { return out_; }
+
+ private:
+  void separate() {
+    if (afterKey_) {
+      afterKey_ = false;
+      return;
+    }
+    if (first_.empty()) return;
+    if (!first_.back()) out_ += ',';
+    first_.back() = false;
+  }
+
+  void quote(const char *s) {
+    out_ += '"';
+    for (; *s; s++) {
+      unsigned char c = (unsigned char)*s;
+      if (c == '"' || c == '\\') {
+        out_ += '\\';
+        out_ += (char)c;
+      } else if (c < 0x20) {
+        char buf[8];
+        std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+        out_ += buf;
+      } else {
+        out_ += (char)c;
+      }
+    }
+    out_ += '"';
+  }
+
+  std::string out_;
+  std::vector<bool> first_;
+  bool afterKey_ = false;
+};
+
+}  // namespace json
+}  // namespace roboarm
@@ -0,0 +1,1283 @@
+// Generated by protocol/gen_protocol.py from protocol/roboarm_protocol.json - do not edit.
+#pragma once
+// RoboArm protocol codec for C++ clients (header-only, C++17, no dependencies).
+// Same structs and binary format as the firmware (roboarm/src/protocol_gen.h);
+// JSON goes through the minimal reader/writer in roboarm/json.h.
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "roboarm/json.h"
+
+namespace roboarm {
+namespace proto {
+
+static const uint8_t VERSION = 1;
+static const uint8_t SERVOS = 5;
+static const uint8_t ERR_LEN = 31;
+static const uint8_t NAME_LEN = 15;
+
+enum MsgId : uint8_t {
+  CMD_PING = 0x01,
+  CMD_HOME = 0x02,
+  CMD_LED = 0x03,
+  CMD_RGB = 0x04,
+  CMD_FRAME = 0x05,
+  CMD_RT_FRAME = 0x06,
+  CMD_STATUS = 0x07,
+  REPLY_PONG = 0x81,
+  REPLY_ACK = 0x82,
+  REPLY_STATUS = 0x83,
+};
+
+// RGB LED colour; missing components keep their current value
+struct Color {
+  bool has_r = false;
+  uint8_t r = 0;
+  bool has_g = false;
+  uint8_t g = 0;
+  bool has_b = false;
+  uint8_t b = 0;
+};
+
+// Compact soft AP link summary
+struct WifiSummary {
+  uint8_t ch = 0;
+  uint8_t sta = 0;
+  bool has_rssi_min = false;
+  int8_t rssi_min = 0;
+};
+
+// Round trip check, answered with pong
+struct PingCmd {
+  enum { ID = CMD_PING, BIN_MAX = 1 };
+};
+
+// Move all joints to 0 deg
+struct HomeCmd {
+  enum { ID = CMD_HOME, BIN_MAX = 12 };
+  uint8_t arm = 0;
+  uint32_t ms = 800;
+  bool has_led = false;
+  uint8_t led = 0;
+  bool has_rgb = false;
+  Color rgb;
+};
+
+// Set the LED channel directly
+struct LedCmd {
+  enum { ID = CMD_LED, BIN_MAX = 3 };
+  uint8_t arm = 0;
+  uint8_t val = 0;
+};
+
+// Set the RGB LED directly
+struct RgbCmd {
+  enum { ID = CMD_RGB, BIN_MAX = 5 };
+  uint8_t arm = 0;
+  uint8_t r = 0;
+  uint8_t g = 0;
+  uint8_t b = 0;
+};
+
+// Move to deg (-90..+90, missing joints hold) in ms, acknowledged
+struct FrameCmd {
+  enum { ID = CMD_FRAME, BIN_MAX = 33 };
+  uint8_t arm = 0;
+  float deg[SERVOS] = {};
+  uint8_t deg_n = 0;
+  uint32_t ms = 100;
+  bool has_led = false;
+  uint8_t led = 0;
+  bool has_rgb = false;
+  Color rgb;
+};
+
+// Like frame, fire-and-forget (no reply), through the input filters
+struct RtFrameCmd {
+  enum { ID = CMD_RT_FRAME, BIN_MAX = 33 };
+  uint8_t arm = 0;
+  float deg[SERVOS] = {};
+  uint8_t deg_n = 0;
+  uint32_t ms = 50;
+  bool has_led = false;
+  uint8_t led = 0;
+  bool has_rgb = false;
+  Color rgb;
+};
+
+// Request a status report
+struct StatusCmd {
+  enum { ID = CMD_STATUS, BIN_MAX = 2 };
+  uint8_t arm = 0;
+};
+
+// Answer to ping
+struct PongReply {
+  enum { ID = REPLY_PONG, BIN_MAX = 1 };
+};
+
+// Result of a command without its own reply
+struct AckReply {
+  enum { ID = REPLY_ACK, BIN_MAX = 35 };
+  bool ok = false;
+  bool has_err = false;
+  char err[ERR_LEN + 1] = {};
+};
+
+// Arm state
+struct StatusReply {
+  enum { ID = REPLY_STATUS, BIN_MAX = 80 };
+  uint8_t arm = 0;
+  bool moving = false;
+  float angles[SERVOS] = {};
+  uint8_t angles_n = 0;
+  uint8_t led = 0;
+  Color rgb;
+  bool trajectory_mode = false;
+  uint8_t trajectory_points = 0;
+  uint8_t trajectory_index = 0;
+  bool stream_mode = false;
+  uint32_t stream_freq = 0;
+  float est_deg[SERVOS] = {};
+  uint8_t est_deg_n = 0;
+  bool has_script = false;
+  char script[NAME_LEN + 1] = {};
+  bool has_script_step = false;
+  uint8_t script_step = 0;
+  WifiSummary wifi;
+};
+
+// ========= Binary =========
+// Little-endian reader/writer over a caller-owned buffer (no allocation)
+class BinReader {
+ public:
+  BinReader(const uint8_t *data, size_t len) : p_(data), end_(data + len) {}
+  bool ok() const { return ok_; }
+  bool done() const { return ok_ && p_ == end_; }
+  uint8_t u8() { return need(1) ? *p_++ : 0; }
+  int8_t i8() { return (int8_t)u8(); }
+  bool boolean() { return u8() != 0; }
+  uint16_t u16() {
+    if (!need(2)) return 0;
+    uint16_t v = (uint16_t)(p_[0] | (p_[1] << 8));
+    p_ += 2;
+    return v;
+  }
+  int16_t i16() { return (int16_t)u16(); }
+  uint32_t u32() {
+    if (!need(4)) return 0;
+    uint32_t v = (uint32_t)p_[0] | ((uint32_t)p_[1] << 8) | ((uint32_t)p_[2] << 16) | ((uint32_t)p_[3] << 24);
+    p_ += 4;
+    return v;
+  }
+  int32_t i32() { return (int32_t)u32(); }
+  float f32() {
+    uint32_t bits = u32();
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+  }
+  void bytes(char *out, size_t n) {
+    if (!need(n)) return;
+    memcpy(out, p_, n);
+    p_ += n;
+  }
+  void fail() { ok_ = false; }
+
+ private:
+  bool need(size_t n) {
+    if (ok_ && (size_t)(end_ - p_) >= n) return true;
+    ok_ = false;
+    return false;
+  }
+  const uint8_t *p_;
+  const uint8_t *end_;
+  bool ok_ = true;
+};
+
+class BinWriter {
+ public:
+  BinWriter(uint8_t *out, size_t cap) : out_(out), cap_(cap) {}
+  bool ok() const { return ok_; }
+  size_t size() const { return n_; }
+  void u8(uint8_t v) {
+    if (need(1)) out_[n_++] = v;
+  }
+  void i8(int8_t v) { u8((uint8_t)v); }
+  void boolean(bool v) { u8(v ? 1 : 0); }
+  void u16(uint16_t v) {
+    u8((uint8_t)v);
+    u8((uint8_t)(v >> 8));
+  }
+  void i16(int16_t v) { u16((uint16_t)v); }
+  void u32(uint32_t v) {
+    u16((uint16_t)v);
+    u16((uint16_t)(v >> 16));
+  }
+  void i32(int32_t v) { u32((uint32_t)v); }
+  void f32(float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    u32(bits);
+  }
+  void bytes(const char *data, size_t n) {
+    if (!need(n)) return;
+    memcpy(out_ + n_, data, n);
+    n_ += n;
+  }
+  // Patched after the optional fields are known
+  size_t reserve() {
+    size_t at = n_;
+    u8(0);
+    return at;
+  }
+  void patch(size_t at, uint8_t v) {
+    if (ok_) out_[at] = v;
+  }
+
+ private:
+  bool need(size_t n) {
+    if (ok_ && cap_ - n_ >= n) return true;
+    ok_ = false;
+    return false;
+  }
+  uint8_t *out_;
+  size_t cap_;
+  size_t n_ = 0;
+  bool ok_ = true;
+};
+
+// Message id of a binary frame (0 = empty)
+inline uint8_t messageId(const uint8_t *data, size_t len) { return len ? data[0] : 0; }
+
+inline const char *decodeFields(BinReader &r, Color &m) {
+  uint8_t mask0 = r.u8();
+  m.has_r = (mask0 & 1) != 0;
+  if (m.has_r) {
+    m.r = r.u8();
+  }
+  m.has_g = (mask0 & 2) != 0;
+  if (m.has_g) {
+    m.g = r.u8();
+  }
+  m.has_b = (mask0 & 4) != 0;
+  if (m.has_b) {
+    m.b = r.u8();
+  }
+  return nullptr;
+}
+
+inline void encodeFields(BinWriter &w, const Color &m) {
+  w.u8((uint8_t)((m.has_r ? 1 : 0) | (m.has_g ? 2 : 0) | (m.has_b ? 4 : 0)));
+  if (m.has_r) {
+    w.u8(m.r);
+  }
+  if (m.has_g) {
+    w.u8(m.g);
+  }
+  if (m.has_b) {
+    w.u8(m.b);
+  }
+}
+
+inline const char *decodeFields(BinReader &r, WifiSummary &m) {
+  uint8_t mask0 = r.u8();
+  m.ch = r.u8();
+  m.sta = r.u8();
+  m.has_rssi_min = (mask0 & 1) != 0;
+  if (m.has_rssi_min) {
+    m.rssi_min = r.i8();
+  }
+  return nullptr;
+}
+
+inline void encodeFields(BinWriter &w, const WifiSummary &m) {
+  w.u8((uint8_t)((m.has_rssi_min ? 1 : 0)));
+  w.u8(m.ch);
+  w.u8(m.sta);
+  if (m.has_rssi_min) {
+    w.i8(m.rssi_min);
+  }
+}
+
+inline const char *decodeFields(BinReader &r, PingCmd &m) {
+  (void)r;
+  (void)m;
+  return nullptr;
+}
+
+inline void encodeFields(BinWriter &w, const PingCmd &m) {
+  (void)w;
+  (void)m;
+}
+
+// Whole frame with id; returns an error code or nullptr
+inline const char *decodeBin(const uint8_t *data, size_t len, PingCmd &m) {
+  BinReader r(data, len);
+  if (r.u8() != PingCmd::ID) return "bad_binary";
+  const char *err = decodeFields(r, m);
+  if (err) return err;
+  return r.done() ? nullptr : "bad_binary";
+}
+
+// Returns the frame length, 0 if cap is too small (PingCmd::BIN_MAX always fits)
+inline size_t encodeBin(const PingCmd &m, uint8_t *out, size_t cap) {
+  BinWriter w(out, cap);
+  w.u8(PingCmd::ID);
+  encodeFields(w, m);
+  return w.ok() ? w.size() : 0;
+}
+
+inline const char *decodeFields(BinReader &r, HomeCmd &m) {
+  uint8_t mask0 = r.u8();
+  m.arm = r.u8();
+  m.ms = r.u32();
+  m.has_led = (mask0 & 1) != 0;
+  if (m.has_led) {
+    m.led = r.u8();
+  }
+  m.has_rgb = (mask0 & 2) != 0;
+  if (m.has_rgb) {
+    {
+      const char *err = decodeFields(r, m.rgb);
+      if (err) return err;
+    }
+  }
+  return nullptr;
+}
+
+inline void encodeFields(BinWriter &w, const HomeCmd &m) {
+  w.u8((uint8_t)((m.has_led ? 1 : 0) | (m.has_rgb ? 2 : 0)));
+  w.u8(m.arm);
+  w.u32(m.ms);
+  if (m.has_led) {
+    w.u8(m.led);
+  }
+  if (m.has_rgb) {
+    encodeFields(w, m.rgb);
+  }
+}
+
+// Whole frame with id; returns an error code or nullptr
+inline const char *decodeBin(const uint8_t *data, size_t len, HomeCmd &m) {
+  BinReader r(data, len);
+  if (r.u8() != HomeCmd::ID) return "bad_binary";
+  const char *err = decodeFields(r, m);
+  if (err) return err;
+  return r.done() ? nullptr : "bad_binary";
+}
+
+// Returns the frame length, 0 if cap is too small (HomeCmd::BIN_MAX always fits)
+inline size_t encodeBin(const HomeCmd &m, uint8_t *out, size_t cap) {
+  BinWriter w(out, cap);
+  w.u8(HomeCmd::ID);
+  encodeFields(w, m);
+  return w.ok() ? w.size() : 0;
+}
+
+inline const char *decodeFields(BinReader &r, LedCmd &m) {
+  m.arm = r.u8();
+  m.val = r.u8();
+  return nullptr;
+}
+
+inline void encodeFields(BinWriter &w, const LedCmd &m) {
+  w.u8(m.arm);
+  w.u8(m.val);
+}
+
+// Whole frame with id; returns an error code or nullptr
+inline const char *decodeBin(const uint8_t *data, size_t len, LedCmd &m) {
+  BinReader r(data, len);
+  if (r.u8() != LedCmd::ID) return "bad_binary";
+  const char *err = decodeFields(r, m);
+  if (err) return err;
+  return r.done() ? nullptr : "bad_binary";
+}
+
+// Returns the frame length, 0 if cap is too small (LedCmd::BIN_MAX always fits)
+inline size_t encodeBin(const LedCmd &m, uint8_t *out, size_t cap) {
+  BinWriter w(out, cap);
+  w.u8(LedCmd::ID);
+  encodeFields(w, m);
+  return w.ok() ? w.size() : 0;
+}
+
+inline const char *decodeFields(BinReader &r, RgbCmd &m) {
+  m.arm = r.u8();
+  m.r = r.u8();
+  m.g = r.u8();
+  m.b = r.u8();
+  return nullptr;
+}
+
+inline void encodeFields(BinWriter &w, const RgbCmd &m) {
+  w.u8(m.arm);
+  w.u8(m.r);
+  w.u8(m.g);
+  w.u8(m.b);
+}
+
+// Whole frame with id; returns an error code or nullptr
+inline const char *decodeBin(const uint8_t *data, size_t len, RgbCmd &m) {
+  BinReader r(data, len);
+  if (r.u8() != RgbCmd::ID) return "bad_binary";
+  const char *err = decodeFields(r, m);
+  if (err) return err;
+  return r.done() ? nullptr : "bad_binary";
+}
+
+// Returns the frame length, 0 if cap is too small (RgbCmd::BIN_MAX always fits)
+inline size_t encodeBin(const RgbCmd &m, uint8_t *out, size_t cap) {
+  BinWriter w(out, cap);
+  w.u8(RgbCmd::ID);
+  encodeFields(w, m);
+  return w.ok() ? w.size() : 0;
+}
+
+inline const char *decodeFields(BinReader &r, FrameCmd &m) {
+  uint8_t mask0 = r.u8();
+  m.arm = r.u8();
+  m.deg_n = r.u8();
+  if (m.deg_n > SERVOS) return "bad_binary";
+  if (m.deg_n < 1) return "missing_deg";
+  for (uint8_t i = 0; i < m.deg_n; i++) m.deg[i] = r.f32();
+  m.ms = r.u32();
+  m.has_led = (mask0 & 1) != 0;
+  if (m.has_led) {
+    m.led = r.u8();
+  }
+  m.has_rgb = (mask0 & 2) != 0;
+  if (m.has_rgb) {
+    {
+      const char *err = decodeFields(r, m.rgb);
+      if (err) return err;
+    }
+  }
+  return nullptr;
+}
+
+inline void encodeFields(BinWriter &w, const FrameCmd &m) {
+  w.u8((uint8_t)((m.has_led ? 1 : 0) | (m.has_rgb ? 2 : 0)));
+  w.u8(m.arm);
+  w.u8(m.deg_n);
+  for (uint8_t i = 0; i < m.deg_n; i++) w.f32(m.deg[i]);
+  w.u32(m.ms);
+  if (m.has_led) {
+    w.u8(m.led);
+  }
+  if (m.has_rgb) {
+    encodeFields(w, m.rgb);
+  }
+}
+
+// Whole frame with id; returns an error code or nullptr
+inline const char *decodeBin(const uint8_t *data, size_t len, FrameCmd &m) {
+  BinReader r(data, len);
+  if (r.u8() != FrameCmd::ID) return "bad_binary";
+  const char *err = decodeFields(r, m);
+  if (err) return err;
+  return r.done() ? nullptr : "bad_binary";
+}
+
+// Returns the frame length, 0 if cap is too small (FrameCmd::BIN_MAX always fits)
+inline size_t encodeBin(const FrameCmd &m, uint8_t *out, size_t cap) {
+  BinWriter w(out, cap);
+  w.u8(FrameCmd::ID);
+  encodeFields(w, m);
+  return w.ok() ? w.size() : 0;
+}
+
+inline const char *decodeFields(BinReader &r, RtFrameCmd &m) {
+  uint8_t mask0 = r.u8();
+  m.arm = r.u8();
+  m.deg_n = r.u8();
+  if (m.deg_n > SERVOS) return "bad_binary";
+  if (m.deg_n < 1) return "missing_deg";
+  for (uint8_t i = 0; i < m.deg_n; i++) m.deg[i] = r.f32();
+  m.ms = r.u32();
+  m.has_led = (mask0 & 1) != 0;
+  if (m.has_led) {
+    m.led = r.u8();
+  }
+  m.has_rgb = (mask0 & 2) != 0;
+  if (m.has_rgb) {
+    {
+      const char *err = decodeFields(r, m.rgb);
+      if (err) return err;
+    }
+  }
+  return nullptr;
+}
+
+inline void encodeFields(BinWriter &w, const RtFrameCmd &m) {
+  w.u8((uint8_t)((m.has_led ? 1 : 0) | (m.has_rgb ? 2 : 0)));
+  w.u8(m.arm);
+  w.u8(m.deg_n);
+  for (uint8_t i = 0; i < m.deg_n; i++) w.f32(m.deg[i]);
+  w.u32(m.ms);
+  if (m.has_led) {
+    w.u8(m.led);
+  }
+  if (m.has_rgb) {
+    encodeFields(w, m.rgb);
+  }
+}
+
+// Whole frame with id; returns an error code or nullptr
+inline const char *decodeBin(const uint8_t *data, size_t len, RtFrameCmd &m) {
+  BinReader r(data, len);
+  if (r.u8() != RtFrameCmd::ID) return "bad_binary";
+  const char *err = decodeFields(r, m);
+  if (err) return err;
+  return r.done() ? nullptr : "bad_binary";
+}
+
+// Returns the frame length, 0 if cap is too small (RtFrameCmd::BIN_MAX always fits)
+inline size_t encodeBin(const RtFrameCmd &m, uint8_t *out, size_t cap) {
+  BinWriter w(out, cap);
+  w.u8(RtFrameCmd::ID);
+  encodeFields(w, m);
+  return w.ok() ? w.size() : 0;
+}
+
+inline const char *decodeFields(BinReader &r, StatusCmd &m) {
+  m.arm = r.u8();
+  return nullptr;
+}
+
+inline void encodeFields(BinWriter &w, const StatusCmd &m) {
+  w.u8(m.arm);
+}
+
+// Whole frame with id; returns an error code or nullptr
+inline const char *decodeBin(const uint8_t *data, size_t len, StatusCmd &m) {
+  BinReader r(data, len);
+  if (r.u8() != StatusCmd::ID) return "bad_binary";
+  const char *err = decodeFields(r, m);
+  if (err) return err;
+  return r.done() ? nullptr : "bad_binary";
+}
+
+// Returns the frame length, 0 if cap is too small (StatusCmd::BIN_MAX always fits)
+inline size_t encodeBin(const StatusCmd &m, uint8_t *out, size_t cap) {
+  BinWriter w(out, cap);
+  w.u8(StatusCmd::ID);
+  encodeFields(w, m);
+  return w.ok() ? w.size() : 0;
+}
+
+inline const char *decodeFields(BinReader &r, PongReply &m) {
+  (void)r;
+  (void)m;
+  return nullptr;
+}
+
+inline void encodeFields(BinWriter &w, const PongReply &m) {
+  (void)w;
+  (void)m;
+}
+
+// Whole frame with id; returns an error code or nullptr
+inline const char *decodeBin(const uint8_t *data, size_t len, PongReply &m) {
+  BinReader r(data, len);
+  if (r.u8() != PongReply::ID) return "bad_binary";
+  const char *err = decodeFields(r, m);
+  if (err) return err;
+  return r.done() ? nullptr : "bad_binary";
+}
+
+// Returns the frame length, 0 if cap is too small (PongReply::BIN_MAX always fits)
+inline size_t encodeBin(const PongReply &m, uint8_t *out, size_t cap) {
+  BinWriter w(out, cap);
+  w.u8(PongReply::ID);
+  encodeFields(w, m);
+  return w.ok() ? w.size() : 0;
+}
+
+inline const char *decodeFields(BinReader &r, AckReply &m) {
+  uint8_t mask0 = r.u8();
+  m.ok = r.boolean();
+  m.has_err = (mask0 & 1) != 0;
+  if (m.has_err) {
+    uint8_t errLen = r.u8();
+    if (errLen > sizeof(m.err) - 1) return "bad_binary";
+    r.bytes(m.err, errLen);
+    m.err[errLen] = 0;
+  }
+  return nullptr;
+}
+
+inline void encodeFields(BinWriter &w, const AckReply &m) {
+  w.u8((uint8_t)((m.has_err ? 1 : 0)));
+  w.boolean(m.ok);
+  if (m.has_err) {
+    uint8_t errLen = (uint8_t)strlen(m.err);
+    w.u8(errLen);
+    w.bytes(m.err, errLen);
+  }
+}
+
+// Whole frame with id; returns an error code or nullptr
+inline const char *decodeBin(const uint8_t *data, size_t len, AckReply &m) {
+  BinReader r(data, len);
+  if (r.u8() != AckReply::ID) return "bad_binary";
+  const char *err = decodeFields(r, m);
+  if (err) return err;
+  return r.done() ? nullptr : "bad_binary";
+}
+
+// Returns the frame length, 0 if cap is too small (AckReply::BIN_MAX always fits)
+inline size_t encodeBin(const AckReply &m, uint8_t *out, size_t cap) {
+  BinWriter w(out, cap);
+  w.u8(AckReply::ID);
+  encodeFields(w, m);
+  return w.ok() ? w.size() : 0;
+}
+
+inline const char *decodeFields(BinReader &r, StatusReply &m) {
+  uint8_t mask0 = r.u8();
+  m.arm = r.u8();
+  m.moving = r.boolean();
+  m.angles_n = r.u8();
+  if (m.angles_n > SERVOS) return "bad_binary";
+  for (uint8_t i = 0; i < m.angles_n; i++) m.angles[i] = r.f32();
+  m.led = r.u8();
+  {
+    const char *err = decodeFields(r, m.rgb);
+    if (err) return err;
+  }
+  m.trajectory_mode = r.boolean();
+  m.trajectory_points = r.u8();
+  m.trajectory_index = r.u8();
+  m.stream_mode = r.boolean();
+  m.stream_freq = r.u32();
+  m.est_deg_n = r.u8();
+  if (m.est_deg_n > SERVOS) return "bad_binary";
+  for (uint8_t i = 0; i < m.est_deg_n; i++) m.est_deg[i] = r.f32();
+  m.has_script = (mask0 & 1) != 0;
+  if (m.has_script) {
+    uint8_t scriptLen = r.u8();
+    if (scriptLen > sizeof(m.script) - 1) return "bad_binary";
+    r.bytes(m.script, scriptLen);
+    m.script[scriptLen] = 0;
+  }
+  m.has_script_step = (mask0 & 2) != 0;
+  if (m.has_script_step) {
+    m.script_step = r.u8();
+  }
+  {
+    const char *err = decodeFields(r, m.wifi);
+    if (err) return err;
+  }
+  return nullptr;
+}
+
+inline void encodeFields(BinWriter &w, const StatusReply &m) {
+  w.u8((uint8_t)((m.has_script ? 1 : 0) | (m.has_script_step ? 2 : 0)));
+  w.u8(m.arm);
+  w.boolean(m.moving);
+  w.u8(m.angles_n);
+  for (uint8_t i = 0; i < m.angles_n; i++) w.f32(m.angles[i]);
+  w.u8(m.led);
+  encodeFields(w, m.rgb);
+  w.boolean(m.trajectory_mode);
+  w.u8(m.trajectory_points);
+  w.u8(m.trajectory_index);
+  w.boolean(m.stream_mode);
+  w.u32(m.stream_freq);
+  w.u8(m.est_deg_n);
+  for (uint8_t i = 0; i < m.est_deg_n; i++) w.f32(m.est_deg[i]);
+  if (m.has_script) {
+    uint8_t scriptLen = (uint8_t)strlen(m.script);
+    w.u8(scriptLen);
+    w.bytes(m.script, scriptLen);
+  }
+  if (m.has_script_step) {
+    w.u8(m.script_step);
+  }
+  encodeFields(w, m.wifi);
+}
+
+// Whole frame with id; returns an error code or nullptr
+inline const char *decodeBin(const uint8_t *data, size_t len, StatusReply &m) {
+  BinReader r(data, len);
+  if (r.u8() != StatusReply::ID) return "bad_binary";
+  const char *err = decodeFields(r, m);
+  if (err) return err;
+  return r.done() ? nullptr : "bad_binary";
+}
+
+// Returns the frame length, 0 if cap is too small (StatusReply::BIN_MAX always fits)
+inline size_t encodeBin(const StatusReply &m, uint8_t *out, size_t cap) {
+  BinWriter w(out, cap);
+  w.u8(StatusReply::ID);
+  encodeFields(w, m);
+  return w.ok() ? w.size() : 0;
+}
+
+// ========= JSON =========
+inline const char *decodeJson(const json::Value &o, Color &m) {
+  const json::Value *v;
+  v = o.get("r");
+  if (v && !v->isNull()) {
+    if (!(*v).isInteger() || (*v).number < 0 || (*v).number > 255) return "bad_r";
+    m.r = (uint8_t)(*v).number;
+    m.has_r = true;
+  }
+  v = o.get("g");
+  if (v && !v->isNull()) {
+    if (!(*v).isInteger() || (*v).number < 0 || (*v).number > 255) return "bad_g";
+    m.g = (uint8_t)(*v).number;
+    m.has_g = true;
+  }
+  v = o.get("b");
+  if (v && !v->isNull()) {
+    if (!(*v).isInteger() || (*v).number < 0 || (*v).number > 255) return "bad_b";
+    m.b = (uint8_t)(*v).number;
+    m.has_b = true;
+  }
+  return nullptr;
+}
+
+inline void encodeJsonFields(json::Writer &w, const Color &m) {
+  if (m.has_r) {
+    w.key("r").value(m.r);
+  }
+  if (m.has_g) {
+    w.key("g").value(m.g);
+  }
+  if (m.has_b) {
+    w.key("b").value(m.b);
+  }
+}
+
+inline const char *decodeJson(const json::Value &o, WifiSummary &m) {
+  const json::Value *v;
+  v = o.get("ch");
+  if (!v || v->isNull()) return "missing_ch";
+  {
+    if (!(*v).isInteger() || (*v).number < 0 || (*v).number > 255) return "bad_ch";
+    m.ch = (uint8_t)(*v).number;
+  }
+  v = o.get("sta");
+  if (!v || v->isNull()) return "missing_sta";
+  {
+    if (!(*v).isInteger() || (*v).number < 0 || (*v).number > 255) return "bad_sta";
+    m.sta = (uint8_t)(*v).number;
+  }
+  v = o.get("rssi_min");
+  if (v && !v->isNull()) {
+    if (!(*v).isInteger() || (*v).number < -128 || (*v).number > 127) return "bad_rssi_min";
+    m.rssi_min = (int8_t)(*v).number;
+    m.has_rssi_min = true;
+  }
+  return nullptr;
+}
+
+inline void encodeJsonFields(json::Writer &w, const WifiSummary &m) {
+  w.key("ch").value(m.ch);
+  w.key("sta").value(m.sta);
+  if (m.has_rssi_min) {
+    w.key("rssi_min").value(m.rssi_min);
+  }
+}
+
+inline const char *decodeJson(const json::Value &o, PingCmd &m) {
+  (void)o;
+  (void)m;
+  return nullptr;
+}
+
+inline void encodeJsonFields(json::Writer &w, const PingCmd &m) {
+  w.key("cmd").value("ping");
+  (void)m;
+}
+
+inline std::string encodeJson(const PingCmd &m) {
+  json::Writer w;
+  w.beginObject();
+  encodeJsonFields(w, m);
+  w.endObject();
+  return w.str();
+}
+
+inline const char *decodeJson(const json::Value &o, HomeCmd &m) {
+  const json::Value *v;
+  v = o.get("arm");
+  if (v && !v->isNull()) {
+    if (!(*v).isInteger() || (*v).number < 0 || (*v).number > 255) return "bad_arm";
+    m.arm = (uint8_t)(*v).number;
+  }
+  v = o.get("ms");
+  if (v && !v->isNull()) {
+    if (!(*v).isInteger() || (*v).number < 0 || (*v).number > 4294967295.0) return "bad_ms";
+    m.ms = (uint32_t)(*v).number;
+  }
+  v = o.get("led");
+  if (v && !v->isNull()) {
+    if (!(*v).isInteger() || (*v).number < 0 || (*v).number > 255) return "bad_led";
+    m.led = (uint8_t)(*v).number;
+    m.has_led = true;
+  }
+  v = o.get("rgb");
+  if (v && !v->isNull()) {
+    if (!v->isObject()) return "bad_rgb";
+    const char *err = decodeJson(*v, m.rgb);
+    if (err) return err;
+    m.has_rgb = true;
+  }
+  return nullptr;
+}
+
+inline void encodeJsonFields(json::Writer &w, const HomeCmd &m) {
+  w.key("cmd").value("home");
+  w.key("arm").value(m.arm);
+  w.key("ms").value(m.ms);
+  if (m.has_led) {
+    w.key("led").value(m.led);
+  }
+  if (m.has_rgb) {
+    w.key("rgb").beginObject();
+    encodeJsonFields(w, m.rgb);
+    w.endObject();
+  }
+}
+
+inline std::string encodeJson(const HomeCmd &m) {
+  json::Writer w;
+  w.beginObject();
+  encodeJsonFields(w, m);
+  w.endObject();
+  return w.str();
+}
+
+inline const char *decodeJson(const json::Value &o, LedCmd &m) {
+  const json::Value *v;
+  v = o.get("arm");
+  if (v && !v->isNull()) {
+    if (!(*v).isInteger() || (*v).number < 0 || (*v).number > 255) return "bad_arm";
+    m.arm = (uint8_t)(*v).number;
+  }
+  v = o.get("val");
+  if (!v || v->isNull()) return "led_range_0_255";
+  {
+    if (!(*v).isInteger() || (*v).number < 0 || (*v).number > 255) return "led_range_0_255";
+    m.val = (uint8_t)(*v).number;
+  }
+  return nullptr;
+}
+
+inline void encodeJsonFields(json::Writer &w, const LedCmd &m) {
+  w.key("cmd").value("led");
+  w.key("arm").value(m.arm);
+  w.key("val").value(m.val);
+}
+
+inline std::string encodeJson(const LedCmd &m) {
+  json::Writer w;
+  w.beginObject();
+  encodeJsonFields(w, m);
+  w.endObject();
+  return w.str();
+}
+
+inline const char *decodeJson(const json::Value &o, RgbCmd &m) {
+  const json::Value *v;
+  v = o.get("arm");
+  if (v && !v->isNull()) {
+    if (!(*v).isInteger() || (*v).number < 0 || (*v).number > 255) return "bad_arm";
+    m.arm = (uint8_t)(*v).number;
+  }
+  v = o.get("r");
+  if (!v || v->isNull()) return "rgb_range_0_255";
+  {
+    if (!(*v).isInteger() || (*v).number < 0 || (*v).number > 255) return "rgb_range_0_255";
+    m.r = (uint8_t)(*v).number;
+  }
+  v = o.get("g");
+  if (!v || v->isNull()) return "rgb_range_0_255";
+  {
+    if (!(*v).isInteger() || (*v).number < 0 || (*v).number > 255) return "rgb_range_0_255";
+    m.g = (uint8_t)(*v).number;
+  }
+  v = o.get("b");
+  if (!v || v->isNull()) return "rgb_range_0_255";
+  {
+    if (!(*v).isInteger() || (*v).number < 0 || (*v).number > 255) return "rgb_range_0_255";
+    m.b = (uint8_t)(*v).number;
+  }
+  return nullptr;
+}
+
+inline void encodeJsonFields(json::Writer &w, const RgbCmd &m) {
+  w.key("cmd").value("rgb");
+  w.key("arm").value(m.arm);
+  w.key("r").value(m.r);
+  w.key("g").value(m.g);
+  w.key("b").value(m.b);
+}
+
+inline std::string encodeJson(const RgbCmd &m) {
+  json::Writer w;
+  w.beginObject();
+  encodeJsonFields(w, m);
+  w.endObject();
+  return w.str();
+}
+
+inline const char *decodeJson(const json::Value &o, FrameCmd &m) {
+  const json::Value *v;
+  v = o.get("arm");
+  if (v && !v->isNull()) {
+    if (!(*v).isInteger() || (*v).number < 0 || (*v).number > 255) return "bad_arm";
+    m.arm = (uint8_t)(*v).number;
+  }
+  v = o.get("deg");
+  if (!v || v->isNull()) return "missing_deg";
+  {
+    if (!v->isArray()) return "missing_deg";
+    m.deg_n = 0;
+    for (const json::Value &e : v->items) {
+      if (m.deg_n == SERVOS) break;
+      if (!e.isNumber()) return "missing_deg";
+      m.deg[m.deg_n++] = (float)e.number;
+    }
+    if (m.deg_n < 1) return "missing_deg";
+  }
+  v = o.get("ms");
+  if (v && !v->isNull()) {
+    if (!(*v).isInteger() || (*v).number < 0 || (*v).number > 4294967295.0) return "bad_ms";
+    m.ms = (uint32_t)(*v).number;
+  }
+  v = o.get("led");
+  if (v && !v->isNull()) {
+    if (!(*v).isInteger() || (*v).number < 0 || (*v).number > 255) return "bad_led";
+    m.led = (uint8_t)(*v).number;
+    m.has_led = true;
+  }
+  v = o.get("rgb");
+  if (v && !v->isNull()) {
+    if (!v->isObject()) return "bad_rgb";
+    const char *err = decodeJson(*v, m.rgb);
+    if (err) return err;
+    m.has_rgb = true;
+  }
+  return nullptr;
+}
+
+inline void encodeJsonFields(json::Writer &w, const FrameCmd &m) {
+  w.key("cmd").value("frame");
+  w.key("arm").value(m.arm);
+  w.key("deg").beginArray();
+  for (uint8_t i = 0; i < m.deg_n; i++) w.value(m.deg[i]);
+  w.endArray();
+  w.key("ms").value(m.ms);
+  if (m.has_led) {
+    w.key("led").value(m.led);
+  }
+  if (m.has_rgb) {
+    w.key("rgb").beginObject();
+    encodeJsonFields(w, m.rgb);
+    w.endObject();
+  }
+}
+
+inline std::string encodeJson(const FrameCmd &m) {
+  json::Writer w;
+  w.beginObject();
+  encodeJsonFields(w, m);
+  w.endObject();
+  return w.str();
+}
+
+inline const char *decodeJson(const json::Value &o, RtFrameCmd &m) {
+  const json::Value *v;
+  v = o.get("arm");
+  if (v && !v->isNull()) {
+    if (!(*v).isInteger() || (*v).number < 0 || (*v).number > 255) return "bad_arm";
+    m.arm = (uint8_t)(*v).number;
+  }
+  v = o.get("deg");
+  if (!v || v->isNull()) return "missing_deg";
+  {
+    if (!v->isArray()) return "missing_deg";
+    m.deg_n = 0;
+    for (const json::Value &e : v->items) {
+      if (m.deg_n == SERVOS) break;
+      if (!e.isNumber()) return "missing_deg";
+      m.deg[m.deg_n++] = (float)e.number;
+    }
+    if (m.deg_n < 1) return "missing_deg";
+  }
+  v = o.get("ms");
+  if (v && !v->isNull()) {
+    if (!(*v).isInteger() || (*v).number < 0 || (*v).number > 4294967295.0) return "bad_ms";
+    m.ms = (uint32_t)(*v).number;
+  }
+  v = o.get("led");
+  if (v && !v->isNull()) {
+    if (!(*v).isInteger() || (*v).number < 0 || (*v).number > 255) return "bad_led";
+    m.led = (uint8_t)(*v).number;
+    m.has_led = true;
+  }
+  v = o.get("rgb");
+  if (v && !v->isNull()) {
+    if (!v->isObject()) return "bad_rgb";
+    const char *err = decodeJson(*v, m.rgb);
+    if (err) return err;
+    m.has_rgb = true;
+  }
+  return nullptr;
+}
+
+inline void encodeJsonFields(json::Writer &w, const RtFrameCmd &m) {
+  w.key("cmd").value("rt_frame");
+  w.key("arm").value(m.arm);
+  w.key("deg").beginArray();
+  for (uint8_t i = 0; i < m.deg_n; i++) w.value(m.deg[i]);
+  w.endArray();
+  w.key("ms").value(m.ms);
+  if (m.has_led) {
+    w.key("led").value(m.led);
+  }
+  if (m.has_rgb) {
+    w.key("rgb").beginObject();
+    encodeJsonFields(w, m.rgb);
+    w.endObject();
+  }
+}
+
+inline std::string encodeJson(const RtFrameCmd &m) {
+  json::Writer w;
+  w.beginObject();
+  encodeJsonFields(w, m);
+  w.endObject();
+  return w.str();
+}
+
+inline const char *decodeJson(const json::Value &o, StatusCmd &m) {
+  const json::Value *v;
+  v = o.get("arm");
+  if (v && !v->isNull()) {
+    if (!(*v).isInteger() || (*v).number < 0 || (*v).number > 255) return "bad_arm";
+    m.arm = (uint8_t)(*v).number;
+  }
+  return nullptr;
+}
+
+inline void encodeJsonFields(json::Writer &w, const StatusCmd &m) {
+  w.key("cmd").value("status");
+  w.key("arm").value(m.arm);
+}
+
+inline std::string encodeJson(const StatusCmd &m) {
+  json::Writer w;
+  w.beginObject();
+  encodeJsonFields(w, m);
+  w.endObject();
+  return w.str();
+}
+
+inline const char *decodeJson(const json::Value &o, PongReply &m) {
+  (void)o;
+  (void)m;
+  return nullptr;
+}
+
+inline void encodeJsonFields(json::Writer &w, const PongReply &m) {
+  w.key("pong").value(true);
+  (void)m;
+}
+
+inline std::string encodeJson(const PongReply &m) {
+  json::Writer w;
+  w.beginObject();
+  encodeJsonFields(w, m);
+  w.endObject();
+  return w.str();
+}
+
+inline const char *decodeJson(const json::Value &o, AckReply &m) {
+  const json::Value *v;
+  v = o.get("ok");
+  if (!v || v->isNull()) return "missing_ok";
+  {
+    if (!(*v).isBool()) return "bad_ok";
+    m.ok = (*v).boolean;
+  }
+  v = o.get("err");
+  if (v && !v->isNull()) {
+    if (!v->isString() || v->string.size() > sizeof(m.err) - 1) return "bad_err";
+    memcpy(m.err, v->string.c_str(), v->string.size() + 1);
+    m.has_err = true;
+  }
+  return nullptr;
+}
+
+inline void encodeJsonFields(json::Writer &w, const AckReply &m) {
+  w.key("ok").value(m.ok);
+  if (m.has_err) {
+    w.key("err").value((const char *)m.err);
+  }
+}
+
+inline std::string encodeJson(const AckReply &m) {
+  json::Writer w;
+  w.beginObject();
+  encodeJsonFields(w, m);
+  w.endObject();
+  return w.str();
+}
+
+inline const char *decodeJson(const json::Value &o, StatusReply &m) {
+  const json::Value *v;
+  v = o.get("arm");
+  if (!v || v->isNull()) return "missing_arm";
+  {
+    if (!(*v).isInteger() || (*v).number < 0 || (*v).number > 255) return "bad_arm";
+    m.arm = (uint8_t)(*v).number;
+  }
+  v = o.get("moving");
+  if (!v || v->isNull()) return "missing_moving";
+  {
+    if (!(*v).isBool()) return "bad_moving";
+    m.moving = (*v).boolean;
+  }
+  v = o.get("angles");
+  if (!v || v->isNull()) return "missing_angles";
+  {
+    if (!v->isArray()) return "bad_angles";
+    m.angles_n = 0;
+    for (const json::Value &e : v->items) {
+      if (m.angles_n == SERVOS) break;
+      if (!e.isNumber()) return "bad_angles";
+      m.angles[m.angles_n++] = (float)e.number;
+    }
+  }
+  v = o.get("led");
+  if (!v || v->isNull()) return "missing_led";
+  {
+    if (!(*v).isInteger() || (*v).number < 0 || (*v).number > 255) return "bad_led";
+    m.led = (uint8_t)(*v).number;
+  }
+  v = o.get("rgb");
+  if (!v || v->isNull()) return "missing_rgb";
+  {
+    if (!v->isObject()) return "bad_rgb";
+    const char *err = decodeJson(*v, m.rgb);
+    if (err) return err;
+  }
+  v = o.get("trajectory_mode");
+  if (!v || v->isNull()) return "missing_trajectory_mode";
+  {
+    if (!(*v).isBool()) return "bad_trajectory_mode";
+    m.trajectory_mode = (*v).boolean;
+  }
+  v = o.get("trajectory_points");
+  if (!v || v->isNull()) return "missing_trajectory_points";
+  {
+    if (!(*v).isInteger() || (*v).number < 0 || (*v).number > 255) return "bad_trajectory_points";
+    m.trajectory_points = (uint8_t)(*v).number;
+  }
+  v = o.get("trajectory_index");
+  if (!v || v->isNull()) return "missing_trajectory_index";
+  {
+    if (!(*v).isInteger() || (*v).number < 0 || (*v).number > 255) return "bad_trajectory_index";
+    m.trajectory_index = (uint8_t)(*v).number;
+  }
+  v = o.get("stream_mode");
+  if (!v || v->isNull()) return "missing_stream_mode";
+  {
+    if (!(*v).isBool()) return "bad_stream_mode";
+    m.stream_mode = (*v).boolean;
+  }
+  v = o.get("stream_freq");
+  if (!v || v->isNull()) return "missing_stream_freq";
+  {
+    if (!(*v).isInteger() || (*v).number < 0 || (*v).number > 4294967295.0) return "bad_stream_freq";
+    m.stream_freq = (uint32_t)(*v).number;
+  }
+  v = o.get("est_deg");
+  if (!v || v->isNull()) return "missing_est_deg";
+  {
+    if (!v->isArray()) return "bad_est_deg";
+    m.est_deg_n = 0;
+    for (const json::Value &e : v->items) {
+      if (m.est_deg_n == SERVOS) break;
+      if (!e.isNumber()) return "bad_est_deg";
+      m.est_deg[m.est_deg_n++] = (float)e.number;
+    }
+  }
+  v = o.get("script");
+  if (v && !v->isNull()) {
+    if (!v->isString() || v->string.size() > sizeof(m.script) - 1) return "bad_script";
+    memcpy(m.script, v->string.c_str(), v->string.size() + 1);
+    m.has_script = true;
+  }
+  v = o.get("script_step");
+  if (v && !v->isNull()) {
+    if (!(*v).isInteger() || (*v).number < 0 || (*v).number > 255) return "bad_script_step";
+    m.script_step = (uint8_t)(*v).number;
+    m.has_script_step = true;
+  }
+  v = o.get("wifi");
+  if (!v || v->isNull()) return "missing_wifi";
+  {
+    if (!v->isObject()) return "bad_wifi";
+    const char *err = decodeJson(*v, m.wifi);
+    if (err) return err;
+  }
+  return nullptr;
+}
+
+inline void encodeJsonFields(json::Writer &w, const StatusReply &m) {
+  w.key("status").value(true);
+  w.key("arm").value(m.arm);
+  w.key("moving").value(m.moving);
+  w.key("angles").beginArray();
+  for (uint8_t i = 0; i < m.angles_n; i++) w.value(m.angles[i]);
+  w.endArray();
+  w.key("led").value(m.led);
+  w.key("rgb").beginObject();
+  encodeJsonFields(w, m.rgb);
+  w.endObject();
+  w.key("trajectory_mode").value(m.trajectory_mode);
+  w.key("trajectory_points").value(m.trajectory_points);
+  w.key("trajectory_index").value(m.trajectory_index);
+  w.key("stream_mode").value(m.stream_mode);
+  w.key("stream_freq").value(m.stream_freq);
+  w.key("est_deg").beginArray();
+  for (uint8_t i = 0; i < m.est_deg_n; i++) w.value(m.est_deg[i]);
+  w.endArray();
+  if (m.has_script) {
+    w.key("script").value((const char *)m.script);
+  }
+  if (m.has_script_step) {
+    w.key("script_step").value(m.script_step);
+  }
+  w.key("wifi").beginObject();
+  encodeJsonFields(w, m.wifi);
+  w.endObject();
+}
+
+inline std::string encodeJson(const StatusReply &m) {
+  json::Writer w;
+  w.beginObject();
+  encodeJsonFields(w, m);
+  w.endObject();
+  return w.str();
+}
+
+// Which reply a parsed JSON message is (0 = none of the schema's replies)
+inline uint8_t replyId(const json::Value &o) {
+  if (o.get("pong")) return REPLY_PONG;
+  if (o.get("status")) return REPLY_STATUS;
+  if (o.get("ok")) return REPLY_ACK;
+  return 0;
+}
+
+}  // namespace proto
+}  // namespace roboarm
@@ -0,0 +1,105 @@
+// Command throughput against the firmware or the emulator, using the C++ client:
+// one command at a time vs pipelined, JSON vs binary, then a paced rt_frame stream.
+//
+//   roboarm_bench [--host 127.0.0.1] [--port 81] [--count 2000] [--in-flight 8] [--hz 200]
+
+#include <roboarm/client.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Run {
+  double seconds = 0;
+  size_t failed = 0;
+  std::vector<double> rttUs;
+  roboarm::ClientStats stats;
+};
+
+Run runFrames(const std::string &host, uint16_t port, size_t count, size_t inFlight, bool binary) {
+  roboarm::ClientOptions opts;
+  opts.maxInFlight = inFlight;
+  opts.binary = binary;
+  roboarm::Client client(opts);
+  Run run;
+  client.onLatency([&run](const roboarm::LatencySample &s) {
+    run.rttUs.push_back(std::chrono::duration<double, std::micro>(s.rtt).count());
+  });
+  if (!client.connect(host, port).get()) {
+    fprintf(stderr, "cannot connect to ws://%s:%u\n", host.c_str(), port);
+    exit(1);
+  }
+
+  std::vector<std::future<roboarm::Reply>> replies;
+  replies.reserve(count);
+  roboarm::Clock::time_point start = roboarm::Clock::now();
+  for (size_t i = 0; i < count; i++) {
+    roboarm::proto::FrameCmd f;
+    f.deg_n = roboarm::proto::SERVOS;
+    f.deg[0] = (float)(i % 60) - 30.0f;
+    f.ms = 20;
+    replies.push_back(client.send(f));
+  }
+  for (auto &r : replies) run.failed += r.get().ok ? 0 : 1;
+  run.seconds = std::chrono::duration<double>(roboarm::Clock::now() - start).count();
+  run.stats = client.stats();
+  return run;
+}
+
+double percentile(std::vector<double> v, double q) {
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  return v[std::min(v.size() - 1, (size_t)(q * (double)v.size()))];
+}
+
+void report(const char *name, size_t count, const Run &r) {
+  printf("%-22s %8.0f cmd/s  rtt p50 %7.0f us  p99 %7.0f us  %5.2f cmd/write  %zu failed\n", name,
+         (double)count / r.seconds, percentile(r.rttUs, 0.5), percentile(r.rttUs, 0.99),
+         r.stats.writes ? (double)r.stats.commands / (double)r.stats.writes : 0.0, r.failed);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  std::string host = "127.0.0.1";
+  uint16_t port = 81;
+  size_t count = 2000;
+  size_t inFlight = 8;
+  double hz = 200;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--host")) host = argv[i + 1];
+    else if (!strcmp(argv[i], "--port")) port = (uint16_t)atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--count")) count = (size_t)atol(argv[i + 1]);
+    else if (!strcmp(argv[i], "--in-flight")) inFlight = (size_t)atol(argv[i + 1]);
+    else if (!strcmp(argv[i], "--hz")) hz = atof(argv[i + 1]);
+    else {
+      fprintf(stderr, "usage: %s [--host H] [--port P] [--count N] [--in-flight N] [--hz F]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  report("json, 1 in flight", count, runFrames(host, port, count, 1, false));
+  report("json, pipelined", count, runFrames(host, port, count, inFlight, false));
+  report("binary, 1 in flight", count, runFrames(host, port, count, 1, true));
+  report("binary, pipelined", count, runFrames(host, port, count, inFlight, true));
+
+  roboarm::Client client;
+  if (!client.connect(host, port).get()) return 1;
+  roboarm::StreamPacer pacer(client, hz);
+  uint64_t ticks = (uint64_t)(hz * 2);
+  roboarm::StreamPacer::Stats s = pacer.run([ticks](uint64_t tick, roboarm::proto::RtFrameCmd &f) {
+    f.deg_n = roboarm::proto::SERVOS;
+    f.deg[0] = 30.0f * (float)std::sin((double)tick * 0.05);
+    return tick < ticks;
+  });
+  client.drain();
+  printf("stream %.0f Hz: %llu frames, %llu skipped, max late %.0f us\n", hz, (unsigned long long)s.sent,
+         (unsigned long long)s.skipped, std::chrono::duration<double, std::micro>(s.maxLate).count());
+  return 0;
+}
@@ -0,0 +1,32 @@
+#pragma once
+// Parallel loop for the host libraries (header-only, C++17)
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace roboarm {
+
+// fn(i) for i in [0, count), spread over up to `threads` workers
+// (0 = hardware concurrency). The calling thread is one of them.
+template <typename Fn>
+void parallelFor(size_t count, int threads, const Fn &fn) {
+  if (threads <= 0) threads = (int)std::max(1u, std::thread::hardware_concurrency());
+  size_t workers = std::min(count, (size_t)threads);
+  if (workers <= 1) {
+    for (size_t i = 0; i < count; i++) fn(i);
+    return;
+  }
+  std::atomic<size_t> next{0};
+  auto work = [&] {
+    for (size_t i; (i = next.fetch_add(1)) < count;) fn(i);
+  };
+  std::vector<std::thread> pool;
+  for (size_t w = 1; w < workers; w++) pool.emplace_back(work);
+  work();
+  for (std::thread &t : pool) t.join();
+}
+
+}  // namespace roboarm
@@ -0,0 +1,33 @@
+// NeoPixel stand-in: show() writes the strip contents to the trace.
+#pragma once
+#include <Arduino.h>
+#include <vector>
+
+typedef uint16_t neoPixelType;
+#define NEO_GRB ((1 << 6) | (1 << 4) | (0 << 2) | (2))
+#define NEO_RGB ((0 << 6) | (0 << 4) | (1 << 2) | (2))
+#define NEO_KHZ800 0x0000
+
+class Adafruit_NeoPixel {
+ public:
+  Adafruit_NeoPixel(uint16_t n, int16_t pin = 6, neoPixelType type = NEO_GRB + NEO_KHZ800)
+      : pixels_(n, 0) { (void)pin; (void)type; }
+
+  void begin() {}
+  void show();
+  void clear() { std::fill(pixels_.begin(), pixels_.end(), 0); }
+  void setBrightness(uint8_t b) { brightness_ = b; }
+  uint8_t getBrightness() const { return brightness_; }
+  uint16_t numPixels() const { return (uint16_t)pixels_.size(); }
+
+  void setPixelColor(uint16_t n, uint32_t c) { if (n < pixels_.size()) pixels_[n] = c & 0xFFFFFF; }
+  void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) { setPixelColor(n, Color(r, g, b)); }
+  uint32_t getPixelColor(uint16_t n) const { return n < pixels_.size() ? pixels_[n] : 0; }
+  static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) {
+    return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+  }
+
+ private:
+  std::vector<uint32_t> pixels_;
+  uint8_t brightness_ = 255;
+};
@@ -0,0 +1,38 @@
+// PCA9685 driver stand-in: same register writes as the Adafruit driver, sent
+// over the emulated Wire bus (decoded and traced in hardware_host.cpp).
+#pragma once
+#include <Arduino.h>
+#include <Wire.h>
+
+class Adafruit_PWMServoDriver {
+ public:
+  Adafruit_PWMServoDriver(uint8_t addr = 0x40, TwoWire &i2c = Wire) : addr_(addr), i2c_(i2c) {}
+
+  bool begin(uint8_t prescale = 0);
+  void reset();
+  void sleep() {}
+  void wakeup() {}
+  void setOscillatorFrequency(uint32_t freq) { osc_ = freq; }
+  uint32_t getOscillatorFrequency() { return osc_; }
+  void setPWMFreq(float freq);
+  uint8_t readPrescale() { return prescale_; }
+
+  uint8_t setPWM(uint8_t num, uint16_t on, uint16_t off);
+  uint16_t getPWM(uint8_t num, bool off = false);
+  void setPin(uint8_t num, uint16_t val, bool invert = false) {
+    if (val > 4095) val = 4095;
+    setPWM(num, 0, invert ? 4095 - val : val);
+  }
+  void writeMicroseconds(uint8_t num, uint16_t us) {
+    double period_us = 1000000.0 * (prescale_ + 1) * 4096.0 / osc_;
+    setPWM(num, 0, (uint16_t)(us * 4096.0 / period_us));
+  }
+
+ private:
+  void write8(uint8_t reg, uint8_t value);
+
+  uint8_t addr_;
+  TwoWire &i2c_;
+  uint32_t osc_ = 25000000;
+  uint8_t prescale_ = 121;
+};
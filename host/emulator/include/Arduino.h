@@ -0,0 +1,148 @@
+// Minimal Arduino core stand-in for building the firmware on a Linux host.
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "host_emulator.h"
+
+using std::max;
+using std::min;
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+
+// ESP32 time base: 32-bit counters that wrap like on the device
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+inline void yield() {}
+
+// CPU clock (esp32-hal-cpu): recorded and traced as "cpu,0,<MHz>", host speed is unaffected
+bool setCpuFrequencyMhz(uint32_t mhz);
+uint32_t getCpuFrequencyMhz();
+
+// Heap figures (Esp.h); the host reports the free space of the malloc arena
+class EspClass {
+ public:
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  uint32_t getMaxAllocHeap() { return getFreeHeap(); }
+};
+extern EspClass ESP;
+
+class String {
+ public:
+  String() {}
+  String(const char *s) : s_(s ? s : "") {}
+  String(const std::string &s) : s_(s) {}
+  String(char c) : s_(1, c) {}
+  String(int v) : s_(std::to_string(v)) {}
+  String(unsigned v) : s_(std::to_string(v)) {}
+  String(long v) : s_(std::to_string(v)) {}
+  String(unsigned long v) : s_(std::to_string(v)) {}
+  String(float v, unsigned decimals = 2) { format(v, decimals); }
+  String(double v, unsigned decimals = 2) { format(v, decimals); }
+
+  const char *c_str() const { return s_.c_str(); }
+  unsigned int length() const { return (unsigned int)s_.size(); }
+  bool isEmpty() const { return s_.empty(); }
+  bool reserve(unsigned int size) { s_.reserve(size); return true; }
+
+  bool concat(const char *s) { if (s) s_ += s; return true; }
+  bool concat(const char *s, unsigned int n) { if (s) s_.append(s, n); return true; }
+  bool concat(char c) { s_ += c; return true; }
+  bool concat(const String &s) { s_ += s.s_; return true; }
+
+  String &operator=(const char *s) { s_ = s ? s : ""; return *this; }
+  String &operator+=(const char *s) { concat(s); return *this; }
+  String &operator+=(const String &s) { concat(s); return *this; }
+  String &operator+=(char c) { concat(c); return *this; }
+  bool operator==(const String &o) const { return s_ == o.s_; }
+  bool operator==(const char *o) const { return o && s_ == o; }
+  bool operator!=(const String &o) const { return s_ != o.s_; }
+  char operator[](unsigned int i) const { return i < s_.size() ? s_[i] : 0; }
+  char &operator[](unsigned int i) { return s_[i]; }
+
+ private:
+  void format(double v, unsigned decimals) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+    s_ = buf;
+  }
+  std::string s_;
+};
+
+inline String operator+(const String &a, const String &b) { String r(a); r += b; return r; }
+
+class IPAddress {
+ public:
+  IPAddress() : b_{0, 0, 0, 0} {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : b_{a, b, c, d} {}
+  uint8_t operator[](int i) const { return b_[i]; }
+  uint8_t &operator[](int i) { return b_[i]; }
+  String toString() const {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", b_[0], b_[1], b_[2], b_[3]);
+    return String(buf);
+  }
+
+ private:
+  uint8_t b_[4];
+};
+
+class HardwareSerial {
+ public:
+  void begin(unsigned long baud) { (void)baud; }
+  void setTimeout(unsigned long ms) { (void)ms; }
+  int available() { return 0; }
+  int read() { return -1; }
+  void flush() { fflush(stdout); }
+
+  int printf(const char *fmt, ...) __attribute__((format(printf, 2, 3))) {
+    if (!host::serialEnabled) return 0;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vprintf(fmt, ap);
+    va_end(ap);
+    if (n > 0) host::serialWait((size_t)n);
+    return n;
+  }
+
+  size_t print(const char *s) { return out(s); }
+  size_t print(const String &s) { return out(s.c_str()); }
+  size_t print(const IPAddress &ip) { return out(ip.toString().c_str()); }
+  size_t print(char c) { char b[2] = {c, 0}; return out(b); }
+  size_t print(int v) { return out(String(v).c_str()); }
+  size_t print(unsigned v) { return out(String(v).c_str()); }
+  size_t print(long v) { return out(String(v).c_str()); }
+  size_t print(unsigned long v) { return out(String(v).c_str()); }
+  size_t print(double v, int decimals = 2) { return out(String(v, decimals).c_str()); }
+
+  template <typename T>
+  size_t println(const T &v) { size_t n = print(v); return n + out("\n"); }
+  size_t println() { return out("\n"); }
+
+ private:
+  size_t out(const char *s) {
+    if (!host::serialEnabled) return 0;
+    if (fputs(s, stdout) < 0) return 0;
+    host::serialWait(strlen(s));
+    return strlen(s);
+  }
+};
+
+extern HardwareSerial Serial;
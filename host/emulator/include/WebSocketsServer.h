@@ -0,0 +1,83 @@
+// WebSocket server stand-in with the links2004/WebSockets API, backed by POSIX sockets.
+#pragma once
+#include <Arduino.h>
+#include <functional>
+
+#ifndef WEBSOCKETS_SERVER_CLIENT_MAX
+#define WEBSOCKETS_SERVER_CLIENT_MAX (5)
+#endif
+
+// Room a caller may reserve in front of a payload (headerToPayload = true)
+#define WEBSOCKETS_MAX_HEADER_SIZE (14)
+
+#ifndef WEBSOCKETS_MAX_DATA_SIZE
+#define WEBSOCKETS_MAX_DATA_SIZE (15 * 1024)
+#endif
+
+typedef enum {
+  WStype_ERROR,
+  WStype_DISCONNECTED,
+  WStype_CONNECTED,
+  WStype_TEXT,
+  WStype_BIN,
+  WStype_FRAGMENT_TEXT_START,
+  WStype_FRAGMENT_BIN_START,
+  WStype_FRAGMENT,
+  WStype_FRAGMENT_FIN,
+  WStype_PING,
+  WStype_PONG,
+} WStype_t;
+
+class WebSocketsServer {
+ public:
+  typedef std::function<void(uint8_t num, WStype_t type, uint8_t *payload, size_t length)>
+      WebSocketServerEvent;
+
+  WebSocketsServer(uint16_t port, const String &origin = "", const String &protocol = "arduino");
+  ~WebSocketsServer();
+
+  void begin();
+  void close();
+  void loop();
+  void onEvent(WebSocketServerEvent cbEvent) { cbEvent_ = cbEvent; }
+
+  // headerToPayload: payload starts with WEBSOCKETS_MAX_HEADER_SIZE spare bytes
+  bool sendTXT(uint8_t num, const uint8_t *payload, size_t length = 0, bool headerToPayload = false);
+  bool sendTXT(uint8_t num, const char *payload, size_t length = 0) {
+    return sendTXT(num, (const uint8_t *)payload, length);
+  }
+  bool sendTXT(uint8_t num, const String &payload) {
+    return sendTXT(num, (const uint8_t *)payload.c_str(), payload.length());
+  }
+  bool broadcastTXT(const uint8_t *payload, size_t length = 0, bool headerToPayload = false);
+  bool broadcastTXT(const char *payload, size_t length = 0) {
+    return broadcastTXT((const uint8_t *)payload, length);
+  }
+  bool broadcastTXT(const String &payload) {
+    return broadcastTXT((const uint8_t *)payload.c_str(), payload.length());
+  }
+  bool sendBIN(uint8_t num, const uint8_t *payload, size_t length, bool headerToPayload = false);
+  bool broadcastBIN(const uint8_t *payload, size_t length, bool headerToPayload = false);
+
+  void disconnect(uint8_t num);
+  void disconnect();
+  uint8_t connectedClients(bool ping = false);
+  bool clientIsConnected(uint8_t num);
+  IPAddress remoteIP(uint8_t num);
+
+ private:
+  struct Client;
+
+  void acceptClients();
+  bool serviceClient(uint8_t num);
+  bool handshake(uint8_t num);
+  bool parseFrames(uint8_t num);
+  bool sendFrame(uint8_t num, uint8_t opcode, const uint8_t *payload, size_t length);
+  bool flush(uint8_t num);
+  void dropClient(uint8_t num);
+
+  uint16_t port_;
+  int listenFd_ = -1;
+  Client *clients_;
+  WebSocketServerEvent cbEvent_;
+};
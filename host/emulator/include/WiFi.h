@@ -0,0 +1,53 @@
+// Soft AP stand-in: the emulator is reachable on the host's loopback/LAN instead.
+#pragma once
+#include <Arduino.h>
+
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3 } wifi_mode_t;
+
+// Event ids used by the firmware; the host has no radio, so no event ever fires
+typedef enum {
+  ARDUINO_EVENT_WIFI_AP_STACONNECTED,
+  ARDUINO_EVENT_WIFI_AP_STADISCONNECTED,
+  ARDUINO_EVENT_MAX
+} arduino_event_id_t;
+typedef void (*WiFiEventCb)(arduino_event_id_t event);
+typedef size_t wifi_event_id_t;
+
+class WiFiClass {
+ public:
+  bool mode(wifi_mode_t m) { mode_ = m; return true; }
+  bool disconnect(bool wifioff = false) { (void)wifioff; return true; }
+  bool softAPConfig(IPAddress local, IPAddress gateway, IPAddress subnet) {
+    (void)gateway; (void)subnet;
+    ip_ = local;
+    return true;
+  }
+  bool softAP(const char *ssid, const char *pass = nullptr, int channel = 1, int hidden = 0,
+              int maxConnection = 4) {
+    (void)ssid; (void)pass; (void)hidden; (void)maxConnection;
+    channel_ = (uint8_t)channel;
+    return true;
+  }
+  IPAddress softAPIP() { return ip_; }
+  wifi_event_id_t onEvent(WiFiEventCb cb, arduino_event_id_t event = ARDUINO_EVENT_MAX) {
+    (void)cb; (void)event;
+    return 0;
+  }
+  uint8_t apChannel() const { return channel_; }
+
+  // No radio on the host: scans find nothing
+  int16_t scanNetworks(bool async = false, bool showHidden = false) {
+    (void)async; (void)showHidden;
+    return 0;
+  }
+  void scanDelete() {}
+  int32_t channel(uint8_t i) { (void)i; return 0; }
+  int32_t RSSI(uint8_t i) { (void)i; return -100; }
+
+ private:
+  wifi_mode_t mode_ = WIFI_OFF;
+  IPAddress ip_;
+  uint8_t channel_ = 1;
+};
+
+extern WiFiClass WiFi;
@@ -0,0 +1,51 @@
+// I2C stand-in: writes are handed to host::i2cWrite(), which takes the bus time
+// at the set clock and decodes the devices on the emulated bus.
+#pragma once
+#include <Arduino.h>
+#include <host_emulator.h>
+
+class TwoWire {
+ public:
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0) {
+    (void)sda; (void)scl;
+    if (frequency) clock_ = frequency;
+    return true;
+  }
+  bool setClock(uint32_t frequency) { clock_ = frequency; return true; }
+  uint32_t getClock() { return clock_; }
+
+  void beginTransmission(uint8_t address) {
+    addr_ = address;
+    len_ = 0;
+  }
+  size_t write(uint8_t data) {
+    if (len_ >= BUFFER_LENGTH) return 0;
+    buf_[len_++] = data;
+    return 1;
+  }
+  size_t write(const uint8_t *data, size_t len) {
+    size_t n = 0;
+    while (n < len && write(data[n])) n++;
+    return n;
+  }
+  uint8_t endTransmission(bool sendStop = true) {
+    (void)sendStop;
+    return host::i2cWrite(addr_, buf_, len_) ? 0 : 2;  // 2 = NACK on address
+  }
+  size_t requestFrom(uint8_t address, size_t len, bool stop = true) {
+    (void)address; (void)stop;
+    return len;
+  }
+  int available() { return 0; }
+  int read() { return 0; }
+
+  static const size_t BUFFER_LENGTH = 128;  // same as the ESP32 core
+
+ private:
+  uint32_t clock_ = 100000;
+  uint8_t addr_ = 0;
+  uint8_t buf_[BUFFER_LENGTH];
+  size_t len_ = 0;
+};
+
+extern TwoWire Wire;
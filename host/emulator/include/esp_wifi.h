@@ -0,0 +1,26 @@
+// ESP-IDF WiFi API stand-in: every WebSocket client is reported as an associated station.
+#pragma once
+#include <cstdint>
+#include <esp_err.h>
+
+#define ESP_WIFI_MAX_CONN_NUM 10
+
+typedef enum { WIFI_SECOND_CHAN_NONE = 0, WIFI_SECOND_CHAN_ABOVE, WIFI_SECOND_CHAN_BELOW } wifi_second_chan_t;
+
+typedef struct {
+  uint8_t mac[6];
+  int8_t rssi;
+  uint32_t phy_11b : 1;
+  uint32_t phy_11g : 1;
+  uint32_t phy_11n : 1;
+  uint32_t phy_lr : 1;
+  uint32_t reserved : 28;
+} wifi_sta_info_t;
+
+typedef struct {
+  wifi_sta_info_t sta[ESP_WIFI_MAX_CONN_NUM];
+  int num;
+} wifi_sta_list_t;
+
+esp_err_t esp_wifi_get_channel(uint8_t *primary, wifi_second_chan_t *second);
+esp_err_t esp_wifi_ap_get_sta_list(wifi_sta_list_t *sta);
@@ -0,0 +1,17 @@
+// FreeRTOS stand-in: tasks are std::threads, queues and notifications use a
+// mutex and condition variable. Ticks are milliseconds (CONFIG_FREERTOS_HZ=1000).
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
@@ -0,0 +1,17 @@
+// FreeRTOS task stand-in. Priorities and core affinity are ignored; every task
+// is a detached thread that runs until the emulator exits.
+#pragma once
+#include <freertos/FreeRTOS.h>
+
+struct HostTask;
+typedef HostTask *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define tskNO_AFFINITY 0x7fffffff
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stackDepth, void *param,
+                                   UBaseType_t priority, TaskHandle_t *created, BaseType_t core);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t wait);
+void vTaskDelay(TickType_t ticks);
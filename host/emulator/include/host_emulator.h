@@ -0,0 +1,33 @@
+// Host-side knobs shared by the hardware stand-ins of the firmware emulator.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+namespace host {
+
+// Set from the command line before setup() runs
+extern uint16_t wsPort;        // 0 = use the port the firmware asks for
+extern const char *bindAddr;   // listen address for the WebSocket server
+extern bool serialEnabled;     // echo Serial output to stdout
+extern FILE *trace;            // output trace (CSV), nullptr = disabled
+extern uint32_t i2cMaxHz;      // emulated wiring limit: faster transactions are NACKed
+extern uint32_t serialBaud;    // >0: Serial output blocks for its UART time, like the ESP32 TX
+
+// Output trace: one CSV row per hardware write
+// t_us,device,channel,value
+void traceEvent(const char *device, int channel, uint32_t value);
+
+// One I2C write transaction (address, then data bytes). PCA9685 boards
+// (0x40..0x6f) are decoded and their output changes traced as "pcaXX";
+// every transaction is traced as "i2c" with the address and byte count.
+// Returns false if no device answers at the address.
+bool i2cWrite(uint8_t address, const uint8_t *data, size_t len);
+
+// Blocks for the time n bytes take on the UART at serialBaud (8N1)
+void serialWait(size_t n);
+
+// Number of WebSocket clients with a completed handshake
+uint8_t connectedClients();
+
+}  // namespace host
@@ -0,0 +1,80 @@
+// Arduino core stand-ins: clock, Serial and the emulator's global knobs.
+#include <Arduino.h>
+#include <malloc.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+HardwareSerial Serial;
+
+namespace host {
+
+uint16_t wsPort = 0;
+const char *bindAddr = "127.0.0.1";
+bool serialEnabled = true;
+FILE *trace = nullptr;
+uint32_t i2cMaxHz = 1000000;
+uint32_t serialBaud = 0;
+
+void traceEvent(const char *device, int channel, uint32_t value) {
+  if (!trace) return;
+  fprintf(trace, "%u,%s,%d,%u\n", (unsigned)micros(), device, channel, (unsigned)value);
+}
+
+void serialWait(size_t n) {
+  if (serialBaud) delayMicroseconds((uint32_t)((uint64_t)n * 10 * 1000000 / serialBaud));
+}
+
+}  // namespace host
+
+namespace {
+uint64_t elapsedUs() {
+  static const std::chrono::steady_clock::time_point bootTime = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - bootTime)
+      .count();
+}
+}  // namespace
+
+uint32_t millis() { return (uint32_t)(elapsedUs() / 1000); }
+uint32_t micros() { return (uint32_t)elapsedUs(); }
+
+namespace {
+uint32_t cpuMhz = 240;
+}
+
+bool setCpuFrequencyMhz(uint32_t mhz) {
+  if (mhz != 240 && mhz != 160 && mhz != 80) return false;  // PLL clocks usable with WiFi
+  if (mhz != cpuMhz) host::traceEvent("cpu", 0, mhz);
+  cpuMhz = mhz;
+  return true;
+}
+
+uint32_t getCpuFrequencyMhz() { return cpuMhz; }
+
+EspClass ESP;
+
+namespace {
+uint32_t minFreeHeap = UINT32_MAX;
+}
+
+uint32_t EspClass::getFreeHeap() {
+  uint32_t free = (uint32_t)mallinfo2().fordblks;
+  minFreeHeap = std::min(minFreeHeap, free);
+  return free;
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+  getFreeHeap();
+  return minFreeHeap;
+}
+
+void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+void delayMicroseconds(uint32_t us) {
+  // Busy-wait like the ESP32 core does, sleeping is too coarse for short delays
+  uint64_t until = elapsedUs() + us;
+  while (elapsedUs() < until) {
+  }
+}
@@ -0,0 +1,77 @@
+// Entry point of the firmware emulator: runs setup()/loop() from roboarm/src/main.cpp
+// against the hardware stand-ins, with the WebSocket server on a local port.
+#include <Arduino.h>
+
+#include <csignal>
+#include <thread>
+
+void setup();
+void loop();
+
+namespace {
+
+volatile std::sig_atomic_t stopRequested = 0;
+
+void onSignal(int) { stopRequested = 1; }
+
+void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [--port N] [--bind ADDR] [--trace FILE] [--quiet] [--idle-us N] [--i2c-max-hz N]\n"
+          "          [--serial-baud N]\n"
+          "  --port N      WebSocket port (default 8081)\n"
+          "  --bind ADDR   listen address (default 127.0.0.1)\n"
+          "  --trace FILE  write PCA9685/NeoPixel outputs as CSV (t_us,device,channel,value)\n"
+          "  --quiet       do not echo Serial output\n"
+          "  --idle-us N   sleep between loop() iterations (default 100, 0 = spin like the ESP32)\n"
+          "  --i2c-max-hz N  fail I2C transactions above this clock (default 1000000)\n"
+          "  --serial-baud N Serial output blocks for its UART time at N baud (default 0 = off)\n",
+          argv0);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  host::wsPort = 8081;
+  uint32_t idleUs = 100;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--port" && hasValue) {
+      host::wsPort = (uint16_t)atoi(argv[++i]);
+    } else if (arg == "--bind" && hasValue) {
+      host::bindAddr = argv[++i];
+    } else if (arg == "--trace" && hasValue) {
+      host::trace = fopen(argv[++i], "w");
+      if (!host::trace) {
+        perror("trace");
+        return 1;
+      }
+      fputs("t_us,device,channel,value\n", host::trace);
+    } else if (arg == "--quiet") {
+      host::serialEnabled = false;
+    } else if (arg == "--idle-us" && hasValue) {
+      idleUs = (uint32_t)atoi(argv[++i]);
+    } else if (arg == "--i2c-max-hz" && hasValue) {
+      host::i2cMaxHz = (uint32_t)atol(argv[++i]);
+    } else if (arg == "--serial-baud" && hasValue) {
+      host::serialBaud = (uint32_t)atol(argv[++i]);
+    } else {
+      usage(argv[0]);
+      return arg == "--help" || arg == "-h" ? 0 : 2;
+    }
+  }
+
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  setup();
+  while (!stopRequested) {
+    loop();
+    if (idleUs) std::this_thread::sleep_for(std::chrono::microseconds(idleUs));
+  }
+
+  if (host::trace) fclose(host::trace);
+  return 0;
+}
@@ -0,0 +1,113 @@
+// FreeRTOS stand-ins on std::thread: queues, tasks and direct-to-task notifications.
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Ring of length items, allocated once like a FreeRTOS queue's storage
+struct HostQueue {
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::vector<uint8_t> storage;
+  size_t head = 0;
+  size_t count = 0;
+  size_t length;
+  size_t itemSize;
+};
+
+struct HostTask {
+  std::mutex mutex;
+  std::condition_variable notified;
+  uint32_t notifications = 0;
+};
+
+namespace {
+
+// Every thread (the emulator main thread included) gets its task record on first use
+thread_local HostTask *currentTask = nullptr;
+
+template <typename Pred>
+bool waitFor(std::condition_variable &cv, std::unique_lock<std::mutex> &lock, TickType_t wait, Pred pred) {
+  if (wait == portMAX_DELAY) {
+    cv.wait(lock, pred);
+    return true;
+  }
+  return cv.wait_for(lock, std::chrono::milliseconds(wait), pred);
+}
+
+}  // namespace
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  HostQueue *q = new HostQueue();
+  q->length = length;
+  q->itemSize = itemSize;
+  q->storage.resize(length * itemSize);
+  return q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait) {
+  std::unique_lock<std::mutex> lock(q->mutex);
+  if (!waitFor(q->changed, lock, wait, [q] { return q->count < q->length; })) return pdFALSE;
+  size_t tail = (q->head + q->count) % q->length;
+  memcpy(&q->storage[tail * q->itemSize], item, q->itemSize);
+  q->count++;
+  q->changed.notify_all();
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait) {
+  std::unique_lock<std::mutex> lock(q->mutex);
+  if (!waitFor(q->changed, lock, wait, [q] { return q->count > 0; })) return pdFALSE;
+  memcpy(item, &q->storage[q->head * q->itemSize], q->itemSize);
+  q->head = (q->head + 1) % q->length;
+  q->count--;
+  q->changed.notify_all();
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+  std::lock_guard<std::mutex> lock(q->mutex);
+  return (UBaseType_t)q->count;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stackDepth, void *param,
+                                   UBaseType_t priority, TaskHandle_t *created, BaseType_t core) {
+  (void)name; (void)stackDepth; (void)priority; (void)core;
+  HostTask *task = new HostTask();
+  std::thread([fn, param, task] {
+    currentTask = task;
+    fn(param);
+  }).detach();
+  if (created) *created = task;
+  return pdPASS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  if (!currentTask) currentTask = new HostTask();
+  return currentTask;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  std::lock_guard<std::mutex> lock(task->mutex);
+  task->notifications++;
+  task->notified.notify_all();
+  return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t wait) {
+  HostTask *task = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> lock(task->mutex);
+  if (wait) waitFor(task->notified, lock, wait, [task] { return task->notifications > 0; });
+  uint32_t value = task->notifications;
+  if (value) task->notifications = clearOnExit ? 0 : value - 1;
+  return value;
+}
+
+void vTaskDelay(TickType_t ticks) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
@@ -0,0 +1,233 @@
+// Peripheral stand-ins: PCA9685 (decoded from the I2C bus), NeoPixel and the soft AP.
+#include <Adafruit_NeoPixel.h>
+#include <Adafruit_PWMServoDriver.h>
+#include <WiFi.h>
+#include <Wire.h>
+#include <driver/i2c.h>
+#include <esp_wifi.h>
+
+#include <chrono>
+#include <mutex>
+#include <new>
+#include <thread>
+
+TwoWire Wire;
+WiFiClass WiFi;
+
+namespace {
+
+// PCA9685 registers used by the firmware
+const uint8_t PCA_MODE1 = 0x00;
+const uint8_t PCA_LED0_ON_L = 0x06;
+const uint8_t PCA_LED15_OFF_H = 0x45;
+const uint8_t PCA_PRESCALE = 0xFE;
+const uint8_t MODE1_AI = 0x20;
+const uint8_t MODE1_SLEEP = 0x10;
+const uint8_t MODE1_RESTART = 0x80;
+
+struct Pca9685 {
+  uint8_t reg[256];
+};
+
+// Boards answer at 0x40..0x6f (0x70 is the all-call address)
+Pca9685 boards[0x30];
+bool boardsReset = false;
+std::mutex busMutex;  // one transaction on the bus at a time (Wire and the driver share it)
+
+Pca9685 *board(uint8_t address) {
+  if (address < 0x40 || address >= 0x70) return nullptr;
+  if (!boardsReset) {
+    for (Pca9685 &b : boards) {
+      memset(b.reg, 0, sizeof(b.reg));
+      b.reg[PCA_MODE1] = MODE1_SLEEP;
+      b.reg[PCA_PRESCALE] = 0x1E;
+    }
+    boardsReset = true;
+  }
+  return &boards[address - 0x40];
+}
+
+uint16_t ledValue(const Pca9685 &b, uint8_t ch, bool off) {
+  uint8_t base = PCA_LED0_ON_L + 4 * ch + (off ? 2 : 0);
+  uint16_t v = b.reg[base] | ((b.reg[base + 1] & 0x1F) << 8);
+  return v;
+}
+
+}  // namespace
+
+namespace host {
+
+bool i2cWrite(uint8_t address, const uint8_t *data, size_t len) {
+  std::lock_guard<std::mutex> lock(busMutex);
+  // Bus time at the Wire clock: start + address + data, 9 bits per byte
+  uint32_t clock = Wire.getClock() ? Wire.getClock() : 100000;
+  std::this_thread::sleep_for(std::chrono::microseconds((len + 1) * 9 * 1000000ULL / clock));
+
+  traceEvent("i2c", address, (uint32_t)len);
+  if (clock > i2cMaxHz) return false;  // edges too fast for the emulated wiring
+  Pca9685 *b = board(address);
+  if (!b) return false;
+  if (len == 0) return true;
+
+  char dev[16];
+  snprintf(dev, sizeof(dev), "pca%02x", address);
+  uint8_t ptr = data[0];
+  for (size_t i = 1; i < len; i++) {
+    b->reg[ptr] = data[i];
+    if (ptr == PCA_PRESCALE) {
+      snprintf(dev, sizeof(dev), "pca%02x_pre", address);
+      traceEvent(dev, -1, data[i]);
+      snprintf(dev, sizeof(dev), "pca%02x", address);
+    } else if (ptr >= PCA_LED0_ON_L && ptr <= PCA_LED15_OFF_H && (ptr - PCA_LED0_ON_L) % 4 == 3) {
+      // OFF_H completes a channel; bit 4 = full off
+      uint8_t ch = (ptr - PCA_LED0_ON_L) / 4;
+      uint16_t off = ledValue(*b, ch, true);
+      traceEvent(dev, ch, (off & 0x1000) ? 0 : off);
+    }
+    if (b->reg[PCA_MODE1] & MODE1_AI) ptr++;  // wraps at 0xff like the chip
+  }
+  return true;
+}
+
+}  // namespace host
+
+// Legacy ESP-IDF I2C driver: a command link is recorded into the caller's buffer
+namespace {
+
+struct HostI2cCmd {
+  bool started;
+  bool haveAddress;
+  uint8_t address;
+  size_t len;
+  uint8_t data[256];
+};
+static_assert(sizeof(HostI2cCmd) <= I2C_LINK_RECOMMENDED_SIZE(1), "command link buffer too small");
+
+}  // namespace
+
+i2c_cmd_handle_t i2c_cmd_link_create_static(uint8_t *buffer, uint32_t size) {
+  if (!buffer || size < sizeof(HostI2cCmd)) return nullptr;
+  return new (buffer) HostI2cCmd();
+}
+
+void i2c_cmd_link_delete_static(i2c_cmd_handle_t cmd) {
+  (void)cmd;
+}
+
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd) {
+  HostI2cCmd *c = static_cast<HostI2cCmd *>(cmd);
+  c->started = true;
+  c->haveAddress = false;
+  c->len = 0;
+  return ESP_OK;
+}
+
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd, uint8_t data, bool ackEn) {
+  return i2c_master_write(cmd, &data, 1, ackEn);
+}
+
+esp_err_t i2c_master_write(i2c_cmd_handle_t cmd, const uint8_t *data, size_t len, bool ackEn) {
+  (void)ackEn;
+  HostI2cCmd *c = static_cast<HostI2cCmd *>(cmd);
+  if (!c->started) return ESP_ERR_INVALID_STATE;
+  for (size_t i = 0; i < len; i++) {
+    if (!c->haveAddress) {
+      c->address = data[i] >> 1;  // address byte, R/W bit 0 = write
+      c->haveAddress = true;
+    } else if (c->len < sizeof(c->data)) {
+      c->data[c->len++] = data[i];
+    } else {
+      return ESP_ERR_INVALID_ARG;
+    }
+  }
+  return ESP_OK;
+}
+
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd) {
+  (void)cmd;
+  return ESP_OK;
+}
+
+esp_err_t i2c_master_cmd_begin(i2c_port_t port, i2c_cmd_handle_t cmd, TickType_t wait) {
+  (void)port; (void)wait;
+  HostI2cCmd *c = static_cast<HostI2cCmd *>(cmd);
+  if (!c->haveAddress) return ESP_ERR_INVALID_STATE;
+  return host::i2cWrite(c->address, c->data, c->len) ? ESP_OK : ESP_FAIL;
+}
+
+void Adafruit_PWMServoDriver::write8(uint8_t reg, uint8_t value) {
+  i2c_.beginTransmission(addr_);
+  i2c_.write(reg);
+  i2c_.write(value);
+  i2c_.endTransmission();
+}
+
+bool Adafruit_PWMServoDriver::begin(uint8_t prescale) {
+  reset();
+  if (prescale) {
+    write8(PCA_MODE1, MODE1_SLEEP);
+    write8(PCA_PRESCALE, prescale);
+    write8(PCA_MODE1, MODE1_RESTART | MODE1_AI);
+    prescale_ = prescale;
+  } else {
+    setPWMFreq(1000);  // the Adafruit driver starts at 1 kHz
+  }
+  return true;
+}
+
+void Adafruit_PWMServoDriver::reset() {
+  write8(PCA_MODE1, MODE1_RESTART);
+}
+
+void Adafruit_PWMServoDriver::setPWMFreq(float freq) {
+  // Same prescale computation and register sequence as the Adafruit driver
+  if (freq < 1) freq = 1;
+  if (freq > 3500) freq = 3500;
+  float prescaleval = ((osc_ / (freq * 4096.0f)) + 0.5f) - 1;
+  if (prescaleval < 3) prescaleval = 3;
+  if (prescaleval > 255) prescaleval = 255;
+  prescale_ = (uint8_t)prescaleval;
+
+  write8(PCA_MODE1, MODE1_SLEEP);
+  write8(PCA_PRESCALE, prescale_);
+  write8(PCA_MODE1, MODE1_RESTART | MODE1_AI);
+}
+
+uint8_t Adafruit_PWMServoDriver::setPWM(uint8_t num, uint16_t on, uint16_t off) {
+  uint8_t buf[5] = {(uint8_t)(PCA_LED0_ON_L + 4 * (num & 15)), (uint8_t)on, (uint8_t)(on >> 8),
+                    (uint8_t)off, (uint8_t)(off >> 8)};
+  i2c_.beginTransmission(addr_);
+  i2c_.write(buf, sizeof(buf));
+  return i2c_.endTransmission();
+}
+
+uint16_t Adafruit_PWMServoDriver::getPWM(uint8_t num, bool off) {
+  Pca9685 *b = board(addr_);
+  return b ? ledValue(*b, num & 15, off) : 0;
+}
+
+void Adafruit_NeoPixel::show() {
+  for (uint16_t i = 0; i < pixels_.size(); i++) {
+    host::traceEvent("rgb", i, pixels_[i]);
+  }
+}
+
+esp_err_t esp_wifi_get_channel(uint8_t *primary, wifi_second_chan_t *second) {
+  if (primary) *primary = WiFi.apChannel();
+  if (second) *second = WIFI_SECOND_CHAN_NONE;
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_ap_get_sta_list(wifi_sta_list_t *sta) {
+  if (!sta) return ESP_FAIL;
+  memset(sta, 0, sizeof(*sta));
+  sta->num = min<int>(host::connectedClients(), ESP_WIFI_MAX_CONN_NUM);
+  for (int i = 0; i < sta->num; i++) {
+    // Locally administered placeholder MACs, loopback has a perfect link
+    uint8_t mac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, (uint8_t)i};
+    memcpy(sta->sta[i].mac, mac, 6);
+    sta->sta[i].rssi = -30;
+    sta->sta[i].phy_11n = 1;
+  }
+  return ESP_OK;
+}
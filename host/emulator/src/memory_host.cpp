@@ -0,0 +1,17 @@
+// Static memory mode (ROBOARM_STATIC_MEMORY): libstdc++ is a shared library
+// here, so its operator new would reach malloc past the firmware's
+// --wrap=malloc hooks. These replacements allocate from this object instead.
+#include <cstdlib>
+#include <new>
+
+void *operator new(size_t n) {
+  void *p = malloc(n ? n : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void *operator new[](size_t n) { return operator new(n); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
@@ -0,0 +1,436 @@
+// RFC 6455 WebSocket server over non-blocking POSIX sockets, polled from loop()
+// exactly like the links2004 library is on the ESP32.
+#include <WebSocketsServer.h>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+
+namespace {
+
+uint8_t openClients = 0;
+
+// ---- SHA-1 / Base64 for the handshake ----
+struct Sha1 {
+  uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+  static uint32_t rol(uint32_t v, int n) { return (v << n) | (v >> (32 - n)); }
+
+  void block(const uint8_t *p) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+      w[i] = ((uint32_t)p[4 * i] << 24) | ((uint32_t)p[4 * i + 1] << 16) |
+             ((uint32_t)p[4 * i + 2] << 8) | p[4 * i + 3];
+    }
+    for (int i = 16; i < 80; i++) w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++) {
+      uint32_t f, k;
+      if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+      else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+      else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+      else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+      uint32_t t = rol(a, 5) + f + e + k + w[i];
+      e = d; d = c; c = rol(b, 30); b = a; a = t;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+  }
+
+  void digest(const std::string &msg, uint8_t out[20]) {
+    std::string m = msg;
+    uint64_t bits = (uint64_t)msg.size() * 8;
+    m += (char)0x80;
+    while (m.size() % 64 != 56) m += (char)0;
+    for (int i = 7; i >= 0; i--) m += (char)(bits >> (8 * i));
+    for (size_t i = 0; i < m.size(); i += 64) block((const uint8_t *)m.data() + i);
+    for (int i = 0; i < 5; i++) {
+      out[4 * i] = h[i] >> 24; out[4 * i + 1] = h[i] >> 16;
+      out[4 * i + 2] = h[i] >> 8; out[4 * i + 3] = h[i];
+    }
+  }
+};
+
+std::string base64(const uint8_t *data, size_t len) {
+  static const char tbl[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  for (size_t i = 0; i < len; i += 3) {
+    uint32_t v = (uint32_t)data[i] << 16;
+    if (i + 1 < len) v |= (uint32_t)data[i + 1] << 8;
+    if (i + 2 < len) v |= data[i + 2];
+    out += tbl[(v >> 18) & 63];
+    out += tbl[(v >> 12) & 63];
+    out += (i + 1 < len) ? tbl[(v >> 6) & 63] : '=';
+    out += (i + 2 < len) ? tbl[v & 63] : '=';
+  }
+  return out;
+}
+
+std::string headerValue(const std::string &req, const char *name) {
+  size_t nameLen = strlen(name);
+  size_t pos = 0;
+  while ((pos = req.find("\r\n", pos)) != std::string::npos) {
+    pos += 2;
+    if (req.size() - pos > nameLen && strncasecmp(req.c_str() + pos, name, nameLen) == 0 &&
+        req[pos + nameLen] == ':') {
+      size_t start = req.find_first_not_of(' ', pos + nameLen + 1);
+      size_t end = req.find("\r\n", pos);
+      if (start == std::string::npos || end == std::string::npos || start > end) return "";
+      return req.substr(start, end - start);
+    }
+  }
+  return "";
+}
+
+}  // namespace
+
+uint8_t host::connectedClients() { return openClients; }
+
+struct WebSocketsServer::Client {
+  int fd = -1;
+  bool open = false;
+  IPAddress ip;
+  std::string rx;
+  std::string tx;
+  std::string message;      // reassembled fragmented message
+  uint8_t messageOpcode = 0;
+};
+
+WebSocketsServer::WebSocketsServer(uint16_t port, const String &origin, const String &protocol)
+    : port_(port), clients_(new Client[WEBSOCKETS_SERVER_CLIENT_MAX]) {
+  (void)origin;
+  (void)protocol;
+}
+
+WebSocketsServer::~WebSocketsServer() {
+  close();
+  delete[] clients_;
+}
+
+void WebSocketsServer::begin() {
+  uint16_t port = host::wsPort ? host::wsPort : port_;
+  listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (listenFd_ < 0) {
+    perror("socket");
+    exit(1);
+  }
+  int one = 1;
+  setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  if (inet_pton(AF_INET, host::bindAddr, &addr.sin_addr) != 1) {
+    fprintf(stderr, "bad bind address: %s\n", host::bindAddr);
+    exit(1);
+  }
+  if (bind(listenFd_, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(listenFd_, 4) < 0) {
+    fprintf(stderr, "cannot listen on %s:%u: %s\n", host::bindAddr, port, strerror(errno));
+    exit(1);
+  }
+  fcntl(listenFd_, F_SETFL, fcntl(listenFd_, F_GETFL) | O_NONBLOCK);
+  fprintf(stderr, "[emulator] WebSocket server on ws://%s:%u\n", host::bindAddr, port);
+}
+
+void WebSocketsServer::close() {
+  disconnect();
+  if (listenFd_ >= 0) ::close(listenFd_);
+  listenFd_ = -1;
+}
+
+void WebSocketsServer::loop() {
+  if (listenFd_ < 0) return;
+  acceptClients();
+  for (uint8_t i = 0; i < WEBSOCKETS_SERVER_CLIENT_MAX; i++) {
+    if (clients_[i].fd >= 0 && !serviceClient(i)) dropClient(i);
+  }
+}
+
+void WebSocketsServer::acceptClients() {
+  for (;;) {
+    sockaddr_in addr = {};
+    socklen_t len = sizeof(addr);
+    int fd = accept(listenFd_, (sockaddr *)&addr, &len);
+    if (fd < 0) return;
+
+    uint8_t slot = WEBSOCKETS_SERVER_CLIENT_MAX;
+    for (uint8_t i = 0; i < WEBSOCKETS_SERVER_CLIENT_MAX; i++) {
+      if (clients_[i].fd < 0) {
+        slot = i;
+        break;
+      }
+    }
+    if (slot == WEBSOCKETS_SERVER_CLIENT_MAX) {
+      // Same behaviour as the library: no free slot, refuse the connection
+      static const char busy[] = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n";
+      send(fd, busy, sizeof(busy) - 1, MSG_NOSIGNAL);
+      ::close(fd);
+      continue;
+    }
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    Client &c = clients_[slot];
+    c = Client();
+    c.fd = fd;
+    uint32_t ip = ntohl(addr.sin_addr.s_addr);
+    c.ip = IPAddress(ip >> 24, ip >> 16, ip >> 8, ip);
+  }
+}
+
+bool WebSocketsServer::serviceClient(uint8_t num) {
+  Client &c = clients_[num];
+  char buf[4096];
+  for (;;) {
+    ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+    if (n > 0) {
+      c.rx.append(buf, n);
+      continue;
+    }
+    if (n == 0) return false;
+    if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+    if (errno == EINTR) continue;
+    return false;
+  }
+
+  if (!c.open && !handshake(num)) return false;
+  if (c.open && !parseFrames(num)) return false;
+  return c.fd >= 0 && flush(num);
+}
+
+bool WebSocketsServer::handshake(uint8_t num) {
+  Client &c = clients_[num];
+  size_t end = c.rx.find("\r\n\r\n");
+  if (end == std::string::npos) return c.rx.size() < 4096;
+
+  std::string req = c.rx.substr(0, end + 2);
+  c.rx.erase(0, end + 4);
+
+  std::string key = headerValue(req, "Sec-WebSocket-Key");
+  if (key.empty()) {
+    c.tx += "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n";
+    flush(num);
+    return false;
+  }
+
+  uint8_t digest[20];
+  Sha1().digest(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11", digest);
+  c.tx += "HTTP/1.1 101 Switching Protocols\r\n"
+          "Upgrade: websocket\r\n"
+          "Connection: Upgrade\r\n"
+          "Sec-WebSocket-Accept: " + base64(digest, sizeof(digest)) + "\r\n\r\n";
+  if (!flush(num)) return false;
+
+  c.open = true;
+  openClients++;
+
+  // The library reports the request path as the CONNECTED payload
+  size_t pathStart = req.find(' ');
+  size_t pathEnd = req.find(' ', pathStart + 1);
+  std::string path = (pathStart != std::string::npos && pathEnd != std::string::npos)
+                         ? req.substr(pathStart + 1, pathEnd - pathStart - 1)
+                         : "/";
+  if (cbEvent_) cbEvent_(num, WStype_CONNECTED, (uint8_t *)&path[0], path.size());
+  return true;
+}
+
+bool WebSocketsServer::parseFrames(uint8_t num) {
+  Client &c = clients_[num];
+  while (c.fd >= 0 && c.open) {
+    const uint8_t *p = (const uint8_t *)c.rx.data();
+    size_t avail = c.rx.size();
+    if (avail < 2) return true;
+
+    bool fin = p[0] & 0x80;
+    uint8_t opcode = p[0] & 0x0F;
+    bool masked = p[1] & 0x80;
+    uint64_t len = p[1] & 0x7F;
+    size_t hdr = 2;
+    if (len == 126) {
+      if (avail < 4) return true;
+      len = ((uint64_t)p[2] << 8) | p[3];
+      hdr = 4;
+    } else if (len == 127) {
+      if (avail < 10) return true;
+      len = 0;
+      for (int i = 0; i < 8; i++) len = (len << 8) | p[2 + i];
+      hdr = 10;
+    }
+    if (!masked || len > WEBSOCKETS_MAX_DATA_SIZE) return false;  // clients must mask
+    if (avail < hdr + 4 + len) return true;
+
+    const uint8_t *mask = p + hdr;
+    std::string payload((const char *)p + hdr + 4, (size_t)len);
+    for (size_t i = 0; i < payload.size(); i++) payload[i] ^= mask[i & 3];
+    c.rx.erase(0, hdr + 4 + len);
+
+    auto deliver = [&](uint8_t op, std::string &msg) {
+      // msg keeps its trailing NUL, text handlers rely on it
+      if (cbEvent_) cbEvent_(num, op == 0x1 ? WStype_TEXT : WStype_BIN, (uint8_t *)&msg[0], msg.size());
+    };
+
+    switch (opcode) {
+      case 0x0:  // continuation of a fragmented message
+        if (!c.messageOpcode) return false;
+        c.message += payload;
+        if (c.message.size() > WEBSOCKETS_MAX_DATA_SIZE) return false;
+        if (fin) {
+          std::string msg;
+          msg.swap(c.message);
+          uint8_t op = c.messageOpcode;
+          c.messageOpcode = 0;
+          deliver(op, msg);
+        }
+        break;
+      case 0x1:
+      case 0x2:
+        if (c.messageOpcode) return false;  // new message inside a fragmented one
+        if (!fin) {
+          c.messageOpcode = opcode;
+          c.message = payload;
+          break;
+        }
+        deliver(opcode, payload);
+        break;
+      case 0x8:  // close: echo and drop
+        sendFrame(num, 0x8, (const uint8_t *)payload.data(), payload.size() >= 2 ? 2 : 0);
+        flush(num);
+        return false;
+      case 0x9:  // ping
+        sendFrame(num, 0xA, (const uint8_t *)payload.data(), payload.size());
+        if (cbEvent_) cbEvent_(num, WStype_PING, (uint8_t *)&payload[0], payload.size());
+        break;
+      case 0xA:
+        if (cbEvent_) cbEvent_(num, WStype_PONG, (uint8_t *)&payload[0], payload.size());
+        break;
+      default:
+        return false;
+    }
+  }
+  return true;
+}
+
+bool WebSocketsServer::sendFrame(uint8_t num, uint8_t opcode, const uint8_t *payload,
+                                 size_t length) {
+  if (num >= WEBSOCKETS_SERVER_CLIENT_MAX) return false;
+  Client &c = clients_[num];
+  if (c.fd < 0 || !c.open) return false;
+
+  uint8_t hdr[10];
+  size_t hdrLen = 2;
+  hdr[0] = 0x80 | opcode;
+  if (length < 126) {
+    hdr[1] = (uint8_t)length;
+  } else if (length <= 0xFFFF) {
+    hdr[1] = 126;
+    hdr[2] = length >> 8;
+    hdr[3] = length;
+    hdrLen = 4;
+  } else {
+    hdr[1] = 127;
+    for (int i = 0; i < 8; i++) hdr[2 + i] = (uint8_t)((uint64_t)length >> (8 * (7 - i)));
+    hdrLen = 10;
+  }
+  c.tx.append((const char *)hdr, hdrLen);
+  c.tx.append((const char *)payload, length);
+  return true;
+}
+
+bool WebSocketsServer::flush(uint8_t num) {
+  Client &c = clients_[num];
+  while (!c.tx.empty()) {
+    ssize_t n = send(c.fd, c.tx.data(), c.tx.size(), MSG_NOSIGNAL);
+    if (n > 0) {
+      c.tx.erase(0, n);
+      continue;
+    }
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;  // retried in loop()
+    return false;
+  }
+  return true;
+}
+
+void WebSocketsServer::dropClient(uint8_t num) {
+  Client &c = clients_[num];
+  if (c.fd < 0) return;
+  ::close(c.fd);
+  bool wasOpen = c.open;
+  c = Client();
+  if (wasOpen) {
+    openClients--;
+    if (cbEvent_) cbEvent_(num, WStype_DISCONNECTED, nullptr, 0);
+  }
+}
+
+bool WebSocketsServer::sendTXT(uint8_t num, const uint8_t *payload, size_t length, bool headerToPayload) {
+  if (headerToPayload) payload += WEBSOCKETS_MAX_HEADER_SIZE;
+  if (length == 0 && payload) length = strlen((const char *)payload);
+  if (!sendFrame(num, 0x1, payload, length)) return false;
+  if (!flush(num)) {
+    dropClient(num);
+    return false;
+  }
+  return true;
+}
+
+bool WebSocketsServer::broadcastTXT(const uint8_t *payload, size_t length, bool headerToPayload) {
+  bool ok = true;
+  for (uint8_t i = 0; i < WEBSOCKETS_SERVER_CLIENT_MAX; i++) {
+    if (clients_[i].open) ok &= sendTXT(i, payload, length, headerToPayload);
+  }
+  return ok;
+}
+
+bool WebSocketsServer::sendBIN(uint8_t num, const uint8_t *payload, size_t length, bool headerToPayload) {
+  if (headerToPayload) payload += WEBSOCKETS_MAX_HEADER_SIZE;
+  if (!sendFrame(num, 0x2, payload, length)) return false;
+  if (!flush(num)) {
+    dropClient(num);
+    return false;
+  }
+  return true;
+}
+
+bool WebSocketsServer::broadcastBIN(const uint8_t *payload, size_t length, bool headerToPayload) {
+  bool ok = true;
+  for (uint8_t i = 0; i < WEBSOCKETS_SERVER_CLIENT_MAX; i++) {
+    if (clients_[i].open) ok &= sendBIN(i, payload, length, headerToPayload);
+  }
+  return ok;
+}
+
+void WebSocketsServer::disconnect(uint8_t num) {
+  if (num >= WEBSOCKETS_SERVER_CLIENT_MAX) return;
+  if (clients_[num].open) {
+    sendFrame(num, 0x8, nullptr, 0);
+    flush(num);
+  }
+  dropClient(num);
+}
+
+void WebSocketsServer::disconnect() {
+  for (uint8_t i = 0; i < WEBSOCKETS_SERVER_CLIENT_MAX; i++) disconnect(i);
+}
+
+uint8_t WebSocketsServer::connectedClients(bool ping) {
+  (void)ping;
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < WEBSOCKETS_SERVER_CLIENT_MAX; i++) n += clients_[i].open;
+  return n;
+}
+
+bool WebSocketsServer::clientIsConnected(uint8_t num) {
+  return num < WEBSOCKETS_SERVER_CLIENT_MAX && clients_[num].open;
+}
+
+IPAddress WebSocketsServer::remoteIP(uint8_t num) {
+  return num < WEBSOCKETS_SERVER_CLIENT_MAX ? clients_[num].ip : IPAddress();
+}
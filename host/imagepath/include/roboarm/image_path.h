@@ -0,0 +1,73 @@
+#pragma once
+// Image -> light painting paths, the C++ counterpart of ImageProcessor's
+// automatic mode (light_painting_simulator.py):
+//
+//   gray -> 5x5 Gaussian -> Canny (L1 gradient) -> external contours ->
+//   smoothed, arc-length resampled polylines -> robot coordinates + colours
+//
+// The pixel stages run on horizontal tiles in parallel, blur and Sobel with
+// SSE2 where available. Robot coordinates follow convert_to_robot_coordinates:
+// x * scale + offset_x, offset_y, -(y * scale) + offset_z.
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace roboarm {
+namespace imagepath {
+
+// 8-bit image, rows packed, 1 (gray) or 3 (RGB) channels
+struct Image {
+  int width = 0;
+  int height = 0;
+  int channels = 0;
+  std::vector<uint8_t> data;
+};
+
+// Binary PPM/PGM, and PNG when built with libpng. Returns an error code
+// ("open_failed", "bad_format", "unsupported_format") or nullptr.
+const char *loadImage(const std::string &path, Image &out);
+
+struct Params {
+  // Canny, as in process_image_auto_fallback (blur 5x5, thresholds 50/150)
+  bool blur = true;
+  int lowThreshold = 50;
+  int highThreshold = 150;
+  // process_edges_with_interpolation
+  double pointSpacing = 3.0;  // target_point_density: pixels per output point
+  size_t minContour = 10;     // shorter contours are dropped
+  size_t minPoints = 10;
+  size_t maxPoints = 300;
+  // convert_to_robot_coordinates
+  double scale = 0.01;
+  double offsetX = 0.0;
+  double offsetY = 0.0;
+  double offsetZ = 0.5;
+  // Execution
+  int threads = 0;     // 0 = hardware concurrency
+  int tileRows = 64;   // rows per parallel tile
+};
+
+struct Path {
+  std::vector<std::array<int, 2>> pixels;     // resampled points, image coordinates
+  std::vector<std::array<double, 3>> robot;   // same points in robot coordinates
+  std::vector<std::array<float, 3>> rgb;      // image colour under each point, 0..1
+};
+
+// Wall time per stage, ms
+struct Timing {
+  double gray = 0, blur = 0, canny = 0, contours = 0, paths = 0;
+  double total() const { return gray + blur + canny + contours + paths; }
+};
+
+std::vector<Path> extractPaths(const Image &img, const Params &params, Timing *timing = nullptr);
+
+// Stages on their own, e.g. to compare the edge map against cv.Canny:
+// 8-bit gray (cv.COLOR_BGR2GRAY weights) and the Canny edge map (255 = edge)
+std::vector<uint8_t> toGray(const Image &img, const Params &params);
+std::vector<uint8_t> cannyEdges(const uint8_t *gray, int width, int height, const Params &params,
+                                Timing *timing = nullptr);
+
+}  // namespace imagepath
+}  // namespace roboarm
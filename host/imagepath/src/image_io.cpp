@@ -0,0 +1,111 @@
+// Image loading for the path pipeline: binary PPM/PGM always, PNG with libpng
+#include <roboarm/image_path.h>
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+
+#ifdef ROBOARM_HAVE_PNG
+#include <png.h>
+#endif
+
+namespace roboarm {
+namespace imagepath {
+
+namespace {
+
+// Next header integer, skipping whitespace and # comments
+bool pnmInt(FILE *f, int &out) {
+  int c = fgetc(f);
+  while (c != EOF && (isspace(c) || c == '#')) {
+    if (c == '#')
+      while (c != EOF && c != '\n') c = fgetc(f);
+    c = fgetc(f);
+  }
+  if (c == EOF || !isdigit(c)) return false;
+  out = 0;
+  while (c != EOF && isdigit(c)) {
+    out = out * 10 + (c - '0');
+    if (out > (1 << 20)) return false;
+    c = fgetc(f);
+  }
+  return true;  // the single whitespace after the value is consumed
+}
+
+const char *loadPnm(FILE *f, Image &out) {
+  char magic[2];
+  if (fread(magic, 1, 2, f) != 2 || magic[0] != 'P' || (magic[1] != '5' && magic[1] != '6'))
+    return "bad_format";
+  int w, h, maxval;
+  if (!pnmInt(f, w) || !pnmInt(f, h) || !pnmInt(f, maxval) || w <= 0 || h <= 0) return "bad_format";
+  if (maxval != 255) return "unsupported_format";  // 16-bit PNM
+  out.width = w;
+  out.height = h;
+  out.channels = magic[1] == '6' ? 3 : 1;
+  out.data.resize((size_t)w * h * out.channels);
+  if (fread(out.data.data(), 1, out.data.size(), f) != out.data.size()) return "bad_format";
+  return nullptr;
+}
+
+#ifdef ROBOARM_HAVE_PNG
+const char *loadPng(FILE *f, Image &out) {
+  png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+  png_infop info = png ? png_create_info_struct(png) : nullptr;
+  if (!info) {
+    png_destroy_read_struct(&png, nullptr, nullptr);
+    return "bad_format";
+  }
+  if (setjmp(png_jmpbuf(png))) {
+    png_destroy_read_struct(&png, &info, nullptr);
+    return "bad_format";
+  }
+  png_init_io(png, f);
+  png_read_info(png, info);
+  // Normalise to 8-bit gray or RGB, alpha dropped
+  png_set_strip_16(png);
+  png_set_strip_alpha(png);
+  png_set_packing(png);
+  png_byte type = png_get_color_type(png, info);
+  if (type == PNG_COLOR_TYPE_PALETTE) png_set_palette_to_rgb(png);
+  if (type == PNG_COLOR_TYPE_GRAY && png_get_bit_depth(png, info) < 8) png_set_expand_gray_1_2_4_to_8(png);
+  png_read_update_info(png, info);
+
+  out.width = (int)png_get_image_width(png, info);
+  out.height = (int)png_get_image_height(png, info);
+  out.channels = png_get_channels(png, info);
+  size_t stride = png_get_rowbytes(png, info);
+  if (out.channels != 1 && out.channels != 3) {
+    png_destroy_read_struct(&png, &info, nullptr);
+    return "unsupported_format";
+  }
+  out.data.resize(stride * out.height);
+  std::vector<png_bytep> rows(out.height);
+  for (int y = 0; y < out.height; y++) rows[y] = out.data.data() + y * stride;
+  png_read_image(png, rows.data());
+  png_destroy_read_struct(&png, &info, nullptr);
+  return nullptr;
+}
+#endif
+
+}  // namespace
+
+const char *loadImage(const std::string &path, Image &out) {
+  FILE *f = fopen(path.c_str(), "rb");
+  if (!f) return "open_failed";
+  unsigned char sig[8] = {0};
+  size_t n = fread(sig, 1, sizeof(sig), f);
+  rewind(f);
+  const char *err = "unsupported_format";
+  if (n >= 2 && sig[0] == 'P') {
+    err = loadPnm(f, out);
+  } else if (n == 8 && !memcmp(sig, "\x89PNG\r\n\x1a\n", 8)) {
+#ifdef ROBOARM_HAVE_PNG
+    err = loadPng(f, out);
+#endif
+  }
+  fclose(f);
+  return err;
+}
+
+}  // namespace imagepath
+}  // namespace roboarm
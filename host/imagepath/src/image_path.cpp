@@ -0,0 +1,446 @@
+// Image -> path pipeline, see image_path.h
+#include <roboarm/image_path.h>
+#include <roboarm/parallel.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace roboarm {
+namespace imagepath {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double msSince(Clock::time_point t0) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+// Row bands of `rows` rows: fn(y0, y1)
+template <typename Fn>
+void forTiles(int height, const Params &p, const Fn &fn) {
+  int rows = std::max(p.tileRows, 1);
+  size_t tiles = (size_t)((height + rows - 1) / rows);
+  parallelFor(tiles, p.threads, [&](size_t t) {
+    int y0 = (int)t * rows;
+    fn(y0, std::min(y0 + rows, height));
+  });
+}
+
+// OpenCV's default border for filters: dcb|abcd|cba
+int reflect101(int i, int n) {
+  if (n == 1) return 0;
+  while (i < 0 || i >= n) {
+    if (i < 0) i = -i;
+    if (i >= n) i = 2 * n - 2 - i;
+  }
+  return i;
+}
+
+// ---- Gray: BT.601 weights in Q14, as cv::cvtColor ----
+
+void grayRows(const Image &img, uint8_t *gray, int y0, int y1) {
+  const int R = 4899, G = 9617, B = 1868;
+  size_t w = (size_t)img.width;
+  for (int y = y0; y < y1; y++) {
+    const uint8_t *s = img.data.data() + (size_t)y * w * img.channels;
+    uint8_t *d = gray + (size_t)y * w;
+    if (img.channels == 1) {
+      std::copy(s, s + w, d);
+      continue;
+    }
+    for (size_t x = 0; x < w; x++, s += 3) d[x] = (uint8_t)((s[0] * R + s[1] * G + s[2] * B + (1 << 13)) >> 14);
+  }
+}
+
+// ---- Gaussian 5x5, sigma from size: separable [1 4 6 4 1] / 16 ----
+// Horizontal pass to u16 (<= 16 * 255), vertical pass sums to <= 65280 and
+// rounds back to u8, so both fit 16-bit lanes.
+
+void blurRowH(const uint8_t *s, uint16_t *d, int w) {
+  auto at = [&](int x) { return (int)s[reflect101(x, w)]; };
+  auto px = [&](int x) {
+    d[x] = (uint16_t)(at(x - 2) + 4 * at(x - 1) + 6 * at(x) + 4 * at(x + 1) + at(x + 2));
+  };
+  int x = 0;
+  for (; x < std::min(2, w); x++) px(x);
+#ifdef __SSE2__
+  const __m128i zero = _mm_setzero_si128();
+  for (; x + 8 <= w - 2; x += 8) {
+    __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(s + x - 2)), zero);
+    __m128i b = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(s + x - 1)), zero);
+    __m128i c = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(s + x)), zero);
+    __m128i e = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(s + x + 1)), zero);
+    __m128i f = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(s + x + 2)), zero);
+    __m128i be = _mm_slli_epi16(_mm_add_epi16(b, e), 2);
+    __m128i c6 = _mm_add_epi16(_mm_slli_epi16(c, 2), _mm_slli_epi16(c, 1));
+    _mm_storeu_si128((__m128i *)(d + x), _mm_add_epi16(_mm_add_epi16(a, f), _mm_add_epi16(be, c6)));
+  }
+#endif
+  for (; x < w - 2; x++)
+    d[x] = (uint16_t)(s[x - 2] + 4 * (s[x - 1] + s[x + 1]) + 6 * s[x] + s[x + 2]);
+  for (; x < w; x++) px(x);
+}
+
+void blurRowV(const uint16_t *r0, const uint16_t *r1, const uint16_t *r2, const uint16_t *r3,
+              const uint16_t *r4, uint8_t *d, int w) {
+  int x = 0;
+#ifdef __SSE2__
+  const __m128i half = _mm_set1_epi16(128);
+  for (; x + 16 <= w; x += 16) {
+    __m128i out[2];
+    for (int k = 0; k < 2; k++) {
+      int o = x + 8 * k;
+      __m128i a = _mm_loadu_si128((const __m128i *)(r0 + o));
+      __m128i b = _mm_loadu_si128((const __m128i *)(r1 + o));
+      __m128i c = _mm_loadu_si128((const __m128i *)(r2 + o));
+      __m128i e = _mm_loadu_si128((const __m128i *)(r3 + o));
+      __m128i f = _mm_loadu_si128((const __m128i *)(r4 + o));
+      __m128i be = _mm_slli_epi16(_mm_add_epi16(b, e), 2);
+      __m128i c6 = _mm_add_epi16(_mm_slli_epi16(c, 2), _mm_slli_epi16(c, 1));
+      __m128i sum = _mm_add_epi16(_mm_add_epi16(a, f), _mm_add_epi16(be, c6));
+      out[k] = _mm_srli_epi16(_mm_add_epi16(sum, half), 8);
+    }
+    _mm_storeu_si128((__m128i *)(d + x), _mm_packus_epi16(out[0], out[1]));
+  }
+#endif
+  for (; x < w; x++)
+    d[x] = (uint8_t)((r0[x] + 4 * (r1[x] + r3[x]) + 6 * r2[x] + r4[x] + 128) >> 8);
+}
+
+// ---- Canny ----
+
+// Sobel 3x3 (replicated border) of rows [y0, y1): dx, dy and the L1
+// magnitude. mag has a zero frame: stride w + 2, row y at (y + 1).
+void sobelRows(const uint8_t *src, int w, int h, int y0, int y1, int16_t *dx, int16_t *dy, int16_t *mag) {
+  size_t ms = (size_t)w + 2;
+  for (int y = y0; y < y1; y++) {
+    const uint8_t *a = src + (size_t)std::max(y - 1, 0) * w;
+    const uint8_t *b = src + (size_t)y * w;
+    const uint8_t *c = src + (size_t)std::min(y + 1, h - 1) * w;
+    int16_t *gx = dx + (size_t)y * w;
+    int16_t *gy = dy + (size_t)y * w;
+    int16_t *m = mag + (size_t)(y + 1) * ms + 1;
+    auto px = [&](int x) {
+      int l = std::max(x - 1, 0), r = std::min(x + 1, w - 1);
+      int vx = (a[r] - a[l]) + 2 * (b[r] - b[l]) + (c[r] - c[l]);
+      int vy = (c[l] + 2 * c[x] + c[r]) - (a[l] + 2 * a[x] + a[r]);
+      gx[x] = (int16_t)vx;
+      gy[x] = (int16_t)vy;
+      m[x] = (int16_t)(std::abs(vx) + std::abs(vy));
+    };
+    int x = 0;
+    if (w > 0) px(x++);
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 8 <= w - 1; x += 8) {
+      __m128i a0 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(a + x - 1)), zero);
+      __m128i a1 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(a + x)), zero);
+      __m128i a2 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(a + x + 1)), zero);
+      __m128i b0 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(b + x - 1)), zero);
+      __m128i b2 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(b + x + 1)), zero);
+      __m128i c0 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(c + x - 1)), zero);
+      __m128i c1 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(c + x)), zero);
+      __m128i c2 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(c + x + 1)), zero);
+      __m128i vx = _mm_add_epi16(_mm_add_epi16(_mm_sub_epi16(a2, a0), _mm_sub_epi16(c2, c0)),
+                                 _mm_slli_epi16(_mm_sub_epi16(b2, b0), 1));
+      __m128i vy = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(c0, c2), _mm_slli_epi16(c1, 1)),
+                                 _mm_add_epi16(_mm_add_epi16(a0, a2), _mm_slli_epi16(a1, 1)));
+      __m128i ax = _mm_max_epi16(vx, _mm_sub_epi16(zero, vx));
+      __m128i ay = _mm_max_epi16(vy, _mm_sub_epi16(zero, vy));
+      _mm_storeu_si128((__m128i *)(gx + x), vx);
+      _mm_storeu_si128((__m128i *)(gy + x), vy);
+      _mm_storeu_si128((__m128i *)(m + x), _mm_add_epi16(ax, ay));
+    }
+#endif
+    for (; x < w; x++) px(x);
+  }
+}
+
+enum : uint8_t { NOT_EDGE = 0, WEAK = 1, STRONG = 2 };
+
+// Non-maximum suppression along the quantised gradient direction (the
+// tan(22.5) / tan(67.5) test of cv::Canny) and double threshold
+void suppressRows(const int16_t *dx, const int16_t *dy, const int16_t *mag, int w, int y0, int y1, int low,
+                  int high, uint8_t *map) {
+  const int TG22 = 13573;  // tan(22.5 deg) in Q15
+  size_t ms = (size_t)w + 2;
+  for (int y = y0; y < y1; y++) {
+    const int16_t *gx = dx + (size_t)y * w;
+    const int16_t *gy = dy + (size_t)y * w;
+    const int16_t *prev = mag + (size_t)y * ms + 1;
+    const int16_t *cur = prev + ms;
+    const int16_t *next = cur + ms;
+    uint8_t *out = map + (size_t)y * w;
+    for (int x = 0; x < w; x++) {
+      int m = cur[x];
+      out[x] = NOT_EDGE;
+      if (m <= low) continue;
+      int xs = gx[x], ys = gy[x];
+      int ax = std::abs(xs), ay = std::abs(ys) << 15;
+      int tg22x = ax * TG22;
+      bool peak;
+      if (ay < tg22x) {
+        peak = m > cur[x - 1] && m >= cur[x + 1];
+      } else if (ay > tg22x + (ax << 16)) {
+        peak = m > prev[x] && m >= next[x];
+      } else {
+        int s = (xs ^ ys) < 0 ? -1 : 1;
+        peak = m > prev[x - s] && m > next[x + s];
+      }
+      if (peak) out[x] = m > high ? STRONG : WEAK;
+    }
+  }
+}
+
+// Weak pixels 8-connected to a strong one become edges
+void hysteresis(uint8_t *map, int w, int h) {
+  std::vector<int> stack;
+  for (int i = 0, n = w * h; i < n; i++)
+    if (map[i] == STRONG) stack.push_back(i);
+  while (!stack.empty()) {
+    int i = stack.back();
+    stack.pop_back();
+    int x = i % w, y = i / w;
+    for (int ny = std::max(y - 1, 0); ny <= std::min(y + 1, h - 1); ny++)
+      for (int nx = std::max(x - 1, 0); nx <= std::min(x + 1, w - 1); nx++) {
+        int j = ny * w + nx;
+        if (map[j] == WEAK) {
+          map[j] = STRONG;
+          stack.push_back(j);
+        }
+      }
+  }
+}
+
+// ---- External contours ----
+// Edge pixels are 8-connected, so background is 4-connected. A contour is
+// external (cv::RETR_EXTERNAL) when it borders the background region that
+// reaches the image frame; contours inside another one's hole are skipped.
+// Work happens on a copy with a one pixel zero frame.
+
+enum : uint8_t { FG = 1, OUTSIDE = 2, TRACED = 4 };
+
+// Scanline flood of the frame-connected background
+void markOutside(std::vector<uint8_t> &st, int pw, int ph) {
+  std::vector<std::pair<int, int>> seeds{{0, 0}};
+  while (!seeds.empty()) {
+    int x = seeds.back().first, y = seeds.back().second;
+    seeds.pop_back();
+    uint8_t *row = &st[(size_t)y * pw];
+    if (row[x] & (FG | OUTSIDE)) continue;
+    int l = x, r = x;
+    while (l > 0 && !(row[l - 1] & (FG | OUTSIDE))) l--;
+    while (r + 1 < pw && !(row[r + 1] & (FG | OUTSIDE))) r++;
+    for (int i = l; i <= r; i++) row[i] |= OUTSIDE;
+    for (int ny = y - 1; ny <= y + 1; ny += 2) {
+      if (ny < 0 || ny >= ph) continue;
+      const uint8_t *nrow = &st[(size_t)ny * pw];
+      for (int i = l; i <= r; i++)
+        if (!(nrow[i] & (FG | OUTSIDE)) && (i == l || (nrow[i - 1] & (FG | OUTSIDE)))) seeds.push_back({i, ny});
+    }
+  }
+}
+
+// Suzuki-Abe outer border following from a pixel whose west neighbour is
+// background; every border pixel, as cv::CHAIN_APPROX_NONE
+std::vector<std::array<int, 2>> traceBorder(std::vector<uint8_t> &st, int pw, int start) {
+  const int delta[16] = {1, -pw + 1, -pw, -pw - 1, -1, pw - 1, pw, pw + 1,
+                         1, -pw + 1, -pw, -pw - 1, -1, pw - 1, pw, pw + 1};
+  std::vector<std::array<int, 2>> pts;
+  auto push = [&](int i) {
+    st[i] |= TRACED;
+    pts.push_back({i % pw - 1, i / pw - 1});
+  };
+  int s = 4, end = 4, i1 = start;
+  do {  // clockwise from west for the first neighbour
+    s = (s - 1) & 7;
+    i1 = start + delta[s];
+  } while (!(st[i1] & FG) && s != end);
+  if (s == end) {  // isolated pixel
+    push(start);
+    return pts;
+  }
+  int i3 = start, i4 = start;
+  for (;;) {
+    while (s < 15) {  // counterclockwise from just past the previous pixel
+      i4 = i3 + delta[++s];
+      if (st[i4] & FG) break;
+    }
+    s &= 7;
+    push(i3);
+    if (i4 == start && i3 == i1) break;
+    i3 = i4;
+    s = (s + 4) & 7;
+  }
+  return pts;
+}
+
+std::vector<std::vector<std::array<int, 2>>> externalContours(const std::vector<uint8_t> &edges, int w, int h) {
+  int pw = w + 2, ph = h + 2;
+  std::vector<uint8_t> st((size_t)pw * ph, 0);
+  for (int y = 0; y < h; y++)
+    for (int x = 0; x < w; x++)
+      if (edges[(size_t)y * w + x]) st[(size_t)(y + 1) * pw + x + 1] = FG;
+  markOutside(st, pw, ph);
+
+  // The first edge pixel of an external component in raster order has
+  // outside background above it, and tracing marks every such pixel of the
+  // component, so each external border starts exactly once
+  std::vector<std::vector<std::array<int, 2>>> contours;
+  for (int y = 1; y <= h; y++) {
+    const uint8_t *row = &st[(size_t)y * pw];
+    const uint8_t *above = row - pw;
+    for (int x = 1; x <= w; x++) {
+      if (row[x] != FG || !(above[x] & OUTSIDE) || (row[x - 1] & FG)) continue;
+      contours.push_back(traceBorder(st, pw, y * pw + x));
+    }
+  }
+  return contours;
+}
+
+// ---- Paths ----
+
+// Light smoothing ([1 2 1], ends fixed) then samples at equal arc length;
+// stands in for the splprep(s = 0.1 * n) spline of the Python pipeline
+std::vector<std::array<double, 2>> resample(const std::vector<std::array<int, 2>> &pts, size_t count) {
+  size_t n = pts.size();
+  std::vector<std::array<double, 2>> sm(n);
+  for (size_t i = 0; i < n; i++) {
+    if (i == 0 || i + 1 == n) {
+      sm[i] = {(double)pts[i][0], (double)pts[i][1]};
+      continue;
+    }
+    for (int k = 0; k < 2; k++) sm[i][k] = 0.25 * pts[i - 1][k] + 0.5 * pts[i][k] + 0.25 * pts[i + 1][k];
+  }
+  std::vector<double> cum(n, 0.0);
+  for (size_t i = 1; i < n; i++) cum[i] = cum[i - 1] + std::hypot(sm[i][0] - sm[i - 1][0], sm[i][1] - sm[i - 1][1]);
+  double total = cum.back();
+  if (total <= 0 || count < 2) return sm;
+
+  std::vector<std::array<double, 2>> out(count);
+  size_t seg = 1;
+  for (size_t k = 0; k < count; k++) {
+    double d = total * (double)k / (double)(count - 1);
+    while (seg + 1 < n && cum[seg] < d) seg++;
+    double len = cum[seg] - cum[seg - 1];
+    double t = len > 0 ? (d - cum[seg - 1]) / len : 0.0;
+    t = std::min(std::max(t, 0.0), 1.0);
+    for (int c = 0; c < 2; c++) out[k][c] = sm[seg - 1][c] + t * (sm[seg][c] - sm[seg - 1][c]);
+  }
+  return out;
+}
+
+bool buildPath(const std::vector<std::array<int, 2>> &contour, const Image &img, const Params &p, Path &out) {
+  if (contour.size() < p.minContour) return false;
+  std::vector<std::array<int, 2>> pts;
+  pts.reserve(contour.size());
+  for (const auto &q : contour)
+    if (pts.empty() || q != pts.back()) pts.push_back(q);
+  if (pts.size() < 3) return false;
+
+  double length = 0;
+  for (size_t i = 1; i < pts.size(); i++)
+    length += std::hypot((double)(pts[i][0] - pts[i - 1][0]), (double)(pts[i][1] - pts[i - 1][1]));
+  size_t count = std::max(p.minPoints, (size_t)(length / std::max(p.pointSpacing, 1e-6)));
+  count = std::min(count, p.maxPoints);
+
+  std::vector<std::array<double, 2>> smooth;
+  if (pts.size() < 4) {
+    for (const auto &q : pts) smooth.push_back({(double)q[0], (double)q[1]});
+  } else {
+    smooth = resample(pts, count);
+  }
+  if (smooth.size() <= 2) return false;
+
+  for (const auto &q : smooth) {
+    int x = (int)q[0], y = (int)q[1];  // truncation, as int() in Python
+    out.pixels.push_back({x, y});
+    out.robot.push_back({x * p.scale + p.offsetX, p.offsetY, -(y * p.scale) + p.offsetZ});
+    int cx = std::min(std::max(x, 0), img.width - 1);
+    int cy = std::min(std::max(y, 0), img.height - 1);
+    const uint8_t *px = img.data.data() + ((size_t)cy * img.width + cx) * img.channels;
+    if (img.channels >= 3) out.rgb.push_back({px[0] / 255.0f, px[1] / 255.0f, px[2] / 255.0f});
+    else out.rgb.push_back({px[0] / 255.0f, px[0] / 255.0f, px[0] / 255.0f});
+  }
+  return true;
+}
+
+}  // namespace
+
+std::vector<uint8_t> toGray(const Image &img, const Params &p) {
+  std::vector<uint8_t> gray((size_t)img.width * img.height);
+  forTiles(img.height, p, [&](int y0, int y1) { grayRows(img, gray.data(), y0, y1); });
+  return gray;
+}
+
+std::vector<uint8_t> cannyEdges(const uint8_t *gray, int w, int h, const Params &p, Timing *timing) {
+  size_t n = (size_t)w * h;
+  Clock::time_point t0 = Clock::now();
+  std::vector<uint8_t> blurred;
+  const uint8_t *src = gray;
+  if (p.blur) {
+    std::vector<uint16_t> tmp(n);
+    blurred.resize(n);
+    forTiles(h, p, [&](int y0, int y1) {
+      for (int y = y0; y < y1; y++) blurRowH(gray + (size_t)y * w, &tmp[(size_t)y * w], w);
+    });
+    forTiles(h, p, [&](int y0, int y1) {
+      for (int y = y0; y < y1; y++) {
+        const uint16_t *r[5];
+        for (int k = 0; k < 5; k++) r[k] = &tmp[(size_t)reflect101(y + k - 2, h) * w];
+        blurRowV(r[0], r[1], r[2], r[3], r[4], &blurred[(size_t)y * w], w);
+      }
+    });
+    src = blurred.data();
+  }
+  if (timing) timing->blur = msSince(t0);
+
+  t0 = Clock::now();
+  std::vector<int16_t> dx(n), dy(n), mag((size_t)(w + 2) * (h + 2), 0);
+  forTiles(h, p, [&](int y0, int y1) { sobelRows(src, w, h, y0, y1, dx.data(), dy.data(), mag.data()); });
+  std::vector<uint8_t> map(n);
+  int low = std::min(p.lowThreshold, p.highThreshold), high = std::max(p.lowThreshold, p.highThreshold);
+  forTiles(h, p, [&](int y0, int y1) {
+    suppressRows(dx.data(), dy.data(), mag.data(), w, y0, y1, low, high, map.data());
+  });
+  hysteresis(map.data(), w, h);
+  for (uint8_t &v : map) v = v == STRONG ? 255 : 0;
+  if (timing) timing->canny = msSince(t0);
+  return map;
+}
+
+std::vector<Path> extractPaths(const Image &img, const Params &p, Timing *timing) {
+  std::vector<Path> paths;
+  if (img.width <= 0 || img.height <= 0 || img.data.size() < (size_t)img.width * img.height * img.channels)
+    return paths;
+  int w = img.width, h = img.height;
+
+  Clock::time_point t0 = Clock::now();
+  std::vector<uint8_t> gray = toGray(img, p);
+  if (timing) timing->gray = msSince(t0);
+
+  std::vector<uint8_t> edges = cannyEdges(gray.data(), w, h, p, timing);
+
+  t0 = Clock::now();
+  std::vector<std::vector<std::array<int, 2>>> contours = externalContours(edges, w, h);
+  if (timing) timing->contours = msSince(t0);
+
+  t0 = Clock::now();
+  std::vector<Path> built(contours.size());
+  std::vector<uint8_t> kept(contours.size(), 0);
+  parallelFor(contours.size(), p.threads, [&](size_t i) { kept[i] = buildPath(contours[i], img, p, built[i]); });
+  for (size_t i = 0; i < built.size(); i++)
+    if (kept[i]) paths.push_back(std::move(built[i]));
+  if (timing) timing->paths = msSince(t0);
+  return paths;
+}
+
+}  // namespace imagepath
+}  // namespace roboarm
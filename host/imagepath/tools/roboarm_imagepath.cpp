@@ -0,0 +1,119 @@
+// Image -> light painting paths, fast replacement for ImageProcessor's
+// automatic mode
+//
+//   roboarm_imagepath IN.(png|ppm|pgm) [--scale 0.01] [--offset X Y Z]
+//                     [--density 3] [--canny LOW HIGH] [--no-blur]
+//                     [--threads N] [--pixels] [--edges OUT.pgm] [--repeat N]
+//
+// Prints {"paths": [[[x,y,z], ...], ...], "colors": [[[r,g,b], ...], ...]},
+// the (robot_paths, robot_colors) pair of convert_to_robot_coordinates with
+// the same scale/offsets (defaults 0.01 and 0, 0, 0.5). --pixels prints
+// image coordinates instead ([[x,y], ...]), i.e. edge_paths/edge_colors.
+// Stage timings go to stderr; --repeat N runs the pipeline N times for them.
+
+#include <roboarm/image_path.h>
+#include <roboarm/json.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace imagepath = roboarm::imagepath;
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr,
+            "usage: %s IN.(png|ppm|pgm) [--scale S] [--offset X Y Z] [--density PX] [--canny LOW HIGH]\n"
+            "       [--no-blur] [--threads N] [--pixels] [--edges OUT.pgm] [--repeat N]\n",
+            argv[0]);
+    return 2;
+  }
+  imagepath::Params p;
+  bool pixels = false;
+  const char *edgesOut = nullptr;
+  int repeat = 1;
+  for (int i = 2; i < argc; i++) {
+    if (!strcmp(argv[i], "--scale") && i + 1 < argc) p.scale = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--offset") && i + 3 < argc) {
+      p.offsetX = atof(argv[++i]);
+      p.offsetY = atof(argv[++i]);
+      p.offsetZ = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--density") && i + 1 < argc) p.pointSpacing = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--canny") && i + 2 < argc) {
+      p.lowThreshold = atoi(argv[++i]);
+      p.highThreshold = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--no-blur")) p.blur = false;
+    else if (!strcmp(argv[i], "--threads") && i + 1 < argc) p.threads = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--pixels")) pixels = true;
+    else if (!strcmp(argv[i], "--edges") && i + 1 < argc) edgesOut = argv[++i];
+    else if (!strcmp(argv[i], "--repeat") && i + 1 < argc) repeat = std::max(1, atoi(argv[++i]));
+    else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 2;
+    }
+  }
+
+  imagepath::Image img;
+  if (const char *err = imagepath::loadImage(argv[1], img)) {
+    fprintf(stderr, "%s: %s\n", argv[1], err);
+    return 1;
+  }
+
+  std::vector<imagepath::Path> paths;
+  imagepath::Timing best;
+  for (int r = 0; r < repeat; r++) {
+    imagepath::Timing t;
+    paths = imagepath::extractPaths(img, p, &t);
+    if (r == 0 || t.total() < best.total()) best = t;
+  }
+
+  if (edgesOut) {
+    std::vector<uint8_t> gray = imagepath::toGray(img, p);
+    std::vector<uint8_t> edges = imagepath::cannyEdges(gray.data(), img.width, img.height, p);
+    FILE *f = fopen(edgesOut, "wb");
+    if (!f) {
+      fprintf(stderr, "%s: open_failed\n", edgesOut);
+      return 1;
+    }
+    fprintf(f, "P5\n%d %d\n255\n", img.width, img.height);
+    fwrite(edges.data(), 1, edges.size(), f);
+    fclose(f);
+  }
+
+  roboarm::json::Writer w;
+  size_t points = 0;
+  w.beginObject().key("paths").beginArray();
+  for (const imagepath::Path &path : paths) {
+    w.beginArray();
+    for (size_t i = 0; i < path.pixels.size(); i++) {
+      w.beginArray();
+      if (pixels) w.value((int32_t)path.pixels[i][0]).value((int32_t)path.pixels[i][1]);
+      else w.value(path.robot[i][0]).value(path.robot[i][1]).value(path.robot[i][2]);
+      w.endArray();
+    }
+    w.endArray();
+    points += path.pixels.size();
+  }
+  w.endArray().key("colors").beginArray();
+  for (const imagepath::Path &path : paths) {
+    w.beginArray();
+    // 4 decimals still tell all 256 levels apart and keep the output small
+    for (const auto &c : path.rgb) {
+      w.beginArray();
+      for (float v : c) w.value(std::round(v * 1e4) / 1e4);
+      w.endArray();
+    }
+    w.endArray();
+  }
+  w.endArray().endObject();
+  fwrite(w.str().data(), 1, w.str().size(), stdout);
+  fputc('\n', stdout);
+
+  fprintf(stderr,
+          "%dx%d: %zu paths, %zu points in %.1f ms (gray %.1f, blur %.1f, canny %.1f, contours %.1f, paths %.1f)\n",
+          img.width, img.height, paths.size(), points, best.total(), best.gray, best.blur, best.canny, best.contours,
+          best.paths);
+  return 0;
+}
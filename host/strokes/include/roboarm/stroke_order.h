@@ -0,0 +1,51 @@
+#pragma once
+// Light painting stroke order: reorders (and reverses) strokes so the unlit
+// moves between them take as little time as possible. Only a stroke's first
+// and last pose matter; drawing time is the same in either direction.
+//
+// Travel between two poses is joint-space time with every joint at its
+// velocity limit: max_i |a_i - b_i| / v_i. The tour starts from a given pose
+// (home) and can optionally return to it. Nearest neighbour builds the first
+// order, then 2-opt (which also flips single strokes) and Or-opt (moving runs
+// of up to three strokes, either way round) improve it until nothing helps or
+// the time budget runs out.
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace roboarm {
+namespace strokes {
+
+using Pose = std::vector<float>;  // joint angles, deg
+
+struct Stroke {
+  Pose first;
+  Pose last;
+};
+
+struct Options {
+  std::vector<float> maxDps;  // per-joint velocity limit, deg/s (same length as the poses)
+  Pose start;                 // pose before the first stroke
+  bool returnToStart = false;
+  std::chrono::milliseconds budget{200};
+};
+
+struct Result {
+  std::vector<uint32_t> order;  // stroke indices in drawing order
+  std::vector<bool> reversed;   // per position in order: draw last -> first
+  double inputMs = 0;           // unlit travel of the order given
+  double nearestMs = 0;         // after nearest neighbour
+  double optimizedMs = 0;       // after 2-opt / Or-opt
+  uint64_t improvements = 0;    // accepted moves
+  bool budgetHit = false;       // stopped by the budget, not at a local optimum
+};
+
+// Travel time in ms between two poses
+double travelMs(const Pose &a, const Pose &b, const std::vector<float> &maxDps);
+
+Result optimize(const std::vector<Stroke> &strokes, const Options &opts);
+
+}  // namespace strokes
+}  // namespace roboarm
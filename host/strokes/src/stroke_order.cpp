@@ -0,0 +1,219 @@
+// Stroke order optimizer, see stroke_order.h
+#include <roboarm/stroke_order.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace roboarm {
+namespace strokes {
+
+double travelMs(const Pose &a, const Pose &b, const std::vector<float> &maxDps) {
+  double worst = 0;
+  for (size_t i = 0; i < a.size() && i < b.size(); i++) {
+    float v = i < maxDps.size() && maxDps[i] > 0 ? maxDps[i] : 1.0f;
+    worst = std::max(worst, (double)std::fabs(a[i] - b[i]) / v);
+  }
+  return worst * 1000.0;
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Node {
+  uint32_t stroke;
+  bool reversed;
+};
+
+// Tour over flat pose storage: pose 2k is stroke k's first, 2k+1 its last,
+// pose 2n the start. nullptr stands for "no pose" (open end, costs nothing).
+class Tour {
+ public:
+  Tour(const std::vector<Stroke> &strokes, const Options &opts)
+      : joints_(opts.start.size()), n_(strokes.size()), returnToStart_(opts.returnToStart) {
+    for (const Stroke &s : strokes) joints_ = std::max({joints_, s.first.size(), s.last.size()});
+    poses_.assign((2 * n_ + 1) * joints_, 0.0f);
+    for (size_t k = 0; k < n_; k++) {
+      std::copy(strokes[k].first.begin(), strokes[k].first.end(), poses_.begin() + (2 * k) * joints_);
+      std::copy(strokes[k].last.begin(), strokes[k].last.end(), poses_.begin() + (2 * k + 1) * joints_);
+    }
+    std::copy(opts.start.begin(), opts.start.end(), poses_.begin() + 2 * n_ * joints_);
+    msPerDeg_.resize(joints_);
+    for (size_t i = 0; i < joints_; i++) {
+      float v = i < opts.maxDps.size() && opts.maxDps[i] > 0 ? opts.maxDps[i] : 1.0f;
+      msPerDeg_[i] = 1000.0f / v;
+    }
+  }
+
+  double cost(const float *a, const float *b) const {
+    if (!a || !b) return 0;
+    float worst = 0;
+    for (size_t i = 0; i < joints_; i++) worst = std::max(worst, std::fabs(a[i] - b[i]) * msPerDeg_[i]);
+    return worst;
+  }
+
+  const float *start() const { return &poses_[2 * n_ * joints_]; }
+  const float *entry(const Node &t) const { return &poses_[(2 * t.stroke + (t.reversed ? 1 : 0)) * joints_]; }
+  const float *exit(const Node &t) const { return &poses_[(2 * t.stroke + (t.reversed ? 0 : 1)) * joints_]; }
+  const float *prevExit(size_t i) const { return i == 0 ? start() : exit(order[i - 1]); }
+  const float *nextEntry(size_t j) const {
+    if (j + 1 < order.size()) return entry(order[j + 1]);
+    return returnToStart_ ? start() : nullptr;
+  }
+
+  double total() const {
+    double sum = 0;
+    for (size_t i = 0; i < order.size(); i++) sum += cost(prevExit(i), entry(order[i]));
+    if (!order.empty()) sum += cost(exit(order.back()), nextEntry(order.size() - 1));
+    return sum;
+  }
+
+  void nearestNeighbour() {
+    std::vector<bool> used(n_, false);
+    order.clear();
+    const float *at = start();
+    for (size_t step = 0; step < n_; step++) {
+      Node best = {0, false};
+      double bestCost = INFINITY;
+      for (uint32_t k = 0; k < n_; k++) {
+        if (used[k]) continue;
+        for (int r = 0; r < 2; r++) {
+          Node t = {k, r == 1};
+          double c = cost(at, entry(t));
+          if (c < bestCost) {
+            bestCost = c;
+            best = t;
+          }
+        }
+      }
+      used[best.stroke] = true;
+      order.push_back(best);
+      at = exit(best);
+    }
+  }
+
+  // One pass of 2-opt: reversing order[i..j] also flips every stroke in it,
+  // so only the two boundary moves change (travel is symmetric)
+  bool twoOpt(Clock::time_point deadline, uint64_t &improvements, bool &budgetHit) {
+    bool improved = false;
+    for (size_t i = 0; i < order.size(); i++) {
+      if (Clock::now() >= deadline) {
+        budgetHit = true;
+        return improved;
+      }
+      const float *before = prevExit(i);
+      for (size_t j = i; j < order.size(); j++) {
+        const float *after = nextEntry(j);
+        double delta = cost(before, exit(order[j])) + cost(entry(order[i]), after) -
+                       cost(before, entry(order[i])) - cost(exit(order[j]), after);
+        if (delta < -1e-6) {
+          std::reverse(order.begin() + i, order.begin() + j + 1);
+          for (size_t k = i; k <= j; k++) order[k].reversed = !order[k].reversed;
+          improvements++;
+          improved = true;
+          before = prevExit(i);
+        }
+      }
+    }
+    return improved;
+  }
+
+  // One pass of Or-opt: move runs of 1..3 strokes to the best other gap,
+  // either way round
+  bool orOpt(Clock::time_point deadline, uint64_t &improvements, bool &budgetHit) {
+    bool improved = false;
+    for (size_t len = 1; len <= 3; len++) {
+      for (size_t i = 0; i + len <= order.size(); i++) {
+        if (Clock::now() >= deadline) {
+          budgetHit = true;
+          return improved;
+        }
+        size_t j = i + len - 1;
+        const float *segIn = entry(order[i]);
+        const float *segOut = exit(order[j]);
+        const float *before = prevExit(i);
+        const float *after = nextEntry(j);
+        double gain = cost(before, segIn) + cost(segOut, after) - cost(before, after);
+        if (gain <= 1e-6) continue;
+
+        // Gap g sits between strokes g-1 and g of the tour without the run
+        double bestDelta = -1e-6;
+        size_t bestGap = 0;
+        bool bestRev = false;
+        size_t rest = order.size() - len;
+        auto at = [&](size_t r) { return order[r < i ? r : r + len]; };
+        for (size_t g = 0; g <= rest; g++) {
+          if (g == i) continue;  // where the run came from
+          const float *x = g == 0 ? start() : exit(at(g - 1));
+          const float *y = g < rest ? entry(at(g)) : (returnToStart_ ? start() : nullptr);
+          double base = cost(x, y);
+          double fwd = cost(x, segIn) + cost(segOut, y) - base - gain;
+          double rev = cost(x, segOut) + cost(segIn, y) - base - gain;
+          if (fwd < bestDelta) {
+            bestDelta = fwd;
+            bestGap = g;
+            bestRev = false;
+          }
+          if (rev < bestDelta) {
+            bestDelta = rev;
+            bestGap = g;
+            bestRev = true;
+          }
+        }
+        if (bestDelta >= -1e-6) continue;
+
+        std::vector<Node> run(order.begin() + i, order.begin() + j + 1);
+        if (bestRev) {
+          std::reverse(run.begin(), run.end());
+          for (Node &t : run) t.reversed = !t.reversed;
+        }
+        order.erase(order.begin() + i, order.begin() + j + 1);
+        order.insert(order.begin() + bestGap, run.begin(), run.end());
+        improvements++;
+        improved = true;
+      }
+    }
+    return improved;
+  }
+
+  std::vector<Node> order;
+
+ private:
+  size_t joints_;
+  size_t n_;
+  bool returnToStart_;
+  std::vector<float> poses_;
+  std::vector<float> msPerDeg_;
+};
+
+}  // namespace
+
+Result optimize(const std::vector<Stroke> &strokes, const Options &opts) {
+  Clock::time_point deadline = Clock::now() + opts.budget;
+  Result res;
+  Tour tour(strokes, opts);
+  for (uint32_t k = 0; k < strokes.size(); k++) tour.order.push_back({k, false});
+  res.inputMs = tour.total();
+
+  tour.nearestNeighbour();
+  res.nearestMs = tour.total();
+  if (res.inputMs < res.nearestMs) {
+    // The given order can already be better (hand-tuned); start from it instead
+    for (uint32_t k = 0; k < strokes.size(); k++) tour.order[k] = {k, false};
+  }
+
+  while (!res.budgetHit) {
+    bool improved = tour.twoOpt(deadline, res.improvements, res.budgetHit);
+    if (!res.budgetHit) improved |= tour.orOpt(deadline, res.improvements, res.budgetHit);
+    if (!improved) break;
+  }
+  res.optimizedMs = tour.total();
+  for (const Node &t : tour.order) {
+    res.order.push_back(t.stroke);
+    res.reversed.push_back(t.reversed);
+  }
+  return res;
+}
+
+}  // namespace strokes
+}  // namespace roboarm
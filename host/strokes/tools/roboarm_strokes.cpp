@@ -0,0 +1,90 @@
+// Stroke order optimizer for light painting jobs
+//
+//   roboarm_strokes IN.json [--budget-ms 200] [--return]
+//
+// IN.json: {"strokes": [[[deg...], ..., [deg...]], ...],   // joint-space polylines
+//           "max_dps": [350, 350, 350, 600, 600],          // optional
+//           "start": [0, 0, 0, 0, 0]}                       // optional, home
+// Only the first and last pose of each stroke are used. Prints
+// {"order":[...],"reversed":[...],"input_ms":...,"optimized_ms":...,"saved_ms":...}
+
+#include <roboarm/json.h>
+#include <roboarm/stroke_order.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+using roboarm::json::Value;
+namespace strokes = roboarm::strokes;
+
+namespace {
+
+// Servo slew limits of the firmware's default lag model (MG996R x3, MG90S x2)
+const float DEFAULT_MAX_DPS[] = {350, 350, 350, 600, 600};
+
+strokes::Pose pose(const Value &v) {
+  strokes::Pose p;
+  for (const Value &x : v.items) p.push_back((float)x.number);
+  return p;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s IN.json [--budget-ms N] [--return]\n", argv[0]);
+    return 2;
+  }
+  strokes::Options opts;
+  for (int i = 2; i < argc; i++) {
+    if (!strcmp(argv[i], "--budget-ms") && i + 1 < argc) opts.budget = std::chrono::milliseconds(atol(argv[++i]));
+    else if (!strcmp(argv[i], "--return")) opts.returnToStart = true;
+  }
+
+  std::ifstream f(argv[1], std::ios::binary);
+  std::stringstream text;
+  text << f.rdbuf();
+  Value doc;
+  if (!f || !roboarm::json::parse(text.str(), doc) || !doc.get("strokes") || !doc.get("strokes")->isArray()) {
+    fprintf(stderr, "%s: expected {\"strokes\": [...]}\n", argv[1]);
+    return 1;
+  }
+
+  std::vector<strokes::Stroke> in;
+  size_t joints = 0;
+  for (const Value &s : doc.get("strokes")->items) {
+    if (!s.isArray() || s.items.empty()) {
+      fprintf(stderr, "%s: empty stroke %zu\n", argv[1], in.size());
+      return 1;
+    }
+    in.push_back({pose(s.items.front()), pose(s.items.back())});
+    joints = std::max(joints, in.back().first.size());
+  }
+  if (const Value *v = doc.get("max_dps")) opts.maxDps = pose(*v);
+  else opts.maxDps.assign(DEFAULT_MAX_DPS, DEFAULT_MAX_DPS + 5);
+  if (const Value *v = doc.get("start")) opts.start = pose(*v);
+  opts.start.resize(joints, 0.0f);
+
+  strokes::Result r = strokes::optimize(in, opts);
+
+  roboarm::json::Writer w;
+  w.beginObject().key("order").beginArray();
+  for (uint32_t k : r.order) w.value(k);
+  w.endArray().key("reversed").beginArray();
+  for (bool b : r.reversed) w.value(b);
+  w.endArray();
+  w.key("input_ms").value(r.inputMs);
+  w.key("nearest_ms").value(r.nearestMs);
+  w.key("optimized_ms").value(r.optimizedMs);
+  w.key("saved_ms").value(r.inputMs - r.optimizedMs);
+  w.key("improvements").value((int64_t)r.improvements);
+  w.key("budget_hit").value(r.budgetHit);
+  w.endObject();
+  printf("%s\n", w.str().c_str());
+  fprintf(stderr, "%zu strokes: unlit travel %.0f ms -> %.0f ms (nearest neighbour %.0f ms), saved %.0f ms\n",
+          in.size(), r.inputMs, r.optimizedMs, r.nearestMs, r.inputMs - r.optimizedMs);
+  return 0;
+}
@@ -0,0 +1,87 @@
+#pragma once
+// Offline model of the firmware's motion path, fast enough to run a trajectory
+// hundreds of times: retiming -> point interpolation with blend zones
+// (stepArm/startBlend/planBlendZones) -> optional lag lead (referenceDeg) ->
+// input shaper (input_shaper.h, the firmware's own code) -> servo writes on
+// the update tick, quantized to PCA9685 steps -> servo lag model
+// (stepLagEstimate) -> optional arm mode (ResonanceModel). Everything runs on
+// the firmware's 2 ms shaper clock.
+//
+// A run is scored by how long the arm needs to finish and settle, and by how
+// far the modelled joints stray from the input polyline (joint space, degrees)
+// while the LED is on. A sweep runs a grid of settings in parallel and marks
+// the Pareto front of (time, max error).
+
+#include <roboarm/trajectory_file.h>
+#include <roboarm/trajectory_lod.h>
+
+#include <input_shaper.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace roboarm {
+namespace sweep {
+
+static const uint8_t MAX_JOINTS = 5;  // NUM_SERVOS
+
+// Servo response, the firmware's ServoLagModel
+struct ServoModel {
+  float deadMs = 20;
+  float tauMs = 80;
+  float maxDps = 350;  // 0 = no slew limit
+};
+
+// DEFAULT_LAG_MODEL in roboarm/src/main.cpp: MG996R x3, MG90S x2
+std::vector<ServoModel> defaultServos();
+
+// The arm being modelled; fixed for a sweep
+struct Model {
+  std::vector<ServoModel> servos = defaultServos();
+  std::vector<float> resolutionDeg = traj::defaultResolutionDeg();  // per joint, 0 = unquantized
+  uint32_t tickMs = 15;        // UPDATE_DT_MS: servo writes
+  float modeHz = 0;            // arm mode on top of the servos, 0 = none
+  float modeDamping = 0.05f;
+  float settleDeg = 0.25f;     // "arrived": every joint this close to the last point
+  uint32_t maxSettleMs = 3000; // give up settling after this
+};
+
+// One point of the grid
+struct Settings {
+  uint32_t pointMs = 0;  // duration of every point, 0 = the trajectory's own ms
+  float maxDps = 0;      // joint speed limit used to stretch points, 0 = off
+  float accel = 0;       // deg/s^2: a point takes at least 2*sqrt(step/accel), 0 = off
+  float blendDeg = -1;   // blend radius on every point, <0 = as in the trajectory
+  ShaperType shaper = SHAPER_NONE;
+  float shaperHz = 0;
+  float shaperDamping = 0;
+  bool lead = false;     // lag mode "lead"
+};
+
+struct Result {
+  double timeMs = 0;       // until settled (or the settle cap)
+  double moveMs = 0;       // until the last point's move ends
+  float maxErrorDeg = 0;   // worst distance from the polyline while lit
+  float rmsErrorDeg = 0;
+  bool settled = false;
+  bool valid = true;       // false: shaper does not fit the history buffer
+  bool pareto = false;
+};
+
+// Point durations and blend radii for the settings; angles and LEDs unchanged
+std::vector<traj::Point> retime(const std::vector<traj::Point> &points, uint8_t joints, const Settings &s);
+
+// Runs the model over points (already retimed). The arm starts at point 0.
+Result simulate(const std::vector<traj::Point> &points, uint8_t joints, const Settings &s, const Model &m);
+
+// retime + simulate for every setting on `threads` workers (0 = all cores),
+// then marks the Pareto front
+std::vector<Result> run(const std::vector<traj::Point> &points, uint8_t joints, const std::vector<Settings> &grid,
+                        const Model &m, int threads = 0);
+
+// Index of the fastest valid run with maxErrorDeg <= maxErrorDeg, -1 if none
+int pickFastest(const std::vector<Result> &results, float maxErrorDeg);
+
+}  // namespace sweep
+}  // namespace roboarm
@@ -0,0 +1,307 @@
+// Offline motion model and parameter sweep, see motion_sim.h
+#include <roboarm/motion_sim.h>
+#include <roboarm/parallel.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace roboarm {
+namespace sweep {
+
+std::vector<ServoModel> defaultServos() {
+  // DEFAULT_LAG_MODEL in roboarm/src/main.cpp
+  return {{20, 80, 350}, {20, 80, 350}, {20, 80, 350}, {20, 50, 600}, {20, 50, 600}};
+}
+
+namespace {
+
+const float BLEND_MAX_FRACTION = 0.5f;  // main.cpp
+const uint8_t DEAD_SAMPLES = 64;        // LAG_DEAD_SAMPLES
+const uint32_t SETTLE_HOLD_MS = 200;    // in the band this long counts as settled
+
+float stepDeg(const traj::Point &a, const traj::Point &b, uint8_t joints) {
+  float d = 0;
+  for (uint8_t j = 0; j < joints; j++) d = std::max(d, std::fabs(b.deg[j] - a.deg[j]));
+  return d;
+}
+
+// planBlendZones with "blend" (degrees of the largest joint step); the move
+// into point 0 does not exist since the arm starts there
+std::vector<uint32_t> blendZones(const std::vector<traj::Point> &p, uint8_t joints) {
+  size_t n = p.size();
+  std::vector<uint32_t> out(n, 0);
+  for (size_t k = 1; k + 1 < n; k++) {
+    float r = p[k].blend;
+    if (r <= 0) continue;
+    float lenIn = stepDeg(p[k - 1], p[k], joints), lenOut = stepDeg(p[k], p[k + 1], joints);
+    float fin = lenIn > r / BLEND_MAX_FRACTION ? r / lenIn : BLEND_MAX_FRACTION;
+    float fout = lenOut > r / BLEND_MAX_FRACTION ? r / lenOut : BLEND_MAX_FRACTION;
+    out[k] = (uint32_t)std::min(fin * p[k].ms, fout * p[k + 1].ms);
+  }
+  return out;
+}
+
+// stepArm/startMoveAt/startBlend/referenceDeg for one arm in trajectory mode
+class Engine {
+ public:
+  Engine(const std::vector<traj::Point> &p, uint8_t joints)
+      : p_(p), joints_(joints), blendMs_(blendZones(p, joints)) {
+    for (uint8_t j = 0; j < joints_; j++) curr[j] = p_[0].deg[j];
+    led = p_[0].led;
+  }
+
+  bool done() const { return next_ >= p_.size() && !moving_; }
+  size_t segment() const { return next_ - 1; }  // point being moved to (or the last one)
+
+  void step(uint32_t now) {
+    for (;;) {
+      if (next_ < p_.size()) {
+        uint32_t blendMs = blendMs_[next_ - 1];
+        bool blend = moving_ && blendMs > 0 && now - moveStart_ + blendMs >= moveDur_;
+        if (!moving_ || blend) {
+          start(now, next_, blend);
+          next_++;
+        }
+      }
+      if (!moving_) return;
+      float t = (float)(now - moveStart_) / (float)moveDur_;
+      if (t < 1.0f) {
+        for (uint8_t j = 0; j < joints_; j++) curr[j] = start_[j] + (target_[j] - start_[j]) * t + blendDeg(j, now);
+        return;
+      }
+      // The firmware starts the next point on the following loop pass, well
+      // under a sample later: do it now
+      for (uint8_t j = 0; j < joints_; j++) curr[j] = target_[j];
+      moving_ = false;
+      blendDur_ = 0;
+      if (next_ >= p_.size()) return;
+    }
+  }
+
+  float reference(uint8_t j, uint32_t at) const {
+    if (!moving_) return curr[j];
+    uint32_t dt = at - moveStart_;
+    if (dt < moveDur_) return start_[j] + (target_[j] - start_[j]) * ((float)dt / (float)moveDur_) + blendDeg(j, at);
+    if (next_ < p_.size()) {
+      float u = (float)(dt - moveDur_) / (float)std::max<uint32_t>(1, p_[next_].ms);
+      if (u > 1.0f) u = 1.0f;
+      return target_[j] + (p_[next_].deg[j] - target_[j]) * u;
+    }
+    return target_[j];
+  }
+
+  float curr[MAX_JOINTS] = {};
+  uint8_t led = 0;
+
+ private:
+  void start(uint32_t now, size_t k, bool blend) {
+    float corner[MAX_JOINTS], offset[MAX_JOINTS];
+    uint32_t remainMs = 0;
+    if (blend) {
+      float t = (float)(now - moveStart_) / (float)moveDur_;
+      for (uint8_t j = 0; j < joints_; j++) {
+        corner[j] = target_[j];
+        offset[j] = (start_[j] - target_[j]) * (1.0f - t);
+      }
+      remainMs = moveStart_ + moveDur_ - now;
+    }
+    for (uint8_t j = 0; j < joints_; j++) {
+      start_[j] = curr[j];
+      target_[j] = p_[k].deg[j];
+    }
+    led = p_[k].led;
+    moveStart_ = now;
+    moveDur_ = std::max<uint32_t>(1, p_[k].ms);
+    moving_ = true;
+    blendDur_ = 0;
+    if (blend) {
+      std::copy(corner, corner + joints_, start_);
+      std::copy(offset, offset + joints_, offset_);
+      blendStart_ = now;
+      blendDur_ = std::max<uint32_t>(1, remainMs);
+    }
+  }
+
+  float blendDeg(uint8_t j, uint32_t at) const {
+    uint32_t dt = at - blendStart_;
+    if (blendDur_ == 0 || dt >= blendDur_) return 0.0f;
+    return offset_[j] * (1.0f - (float)dt / (float)blendDur_);
+  }
+
+  const std::vector<traj::Point> &p_;
+  uint8_t joints_;
+  std::vector<uint32_t> blendMs_;
+  size_t next_ = 1;
+  bool moving_ = false;
+  uint32_t moveStart_ = 0, moveDur_ = 1, blendStart_ = 0, blendDur_ = 0;
+  float start_[MAX_JOINTS] = {}, target_[MAX_JOINTS] = {}, offset_[MAX_JOINTS] = {};
+};
+
+// Distance of q from the segment a-b in joint space
+float segmentDistance(const float *q, const traj::Point &a, const traj::Point &b, uint8_t joints) {
+  float dd = 0, dq = 0;
+  for (uint8_t j = 0; j < joints; j++) {
+    float d = b.deg[j] - a.deg[j];
+    dd += d * d;
+    dq += (q[j] - a.deg[j]) * d;
+  }
+  float u = dd > 0 ? std::min(std::max(dq / dd, 0.0f), 1.0f) : 0.0f;
+  float s = 0;
+  for (uint8_t j = 0; j < joints; j++) {
+    float e = q[j] - (a.deg[j] + u * (b.deg[j] - a.deg[j]));
+    s += e * e;
+  }
+  return std::sqrt(s);
+}
+
+}  // namespace
+
+std::vector<traj::Point> retime(const std::vector<traj::Point> &points, uint8_t joints, const Settings &s) {
+  std::vector<traj::Point> out(points);
+  joints = std::min(joints, MAX_JOINTS);
+  for (size_t k = 0; k < out.size(); k++) {
+    if (s.blendDeg >= 0) out[k].blend = s.blendDeg;
+    if (k == 0) continue;
+    float d = stepDeg(out[k - 1], out[k], joints);
+    double ms = s.pointMs > 0 ? s.pointMs : out[k].ms;
+    if (s.maxDps > 0) ms = std::max(ms, 1000.0 * d / s.maxDps);
+    if (s.accel > 0) ms = std::max(ms, 2000.0 * std::sqrt(d / s.accel));
+    out[k].ms = (uint32_t)std::max(1.0, std::ceil(ms));
+  }
+  return out;
+}
+
+Result simulate(const std::vector<traj::Point> &points, uint8_t joints, const Settings &s, const Model &m) {
+  Result r;
+  joints = std::min(joints, MAX_JOINTS);
+  if (points.empty() || joints == 0) return r;
+
+  InputShaper shaper[MAX_JOINTS];
+  ServoModel servo[MAX_JOINTS];
+  float res[MAX_JOINTS], held[MAX_JOINTS], est[MAX_JOINTS];
+  float dead[MAX_JOINTS][DEAD_SAMPLES];
+  ResonanceModel mode[MAX_JOINTS];
+  const float *start = points[0].deg;
+  for (uint8_t j = 0; j < joints; j++) {
+    if (!shaper[j].configure(s.shaper, s.shaperHz, s.shaperDamping)) {
+      r.valid = false;
+      return r;
+    }
+    shaper[j].reset((int16_t)std::lround(start[j] * 100.0f));
+    servo[j] = m.servos.empty() ? ServoModel() : m.servos[std::min((size_t)j, m.servos.size() - 1)];
+    res[j] = m.resolutionDeg.empty() ? 0.0f : m.resolutionDeg[std::min((size_t)j, m.resolutionDeg.size() - 1)];
+    held[j] = est[j] = start[j];
+    std::fill(dead[j], dead[j] + DEAD_SAMPLES, start[j]);
+    mode[j].reset(start[j]);
+  }
+
+  bool anyLit = false;
+  for (const traj::Point &p : points) anyLit |= p.led > 0;
+
+  Engine engine(points, joints);
+  const float dt = SHAPER_SAMPLE_MS / 1000.0f;
+  const uint32_t tickMs = std::max<uint32_t>(m.tickMs, SHAPER_SAMPLE_MS);
+  const traj::Point &last = points.back();
+  uint8_t head = 0;
+  uint32_t nextTick = 0, moveEnd = 0, lastOut = 0;
+  bool moveDone = false;
+  double sumSq = 0;
+  size_t lit = 0;
+
+  for (uint32_t now = 0;; now += SHAPER_SAMPLE_MS) {
+    engine.step(now);
+    if (!moveDone && engine.done()) {
+      moveDone = true;
+      moveEnd = now;
+    }
+
+    head = (uint8_t)((head + 1) % DEAD_SAMPLES);
+    float arm[MAX_JOINTS];
+    bool out = false;
+    for (uint8_t j = 0; j < joints; j++) {
+      float lead = servo[j].deadMs + servo[j].tauMs;
+      float cmd = s.lead ? engine.reference(j, now + (uint32_t)lead) : engine.curr[j];
+      shaper[j].push((int16_t)std::lround(cmd * 100.0f));
+      float shaped = shaper[j].enabled() ? shaper[j].output() / 100.0f : cmd;
+      if (now >= nextTick) held[j] = res[j] > 0 ? std::round(shaped / res[j]) * res[j] : shaped;
+
+      // stepLagEstimate on what the servo was actually sent
+      dead[j][head] = held[j];
+      uint8_t back = (uint8_t)std::min<uint32_t>((uint32_t)servo[j].deadMs / SHAPER_SAMPLE_MS, DEAD_SAMPLES - 1);
+      float u = dead[j][(head + DEAD_SAMPLES - back) % DEAD_SAMPLES];
+      float step = servo[j].tauMs > 0 ? (u - est[j]) * (1.0f - std::exp(-dt * 1000.0f / servo[j].tauMs)) : u - est[j];
+      if (servo[j].maxDps > 0) step = std::min(std::max(step, -servo[j].maxDps * dt), servo[j].maxDps * dt);
+      est[j] += step;
+
+      arm[j] = est[j];
+      if (m.modeHz > 0) {
+        mode[j].step(est[j], dt, m.modeHz, m.modeDamping);
+        arm[j] = mode[j].pos;
+      }
+      out |= std::fabs(arm[j] - last.deg[j]) > m.settleDeg;
+    }
+    if (now >= nextTick) nextTick += tickMs;
+
+    if (!anyLit || engine.led > 0) {
+      // Nearest segment around the one being executed; the arm trails it
+      size_t seg = engine.segment();
+      size_t lo = seg > 24 ? seg - 24 : 1, hi = std::min(seg + 4, points.size() - 1);
+      float e = points.size() == 1 ? segmentDistance(arm, points[0], points[0], joints) : INFINITY;
+      for (size_t k = lo; k <= hi; k++) e = std::min(e, segmentDistance(arm, points[k - 1], points[k], joints));
+      r.maxErrorDeg = std::max(r.maxErrorDeg, e);
+      sumSq += (double)e * e;
+      lit++;
+    }
+
+    if (out || !moveDone) lastOut = now;
+    if (moveDone && now - lastOut >= SETTLE_HOLD_MS) {
+      r.settled = true;
+      break;
+    }
+    if (moveDone && now - moveEnd >= m.maxSettleMs) break;
+  }
+
+  r.moveMs = moveEnd;
+  r.timeMs = r.settled ? lastOut + SHAPER_SAMPLE_MS : moveEnd + m.maxSettleMs;
+  r.rmsErrorDeg = lit ? (float)std::sqrt(sumSq / lit) : 0.0f;
+  return r;
+}
+
+std::vector<Result> run(const std::vector<traj::Point> &points, uint8_t joints, const std::vector<Settings> &grid,
+                        const Model &m, int threads) {
+  std::vector<Result> results(grid.size());
+  parallelFor(grid.size(), threads, [&](size_t i) {
+    results[i] = simulate(retime(points, joints, grid[i]), joints, grid[i], m);
+  });
+
+  // Pareto front of (time, max error): by time, keep what beats every faster run
+  std::vector<size_t> order(results.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    if (results[a].timeMs != results[b].timeMs) return results[a].timeMs < results[b].timeMs;
+    return results[a].maxErrorDeg < results[b].maxErrorDeg;
+  });
+  float best = INFINITY;
+  for (size_t i : order) {
+    if (!results[i].valid || results[i].maxErrorDeg >= best) continue;
+    results[i].pareto = true;
+    best = results[i].maxErrorDeg;
+  }
+  return results;
+}
+
+int pickFastest(const std::vector<Result> &results, float maxErrorDeg) {
+  int pick = -1;
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result &r = results[i];
+    if (!r.valid || r.maxErrorDeg > maxErrorDeg) continue;
+    if (pick < 0 || r.timeMs < results[pick].timeMs ||
+        (r.timeMs == results[pick].timeMs && r.maxErrorDeg < results[pick].maxErrorDeg))
+      pick = (int)i;
+  }
+  return pick;
+}
+
+}  // namespace sweep
+}  // namespace roboarm
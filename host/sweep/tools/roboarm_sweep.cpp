@@ -0,0 +1,288 @@
+// Parameter sweep of a trajectory over the offline motion model
+//
+//   roboarm_sweep IN.(json|rtraj) [--grid GRID.json] [--max-error DEG] [--threads N]
+//
+// Runs every combination of the grid through motion_sim.h and prints
+// {"runs": [...], "pareto": [i, ...], "best": i}: per run the settings
+// and time_ms / move_ms / max_error_deg / rms_error_deg / settled, the
+// indices of the (time, max error) Pareto front by time, and the fastest run
+// whose max error is within --max-error (default 1 deg; no "best" if none
+// is). The Pareto front also goes to stderr as a table.
+//
+// GRID.json lists the values to try; missing keys keep the defaults below.
+//   {"ms": [0], "max_dps": [0, 60, 120, 240], "accel": [0, 300, 1000],
+//    "blend": [0, 0.5, 1, 2], "lag": ["off", "lead"],
+//    "shaper": ["none", {"type": "zvd", "freq": 8, "damping": 0.1}],
+//    "servos": [{"dead_ms": 20, "tau_ms": 80, "max_dps": 350}, ...],
+//    "mode": {"freq": 6, "damping": 0.05}, "tick_ms": 15}
+// "ms" 0 keeps the trajectory's own point durations and "blend" -1 its own
+// radii. "servos", "mode" and "tick_ms" describe the arm (one per sweep, as
+// for the firmware's "lag" command and the ringing test), not grid axes.
+
+#include <roboarm/json.h>
+#include <roboarm/motion_sim.h>
+#include <roboarm/trajectory_file.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using roboarm::json::Value;
+namespace sweep = roboarm::sweep;
+namespace traj = roboarm::traj;
+
+namespace {
+
+double number(const Value *v, double def) { return v && v->isNumber() ? v->number : def; }
+
+bool readJson(const char *path, Value &doc) {
+  std::ifstream f(path, std::ios::binary);
+  std::stringstream text;
+  text << f.rdbuf();
+  return f && roboarm::json::parse(text.str(), doc);
+}
+
+// A {"cmd":"trajectory","points":[...]} message, {"points":[...]}, a bare
+// point array or an .rtraj file
+bool readPoints(const char *path, std::vector<traj::Point> &out, uint8_t &joints) {
+  size_t len = strlen(path);
+  if (len > 6 && !strcmp(path + len - 6, ".rtraj")) {
+    traj::File file;
+    if (const char *err = file.open(path)) {
+      fprintf(stderr, "%s: %s\n", path, err);
+      return false;
+    }
+    joints = file.joints();
+    for (uint64_t i = 0; i < file.size(); i++) out.push_back(file.point(i));
+    return true;
+  }
+
+  Value doc;
+  if (!readJson(path, doc)) {
+    fprintf(stderr, "%s: not JSON\n", path);
+    return false;
+  }
+  const Value *points = doc.isArray() ? &doc : doc.get("points");
+  if (!points || !points->isArray()) {
+    fprintf(stderr, "%s: no points\n", path);
+    return false;
+  }
+  joints = 0;
+  traj::Point prev;  // missing joints hold the previous angle, like the firmware
+  for (const Value &p : points->items) {
+    traj::Point pt = prev;
+    const Value *deg = p.get("deg");
+    for (size_t i = 0; deg && i < deg->items.size() && i < traj::MAX_JOINTS; i++) {
+      pt.deg[i] = (float)deg->items[i].number;
+      joints = std::max(joints, (uint8_t)(i + 1));
+    }
+    pt.ms = (uint32_t)number(p.get("ms"), 200);
+    pt.blend = (float)number(p.get("blend"), 0);
+    pt.led = (uint8_t)number(p.get("led"), prev.led);
+    out.push_back(pt);
+    prev = pt;
+  }
+  return true;
+}
+
+std::vector<double> axis(const Value &grid, const char *key, std::vector<double> def) {
+  const Value *v = grid.get(key);
+  if (!v) return def;
+  std::vector<double> out;
+  if (v->isNumber()) out.push_back(v->number);
+  for (const Value &x : v->items)
+    if (x.isNumber()) out.push_back(x.number);
+  return out.empty() ? def : out;
+}
+
+struct ShaperSetting {
+  ShaperType type;
+  float freq, damping;
+};
+
+const char *shaperAxis(const Value &grid, std::vector<ShaperSetting> &out) {
+  out = {{SHAPER_NONE, 0, 0}};
+  const Value *v = grid.get("shaper");
+  if (!v) return nullptr;
+  std::vector<Value> items = v->isArray() ? v->items : std::vector<Value>{*v};
+  out.clear();
+  for (const Value &s : items) {
+    ShaperSetting ss = {SHAPER_NONE, 0, 0};
+    const Value *type = s.isString() ? &s : s.get("type");
+    if (type && !shaperFromName(type->string.c_str(), ss.type)) return "bad_shaper";
+    ss.freq = (float)number(s.get("freq"), 0);
+    ss.damping = (float)number(s.get("damping"), 0);
+    out.push_back(ss);
+  }
+  return out.empty() ? "bad_shaper" : nullptr;
+}
+
+const char *lagAxis(const Value &grid, std::vector<bool> &out) {
+  out = {false, true};
+  const Value *v = grid.get("lag");
+  if (!v) return nullptr;
+  std::vector<Value> items = v->isArray() ? v->items : std::vector<Value>{*v};
+  out.clear();
+  for (const Value &s : items) {
+    if (s.string == "off") out.push_back(false);
+    else if (s.string == "lead") out.push_back(true);
+    else return "bad_lag";
+  }
+  return out.empty() ? "bad_lag" : nullptr;
+}
+
+double milli(double v) { return std::round(v * 1000.0) / 1000.0; }
+
+void writeSettings(roboarm::json::Writer &w, const sweep::Settings &s) {
+  w.beginObject();
+  w.key("ms").value(s.pointMs).key("max_dps").value(milli(s.maxDps)).key("accel").value(milli(s.accel));
+  w.key("blend").value(milli(s.blendDeg));
+  w.key("shaper").beginObject().key("type").value(shaperName(s.shaper));
+  if (s.shaper != SHAPER_NONE) w.key("freq").value(milli(s.shaperHz)).key("damping").value(milli(s.shaperDamping));
+  w.endObject().key("lag").value(s.lead ? "lead" : "off");
+  w.endObject();
+}
+
+void printRow(const sweep::Settings &s, const sweep::Result &r, int i) {
+  char shaper[32] = "none";
+  if (s.shaper != SHAPER_NONE) snprintf(shaper, sizeof(shaper), "%s %.1f/%.2f", shaperName(s.shaper), s.shaperHz, s.shaperDamping);
+  fprintf(stderr, "%4d %9.2f %8.3f %8.3f %5u %7.0f %7.0f %5.2f %-14s %s%s\n", i, r.timeMs / 1000.0, r.maxErrorDeg,
+          r.rmsErrorDeg, s.pointMs, s.maxDps, s.accel, s.blendDeg, shaper, s.lead ? "lead" : "off",
+          r.settled ? "" : "  (not settled)");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s IN.(json|rtraj) [--grid GRID.json] [--max-error DEG] [--threads N]\n", argv[0]);
+    return 2;
+  }
+  const char *gridPath = nullptr;
+  float maxError = 1.0f;
+  int threads = 0;
+  for (int i = 2; i < argc; i++) {
+    if (!strcmp(argv[i], "--grid") && i + 1 < argc) gridPath = argv[++i];
+    else if (!strcmp(argv[i], "--max-error") && i + 1 < argc) maxError = (float)atof(argv[++i]);
+    else if (!strcmp(argv[i], "--threads") && i + 1 < argc) threads = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 2;
+    }
+  }
+
+  std::vector<traj::Point> points;
+  uint8_t joints = 0;
+  if (!readPoints(argv[1], points, joints)) return 1;
+  if (points.size() < 2 || joints == 0) {
+    fprintf(stderr, "%s: need at least 2 points\n", argv[1]);
+    return 1;
+  }
+  if (joints > sweep::MAX_JOINTS) {
+    fprintf(stderr, "%s: %u joints, modelling the first %u\n", argv[1], joints, sweep::MAX_JOINTS);
+    joints = sweep::MAX_JOINTS;
+  }
+
+  Value grid;
+  grid.type = Value::OBJECT;
+  if (gridPath && !readJson(gridPath, grid)) {
+    fprintf(stderr, "%s: not JSON\n", gridPath);
+    return 1;
+  }
+
+  sweep::Model model;
+  if (const Value *servos = grid.get("servos")) {
+    std::vector<sweep::ServoModel> defaults = model.servos;
+    model.servos.clear();
+    for (const Value &s : servos->items) {
+      sweep::ServoModel sm = defaults[std::min(model.servos.size(), defaults.size() - 1)];
+      sm.deadMs = (float)number(s.get("dead_ms"), sm.deadMs);
+      sm.tauMs = (float)number(s.get("tau_ms"), sm.tauMs);
+      sm.maxDps = (float)number(s.get("max_dps"), sm.maxDps);
+      model.servos.push_back(sm);
+    }
+  }
+  if (const Value *mode = grid.get("mode")) {
+    model.modeHz = (float)number(mode->get("freq"), 0);
+    model.modeDamping = (float)number(mode->get("damping"), model.modeDamping);
+  }
+  model.tickMs = (uint32_t)number(grid.get("tick_ms"), model.tickMs);
+
+  std::vector<ShaperSetting> shapers;
+  std::vector<bool> lags;
+  const char *err = shaperAxis(grid, shapers);
+  if (!err) err = lagAxis(grid, lags);
+  if (err) {
+    fprintf(stderr, "%s: %s\n", gridPath, err);
+    return 1;
+  }
+
+  std::vector<sweep::Settings> settings;
+  for (double ms : axis(grid, "ms", {0}))
+    for (double dps : axis(grid, "max_dps", {0, 60, 120, 240}))
+      for (double acc : axis(grid, "accel", {0, 300, 1000}))
+        for (double blend : axis(grid, "blend", {0, 0.5, 1, 2}))
+          for (const ShaperSetting &sh : shapers)
+            for (bool lead : lags) {
+              sweep::Settings s;
+              s.pointMs = (uint32_t)std::max(0.0, ms);
+              s.maxDps = (float)dps;
+              s.accel = (float)acc;
+              s.blendDeg = (float)blend;
+              s.shaper = sh.type;
+              s.shaperHz = sh.freq;
+              s.shaperDamping = sh.damping;
+              s.lead = lead;
+              settings.push_back(s);
+            }
+
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<sweep::Result> results = sweep::run(points, joints, settings, model, threads);
+  double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+  int best = sweep::pickFastest(results, maxError);
+
+  std::vector<int> front;
+  for (size_t i = 0; i < results.size(); i++)
+    if (results[i].pareto) front.push_back((int)i);
+  std::sort(front.begin(), front.end(), [&](int a, int b) { return results[a].timeMs < results[b].timeMs; });
+
+  roboarm::json::Writer w;
+  w.beginObject().key("runs").beginArray();
+  for (size_t i = 0; i < results.size(); i++) {
+    const sweep::Result &r = results[i];
+    w.beginObject().key("settings");
+    writeSettings(w, settings[i]);
+    w.key("valid").value(r.valid);
+    if (r.valid) {
+      w.key("time_ms").value(milli(r.timeMs)).key("move_ms").value(milli(r.moveMs));
+      w.key("max_error_deg").value(milli(r.maxErrorDeg)).key("rms_error_deg").value(milli(r.rmsErrorDeg));
+      w.key("settled").value(r.settled);
+    }
+    w.endObject();
+  }
+  w.endArray().key("pareto").beginArray();
+  for (int i : front) w.value((int32_t)i);
+  w.endArray();
+  if (best >= 0) w.key("best").value((int32_t)best);
+  w.endObject();
+  fwrite(w.str().data(), 1, w.str().size(), stdout);
+  fputc('\n', stdout);
+
+  fprintf(stderr, "%zu points, %zu runs in %.0f ms; Pareto front:\n", points.size(), results.size(), wallMs);
+  fprintf(stderr, "%4s %9s %8s %8s %5s %7s %7s %5s %-14s %s\n", "run", "time_s", "max_deg", "rms_deg", "ms", "max_dps",
+          "accel", "blend", "shaper", "lag");
+  for (int i : front) printRow(settings[i], results[i], i);
+  if (best >= 0) {
+    fprintf(stderr, "fastest within %.2f deg:\n", maxError);
+    printRow(settings[best], results[best], best);
+  } else {
+    fprintf(stderr, "no run within %.2f deg\n", maxError);
+  }
+  return 0;
+}
@@ -0,0 +1,47 @@
+#pragma once
+// Minimal assertions for the host tests: a failed CHECK prints where and what,
+// main() returns checkResult() so ctest sees the failure.
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace roboarm {
+namespace test {
+
+inline int &failures() {
+  static int n = 0;
+  return n;
+}
+
+inline bool check(bool ok, const char *file, int line, const char *what) {
+  if (!ok) {
+    std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, what);
+    failures()++;
+  }
+  return ok;
+}
+
+// Error codes are const char* or nullptr
+inline bool checkErr(const char *got, const char *want, const char *file, int line, const char *what) {
+  bool ok = got == want || (got && want && std::strcmp(got, want) == 0);
+  if (!ok) {
+    std::fprintf(stderr, "%s:%d: %s returned %s, expected %s\n", file, line, what, got ? got : "nullptr",
+                 want ? want : "nullptr");
+    failures()++;
+  }
+  return ok;
+}
+
+inline int checkResult() {
+  if (failures()) std::fprintf(stderr, "%d check(s) failed\n", failures());
+  return failures() ? 1 : 0;
+}
+
+}  // namespace test
+}  // namespace roboarm
+
+#define CHECK(cond) roboarm::test::check((cond), __FILE__, __LINE__, #cond)
+#define CHECK_NEAR(a, b, eps) \
+  roboarm::test::check(std::fabs((double)(a) - (double)(b)) <= (eps), __FILE__, __LINE__, #a " ~ " #b)
+#define CHECK_ERR(expr, want) roboarm::test::checkErr((expr), (want), __FILE__, __LINE__, #expr)
@@ -0,0 +1,112 @@
+// Image -> path pipeline on synthetic images: contours, coordinates, threads
+#include <roboarm/image_path.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "check.h"
+
+using namespace roboarm::imagepath;
+
+namespace {
+
+// RGB image with a filled rectangle of `color` on black
+Image rectangle(int w, int h, int x0, int y0, int x1, int y1, const uint8_t color[3]) {
+  Image img;
+  img.width = w;
+  img.height = h;
+  img.channels = 3;
+  img.data.assign((size_t)w * h * 3, 0);
+  for (int y = y0; y < y1; y++)
+    for (int x = x0; x < x1; x++)
+      for (int c = 0; c < 3; c++) img.data[((size_t)y * w + x) * 3 + c] = color[c];
+  return img;
+}
+
+// Distance in pixels from the outline of the rectangle [x0,x1) x [y0,y1)
+int outlineDistance(int x, int y, int x0, int y0, int x1, int y1) {
+  bool inX = x >= x0 - 2 && x <= x1 + 1, inY = y >= y0 - 2 && y <= y1 + 1;
+  int d = 1 << 20;
+  if (inY) d = std::min({d, std::abs(x - x0), std::abs(x - (x1 - 1))});
+  if (inX) d = std::min({d, std::abs(y - y0), std::abs(y - (y1 - 1))});
+  return d;
+}
+
+void testRectangle() {
+  const uint8_t red[3] = {255, 0, 0};
+  Image img = rectangle(120, 90, 30, 20, 90, 70, red);
+  Params p;
+  p.threads = 1;
+  p.tileRows = 16;
+  std::vector<Path> paths = extractPaths(img, p);
+  if (!CHECK(paths.size() == 1)) return;
+  const Path &path = paths[0];
+  CHECK(path.pixels.size() >= p.minPoints && path.pixels.size() <= p.maxPoints);
+  CHECK(path.robot.size() == path.pixels.size() && path.rgb.size() == path.pixels.size());
+
+  // An external contour: every point on the outline, all four sides visited
+  int sides[4] = {};
+  for (size_t i = 0; i < path.pixels.size(); i++) {
+    int x = path.pixels[i][0], y = path.pixels[i][1];
+    CHECK(outlineDistance(x, y, 30, 20, 90, 70) <= 2);
+    if (std::abs(x - 30) <= 2) sides[0]++;
+    if (std::abs(x - 89) <= 2) sides[1]++;
+    if (std::abs(y - 20) <= 2) sides[2]++;
+    if (std::abs(y - 69) <= 2) sides[3]++;
+    CHECK_NEAR(path.robot[i][0], x * p.scale + p.offsetX, 1e-9);
+    CHECK_NEAR(path.robot[i][1], p.offsetY, 1e-9);
+    CHECK_NEAR(path.robot[i][2], -(y * p.scale) + p.offsetZ, 1e-9);
+  }
+  CHECK(sides[0] > 0 && sides[1] > 0 && sides[2] > 0 && sides[3] > 0);
+}
+
+void testThreadsAgree() {
+  const uint8_t white[3] = {255, 255, 255};
+  Image img = rectangle(300, 200, 40, 30, 140, 120, white);
+  for (int y = 140; y < 190; y++)  // and a second shape
+    for (int x = 180; x < 280; x++)
+      if ((x - 230) * (x - 230) + (y - 165) * (y - 165) < 600)
+        for (int c = 0; c < 3; c++) img.data[((size_t)y * img.width + x) * 3 + c] = 200;
+
+  Params p;
+  p.threads = 1;
+  p.tileRows = 7;  // tiles that do not divide the image
+  std::vector<Path> one = extractPaths(img, p);
+  p.threads = 4;
+  std::vector<Path> four = extractPaths(img, p);
+  CHECK(one.size() == 2);
+  if (!CHECK(one.size() == four.size())) return;
+  for (size_t k = 0; k < one.size(); k++) CHECK(one[k].pixels == four[k].pixels);
+
+  std::vector<uint8_t> gray = toGray(img, p);
+  p.threads = 1;
+  std::vector<uint8_t> e1 = cannyEdges(gray.data(), img.width, img.height, p);
+  p.threads = 3;
+  std::vector<uint8_t> e3 = cannyEdges(gray.data(), img.width, img.height, p);
+  CHECK(e1 == e3);
+}
+
+void testBlank() {
+  const uint8_t black[3] = {0, 0, 0};
+  Image img = rectangle(64, 64, 0, 0, 0, 0, black);
+  CHECK(extractPaths(img, Params()).empty());
+
+  // Contours shorter than minContour are dropped
+  const uint8_t white[3] = {255, 255, 255};
+  img = rectangle(64, 64, 20, 20, 30, 30, white);
+  Params p;
+  CHECK(extractPaths(img, p).size() == 1);
+  p.minContour = 200;
+  CHECK(extractPaths(img, p).empty());
+}
+
+}  // namespace
+
+int main() {
+  testRectangle();
+  testThreadsAgree();
+  testBlank();
+  return roboarm::test::checkResult();
+}
@@ -0,0 +1,210 @@
+// Generated protocol codecs: binary and JSON round trips, malformed input
+#include <roboarm/protocol.h>
+
+#include <cstring>
+#include <string>
+
+#include "check.h"
+
+using namespace roboarm;
+using namespace roboarm::proto;
+
+namespace {
+
+template <typename M>
+bool binRoundTrip(const M &in, M &out) {
+  uint8_t buf[M::BIN_MAX];
+  size_t n = encodeBin(in, buf, sizeof(buf));
+  if (!CHECK(n > 0 && n <= (size_t)M::BIN_MAX)) return false;
+  CHECK(messageId(buf, n) == M::ID);
+  if (!CHECK_ERR(decodeBin(buf, n, out), nullptr)) return false;
+
+  // Every shorter prefix and one trailing byte are rejected
+  for (size_t k = 0; k < n; k++) {
+    M cut;
+    if (!CHECK(decodeBin(buf, k, cut) != nullptr)) break;
+  }
+  uint8_t longer[M::BIN_MAX + 1];
+  memcpy(longer, buf, n);
+  longer[n] = 0;
+  M extra;
+  CHECK_ERR(decodeBin(longer, n + 1, extra), "bad_binary");
+  // ...and so is a frame that is too big for the caller's buffer
+  CHECK(encodeBin(in, buf, n - 1) == 0);
+  return true;
+}
+
+template <typename M>
+bool jsonRoundTrip(const M &in, M &out) {
+  std::string text = encodeJson(in);
+  json::Value v;
+  if (!CHECK(json::parse(text, v) && v.isObject())) return false;
+  return CHECK_ERR(decodeJson(v, out), nullptr);
+}
+
+template <typename M>
+const char *decodeText(const char *text, M &out) {
+  json::Value v;
+  if (!json::parse(std::string(text), v)) return "parse_failed";
+  return decodeJson(v, out);
+}
+
+bool sameColor(const Color &a, const Color &b) {
+  return a.has_r == b.has_r && a.has_g == b.has_g && a.has_b == b.has_b && (!a.has_r || a.r == b.r) &&
+         (!a.has_g || a.g == b.g) && (!a.has_b || a.b == b.b);
+}
+
+bool sameFrame(const FrameCmd &a, const FrameCmd &b) {
+  if (a.arm != b.arm || a.deg_n != b.deg_n || a.ms != b.ms || a.has_led != b.has_led || a.has_rgb != b.has_rgb)
+    return false;
+  for (uint8_t i = 0; i < a.deg_n; i++)
+    if (a.deg[i] != b.deg[i]) return false;
+  if (a.has_led && a.led != b.led) return false;
+  return !a.has_rgb || sameColor(a.rgb, b.rgb);
+}
+
+void testFrame() {
+  FrameCmd m;
+  m.arm = 1;
+  m.deg_n = 3;
+  m.deg[0] = 10.5f;
+  m.deg[1] = -45.25f;
+  m.deg[2] = 90.0f;
+  m.ms = 123456;
+  FrameCmd out;
+  if (binRoundTrip(m, out)) CHECK(sameFrame(m, out));
+  out = FrameCmd();
+  if (jsonRoundTrip(m, out)) CHECK(sameFrame(m, out));
+
+  // Optional fields, a partial colour and all joints
+  m.deg_n = SERVOS;
+  for (uint8_t i = 0; i < SERVOS; i++) m.deg[i] = -90.0f + 45.0f * i;
+  m.has_led = true;
+  m.led = 7;
+  m.has_rgb = true;
+  m.rgb.has_r = true;
+  m.rgb.r = 255;
+  m.rgb.has_b = true;
+  m.rgb.b = 1;
+  out = FrameCmd();
+  if (binRoundTrip(m, out)) CHECK(sameFrame(m, out));
+  out = FrameCmd();
+  if (jsonRoundTrip(m, out)) CHECK(sameFrame(m, out));
+
+  // Malformed binary: wrong id, joint count out of range
+  uint8_t buf[FrameCmd::BIN_MAX];
+  size_t n = encodeBin(m, buf, sizeof(buf));
+  buf[0] = CMD_RT_FRAME;
+  CHECK_ERR(decodeBin(buf, n, out), "bad_binary");
+  buf[0] = CMD_FRAME;
+  buf[3] = SERVOS + 1;
+  CHECK_ERR(decodeBin(buf, n, out), "bad_binary");
+  buf[3] = 0;
+  CHECK_ERR(decodeBin(buf, n, out), "missing_deg");
+
+  // Malformed JSON fields
+  FrameCmd f;
+  CHECK_ERR(decodeText("{\"cmd\":\"frame\"}", f), "missing_deg");
+  CHECK_ERR(decodeText("{\"cmd\":\"frame\",\"deg\":[]}", f), "missing_deg");
+  CHECK_ERR(decodeText("{\"cmd\":\"frame\",\"deg\":[1,\"x\"]}", f), "missing_deg");
+  CHECK_ERR(decodeText("{\"cmd\":\"frame\",\"deg\":[1],\"ms\":-1}", f), "bad_ms");
+  CHECK_ERR(decodeText("{\"cmd\":\"frame\",\"deg\":[1],\"ms\":1.5}", f), "bad_ms");
+  CHECK_ERR(decodeText("{\"cmd\":\"frame\",\"deg\":[1],\"led\":256}", f), "bad_led");
+  CHECK_ERR(decodeText("{\"cmd\":\"frame\",\"deg\":[1],\"arm\":-1}", f), "bad_arm");
+  CHECK_ERR(decodeText("{\"cmd\":\"frame\",\"deg\":[1],\"rgb\":3}", f), "bad_rgb");
+  // Extra joints are ignored, defaults stay
+  f = FrameCmd();
+  CHECK_ERR(decodeText("{\"cmd\":\"frame\",\"deg\":[1,2,3,4,5,6,7]}", f), nullptr);
+  CHECK(f.deg_n == SERVOS && f.ms == FrameCmd().ms && !f.has_led && !f.has_rgb);
+}
+
+void testSmallMessages() {
+  PingCmd ping, pingOut;
+  binRoundTrip(ping, pingOut);
+
+  StatusCmd st, stOut;
+  st.arm = 3;
+  if (binRoundTrip(st, stOut)) CHECK(stOut.arm == 3);
+  stOut = StatusCmd();
+  if (jsonRoundTrip(st, stOut)) CHECK(stOut.arm == 3);
+
+  RtFrameCmd rt, rtOut;
+  rt.deg_n = 2;
+  rt.deg[0] = 1.0f;
+  rt.deg[1] = 2.0f;
+  rt.ms = 20;
+  if (binRoundTrip(rt, rtOut)) CHECK(rtOut.deg_n == 2 && rtOut.deg[1] == 2.0f && rtOut.ms == 20);
+
+  AckReply ack, ackOut;
+  ack.ok = false;
+  ack.has_err = true;
+  strcpy(ack.err, "point_ms_range");
+  if (binRoundTrip(ack, ackOut)) CHECK(!ackOut.ok && ackOut.has_err && strcmp(ackOut.err, "point_ms_range") == 0);
+  ack.ok = true;
+  ack.has_err = false;
+  ackOut = AckReply();
+  if (binRoundTrip(ack, ackOut)) CHECK(ackOut.ok && !ackOut.has_err);
+}
+
+void testStatus() {
+  StatusReply m;
+  m.arm = 1;
+  m.moving = true;
+  m.angles_n = SERVOS;
+  for (uint8_t i = 0; i < SERVOS; i++) m.angles[i] = 10.0f * i - 20.0f;
+  m.led = 128;
+  m.rgb.has_r = m.rgb.has_g = m.rgb.has_b = true;
+  m.rgb.r = 1;
+  m.rgb.g = 2;
+  m.rgb.b = 3;
+  m.trajectory_mode = true;
+  m.trajectory_points = 20;
+  m.trajectory_index = 4;
+  m.stream_freq = 50;
+  m.est_deg_n = 2;
+  m.est_deg[0] = 1.5f;
+  m.est_deg[1] = -1.5f;
+  m.has_script = true;
+  strcpy(m.script, "scan");
+  m.has_script_step = true;
+  m.script_step = 9;
+  m.wifi.ch = 6;
+  m.wifi.sta = 1;
+  m.wifi.has_rssi_min = true;
+  m.wifi.rssi_min = -61;
+
+  for (int pass = 0; pass < 2; pass++) {
+    StatusReply out;
+    bool ok = pass == 0 ? binRoundTrip(m, out) : jsonRoundTrip(m, out);
+    if (!ok) continue;
+    CHECK(out.arm == 1 && out.moving && out.angles_n == SERVOS && out.angles[4] == 20.0f);
+    CHECK(out.led == 128 && sameColor(out.rgb, m.rgb));
+    CHECK(out.trajectory_mode && out.trajectory_points == 20 && out.trajectory_index == 4);
+    CHECK(!out.stream_mode && out.stream_freq == 50);
+    CHECK(out.est_deg_n == 2 && out.est_deg[1] == -1.5f);
+    CHECK(out.has_script && strcmp(out.script, "scan") == 0 && out.has_script_step && out.script_step == 9);
+    CHECK(out.wifi.ch == 6 && out.wifi.sta == 1 && out.wifi.has_rssi_min && out.wifi.rssi_min == -61);
+  }
+
+  json::Value v;
+  CHECK(json::parse(encodeJson(m), v));
+  CHECK(replyId(v) == REPLY_STATUS);
+}
+
+void testReplyId() {
+  json::Value v;
+  CHECK(json::parse(std::string("{\"pong\":true}"), v) && replyId(v) == REPLY_PONG);
+  CHECK(json::parse(std::string("{\"ok\":false,\"err\":\"busy\"}"), v) && replyId(v) == REPLY_ACK);
+  CHECK(json::parse(std::string("{\"ringing\":true}"), v) && replyId(v) == 0);
+  CHECK(messageId(nullptr, 0) == 0);
+}
+
+}  // namespace
+
+int main() {
+  testFrame();
+  testSmallMessages();
+  testStatus();
+  testReplyId();
+  return roboarm::test::checkResult();
+}
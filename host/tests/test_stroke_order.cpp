@@ -0,0 +1,111 @@
+// Stroke order optimizer: valid tours, reported times, known optimum
+#include <roboarm/stroke_order.h>
+
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "check.h"
+
+using namespace roboarm::strokes;
+
+namespace {
+
+Options options(std::vector<float> maxDps, Pose start) {
+  Options opts;
+  opts.maxDps = std::move(maxDps);
+  opts.start = std::move(start);
+  return opts;
+}
+
+// Unlit travel of a result, recomputed from the strokes
+double tourMs(const std::vector<Stroke> &strokes, const Result &r, const Options &opts) {
+  double ms = 0;
+  Pose at = opts.start;
+  for (size_t i = 0; i < r.order.size(); i++) {
+    const Stroke &s = strokes[r.order[i]];
+    ms += travelMs(at, r.reversed[i] ? s.last : s.first, opts.maxDps);
+    at = r.reversed[i] ? s.first : s.last;
+  }
+  if (opts.returnToStart) ms += travelMs(at, opts.start, opts.maxDps);
+  return ms;
+}
+
+bool isPermutation(const Result &r, size_t n) {
+  if (r.order.size() != n || r.reversed.size() != n) return false;
+  std::vector<uint32_t> sorted = r.order;
+  std::sort(sorted.begin(), sorted.end());
+  for (size_t k = 0; k < n; k++)
+    if (sorted[k] != k) return false;
+  return true;
+}
+
+void testTravel() {
+  std::vector<float> dps = {100, 50};
+  CHECK_NEAR(travelMs({0, 0}, {10, 0}, dps), 100.0, 1e-6);
+  CHECK_NEAR(travelMs({0, 0}, {10, 10}, dps), 200.0, 1e-6);  // the slower joint decides
+  CHECK_NEAR(travelMs({5, 5}, {5, 5}, dps), 0.0, 1e-9);
+}
+
+void testLine() {
+  // Strokes along one joint, shuffled and half of them stored backwards: the
+  // best order draws them left to right, each unlit move is the 5 deg gap
+  const size_t n = 20;
+  std::vector<Stroke> strokes;
+  for (size_t k = 0; k < n; k++) {
+    Stroke s{{10.0f * k, 0.0f}, {10.0f * k + 5.0f, 0.0f}};
+    if (k % 2) std::swap(s.first, s.last);
+    strokes.push_back(s);
+  }
+  std::mt19937 rng(7);
+  std::shuffle(strokes.begin(), strokes.end(), rng);
+  Options opts = options({100, 100}, {0, 0});
+  opts.budget = std::chrono::milliseconds(2000);
+  Result r = optimize(strokes, opts);
+  CHECK(isPermutation(r, n));
+  CHECK_NEAR(r.optimizedMs, (n - 1) * 50.0, 1e-3);
+  CHECK_NEAR(tourMs(strokes, r, opts), r.optimizedMs, 1e-3);
+  CHECK(r.optimizedMs < r.inputMs);
+}
+
+void testRandom() {
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> deg(-90.0f, 90.0f);
+  std::vector<Stroke> strokes;
+  for (int k = 0; k < 60; k++) {
+    Pose first = {deg(rng), deg(rng), deg(rng)};
+    Pose last = {deg(rng), deg(rng), deg(rng)};
+    strokes.push_back({first, last});
+  }
+  for (bool back : {false, true}) {
+    Options opts = options({120, 90, 60}, {0, 0, 0});
+    opts.returnToStart = back;
+    opts.budget = std::chrono::milliseconds(2000);
+    Result r = optimize(strokes, opts);
+    CHECK(isPermutation(r, strokes.size()));
+    CHECK(!r.budgetHit);
+    CHECK(r.optimizedMs <= r.nearestMs + 1e-6 && r.optimizedMs <= r.inputMs + 1e-6);
+    CHECK_NEAR(tourMs(strokes, r, opts), r.optimizedMs, 1e-2);
+  }
+}
+
+void testEdgeCases() {
+  Options opts = options({100}, {0});
+  Result r = optimize({}, opts);
+  CHECK(r.order.empty() && r.optimizedMs == 0);
+
+  r = optimize({Stroke{{50}, {10}}}, opts);
+  CHECK(r.order.size() == 1 && r.reversed[0]);  // start at the nearer end
+  CHECK_NEAR(r.optimizedMs, 100.0, 1e-6);
+}
+
+}  // namespace
+
+int main() {
+  testTravel();
+  testLine();
+  testRandom();
+  testEdgeCases();
+  return roboarm::test::checkResult();
+}
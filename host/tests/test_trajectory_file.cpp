@@ -0,0 +1,227 @@
+// .rtraj records, Writer -> File::open round trip, header validation and seek
+#include <roboarm/trajectory_file.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "check.h"
+
+using namespace roboarm::traj;
+
+namespace {
+
+const uint8_t JOINTS = 5;
+
+std::vector<Point> samplePoints(size_t n) {
+  std::vector<Point> points;
+  for (size_t i = 0; i < n; i++) {
+    Point p;
+    for (uint8_t j = 0; j < JOINTS; j++) p.deg[j] = (float)((int)(i * 7 + j * 13) % 181 - 90) + 0.25f;
+    p.ms = 10 + (uint32_t)(i % 5) * 40;
+    p.blend = (float)(i % 3);
+    p.led = (uint8_t)(i % 2 ? 255 : 0);
+    p.r = (uint8_t)i;
+    p.g = (uint8_t)(i * 3);
+    p.b = (uint8_t)(255 - i);
+    points.push_back(p);
+  }
+  return points;
+}
+
+void writeBytes(const std::string &path, const std::vector<uint8_t> &data) {
+  FILE *f = fopen(path.c_str(), "wb");
+  if (!f) return;
+  fwrite(data.data(), 1, data.size(), f);
+  fclose(f);
+}
+
+void put64(std::vector<uint8_t> &d, size_t at, uint64_t v) {
+  for (int i = 0; i < 8; i++) d[at + i] = (uint8_t)(v >> (8 * i));
+}
+
+bool samePoint(const Point &a, const Point &b) {
+  for (uint8_t j = 0; j < JOINTS; j++)
+    if (std::fabs(a.deg[j] - b.deg[j]) > 0.005f) return false;
+  return std::fabs(a.blend - b.blend) <= 0.005f && a.ms == b.ms && a.led == b.led && a.r == b.r && a.g == b.g &&
+         a.b == b.b;
+}
+
+// Reference for seek: linear walk over the point list
+uint64_t scan(const std::vector<Point> &points, uint64_t ms, uint64_t &start) {
+  start = 0;
+  for (size_t i = 0; i < points.size(); i++) {
+    if (start + points[i].ms > ms) return i;
+    start += points[i].ms;
+  }
+  return points.size();
+}
+
+void testRecord() {
+  Point p;
+  p.deg[0] = 12.345f;
+  p.deg[1] = -90.0f;
+  p.deg[2] = 400.0f;  // saturates
+  p.deg[3] = -400.0f;
+  p.ms = 70000;
+  p.blend = 2.5f;
+  p.led = 200;
+  p.r = 1;
+  p.g = 2;
+  p.b = 3;
+  CHECK(recordSize(JOINTS) % 4 == 0);
+  std::vector<uint8_t> rec(recordSize(JOINTS));
+  encodeRecord(p, JOINTS, rec.data());
+  Point q = decodeRecord(rec.data(), JOINTS);
+  CHECK_NEAR(q.deg[0], 12.35, 1e-4);
+  CHECK_NEAR(q.deg[1], -90.0, 1e-4);
+  CHECK_NEAR(q.deg[2], 327.67, 1e-3);
+  CHECK_NEAR(q.deg[3], -327.68, 1e-3);
+  CHECK_NEAR(q.deg[4], 0.0, 1e-6);
+  CHECK_NEAR(q.blend, 2.5, 1e-4);
+  CHECK(q.ms == 70000 && q.led == 200 && q.r == 1 && q.g == 2 && q.b == 3);
+
+  p.blend = -1.0f;  // no blend
+  encodeRecord(p, JOINTS, rec.data());
+  CHECK(decodeRecord(rec.data(), JOINTS).blend == 0.0f);
+}
+
+void testRoundTrip(uint32_t indexEvery) {
+  std::vector<Point> points = samplePoints(37);
+  Writer w(JOINTS, indexEvery);
+  uint64_t total = 0;
+  for (const Point &p : points) {
+    w.add(p);
+    total += p.ms;
+  }
+  CHECK(w.size() == points.size());
+  CHECK(w.totalMs() == total);
+
+  std::string path = "roundtrip_" + std::to_string(indexEvery) + ".rtraj";
+  CHECK_ERR(w.save(path), nullptr);
+  File f;
+  if (!CHECK_ERR(f.open(path), nullptr)) return;
+  CHECK(f.joints() == JOINTS);
+  CHECK(f.unitsPerDeg() == UNITS_PER_DEG);
+  CHECK(f.recordSize() == recordSize(JOINTS));
+  CHECK(f.size() == points.size());
+  CHECK(f.totalMs() == total);
+  CHECK(f.hasIndex() == (indexEvery > 0));
+  for (size_t i = 0; i < points.size(); i++) {
+    CHECK(samePoint(f.point(i), points[i]));
+    CHECK(f.durationMs(i) == points[i].ms);
+  }
+
+  // Every boundary, the ms on either side of it and past the end
+  for (uint64_t ms = 0; ms <= total + 5; ms++) {
+    uint64_t want, wantStart, got, gotStart = 12345;
+    want = scan(points, ms, wantStart);
+    got = f.seek(ms, &gotStart);
+    if (!CHECK(got == want && gotStart == wantStart)) {
+      std::fprintf(stderr, "  seek(%llu) with index every %u\n", (unsigned long long)ms, indexEvery);
+      break;
+    }
+  }
+  CHECK(f.seek(total) == f.size());
+  remove(path.c_str());
+}
+
+void testEmpty() {
+  Writer w(JOINTS);
+  CHECK_ERR(w.save("empty.rtraj"), nullptr);
+  File f;
+  CHECK_ERR(f.open("empty.rtraj"), nullptr);
+  CHECK(f.size() == 0 && f.totalMs() == 0);
+  CHECK(f.seek(100) == 0);
+  remove("empty.rtraj");
+}
+
+void testBadFiles() {
+  File f;
+  CHECK_ERR(f.open("does_not_exist.rtraj"), "open_failed");
+  CHECK(!f.isOpen());
+
+  Writer w(JOINTS, 4);
+  for (const Point &p : samplePoints(10)) w.add(p);
+  const std::vector<uint8_t> good = w.bytes();
+  const std::string path = "bad.rtraj";
+
+  writeBytes(path, std::vector<uint8_t>(good.begin(), good.begin() + HEADER_SIZE - 1));
+  CHECK_ERR(f.open(path), "truncated");
+
+  std::vector<uint8_t> d = good;
+  d[0] = 'X';
+  writeBytes(path, d);
+  CHECK_ERR(f.open(path), "bad_magic");
+
+  d = good;
+  d[4] = 2;
+  writeBytes(path, d);
+  CHECK_ERR(f.open(path), "bad_version");
+
+  d = good;
+  d[8] = 0;  // joints
+  writeBytes(path, d);
+  CHECK_ERR(f.open(path), "bad_header");
+
+  d = good;
+  d[8] = MAX_JOINTS + 1;
+  writeBytes(path, d);
+  CHECK_ERR(f.open(path), "bad_header");
+
+  d = good;
+  d[10] = 4;  // record size smaller than the joints need
+  d[11] = 0;
+  writeBytes(path, d);
+  CHECK_ERR(f.open(path), "bad_header");
+
+  d = good;
+  put64(d, 24, 8);  // records inside the header
+  writeBytes(path, d);
+  CHECK_ERR(f.open(path), "bad_header");
+
+  // Records cut short: the index is gone and the last record is partial
+  size_t recordsEnd = HEADER_SIZE + 10 * recordSize(JOINTS);
+  writeBytes(path, std::vector<uint8_t>(good.begin(), good.begin() + recordsEnd - 1));
+  CHECK_ERR(f.open(path), "truncated");
+
+  // Index cut short
+  writeBytes(path, std::vector<uint8_t>(good.begin(), good.end() - 1));
+  CHECK_ERR(f.open(path), "truncated");
+
+  d = good;
+  put64(d, 16, 1000000);  // more records than the file holds
+  writeBytes(path, d);
+  CHECK_ERR(f.open(path), "truncated");
+
+  d = good;
+  put64(d, 32, d.size() + 16);  // index past the end
+  writeBytes(path, d);
+  CHECK_ERR(f.open(path), "truncated");
+  CHECK(!f.isOpen());
+
+  // A damaged index entry falls back to a scan
+  d = good;
+  put64(d, recordsEnd + 2 * INDEX_ENTRY_SIZE, 999);  // last entry points past the records
+  writeBytes(path, d);
+  if (CHECK_ERR(f.open(path), nullptr)) {
+    std::vector<Point> points = samplePoints(10);
+    uint64_t start, want = scan(points, f.totalMs() - 1, start);
+    CHECK(f.seek(f.totalMs() - 1) == want);
+  }
+  f.close();
+  remove(path.c_str());
+}
+
+}  // namespace
+
+int main() {
+  testRecord();
+  testRoundTrip(0);
+  testRoundTrip(1);
+  testRoundTrip(4);
+  testRoundTrip(256);
+  testEmpty();
+  testBadFiles();
+  return roboarm::test::checkResult();
+}
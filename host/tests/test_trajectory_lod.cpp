@@ -0,0 +1,131 @@
+// Trajectory LOD pyramid: error bounds, pinned points, timing
+#include <roboarm/trajectory_lod.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "check.h"
+
+using namespace roboarm::traj;
+
+namespace {
+
+const uint8_t JOINTS = 5;
+
+// A slow wave on every joint with the light switched on for the middle third
+std::vector<Point> wave(size_t n) {
+  std::vector<Point> points;
+  for (size_t i = 0; i < n; i++) {
+    Point p;
+    for (uint8_t j = 0; j < JOINTS; j++) p.deg[j] = 40.0f * std::sin(0.05f * (float)i + j) + 0.3f * (float)(i % 3);
+    p.ms = 20 + (uint32_t)(i % 4) * 5;
+    p.led = i >= n / 3 && i < 2 * n / 3 ? 255 : 0;
+    points.push_back(p);
+  }
+  return points;
+}
+
+uint64_t totalMs(const std::vector<Point> &points) {
+  uint64_t t = 0;
+  for (const Point &p : points) t += p.ms;
+  return t;
+}
+
+bool keeps(const LodLevel &level, uint32_t i) { return std::binary_search(level.keep.begin(), level.keep.end(), i); }
+
+void testStraightLine() {
+  std::vector<Point> points;
+  for (int i = 0; i < 50; i++) {
+    Point p;
+    for (uint8_t j = 0; j < JOINTS; j++) p.deg[j] = (float)i * (j + 1) * 0.5f;
+    p.ms = 10;
+    points.push_back(p);
+  }
+  Lod lod = buildLod(points, JOINTS);
+  CHECK(lod.levels.size() == 2);
+  CHECK(lod.levels[0].keep.size() == points.size());
+  const LodLevel &l1 = lod.levels.back();
+  CHECK(l1.keep.size() == 2 && l1.keep.front() == 0 && l1.keep.back() == 49);
+  CHECK(l1.maxErrorSteps < 1e-3f);
+  std::vector<Point> out = levelPoints(points, l1);
+  CHECK(out.size() == 2 && out[0].ms == 10 && out[1].ms == 490);
+}
+
+void testPyramid() {
+  std::vector<Point> points = wave(400);
+  LodOptions opts;
+  opts.pinned = {123, 5000};  // out of range ones are ignored
+  Lod lod = buildLod(points, JOINTS, opts);
+  CHECK(lod.levels.size() > 3);
+  uint64_t total = totalMs(points);
+  uint32_t on = 400 / 3, off = 2 * 400 / 3;
+  for (size_t l = 1; l < lod.levels.size(); l++) {
+    const LodLevel &level = lod.levels[l];
+    CHECK(level.maxErrorSteps <= level.toleranceSteps);
+    CHECK(level.keep.size() <= lod.levels[l - 1].keep.size());
+    CHECK(std::is_sorted(level.keep.begin(), level.keep.end()));
+    CHECK(keeps(level, 0) && keeps(level, 399) && keeps(level, 123));
+    CHECK(keeps(level, on - 1) && keeps(level, on) && keeps(level, off - 1) && keeps(level, off));
+    CHECK(totalMs(levelPoints(points, level)) == total);
+    if (l > 1) CHECK_NEAR(level.toleranceSteps, 2 * lod.levels[l - 1].toleranceSteps, 1e-6);
+  }
+  CHECK(levelForResolution(lod, 0.5f) == 1);
+  CHECK(levelForResolution(lod, 0.1f) == 0);
+  size_t budget = lod.levels[2].keep.size();
+  CHECK(levelForBudget(lod, budget) == 2);
+  CHECK(levelForBudget(lod, 0) == lod.levels.size() - 1);
+}
+
+void testColour() {
+  // Joints on a straight line, the light lit throughout: red with a green
+  // ramp and a slight dip in brightness, then blue, then dimmed. The two big
+  // switches are pinned, the dip is kept while the tolerance is below it and
+  // the linear ramp is never needed
+  std::vector<Point> points;
+  for (uint32_t i = 0; i < 200; i++) {
+    Point p;
+    for (uint8_t j = 0; j < JOINTS; j++) p.deg[j] = (float)i * 0.3f;
+    p.ms = 10;
+    p.led = i < 50 ? 255 : i < 100 ? 240 : i < 150 ? 255 : 120;
+    p.r = i < 100 ? 255 : 0;
+    p.g = i < 100 ? (uint8_t)(2 * i) : 0;
+    p.b = i < 100 ? 0 : 255;
+    points.push_back(p);
+  }
+  Lod lod = buildLod(points, JOINTS);
+  CHECK(lod.levels.size() > 3);
+  CHECK((lod.levels[1].keep == std::vector<uint32_t>{0, 49, 50, 99, 100, 149, 150, 199}));
+  CHECK(lod.levels.back().keep.size() == 6 && !keeps(lod.levels.back(), 50));
+  for (size_t l = 1; l < lod.levels.size(); l++) {
+    const LodLevel &level = lod.levels[l];
+    CHECK(keeps(level, 99) && keeps(level, 100) && keeps(level, 149) && keeps(level, 150));
+    CHECK(level.maxErrorLevel <= level.toleranceSteps && level.maxErrorSteps <= level.toleranceSteps);
+    CHECK(level.maxErrorDeg < 1e-3f);
+  }
+
+  // Without switch pins and with the light weighted down to nothing only the
+  // ends are left
+  LodOptions opts;
+  opts.switchLevels = 0;
+  opts.levelsPerStep = 1000.0f;
+  lod = buildLod(points, JOINTS, opts);
+  CHECK(lod.levels.size() == 2 && lod.levels[1].keep.size() == 2);
+}
+
+void testSmall() {
+  std::vector<Point> points = wave(2);
+  Lod lod = buildLod(points, JOINTS);
+  CHECK(lod.levels.size() == 1 && lod.levels[0].keep.size() == 2);
+  CHECK(buildLod(std::vector<Point>(), JOINTS).levels.size() == 1);
+}
+
+}  // namespace
+
+int main() {
+  testStraightLine();
+  testPyramid();
+  testColour();
+  testSmall();
+  return roboarm::test::checkResult();
+}
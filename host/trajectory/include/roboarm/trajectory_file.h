@@ -0,0 +1,128 @@
+#pragma once
+// Binary trajectory file (.rtraj): fixed-size little-endian records, read
+// through mmap without copying. Version 1 layout:
+//
+//   header (64 B)
+//     0  char[4]  magic "RTRJ"
+//     4  u16      version (1)
+//     6  u16      header size (64)
+//     8  u8       joints (1..MAX_JOINTS)
+//     9  u8       flags (FLAG_INDEX)
+//    10  u16      record size
+//    12  u16      units per degree (100: joints in centidegrees)
+//    14  u16      reserved
+//    16  u64      record count
+//    24  u64      records offset
+//    32  u64      index offset (0 = no index)
+//    40  u64      index entries
+//    48  u32      records per index entry
+//    52  u32      reserved
+//    56  u64      total duration, ms
+//   record (recordSize(joints) B, 4-byte aligned)
+//     i16[joints] deg * units, u16 blend (deg * units, 0 = stop),
+//     [pad to 4], u32 ms, u8 led, u8 r, u8 g, u8 b
+//   index entry (16 B): u64 first record, u64 start ms
+//
+// The index allows seeking by time without touching the records before it;
+// it is optional so a writer can stream records out and skip it.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace roboarm {
+namespace traj {
+
+static const uint16_t VERSION = 1;
+static const uint8_t MAX_JOINTS = 16;
+static const uint16_t UNITS_PER_DEG = 100;
+static const size_t HEADER_SIZE = 64;
+static const size_t INDEX_ENTRY_SIZE = 16;
+static const uint8_t FLAG_INDEX = 1;
+
+// One trajectory point, the same fields as a {"cmd":"trajectory"} point
+struct Point {
+  float deg[MAX_JOINTS] = {};
+  uint32_t ms = 200;
+  float blend = 0.0f;  // blend radius, deg
+  uint8_t led = 0;
+  uint8_t r = 0, g = 0, b = 0;
+};
+
+inline size_t msOffset(uint8_t joints) { return ((size_t)joints * 2 + 2 + 3) & ~(size_t)3; }
+inline size_t recordSize(uint8_t joints) { return msOffset(joints) + 8; }
+
+// Encodes one record into out (recordSize(joints) bytes). Angles saturate at
+// the int16 range (+-327 deg at 100 units/deg).
+void encodeRecord(const Point &p, uint8_t joints, uint8_t *out);
+// Decodes a record of a file with the given joint count and units
+Point decodeRecord(const uint8_t *rec, uint8_t joints, uint16_t unitsPerDeg = UNITS_PER_DEG);
+
+// Builds a file in memory; save() writes it in one go
+class Writer {
+ public:
+  explicit Writer(uint8_t joints, uint32_t indexEvery = 256);
+
+  void add(const Point &p);
+  size_t size() const { return count_; }
+  uint64_t totalMs() const { return totalMs_; }
+
+  // Returns an error code or nullptr
+  const char *save(const std::string &path) const;
+  std::vector<uint8_t> bytes() const;
+
+ private:
+  uint8_t joints_;
+  uint32_t indexEvery_;
+  size_t count_ = 0;
+  uint64_t totalMs_ = 0;
+  std::vector<uint8_t> records_;
+  std::vector<uint64_t> index_;  // first record, start ms pairs
+};
+
+// Read-only mapping of a file. Records are read in place; nothing is copied
+// until decodeRecord().
+class File {
+ public:
+  File() = default;
+  ~File() { close(); }
+  File(const File &) = delete;
+  File &operator=(const File &) = delete;
+
+  // Returns an error code ("open_failed", "bad_magic", "bad_version",
+  // "bad_header", "truncated") or nullptr
+  const char *open(const std::string &path);
+  void close();
+
+  bool isOpen() const { return data_ != nullptr; }
+  uint8_t joints() const { return joints_; }
+  uint16_t unitsPerDeg() const { return units_; }
+  size_t recordSize() const { return recordSize_; }
+  uint64_t size() const { return count_; }
+  uint64_t totalMs() const { return totalMs_; }
+  bool hasIndex() const { return indexCount_ > 0; }
+
+  const uint8_t *record(uint64_t i) const { return data_ + recordsOffset_ + i * recordSize_; }
+  Point point(uint64_t i) const { return decodeRecord(record(i), joints_, units_); }
+  uint32_t durationMs(uint64_t i) const;
+
+  // First record whose move is still running at `ms` from the start (size()
+  // past the end). Uses the index when there is one, a scan otherwise.
+  uint64_t seek(uint64_t ms, uint64_t *startMs = nullptr) const;
+
+ private:
+  const uint8_t *data_ = nullptr;
+  size_t length_ = 0;
+  uint8_t joints_ = 0;
+  uint16_t units_ = UNITS_PER_DEG;
+  size_t recordSize_ = 0;
+  uint64_t count_ = 0;
+  uint64_t recordsOffset_ = 0;
+  uint64_t indexOffset_ = 0;
+  uint64_t indexCount_ = 0;
+  uint64_t totalMs_ = 0;
+};
+
+}  // namespace traj
+}  // namespace roboarm
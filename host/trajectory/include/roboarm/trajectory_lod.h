@@ -0,0 +1,67 @@
+#pragma once
+// Level-of-detail pyramid of a trajectory: progressively simplified versions
+// of the same point list with a known error bound each.
+//
+// Points are placed in time (arrival = sum of ms so far) and simplified with
+// Ramer-Douglas-Peucker: a dropped point may deviate from the straight line
+// between the kept points around it, evaluated at its own arrival time, by at
+// most the level's tolerance on every joint and on the light (led, r, g, b,
+// which the firmware fades linearly between points too). Tolerances are in
+// servo steps (one PCA9685 tick, ~0.4 deg for the default servo config) so one
+// number means the same thing on every joint; a light channel counts
+// levelsPerStep 8-bit levels as one step. Kept points absorb the durations of
+// the points dropped before them, so every level takes the same total time.
+//
+// Level 0 is the input. Level 1 drops only what the servos cannot resolve
+// (half a step by default) - the one to execute; coarser levels double the
+// tolerance each and suit previews with a frame budget. Pinned points
+// (first, last, both sides of an LED on/off change or of a colour/brightness
+// jump of at least switchLevels, and caller-chosen ones such as stroke ends)
+// are kept on every level.
+
+#include <roboarm/trajectory_file.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace roboarm {
+namespace traj {
+
+// Degrees per servo step of the firmware's default servo config at 50 Hz:
+// 180 / ((max_us - min_us) * 4096 * 50 / 1e6)
+std::vector<float> defaultResolutionDeg();
+
+struct LodOptions {
+  std::vector<float> resolutionDeg = defaultResolutionDeg();  // per joint; missing joints use the last
+  float levelsPerStep = 1.0f;   // LED/RGB 8-bit levels per step
+  uint8_t switchLevels = 32;    // LED/RGB jump between neighbours that pins both; 0 = off
+  float firstTolerance = 0.5f;  // level 1 tolerance, steps; doubles per level
+  uint8_t maxLevels = 10;       // including level 0
+  std::vector<uint32_t> pinned; // extra point indices kept on every level
+};
+
+struct LodLevel {
+  float toleranceSteps = 0;   // bound used to build the level
+  float maxErrorSteps = 0;    // measured worst deviation of a dropped point, <= tolerance
+  float maxErrorDeg = 0;      // worst joint deviation, degrees
+  float maxErrorLevel = 0;    // worst LED/RGB deviation, 8-bit levels
+  std::vector<uint32_t> keep; // indices of kept input points, ascending
+};
+
+struct Lod {
+  std::vector<LodLevel> levels;  // levels[0] keeps everything
+};
+
+Lod buildLod(const std::vector<Point> &points, uint8_t joints, const LodOptions &opts = LodOptions());
+
+// Points of a level; each carries the summed duration of the input points it replaces
+std::vector<Point> levelPoints(const std::vector<Point> &points, const LodLevel &level);
+
+// Coarsest level whose tolerance is at most `steps` (execution)
+size_t levelForResolution(const Lod &lod, float steps = 0.5f);
+// Finest level with at most maxPoints points, else the coarsest (preview)
+size_t levelForBudget(const Lod &lod, size_t maxPoints);
+
+}  // namespace traj
+}  // namespace roboarm
@@ -0,0 +1,48 @@
+#pragma once
+// Sparse keyframe tracks from a point list: the {"cmd":"trajectory","tracks":...}
+// form of a trajectory (roboarm/src/main.cpp, startKeyframes).
+//
+// The firmware moves every channel (joint, LED, R, G, B) linearly in time
+// between points, so a channel only needs a key where its slope changes. Per
+// channel, a point is dropped when the line between the kept keys around it
+// passes within the tolerance of its value at its own arrival time; a joint
+// that only moves in one stroke of a long job ends up with a handful of keys.
+// Blend radii have no track equivalent and are ignored.
+
+#include <roboarm/trajectory_file.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace roboarm {
+namespace traj {
+
+static const uint32_t KEY_MAX_MS = 0xFFFF;  // firmware Keyframe.ms
+static const size_t FIRMWARE_MAX_KEYS = 64; // MAX_KEYFRAMES, keys per message
+
+struct Key {
+  uint32_t ms = 0;   // from the previous key of the track (the first: from the start)
+  float value = 0;   // deg for joints, 0..255 for LED/RGB
+};
+
+struct Track {
+  std::string name;  // "j0", "j1", ..., "led", "r", "g", "b"
+  std::vector<Key> keys;
+};
+
+struct TrackOptions {
+  float toleranceDeg = 0.01f;   // joints; the firmware keeps centidegrees
+  float toleranceLevel = 0.5f;  // LED/RGB levels
+};
+
+// One track per joint, then led/r/g/b. Every track keeps the arrival of
+// point 0 (the start pose is whatever the arm holds) and the last point;
+// gaps longer than KEY_MAX_MS are split with keys on the line.
+std::vector<Track> toTracks(const std::vector<Point> &points, uint8_t joints, const TrackOptions &opts = TrackOptions());
+
+size_t keyCount(const std::vector<Track> &tracks);
+
+}  // namespace traj
+}  // namespace roboarm
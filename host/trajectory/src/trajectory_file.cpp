@@ -0,0 +1,200 @@
+// Binary trajectory file writer and mmap reader, layout in trajectory_file.h
+#include <roboarm/trajectory_file.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace roboarm {
+namespace traj {
+
+namespace {
+
+void put16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+void put32(uint8_t *p, uint32_t v) {
+  put16(p, (uint16_t)v);
+  put16(p + 2, (uint16_t)(v >> 16));
+}
+void put64(uint8_t *p, uint64_t v) {
+  put32(p, (uint32_t)v);
+  put32(p + 4, (uint32_t)(v >> 32));
+}
+uint16_t get16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+uint32_t get32(const uint8_t *p) { return (uint32_t)get16(p) | ((uint32_t)get16(p + 2) << 16); }
+uint64_t get64(const uint8_t *p) { return (uint64_t)get32(p) | ((uint64_t)get32(p + 4) << 32); }
+
+int16_t quantize(float v, uint16_t units) {
+  float q = std::round(v * (float)units);
+  if (q > 32767.0f) return 32767;
+  if (q < -32768.0f) return -32768;
+  return (int16_t)q;
+}
+
+}  // namespace
+
+void encodeRecord(const Point &p, uint8_t joints, uint8_t *out) {
+  memset(out, 0, recordSize(joints));
+  for (uint8_t i = 0; i < joints; i++) put16(out + 2 * i, (uint16_t)quantize(p.deg[i], UNITS_PER_DEG));
+  float blend = std::round(p.blend * UNITS_PER_DEG);
+  put16(out + 2 * joints, blend <= 0.0f ? 0 : blend >= 65535.0f ? 65535 : (uint16_t)blend);
+  uint8_t *tail = out + msOffset(joints);
+  put32(tail, p.ms);
+  tail[4] = p.led;
+  tail[5] = p.r;
+  tail[6] = p.g;
+  tail[7] = p.b;
+}
+
+Point decodeRecord(const uint8_t *rec, uint8_t joints, uint16_t unitsPerDeg) {
+  Point p;
+  float scale = 1.0f / (float)unitsPerDeg;
+  for (uint8_t i = 0; i < joints; i++) p.deg[i] = (float)(int16_t)get16(rec + 2 * i) * scale;
+  p.blend = (float)get16(rec + 2 * joints) * scale;
+  const uint8_t *tail = rec + msOffset(joints);
+  p.ms = get32(tail);
+  p.led = tail[4];
+  p.r = tail[5];
+  p.g = tail[6];
+  p.b = tail[7];
+  return p;
+}
+
+// ---- Writer ----
+
+Writer::Writer(uint8_t joints, uint32_t indexEvery)
+    : joints_(joints < 1 ? 1 : joints > MAX_JOINTS ? MAX_JOINTS : joints), indexEvery_(indexEvery) {}
+
+void Writer::add(const Point &p) {
+  if (indexEvery_ && count_ % indexEvery_ == 0) {
+    index_.push_back(count_);
+    index_.push_back(totalMs_);
+  }
+  size_t at = records_.size();
+  records_.resize(at + recordSize(joints_));
+  encodeRecord(p, joints_, &records_[at]);
+  count_++;
+  totalMs_ += p.ms;
+}
+
+std::vector<uint8_t> Writer::bytes() const {
+  size_t indexEntries = index_.size() / 2;
+  std::vector<uint8_t> out(HEADER_SIZE + records_.size() + indexEntries * INDEX_ENTRY_SIZE);
+  uint8_t *h = out.data();
+  memcpy(h, "RTRJ", 4);
+  put16(h + 4, VERSION);
+  put16(h + 6, (uint16_t)HEADER_SIZE);
+  h[8] = joints_;
+  h[9] = indexEntries ? FLAG_INDEX : 0;
+  put16(h + 10, (uint16_t)recordSize(joints_));
+  put16(h + 12, UNITS_PER_DEG);
+  put64(h + 16, count_);
+  put64(h + 24, HEADER_SIZE);
+  put64(h + 32, indexEntries ? HEADER_SIZE + records_.size() : 0);
+  put64(h + 40, indexEntries);
+  put32(h + 48, indexEntries ? indexEvery_ : 0);
+  put64(h + 56, totalMs_);
+  if (!records_.empty()) memcpy(h + HEADER_SIZE, records_.data(), records_.size());
+  uint8_t *idx = h + HEADER_SIZE + records_.size();
+  for (size_t i = 0; i < index_.size(); i++) put64(idx + 8 * i, index_[i]);
+  return out;
+}
+
+const char *Writer::save(const std::string &path) const {
+  std::vector<uint8_t> data = bytes();
+  FILE *f = fopen(path.c_str(), "wb");
+  if (!f) return "open_failed";
+  bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+  ok &= fclose(f) == 0;
+  return ok ? nullptr : "write_failed";
+}
+
+// ---- File ----
+
+const char *File::open(const std::string &path) {
+  close();
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return "open_failed";
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t)HEADER_SIZE) {
+    ::close(fd);
+    return "truncated";
+  }
+  void *map = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);  // the mapping keeps the file
+  if (map == MAP_FAILED) return "open_failed";
+  data_ = (const uint8_t *)map;
+  length_ = (size_t)st.st_size;
+
+  const uint8_t *h = data_;
+  const char *err = nullptr;
+  if (memcmp(h, "RTRJ", 4) != 0) {
+    err = "bad_magic";
+  } else if (get16(h + 4) != VERSION) {
+    err = "bad_version";
+  } else {
+    joints_ = h[8];
+    recordSize_ = get16(h + 10);
+    units_ = get16(h + 12);
+    count_ = get64(h + 16);
+    recordsOffset_ = get64(h + 24);
+    indexOffset_ = get64(h + 32);
+    indexCount_ = indexOffset_ ? get64(h + 40) : 0;
+    totalMs_ = get64(h + 56);
+    if (joints_ < 1 || joints_ > MAX_JOINTS || units_ == 0 || recordSize_ < traj::recordSize(joints_) ||
+        get16(h + 6) < HEADER_SIZE || recordsOffset_ < get16(h + 6)) {
+      err = "bad_header";
+    } else if (recordsOffset_ > length_ || count_ > (length_ - recordsOffset_) / recordSize_ ||
+               indexOffset_ > length_ || indexCount_ > (length_ - indexOffset_) / INDEX_ENTRY_SIZE) {
+      err = "truncated";
+    }
+  }
+  if (err) close();
+  else madvise((void *)data_, length_, MADV_SEQUENTIAL);  // playback reads front to back
+  return err;
+}
+
+void File::close() {
+  if (data_) munmap((void *)data_, length_);
+  data_ = nullptr;
+  length_ = 0;
+  count_ = 0;
+  indexCount_ = 0;
+}
+
+uint32_t File::durationMs(uint64_t i) const { return get32(record(i) + msOffset(joints_)); }
+
+uint64_t File::seek(uint64_t ms, uint64_t *startMs) const {
+  uint64_t first = 0;
+  uint64_t t = 0;
+  if (indexCount_) {
+    // Last index entry starting at or before ms
+    const uint8_t *idx = data_ + indexOffset_;
+    uint64_t lo = 0, hi = indexCount_;
+    while (hi - lo > 1) {
+      uint64_t mid = (lo + hi) / 2;
+      if (get64(idx + mid * INDEX_ENTRY_SIZE + 8) <= ms) lo = mid;
+      else hi = mid;
+    }
+    first = get64(idx + lo * INDEX_ENTRY_SIZE);
+    t = get64(idx + lo * INDEX_ENTRY_SIZE + 8);
+    if (first > count_ || t > ms) first = t = 0;  // damaged index: scan from the start
+  }
+  for (; first < count_; first++) {
+    uint32_t d = durationMs(first);
+    if (t + d > ms) break;
+    t += d;
+  }
+  if (startMs) *startMs = t;
+  return first;
+}
+
+}  // namespace traj
+}  // namespace roboarm
@@ -0,0 +1,192 @@
+// Trajectory level-of-detail pyramid, see trajectory_lod.h
+#include <roboarm/trajectory_lod.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+namespace roboarm {
+namespace traj {
+
+std::vector<float> defaultResolutionDeg() {
+  // DEFAULT_SERVO_CFG in roboarm/src/main.cpp: MG996R 620-2520 us, MG90S 601-2881 us
+  const float spanUs[] = {1900, 1900, 1900, 2280, 2280};
+  const float ticksPerUs = 4096.0f * 50.0f / 1e6f;
+  std::vector<float> out;
+  for (float us : spanUs) out.push_back(180.0f / (us * ticksPerUs));
+  return out;
+}
+
+namespace {
+
+const float PINNED = std::numeric_limits<float>::infinity();
+
+class Track {
+ public:
+  Track(const std::vector<Point> &points, uint8_t joints, const LodOptions &opts)
+      : points_(points), joints_(std::min(joints, MAX_JOINTS)), arrival_(points.size()) {
+    const std::vector<float> &resolutionDeg = opts.resolutionDeg;
+    double t = 0;
+    for (size_t i = 0; i < points.size(); i++) arrival_[i] = t += points[i].ms;
+    for (uint8_t j = 0; j < joints_; j++) {
+      float res = resolutionDeg.empty() ? 1.0f : resolutionDeg[std::min((size_t)j, resolutionDeg.size() - 1)];
+      stepsPerDeg_[j] = res > 0 ? 1.0f / res : 1.0f;
+    }
+    stepsPerLevel_ = opts.levelsPerStep > 0 ? 1.0f / opts.levelsPerStep : 1.0f;
+  }
+
+  // Worst joint or light deviation of point k from the line a-b at k's
+  // arrival, in steps; *deg and *level get the worst joint in degrees and the
+  // worst light channel in 8-bit levels
+  float deviation(size_t a, size_t b, size_t k, float *deg = nullptr, float *level = nullptr) const {
+    double span = arrival_[b] - arrival_[a];
+    float u = span > 0 ? (float)((arrival_[k] - arrival_[a]) / span) : (float)(k - a) / (float)(b - a);
+    float worst = 0, worstDeg = 0;
+    for (uint8_t j = 0; j < joints_; j++) {
+      float line = points_[a].deg[j] + u * (points_[b].deg[j] - points_[a].deg[j]);
+      float d = std::fabs(points_[k].deg[j] - line);
+      worst = std::max(worst, d * stepsPerDeg_[j]);
+      worstDeg = std::max(worstDeg, d);
+    }
+    float worstLevel = 0;
+    for (uint8_t c = 0; c < 4; c++) {
+      float from = light(points_[a], c), to = light(points_[b], c);
+      worstLevel = std::max(worstLevel, std::fabs(light(points_[k], c) - (from + u * (to - from))));
+    }
+    worst = std::max(worst, worstLevel * stepsPerLevel_);
+    if (deg) *deg = worstDeg;
+    if (level) *level = worstLevel;
+    return worst;
+  }
+
+ private:
+  const std::vector<Point> &points_;
+  uint8_t joints_;
+  std::vector<double> arrival_;
+  float stepsPerDeg_[MAX_JOINTS] = {};
+  float stepsPerLevel_ = 1.0f;
+
+  static float light(const Point &p, uint8_t c) {
+    switch (c) {
+      case 0: return p.led;
+      case 1: return p.r;
+      case 2: return p.g;
+      default: return p.b;
+    }
+  }
+};
+
+// Largest LED/RGB difference between two points, 8-bit levels
+int lightJump(const Point &a, const Point &b) {
+  return std::max({std::abs(a.led - b.led), std::abs(a.r - b.r), std::abs(a.g - b.g), std::abs(a.b - b.b)});
+}
+
+// RDP run once to the end: a point's importance is the deviation at which it
+// split its segment, capped by its parent's, so "importance > tol" is exactly
+// the point set RDP keeps at tolerance tol
+std::vector<float> importance(const Track &track, size_t n, const std::vector<bool> &pin) {
+  std::vector<float> imp(n, 0.0f);
+  struct Span {
+    size_t a, b;
+    float cap;
+  };
+  std::vector<Span> stack;
+  size_t prev = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (!pin[i]) continue;
+    imp[i] = PINNED;
+    if (i > prev + 1) stack.push_back({prev, i, PINNED});
+    prev = i;
+  }
+  while (!stack.empty()) {
+    Span s = stack.back();
+    stack.pop_back();
+    size_t best = s.a + 1;
+    float bestDev = -1;
+    for (size_t k = s.a + 1; k < s.b; k++) {
+      float d = track.deviation(s.a, s.b, k);
+      if (d > bestDev) {
+        bestDev = d;
+        best = k;
+      }
+    }
+    imp[best] = std::min(bestDev, s.cap);
+    if (best > s.a + 1) stack.push_back({s.a, best, imp[best]});
+    if (s.b > best + 1) stack.push_back({best, s.b, imp[best]});
+  }
+  return imp;
+}
+
+}  // namespace
+
+Lod buildLod(const std::vector<Point> &points, uint8_t joints, const LodOptions &opts) {
+  Lod lod;
+  size_t n = points.size();
+  LodLevel all;
+  for (size_t i = 0; i < n; i++) all.keep.push_back((uint32_t)i);
+  lod.levels.push_back(all);
+  if (n < 3) return lod;
+
+  std::vector<bool> pin(n, false);
+  pin[0] = pin[n - 1] = true;
+  for (size_t i = 1; i < n; i++) {
+    if ((points[i].led > 0) != (points[i - 1].led > 0)) pin[i - 1] = pin[i] = true;  // light switches
+    if (opts.switchLevels > 0 && lightJump(points[i - 1], points[i]) >= opts.switchLevels)
+      pin[i - 1] = pin[i] = true;  // colour or brightness switches
+  }
+  for (uint32_t i : opts.pinned)
+    if (i < n) pin[i] = true;
+  size_t pinnedCount = (size_t)std::count(pin.begin(), pin.end(), true);
+
+  Track track(points, joints, opts);
+  std::vector<float> imp = importance(track, n, pin);
+
+  float tol = opts.firstTolerance > 0 ? opts.firstTolerance : 0.5f;
+  for (uint8_t l = 1; l < opts.maxLevels && lod.levels.back().keep.size() > pinnedCount; l++, tol *= 2) {
+    LodLevel level;
+    level.toleranceSteps = tol;
+    for (size_t i = 0; i < n; i++)
+      if (imp[i] > tol) level.keep.push_back((uint32_t)i);
+    for (size_t s = 0; s + 1 < level.keep.size(); s++) {
+      for (size_t k = level.keep[s] + 1; k < level.keep[s + 1]; k++) {
+        float deg, light;
+        float steps = track.deviation(level.keep[s], level.keep[s + 1], k, &deg, &light);
+        level.maxErrorSteps = std::max(level.maxErrorSteps, steps);
+        level.maxErrorDeg = std::max(level.maxErrorDeg, deg);
+        level.maxErrorLevel = std::max(level.maxErrorLevel, light);
+      }
+    }
+    lod.levels.push_back(std::move(level));
+  }
+  return lod;
+}
+
+std::vector<Point> levelPoints(const std::vector<Point> &points, const LodLevel &level) {
+  std::vector<Point> out;
+  size_t next = 0;
+  for (uint32_t k : level.keep) {
+    if (k >= points.size()) break;
+    Point p = points[k];
+    p.ms = 0;
+    for (; next <= k; next++) p.ms += points[next].ms;
+    out.push_back(p);
+  }
+  return out;
+}
+
+size_t levelForResolution(const Lod &lod, float steps) {
+  size_t pick = 0;
+  for (size_t l = 1; l < lod.levels.size(); l++)
+    if (lod.levels[l].toleranceSteps <= steps) pick = l;
+  return pick;
+}
+
+size_t levelForBudget(const Lod &lod, size_t maxPoints) {
+  for (size_t l = 0; l < lod.levels.size(); l++)
+    if (lod.levels[l].keep.size() <= maxPoints) return l;
+  return lod.levels.empty() ? 0 : lod.levels.size() - 1;
+}
+
+}  // namespace traj
+}  // namespace roboarm
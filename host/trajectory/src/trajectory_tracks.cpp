@@ -0,0 +1,142 @@
+// Sparse keyframe tracks, see trajectory_tracks.h
+#include <roboarm/trajectory_tracks.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace roboarm {
+namespace traj {
+
+namespace {
+
+float channelValue(const Point &p, uint8_t joints, uint8_t c) {
+  if (c < joints) return p.deg[c];
+  switch (c - joints) {
+    case 0: return p.led;
+    case 1: return p.r;
+    case 2: return p.g;
+    default: return p.b;
+  }
+}
+
+// Indices of the samples to keep: one pass, each anchor keeps the range of
+// slopes that passes within tol of every sample after it; the next sample
+// extends the run while the line to it stays inside that range
+std::vector<size_t> simplify(const std::vector<double> &t, const std::vector<float> &v, float tol) {
+  size_t n = t.size();
+  std::vector<size_t> keep;
+  if (n == 0) return keep;
+  keep.push_back(0);
+  size_t a = 0;
+  double lo = -std::numeric_limits<double>::infinity(), hi = std::numeric_limits<double>::infinity();
+  for (size_t b = a + 1; b < n; b++) {
+    double dt = t[b] - t[a];
+    double dv = (double)v[b] - v[a];
+    bool fits;
+    if (dt <= 0) {
+      fits = std::fabs(dv) <= tol;
+    } else {
+      double slope = dv / dt;
+      fits = slope >= lo && slope <= hi;
+    }
+    if (!fits && b > a + 1) {
+      // The run ends at the previous sample, which anchors the next one
+      a = b - 1;
+      keep.push_back(a);
+      lo = -std::numeric_limits<double>::infinity();
+      hi = std::numeric_limits<double>::infinity();
+      dt = t[b] - t[a];
+      dv = (double)v[b] - v[a];
+    }
+    if (dt > 0) {
+      lo = std::max(lo, (dv - tol) / dt);
+      hi = std::min(hi, (dv + tol) / dt);
+    } else if (std::fabs(dv) > tol) {
+      // Jump at the anchor's time: keep it as a key of its own
+      a = b;
+      keep.push_back(a);
+      lo = -std::numeric_limits<double>::infinity();
+      hi = std::numeric_limits<double>::infinity();
+    }
+  }
+  if (keep.back() != n - 1) keep.push_back(n - 1);
+  return keep;
+}
+
+// Key at `ms` after the track's last key, split into pieces of at most
+// KEY_MAX_MS on the line from `from`
+void appendSegment(Track &track, uint32_t ms, float from, float to) {
+  uint32_t parts = std::max<uint32_t>(1, (ms + KEY_MAX_MS - 1) / KEY_MAX_MS);
+  uint32_t done = 0;
+  for (uint32_t p = 1; p <= parts; p++) {
+    uint32_t at = (uint32_t)((uint64_t)ms * p / parts);
+    Key key;
+    key.ms = at - done;
+    key.value = p == parts ? to : from + (to - from) * (float)at / (float)ms;
+    track.keys.push_back(key);
+    done = at;
+  }
+}
+
+uint64_t trackMs(const Track &track) {
+  uint64_t ms = 0;
+  for (const Key &k : track.keys) ms += k.ms;
+  return ms;
+}
+
+}  // namespace
+
+std::vector<Track> toTracks(const std::vector<Point> &points, uint8_t joints, const TrackOptions &opts) {
+  joints = std::min(joints, MAX_JOINTS);
+  std::vector<double> arrival(points.size());
+  double t = 0;
+  for (size_t i = 0; i < points.size(); i++) arrival[i] = t += points[i].ms;
+
+  static const char *const LIGHTS[] = {"led", "r", "g", "b"};
+  std::vector<Track> tracks;
+  for (uint8_t c = 0; c < joints + 4; c++) {
+    Track track;
+    track.name = c < joints ? "j" + std::to_string(c) : LIGHTS[c - joints];
+    if (points.empty()) {
+      tracks.push_back(track);
+      continue;
+    }
+    std::vector<float> v(points.size());
+    for (size_t i = 0; i < points.size(); i++) v[i] = channelValue(points[i], joints, c);
+    float tol = c < joints ? opts.toleranceDeg : opts.toleranceLevel;
+    std::vector<size_t> keep = simplify(arrival, v, tol);
+    // A finished track holds its value: trailing keys that keep it go
+    while (keep.size() > 1 && std::fabs(v[keep.back()] - v[keep[keep.size() - 2]]) <= tol) keep.pop_back();
+
+    Key first;
+    first.ms = (uint32_t)arrival[keep[0]];
+    first.value = v[keep[0]];
+    track.keys.push_back(first);
+    for (size_t k = 1; k < keep.size(); k++) {
+      appendSegment(track, (uint32_t)(arrival[keep[k]] - arrival[keep[k - 1]]), v[keep[k - 1]], v[keep[k]]);
+    }
+    tracks.push_back(track);
+  }
+
+  // Playback lasts as long as the longest track; the first one holds until
+  // the end of the point list so the timing stays the same
+  if (!points.empty()) {
+    uint64_t longest = 0;
+    for (const Track &t : tracks) longest = std::max(longest, trackMs(t));
+    uint64_t total = (uint64_t)arrival.back();
+    Track &first = tracks.front();
+    float last = first.keys.back().value;
+    if (longest < total) appendSegment(first, (uint32_t)(total - trackMs(first)), last, last);
+  }
+  return tracks;
+}
+
+size_t keyCount(const std::vector<Track> &tracks) {
+  size_t n = 0;
+  for (const Track &t : tracks) n += t.keys.size();
+  return n;
+}
+
+}  // namespace traj
+}  // namespace roboarm
@@ -0,0 +1,342 @@
+// .rtraj converter and player
+//
+//   roboarm_traj to-bin points.json job.rtraj [--joints N] [--index-every N]
+//   roboarm_traj to-json job.rtraj points.json
+//   roboarm_traj info job.rtraj
+//   roboarm_traj play job.rtraj [--host H] [--port P] [--arm A] [--from-ms T]
+//   roboarm_traj lod IN.(json|rtraj) [--max-points N] [--exec-steps S] [--levels N]
+//                    [--first-steps S] [--resolution D0,D1,...] [--rtraj PREFIX]
+//   roboarm_traj to-tracks IN.(json|rtraj) OUT.json [--tolerance DEG]
+//
+// JSON input is a {"cmd":"trajectory","points":[...]} message, {"points":[...]}
+// or a bare array of points; to-json writes the trajectory message. lod prints
+// the level pyramid (trajectory_lod.h) as JSON: per level the kept point
+// indices and their merged durations, plus the levels picked for execution
+// (--exec-steps, servo steps) and for a preview of at most --max-points.
+// --rtraj also writes every level as PREFIX.<level>.rtraj. to-tracks writes the
+// sparse keyframe form (trajectory_tracks.h) and reports the size against the
+// point message.
+
+#include <roboarm/client.h>
+#include <roboarm/json.h>
+#include <roboarm/trajectory_file.h>
+#include <roboarm/trajectory_lod.h>
+#include <roboarm/trajectory_tracks.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using roboarm::json::Value;
+namespace traj = roboarm::traj;
+
+namespace {
+
+int usage() {
+  fprintf(stderr,
+          "usage: roboarm_traj to-bin IN.json OUT.rtraj [--joints N] [--index-every N]\n"
+          "       roboarm_traj to-json IN.rtraj OUT.json\n"
+          "       roboarm_traj info IN.rtraj\n"
+          "       roboarm_traj play IN.rtraj [--host H] [--port P] [--arm A] [--from-ms T]\n"
+          "       roboarm_traj lod IN.(json|rtraj) [--max-points N] [--exec-steps S] [--levels N]\n"
+          "                        [--first-steps S] [--resolution D0,D1,...] [--rtraj PREFIX]\n"
+          "       roboarm_traj to-tracks IN.(json|rtraj) OUT.json [--tolerance DEG]\n");
+  return 2;
+}
+
+const char *option(int argc, char **argv, const char *name, const char *def) {
+  for (int i = 3; i + 1 < argc; i++) {
+    if (!strcmp(argv[i], name)) return argv[i + 1];
+  }
+  return def;
+}
+
+double number(const Value *v, double def) { return v && v->isNumber() ? v->number : def; }
+
+// Reads a JSON point list. joints <= 0: as many as the widest "deg".
+// pinned gets the indices of points marked "pin": true (LOD stroke ends).
+bool readJsonPoints(const char *in, int &joints, std::vector<traj::Point> &out, std::vector<uint32_t> *pinned) {
+  std::ifstream f(in, std::ios::binary);
+  std::stringstream text;
+  text << f.rdbuf();
+  Value doc;
+  if (!f || !roboarm::json::parse(text.str(), doc)) {
+    fprintf(stderr, "%s: not JSON\n", in);
+    return false;
+  }
+  const Value *points = doc.isArray() ? &doc : doc.get("points");
+  if (!points || !points->isArray()) {
+    fprintf(stderr, "%s: no points\n", in);
+    return false;
+  }
+  if (joints <= 0) {
+    for (const Value &p : points->items) {
+      const Value *deg = p.get("deg");
+      if (deg && (int)deg->items.size() > joints) joints = (int)deg->items.size();
+    }
+  }
+  if (joints < 1 || joints > traj::MAX_JOINTS) {
+    fprintf(stderr, "%s: need 1..%u joints\n", in, traj::MAX_JOINTS);
+    return false;
+  }
+
+  // Missing joints hold the previous point's angle, like the firmware does
+  traj::Point prev;
+  for (const Value &p : points->items) {
+    traj::Point pt = prev;
+    const Value *deg = p.get("deg");
+    for (int i = 0; i < joints && deg && i < (int)deg->items.size(); i++) pt.deg[i] = (float)deg->items[i].number;
+    pt.ms = (uint32_t)number(p.get("ms"), 200);
+    pt.blend = (float)number(p.get("blend"), 0);
+    pt.led = (uint8_t)number(p.get("led"), prev.led);
+    const Value *rgb = p.get("rgb");
+    if (rgb) {
+      pt.r = (uint8_t)number(rgb->get("r"), prev.r);
+      pt.g = (uint8_t)number(rgb->get("g"), prev.g);
+      pt.b = (uint8_t)number(rgb->get("b"), prev.b);
+    }
+    const Value *pin = p.get("pin");
+    if (pinned && pin && pin->isBool() && pin->boolean) pinned->push_back((uint32_t)out.size());
+    out.push_back(pt);
+    prev = pt;
+  }
+  return true;
+}
+
+int toBin(const char *in, const char *out, int joints, uint32_t indexEvery) {
+  std::vector<traj::Point> points;
+  if (!readJsonPoints(in, joints, points, nullptr)) return 1;
+  traj::Writer w((uint8_t)joints, indexEvery);
+  for (const traj::Point &pt : points) w.add(pt);
+  if (const char *err = w.save(out)) {
+    fprintf(stderr, "%s: %s\n", out, err);
+    return 1;
+  }
+  printf("%zu points, %u joints, %.1f s -> %s\n", w.size(), joints, (double)w.totalMs() / 1000.0, out);
+  return 0;
+}
+
+double centi(float v) { return std::round((double)v * 100.0) / 100.0; }
+
+std::string pointsMessage(const std::vector<traj::Point> &points, uint8_t joints) {
+  roboarm::json::Writer w;
+  w.beginObject().key("cmd").value("trajectory").key("points").beginArray();
+  for (const traj::Point &p : points) {
+    w.beginObject().key("deg").beginArray();
+    for (uint8_t j = 0; j < joints; j++) w.value(centi(p.deg[j]));
+    w.endArray().key("ms").value(p.ms);
+    if (p.blend > 0.0f) w.key("blend").value(centi(p.blend));
+    w.key("led").value(p.led);
+    w.key("rgb").beginObject().key("r").value(p.r).key("g").value(p.g).key("b").value(p.b).endObject();
+    w.endObject();
+  }
+  w.endArray().endObject();
+  return w.str();
+}
+
+int writeText(const char *out, const std::string &text) {
+  std::ofstream f(out, std::ios::binary);
+  f << text << "\n";
+  if (!f) {
+    fprintf(stderr, "%s: write_failed\n", out);
+    return 1;
+  }
+  return 0;
+}
+
+int toJson(const traj::File &file, const char *out) {
+  std::vector<traj::Point> points;
+  for (uint64_t i = 0; i < file.size(); i++) points.push_back(file.point(i));
+  return writeText(out, pointsMessage(points, file.joints()));
+}
+
+// Sends every record as a frame when its move is due; replies are not awaited
+// (pipelined), so the file streams at the rate the moves take
+int play(const traj::File &file, const char *host, uint16_t port, uint8_t arm, uint64_t fromMs) {
+  if (file.joints() > roboarm::proto::SERVOS) {
+    fprintf(stderr, "file has %u joints, the firmware %u\n", file.joints(), roboarm::proto::SERVOS);
+    return 1;
+  }
+  roboarm::Client client;
+  if (!client.connect(host, port).get()) {
+    fprintf(stderr, "cannot connect to ws://%s:%u\n", host, port);
+    return 1;
+  }
+  uint64_t t = 0;
+  uint64_t first = file.seek(fromMs, &t);
+  roboarm::Clock::time_point start = roboarm::Clock::now() - std::chrono::milliseconds(t);
+  size_t failed = 0;
+  std::vector<std::future<roboarm::Reply>> replies;
+  for (uint64_t i = first; i < file.size() && client.connected(); i++) {
+    std::this_thread::sleep_until(start + std::chrono::milliseconds(t));
+    traj::Point p = file.point(i);
+    roboarm::proto::FrameCmd f;
+    f.arm = arm;
+    f.deg_n = file.joints();
+    for (uint8_t j = 0; j < f.deg_n; j++) f.deg[j] = p.deg[j];
+    f.ms = p.ms;
+    f.has_led = true;
+    f.led = p.led;
+    f.has_rgb = true;
+    f.rgb.has_r = f.rgb.has_g = f.rgb.has_b = true;
+    f.rgb.r = p.r;
+    f.rgb.g = p.g;
+    f.rgb.b = p.b;
+    replies.push_back(client.send(f));
+    t += p.ms;
+    // Collect finished replies so a long job does not keep them all
+    while (!replies.empty() && replies.front().wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+      failed += replies.front().get().ok ? 0 : 1;
+      replies.erase(replies.begin());
+    }
+  }
+  for (auto &r : replies) failed += r.get().ok ? 0 : 1;
+  printf("played %llu points from %.1f s, %zu failed\n", (unsigned long long)(file.size() - first),
+         (double)fromMs / 1000.0, failed);
+  return failed ? 1 : 0;
+}
+
+// Points of a .rtraj file, else of a JSON point list
+bool readPoints(const char *in, int &joints, std::vector<traj::Point> &points, std::vector<uint32_t> *pinned) {
+  traj::File file;
+  if (file.open(in)) return readJsonPoints(in, joints, points, pinned);
+  joints = file.joints();
+  for (uint64_t i = 0; i < file.size(); i++) points.push_back(file.point(i));
+  return true;
+}
+
+int lod(int argc, char **argv) {
+  const char *in = argv[2];
+  int joints = 0;
+  std::vector<traj::Point> points;
+  traj::LodOptions opts;
+  if (!readPoints(in, joints, points, &opts.pinned)) return 1;
+  opts.maxLevels = (uint8_t)std::max(1, std::min(64, atoi(option(argc, argv, "--levels", "10"))));
+  opts.firstTolerance = (float)atof(option(argc, argv, "--first-steps", "0.5"));
+  if (const char *res = option(argc, argv, "--resolution", nullptr)) {
+    opts.resolutionDeg.clear();
+    for (const char *p = res; *p;) {
+      char *end;
+      opts.resolutionDeg.push_back(strtof(p, &end));
+      if (end == p) break;
+      p = *end == ',' ? end + 1 : end;
+    }
+  }
+
+  traj::Lod pyramid = traj::buildLod(points, (uint8_t)joints, opts);
+  size_t exec = traj::levelForResolution(pyramid, (float)atof(option(argc, argv, "--exec-steps", "0.5")));
+  size_t preview = traj::levelForBudget(pyramid, (size_t)atol(option(argc, argv, "--max-points", "500")));
+
+  roboarm::json::Writer w;
+  w.beginObject().key("points").value((int64_t)points.size());
+  w.key("execution").value((int64_t)exec).key("preview").value((int64_t)preview);
+  w.key("levels").beginArray();
+  for (size_t l = 0; l < pyramid.levels.size(); l++) {
+    const traj::LodLevel &level = pyramid.levels[l];
+    std::vector<traj::Point> merged = traj::levelPoints(points, level);
+    w.beginObject();
+    w.key("tolerance_steps").value(centi(level.toleranceSteps));
+    w.key("max_error_steps").value(centi(level.maxErrorSteps));
+    w.key("max_error_deg").value(centi(level.maxErrorDeg));
+    w.key("max_error_level").value(centi(level.maxErrorLevel));
+    w.key("keep").beginArray();
+    for (uint32_t k : level.keep) w.value(k);
+    w.endArray().key("ms").beginArray();
+    for (const traj::Point &p : merged) w.value(p.ms);
+    w.endArray().endObject();
+
+    if (const char *prefix = option(argc, argv, "--rtraj", nullptr)) {
+      traj::Writer out((uint8_t)joints);
+      for (const traj::Point &p : merged) out.add(p);
+      std::string path = std::string(prefix) + "." + std::to_string(l) + ".rtraj";
+      if (const char *err = out.save(path)) {
+        fprintf(stderr, "%s: %s\n", path.c_str(), err);
+        return 1;
+      }
+    }
+    fprintf(stderr, "level %zu: %zu points, tolerance %.2f steps, max error %.2f steps (%.2f deg, %.1f levels)%s%s\n",
+            l, level.keep.size(), level.toleranceSteps, level.maxErrorSteps, level.maxErrorDeg, level.maxErrorLevel,
+            l == exec ? " [execution]" : "", l == preview ? " [preview]" : "");
+  }
+  w.endArray().endObject();
+  printf("%s\n", w.str().c_str());
+  return 0;
+}
+
+int toTracks(int argc, char **argv) {
+  const char *in = argv[2];
+  int joints = 0;
+  std::vector<traj::Point> points;
+  if (!readPoints(in, joints, points, nullptr)) return 1;
+  traj::TrackOptions opts;
+  opts.toleranceDeg = (float)atof(option(argc, argv, "--tolerance", "0.01"));
+  std::vector<traj::Track> tracks = traj::toTracks(points, (uint8_t)joints, opts);
+
+  roboarm::json::Writer w;
+  w.beginObject().key("cmd").value("trajectory").key("tracks").beginObject();
+  bool tooLong = false;
+  for (const traj::Track &t : tracks) {
+    w.key(t.name.c_str()).beginArray();
+    for (const traj::Key &k : t.keys) {
+      w.beginArray().value(k.ms).value(centi(k.value)).endArray();
+      tooLong |= k.ms > traj::KEY_MAX_MS;
+    }
+    w.endArray();
+  }
+  w.endObject().endObject();
+  if (writeText(argv[3], w.str())) return 1;
+
+  size_t keys = traj::keyCount(tracks);
+  fprintf(stderr, "%zu points -> %zu keys, %zu B -> %zu B of JSON\n", points.size(), keys,
+          pointsMessage(points, (uint8_t)joints).size(), w.str().size());
+  if (keys > traj::FIRMWARE_MAX_KEYS) {
+    fprintf(stderr, "warning: the firmware takes %zu keys per message\n", traj::FIRMWARE_MAX_KEYS);
+  }
+  if (tooLong) fprintf(stderr, "warning: point 0 arrives after %u ms, the firmware limit\n", traj::KEY_MAX_MS);
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 3) return usage();
+  std::string cmd = argv[1];
+  if (cmd == "to-bin") {
+    if (argc < 4) return usage();
+    return toBin(argv[2], argv[3], atoi(option(argc, argv, "--joints", "0")),
+                 (uint32_t)atol(option(argc, argv, "--index-every", "256")));
+  }
+
+  if (cmd == "lod") return lod(argc, argv);
+  if (cmd == "to-tracks") {
+    if (argc < 4) return usage();
+    return toTracks(argc, argv);
+  }
+
+  traj::File file;
+  if (const char *err = file.open(argv[2])) {
+    fprintf(stderr, "%s: %s\n", argv[2], err);
+    return 1;
+  }
+  if (cmd == "to-json") {
+    if (argc < 4) return usage();
+    return toJson(file, argv[3]);
+  }
+  if (cmd == "info") {
+    printf("%llu points, %u joints, %zu B records, %.1f s, %s\n", (unsigned long long)file.size(), file.joints(),
+           file.recordSize(), (double)file.totalMs() / 1000.0, file.hasIndex() ? "indexed" : "no index");
+    return 0;
+  }
+  if (cmd == "play") {
+    return play(file, option(argc, argv, "--host", "192.168.4.1"), (uint16_t)atoi(option(argc, argv, "--port", "81")),
+                (uint8_t)atoi(option(argc, argv, "--arm", "0")),
+                (uint64_t)atoll(option(argc, argv, "--from-ms", "0")));
+  }
+  return usage();
+}
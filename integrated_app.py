@@ -13,6 +13,9 @@ Funkcjonalności:
 import tkinter as tk
 from tkinter import ttk, messagebox, filedialog
 import json
+import os
+import subprocess
+import tempfile
 import asyncio
 import threading
 import time
@@ -35,8 +38,8 @@ except ImportError:
 PI = np.pi
 
 # Konfiguracja ESP32
-HOST = "192.168.4.1"
-PORT = 81
+HOST = os.environ.get("ROBOARM_HOST", "192.168.4.1")
+PORT = int(os.environ.get("ROBOARM_PORT", "81"))
 
 # Lista obsługiwanych komend ESP32
 ESP32_COMMANDS = {
@@ -270,6 +273,7 @@ class IntegratedApp(tk.Tk):
         # Zmienne stanu
         self.current_robot_paths = []
         self.trajectory_points = []
+        self.trajectory_pins = set()
         
         self.create_widgets()
         
@@ -460,6 +464,10 @@ class IntegratedApp(tk.Tk):
         self.move_time_var = tk.StringVar(value="1000")
         ttk.Entry(params_frame, textvariable=self.move_time_var, width=10).pack(side="left", padx=(5, 20))
         
+        ttk.Label(params_frame, text="Blend (mm):").pack(side="left")
+        self.blend_mm_var = tk.StringVar(value="0")
+        ttk.Entry(params_frame, textvariable=self.blend_mm_var, width=10).pack(side="left", padx=(5, 20))
+        
         ttk.Label(params_frame, text="Jasność LED:").pack(side="left")
         self.led_brightness_var = tk.StringVar(value="255")
         ttk.Entry(params_frame, textvariable=self.led_brightness_var, width=10).pack(side="left", padx=(5, 20))
@@ -587,11 +595,15 @@ class IntegratedApp(tk.Tk):
             return
         
         self.trajectory_points = []
+        self.trajectory_pins = set()  # końce ścieżek - zostają przy upraszczaniu (LOD)
         failed_points = 0
+        # Promień strefy przejścia między punktami (0 = zatrzymanie w każdym punkcie)
+        blend_mm = float(self.blend_mm_var.get() or 0)
         
         self.log_message("🗺️ Generowanie trajektorii z kinematyką odwrotną...")
         
         for path_idx, robot_path in enumerate(self.current_robot_paths):
+            first_point = len(self.trajectory_points)
             for point_idx, position in enumerate(robot_path):
                 angles, actual_pos, error_msg = self.kinematics.calculate_inverse_kinematics(position)
                 
@@ -607,10 +619,17 @@ class IntegratedApp(tk.Tk):
                         "ms": int(self.move_time_var.get()),
                         "rgb": {"r": r, "g": g, "b": b}
                     }
+                    # Pozycja w mm do wyznaczenia strefy przejścia; ostatni punkt ścieżki bez blendu
+                    if blend_mm > 0:
+                        trajectory_point["pos"] = [round(c * 1000, 1) for c in position]
+                        if point_idx < len(robot_path) - 1:
+                            trajectory_point["blend_mm"] = blend_mm
                     
                     self.trajectory_points.append(trajectory_point)
                 else:
                     failed_points += 1
+            if len(self.trajectory_points) > first_point:
+                self.trajectory_pins.update((first_point, len(self.trajectory_points) - 1))
         
         # Aktualizuj listę ścieżek
         self.paths_listbox.delete(0, tk.END)
@@ -662,18 +681,50 @@ class IntegratedApp(tk.Tk):
             return
         
         # Ograniczenie do pierwszych 20 punktów (limit ESP32)
-        points_to_send = self.trajectory_points[:20]
+        points_to_send = self.execution_trajectory()[:20]
         
         trajectory_params = {"points": points_to_send}
         
         self.log_message(f"🎨 Rozpoczynanie Light Painting: {len(points_to_send)} punktów")
         self.esp32_client.send_command("trajectory", trajectory_params)
     
+    def execution_trajectory(self):
+        """Trajektoria bez punktów, których serwa nie rozróżnią (poziom LOD do wykonania).
+
+        Liczy host/trajectory (roboarm_traj lod): usuwa punkty odchylone od prostej między
+        sąsiednimi o mniej niż pół kroku PCA9685 (~0.2°), czas ruchu się nie zmienia.
+        Ścieżka do programu: ROBOARM_TRAJ lub host/build. Bez programu - wszystkie punkty.
+        """
+        tool = os.environ.get("ROBOARM_TRAJ", os.path.join(
+            os.path.dirname(os.path.abspath(__file__)), "host", "build", "trajectory", "roboarm_traj"))
+        if len(self.trajectory_points) < 3 or not os.path.exists(tool):
+            return self.trajectory_points
+        
+        points = [dict(point, pin=i in self.trajectory_pins) for i, point in enumerate(self.trajectory_points)]
+        with tempfile.NamedTemporaryFile("w", suffix=".json", delete=False) as f:
+            json.dump({"points": points}, f)
+            job = f.name
+        try:
+            out = subprocess.run([tool, "lod", job], capture_output=True, text=True, check=True)
+            result = json.loads(out.stdout)
+        except (subprocess.CalledProcessError, ValueError) as e:
+            self.log_message(f"❌ LOD nieudany: {e}")
+            return self.trajectory_points
+        finally:
+            os.unlink(job)
+        
+        level = result["levels"][result["execution"]]
+        # Zachowane punkty przejmują czas usuniętych przed nimi
+        execution = [dict(self.trajectory_points[k], ms=ms) for k, ms in zip(level["keep"], level["ms"])]
+        self.log_message(f"✂️ LOD: {len(execution)}/{len(self.trajectory_points)} punktów, "
+                         f"błąd ≤ {level['max_error_deg']:.2f}°, kolor ≤ {level['max_error_level']:.0f}")
+        return execution
+    
     def stop_execution(self):
         """Zatrzymuje wykonywanie trajektorii"""
         self.log_message("⏸️ Zatrzymywanie wykonania...")
-        # Wyślij komendę home jako zatrzymanie
-        self.send_home()
+        # stop działa natychmiast, przed poleceniami czekającymi w kolejce ESP32
+        self.esp32_client.send_command("stop", {"led": 0})
     
     def send_manual_position(self):
         """Wysyła ręcznie ustawioną pozycję"""
@@ -23,6 +23,10 @@ import time
 import threading
 from matplotlib.patches import Circle
 import colorsys
+import json
+import os
+import subprocess
+import tempfile
 
 # Próba importu ikpy
 try:
@@ -366,6 +370,35 @@ class ImageProcessor:
                 smooth_edge_colors.append(path_colors)
         
         return smooth_edge_paths, smooth_edge_colors
+
+    def process_image_native(self, target_point_density=3.0):
+        """Ten sam tryb automatyczny w C++ (host/imagepath, roboarm_imagepath).
+
+        Wielokrotnie szybszy dla dużych obrazów. Ścieżka do programu: ROBOARM_IMAGEPATH
+        lub host/build. Zwraca False, gdy programu nie ma - wtedy liczy Python.
+        """
+        tool = os.environ.get("ROBOARM_IMAGEPATH", os.path.join(
+            os.path.dirname(os.path.abspath(__file__)), "host", "build", "imagepath", "roboarm_imagepath"))
+        if not os.path.exists(tool):
+            return False
+        
+        with tempfile.NamedTemporaryFile(suffix=".ppm", delete=False) as f:
+            image = f.name
+        try:
+            cv.imwrite(image, self.current_image)
+            out = subprocess.run([tool, image, "--pixels", "--density", str(target_point_density)],
+                                 capture_output=True, text=True, check=True)
+            result = json.loads(out.stdout)
+        except (subprocess.CalledProcessError, ValueError) as e:
+            print(f"roboarm_imagepath nieudany: {e}")
+            return False
+        finally:
+            os.unlink(image)
+        
+        self.edge_paths = [[(x, y) for x, y in path] for path in result["paths"]]
+        self.edge_colors = [[tuple(c) for c in colors] for colors in result["colors"]]
+        return True
+
     def process_image_auto_fallback(self):
         """Automatyczne wykrywanie konturów z gładkim przetwarzaniem"""
         if self.current_image is None:
@@ -386,6 +419,10 @@ class ImageProcessor:
             return True, "Użyto gładkiej elipsy jako fallback"
             
         try:
+            if self.process_image_native():
+                print(f"Automatycznie wykryto {len(self.edge_paths)} gładkich ścieżek (host/imagepath)")
+                return True, f"Automatycznie wykryto {len(self.edge_paths)} gładkich ścieżek"
+            
             # Standard preprocessing
             gray = cv.cvtColor(self.current_image, cv.COLOR_BGR2GRAY)
             blurred = cv.GaussianBlur(gray, (5, 5), 0)
@@ -457,6 +494,7 @@ class LightPaintingSimulator(tk.Tk):
         self.robot_paths = []
         self.robot_colors = []  # Kolory dla każdej ścieżki
         self.trajectory_points = []
+        self.preview_points = []
         self.light_painting_dots = []  # Kropki light painting (2D)
         self.light_painting_3d_dots = []  # Kropki light painting (3D)
         self.light_painting_lines_2d = []  # Linie light painting (2D)
@@ -485,6 +523,7 @@ class LightPaintingSimulator(tk.Tk):
         ttk.Button(control_frame, text="📁 Wczytaj obraz", command=self.load_image).pack(side="left", padx=5)
         ttk.Button(control_frame, text="✏️ Rysuj kontury", command=self.process_image).pack(side="left", padx=5)
         ttk.Button(control_frame, text="Pokaż wykryte krawędzie", command=self.show_edges).pack(side="left", padx=5)
+        ttk.Button(control_frame, text="🔀 Optymalizuj kolejność", command=self.optimize_stroke_order).pack(side="left", padx=5)
         ttk.Button(control_frame, text="🚀 Start Light Painting", command=self.start_simulation).pack(side="left", padx=5)
         ttk.Button(control_frame, text="⏸️ Stop", command=self.stop_simulation).pack(side="left", padx=5)
         ttk.Button(control_frame, text="🗑️ Wyczyść", command=self.clear_simulation).pack(side="left", padx=5)
@@ -535,6 +574,10 @@ class LightPaintingSimulator(tk.Tk):
         self.speed_var = tk.StringVar(value="50")
         ttk.Entry(param_line, textvariable=self.speed_var, width=8).pack(side="left", padx=(5, 15))
         
+        ttk.Label(param_line, text="Podgląd (pkt):").pack(side="left")
+        self.preview_points_var = tk.StringVar(value="400")
+        ttk.Entry(param_line, textvariable=self.preview_points_var, width=8).pack(side="left", padx=(5, 15))
+        
         ttk.Label(param_line, text="Dokładność:").pack(side="left")
         self.accuracy_var = tk.StringVar(value="Normalna")
         accuracy_combo = ttk.Combobox(param_line, textvariable=self.accuracy_var, width=10, values=["Wysoka", "Normalna", "Niska"])
@@ -1268,6 +1311,107 @@ class LightPaintingSimulator(tk.Tk):
         if success_points == 0:
             self.log_message("❌ Brak punktów do wykonania - sprawdź parametry konwersji")
     
+    def optimize_stroke_order(self):
+        """Zmienia kolejność (i kierunek) ścieżek, żeby skrócić przejazdy ze zgaszonym światłem.
+
+        Liczy host/strokes (roboarm_strokes): czas ruchu w przestrzeni przegubów przy
+        limitach prędkości serw. Ścieżka do programu: ROBOARM_STROKES lub host/build.
+        """
+        if not self.trajectory_points:
+            messagebox.showwarning("Błąd", "Brak trajektorii! Najpierw przetwórz obraz.")
+            return
+        
+        # Pierwszy i ostatni punkt każdej ścieżki w kątach przegubów
+        strokes = {}
+        for point in self.trajectory_points:
+            strokes.setdefault(point["path_idx"], []).append([float(a) for a in point["angles"]])
+        path_ids = sorted(strokes)
+        
+        tool = os.environ.get("ROBOARM_STROKES", os.path.join(
+            os.path.dirname(os.path.abspath(__file__)), "host", "build", "strokes", "roboarm_strokes"))
+        if not os.path.exists(tool):
+            self.log_message(f"❌ Brak optymalizatora {tool} - zbuduj host/ (cmake)")
+            return
+        
+        with tempfile.NamedTemporaryFile("w", suffix=".json", delete=False) as f:
+            json.dump({"strokes": [[strokes[i][0], strokes[i][-1]] for i in path_ids]}, f)
+            job = f.name
+        try:
+            out = subprocess.run([tool, job, "--budget-ms", "500"], capture_output=True, text=True, check=True)
+            result = json.loads(out.stdout)
+        except (subprocess.CalledProcessError, ValueError) as e:
+            self.log_message(f"❌ Optymalizacja nieudana: {e}")
+            return
+        finally:
+            os.unlink(job)
+        
+        paths, colors = [], []
+        for k, reverse in zip(result["order"], result["reversed"]):
+            idx = path_ids[k]
+            path = list(self.robot_paths[idx])
+            path_colors = list(self.robot_colors[idx]) if idx < len(self.robot_colors) else []
+            paths.append(path[::-1] if reverse else path)
+            colors.append(path_colors[::-1] if reverse else path_colors)
+        self.robot_paths, self.robot_colors = paths, colors
+        self.generate_trajectory()
+        
+        self.log_message(f"🔀 Przejazdy bez światła: {result['input_ms'] / 1000:.1f} s -> "
+                         f"{result['optimized_ms'] / 1000:.1f} s (oszczędność {result['saved_ms'] / 1000:.1f} s)")
+    
+    def preview_trajectory(self):
+        """Uproszczona trajektoria do podglądu: poziom LOD mieszczący się w budżecie klatek.
+
+        Liczy host/trajectory (roboarm_traj lod): RDP w przestrzeni przegubów ze znanym
+        błędem, końce ścieżek zostają. Ścieżka do programu: ROBOARM_TRAJ lub host/build.
+        Bez programu podgląd pokazuje wszystkie punkty.
+        """
+        try:
+            budget = int(self.preview_points_var.get())
+        except ValueError:
+            budget = 0
+        if budget <= 0 or len(self.trajectory_points) <= budget:
+            return self.trajectory_points
+        
+        tool = os.environ.get("ROBOARM_TRAJ", os.path.join(
+            os.path.dirname(os.path.abspath(__file__)), "host", "build", "trajectory", "roboarm_traj"))
+        if not os.path.exists(tool):
+            self.log_message(f"ℹ️ Brak {tool} - podgląd wszystkich punktów")
+            return self.trajectory_points
+        
+        # Punkty równo w czasie (symulacja ma stały krok), końce ścieżek przypięte
+        points = []
+        for i, point in enumerate(self.trajectory_points):
+            prev_path = self.trajectory_points[i - 1]["path_idx"] if i > 0 else None
+            next_path = self.trajectory_points[i + 1]["path_idx"] if i + 1 < len(self.trajectory_points) else None
+            pin = point["path_idx"] != prev_path or point["path_idx"] != next_path
+            points.append({"deg": [float(a) for a in point["angles"]], "ms": 1, "pin": pin})
+        
+        with tempfile.NamedTemporaryFile("w", suffix=".json", delete=False) as f:
+            json.dump({"points": points}, f)
+            job = f.name
+        try:
+            out = subprocess.run([tool, "lod", job, "--max-points", str(budget)],
+                                 capture_output=True, text=True, check=True)
+            result = json.loads(out.stdout)
+        except (subprocess.CalledProcessError, ValueError) as e:
+            self.log_message(f"❌ LOD nieudany: {e}")
+            return self.trajectory_points
+        finally:
+            os.unlink(job)
+        
+        level = result["levels"][result["preview"]]
+        preview = []
+        prev_path, idx = None, 0
+        for k in level["keep"]:
+            point = dict(self.trajectory_points[k])
+            # Kolejne numery w ścieżce, żeby podgląd łączył punkty liniami
+            idx = idx + 1 if point["path_idx"] == prev_path else 0
+            prev_path, point["point_idx"] = point["path_idx"], idx
+            preview.append(point)
+        self.log_message(f"🔍 Podgląd: poziom {result['preview']}, {len(preview)}/{len(self.trajectory_points)} "
+                         f"punktów, błąd ≤ {level['max_error_deg']:.2f}°, kolor ≤ {level['max_error_level']:.0f}")
+        return preview
+
     def start_simulation(self):
         """Rozpoczyna symulację light painting"""
         if not self.trajectory_points:
@@ -1299,6 +1443,7 @@ class LightPaintingSimulator(tk.Tk):
             self.painting_ax.set_facecolor('black')
             self.painting_ax.set_title("Light Painting - Płaszczyzna pionowa (XZ)", color='white', fontsize=14)
         
+        self.preview_points = self.preview_trajectory()
         self.simulation_running = True
         self.current_point_index = 0
         
@@ -1307,12 +1452,12 @@ class LightPaintingSimulator(tk.Tk):
     
     def run_animation(self):
         """Uruchamia animację symulacji"""
-        if not self.simulation_running or self.current_point_index >= len(self.trajectory_points):
+        if not self.simulation_running or self.current_point_index >= len(self.preview_points):
             self.finish_simulation()
             return
         
         # Pobierz aktualny punkt
-        point = self.trajectory_points[self.current_point_index]
+        point = self.preview_points[self.current_point_index]
         
         # Aktualizuj wizualizację robota
         self.update_robot_visualization(point)
@@ -1324,7 +1469,7 @@ class LightPaintingSimulator(tk.Tk):
         self.current_point_index += 1
         
         # Progress
-        progress = (self.current_point_index / len(self.trajectory_points)) * 100
+        progress = (self.current_point_index / len(self.preview_points)) * 100
         self.status_label.config(text=f"Symulacja: {progress:.1f}%", foreground="orange")
         
         # Zaplanuj następną klatkę
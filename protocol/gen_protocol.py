@@ -0,0 +1,847 @@
+#!/usr/bin/env python3
+"""Generuje kodeki protokołu RoboArm z jednego schematu (roboarm_protocol.json).
+
+Wyjścia:
+- roboarm/src/protocol_gen.h             - firmware: struktury, JSON (ArduinoJson) i binarne
+- host/client/include/roboarm/protocol.h - klient C++ (header-only, bez zależności)
+- test-esp/roboarm_protocol.py           - Python: buildery poleceń, walidacja, binarne
+
+Użycie:
+    python protocol/gen_protocol.py          # zapisuje pliki
+    python protocol/gen_protocol.py --check  # kod wyjścia 1, jeśli pliki są nieaktualne
+
+Format binarny (ramka WebSocket BIN, little-endian):
+    [id u8] [maska pól opcjonalnych] [pola w kolejności schematu]
+- maska: ceil(n/8) bajtów, bit i = i-te pole opcjonalne obecne (tylko obiekty z takimi polami)
+- tablica: [n u8] + n elementów, str: [len u8] + bajty, obiekt: jak wiadomość bez id
+"""
+
+import argparse
+import json
+import os
+import pprint
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SCHEMA = os.path.join(ROOT, "protocol", "roboarm_protocol.json")
+OUT_FIRMWARE = os.path.join(ROOT, "roboarm", "src", "protocol_gen.h")
+OUT_CLIENT = os.path.join(ROOT, "host", "client", "include", "roboarm", "protocol.h")
+OUT_PYTHON = os.path.join(ROOT, "test-esp", "roboarm_protocol.py")
+
+# type -> (C++ type, BinReader/BinWriter method, min, max)
+PRIMS = {
+    "bool": ("bool", "boolean", None, None),
+    "u8": ("uint8_t", "u8", 0, 255),
+    "i8": ("int8_t", "i8", -128, 127),
+    "u16": ("uint16_t", "u16", 0, 65535),
+    "i16": ("int16_t", "i16", -32768, 32767),
+    "u32": ("uint32_t", "u32", None, None),
+    "i32": ("int32_t", "i32", None, None),
+    "f32": ("float", "f32", None, None),
+}
+
+
+def camel(name):
+    return "".join(p.capitalize() for p in name.split("_"))
+
+
+class Schema:
+    def __init__(self, data):
+        self.data = data
+        self.version = data["version"]
+        self.constants = data["constants"]
+        self.types = data.get("types", [])
+        self.commands = data.get("commands", [])
+        self.replies = data.get("replies", [])
+        self.type_names = {t["name"] for t in self.types}
+        for t in self.types:
+            t["kind"] = "type"
+        for c in self.commands:
+            c["kind"] = "command"
+        for r in self.replies:
+            r["kind"] = "reply"
+        self._validate()
+
+    def _validate(self):
+        ids = set()
+        for m in self.commands + self.replies:
+            assert 1 <= m["id"] <= 255 and m["id"] not in ids, f"bad/duplicate id in {m['name']}"
+            ids.add(m["id"])
+        for obj in self.types + self.commands + self.replies:
+            opts = [f for f in obj.get("fields", []) if f.get("optional")]
+            assert len(opts) <= 8, f"{obj['name']}: at most 8 optional fields"
+            for f in obj.get("fields", []):
+                t = f["type"]
+                assert t in PRIMS or t == "str" or t in self.type_names, f"unknown type {t}"
+                if "count" in f:
+                    assert t in PRIMS, f"{obj['name']}.{f['name']}: arrays of primitives only"
+                if t == "str":
+                    assert "max" in f, f"{obj['name']}.{f['name']}: str needs max"
+
+    def struct(self, obj):
+        return camel(obj["name"]) + {"type": "", "command": "Cmd", "reply": "Reply"}[obj["kind"]]
+
+    def enum(self, obj):
+        return ("CMD_" if obj["kind"] == "command" else "REPLY_") + obj["name"].upper()
+
+    def const(self, v):
+        return self.constants[v] if isinstance(v, str) else v
+
+    def type_obj(self, name):
+        return next(t for t in self.types if t["name"] == name)
+
+    def bin_max(self, obj):
+        fields = obj.get("fields", [])
+        size = (len([f for f in fields if f.get("optional")]) + 7) // 8
+        for f in fields:
+            t = f["type"]
+            if t == "str":
+                n = 1 + self.const(f["max"])
+            elif t in PRIMS:
+                width = {"bool": 1, "u8": 1, "i8": 1, "u16": 2, "i16": 2}.get(t, 4)
+                n = 1 + width * self.const(f["count"]) if "count" in f else width
+            else:
+                n = self.bin_max(self.type_obj(t))
+            size += n
+        return size
+
+
+def err_missing(f):
+    return f.get("error", "missing_" + f["name"])
+
+
+def err_bad(f):
+    return f.get("error", "bad_" + f["name"])
+
+
+# ========= C++ (shared parts) =========
+
+def cpp_struct(s, obj):
+    lines = []
+    if obj.get("doc"):
+        lines.append(f"// {obj['doc']}")
+    lines.append(f"struct {s.struct(obj)} {{")
+    if obj["kind"] != "type":
+        lines.append(f"  enum {{ ID = {s.enum(obj)}, BIN_MAX = {s.bin_max(obj) + 1} }};")
+    for f in obj.get("fields", []):
+        name, t = f["name"], f["type"]
+        if f.get("optional"):
+            lines.append(f"  bool has_{name} = false;")
+        if t == "str":
+            lines.append(f"  char {name}[{f['max']} + 1] = {{}};")
+        elif t in PRIMS:
+            ctype = PRIMS[t][0]
+            if "count" in f:
+                count = f["count"]
+                lines.append(f"  {ctype} {name}[{count}] = {{}};")
+                lines.append(f"  uint8_t {name}_n = 0;")
+            else:
+                default = f.get("default")
+                if default is None:
+                    default = "false" if t == "bool" else "0"
+                elif t == "bool":
+                    default = "true" if default else "false"
+                elif t == "f32":
+                    default = f"{float(default)!r}f"
+                lines.append(f"  {ctype} {name} = {default};")
+        else:
+            lines.append(f"  {camel(t)} {name};")
+    lines.append("};")
+    return "\n".join(lines)
+
+
+BIN_RUNTIME = """// Little-endian reader/writer over a caller-owned buffer (no allocation)
+class BinReader {
+ public:
+  BinReader(const uint8_t *data, size_t len) : p_(data), end_(data + len) {}
+  bool ok() const { return ok_; }
+  bool done() const { return ok_ && p_ == end_; }
+  uint8_t u8() { return need(1) ? *p_++ : 0; }
+  int8_t i8() { return (int8_t)u8(); }
+  bool boolean() { return u8() != 0; }
+  uint16_t u16() {
+    if (!need(2)) return 0;
+    uint16_t v = (uint16_t)(p_[0] | (p_[1] << 8));
+    p_ += 2;
+    return v;
+  }
+  int16_t i16() { return (int16_t)u16(); }
+  uint32_t u32() {
+    if (!need(4)) return 0;
+    uint32_t v = (uint32_t)p_[0] | ((uint32_t)p_[1] << 8) | ((uint32_t)p_[2] << 16) | ((uint32_t)p_[3] << 24);
+    p_ += 4;
+    return v;
+  }
+  int32_t i32() { return (int32_t)u32(); }
+  float f32() {
+    uint32_t bits = u32();
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+  }
+  void bytes(char *out, size_t n) {
+    if (!need(n)) return;
+    memcpy(out, p_, n);
+    p_ += n;
+  }
+  void fail() { ok_ = false; }
+
+ private:
+  bool need(size_t n) {
+    if (ok_ && (size_t)(end_ - p_) >= n) return true;
+    ok_ = false;
+    return false;
+  }
+  const uint8_t *p_;
+  const uint8_t *end_;
+  bool ok_ = true;
+};
+
+class BinWriter {
+ public:
+  BinWriter(uint8_t *out, size_t cap) : out_(out), cap_(cap) {}
+  bool ok() const { return ok_; }
+  size_t size() const { return n_; }
+  void u8(uint8_t v) {
+    if (need(1)) out_[n_++] = v;
+  }
+  void i8(int8_t v) { u8((uint8_t)v); }
+  void boolean(bool v) { u8(v ? 1 : 0); }
+  void u16(uint16_t v) {
+    u8((uint8_t)v);
+    u8((uint8_t)(v >> 8));
+  }
+  void i16(int16_t v) { u16((uint16_t)v); }
+  void u32(uint32_t v) {
+    u16((uint16_t)v);
+    u16((uint16_t)(v >> 16));
+  }
+  void i32(int32_t v) { u32((uint32_t)v); }
+  void f32(float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    u32(bits);
+  }
+  void bytes(const char *data, size_t n) {
+    if (!need(n)) return;
+    memcpy(out_ + n_, data, n);
+    n_ += n;
+  }
+  // Patched after the optional fields are known
+  size_t reserve() {
+    size_t at = n_;
+    u8(0);
+    return at;
+  }
+  void patch(size_t at, uint8_t v) {
+    if (ok_) out_[at] = v;
+  }
+
+ private:
+  bool need(size_t n) {
+    if (ok_ && cap_ - n_ >= n) return true;
+    ok_ = false;
+    return false;
+  }
+  uint8_t *out_;
+  size_t cap_;
+  size_t n_ = 0;
+  bool ok_ = true;
+};
+
+// Message id of a binary frame (0 = empty)
+inline uint8_t messageId(const uint8_t *data, size_t len) { return len ? data[0] : 0; }
+"""
+
+
+def cpp_bin_codec(s, obj):
+    st = s.struct(obj)
+    fields = obj.get("fields", [])
+    opts = [f for f in fields if f.get("optional")]
+    mask_bytes = (len(opts) + 7) // 8
+    enc = [f"inline void encodeFields(BinWriter &w, const {st} &m) {{"]
+    dec = [f"inline const char *decodeFields(BinReader &r, {st} &m) {{"]
+    if not fields:
+        enc.append("  (void)w;")
+        enc.append("  (void)m;")
+        dec.append("  (void)r;")
+        dec.append("  (void)m;")
+    for k in range(mask_bytes):
+        bits = [f"(m.has_{f['name']} ? {1 << (i - 8 * k)} : 0)" for i, f in enumerate(opts) if i // 8 == k]
+        enc.append(f"  w.u8((uint8_t)({' | '.join(bits)}));")
+        dec.append(f"  uint8_t mask{k} = r.u8();")
+    for f in fields:
+        name, t = f["name"], f["type"]
+        ind = "  "
+        if f.get("optional"):
+            i = opts.index(f)
+            enc.append(f"  if (m.has_{name}) {{")
+            dec.append(f"  m.has_{name} = (mask{i // 8} & {1 << (i % 8)}) != 0;")
+            dec.append(f"  if (m.has_{name}) {{")
+            ind = "    "
+        if t == "str":
+            enc.append(f"{ind}uint8_t {name}Len = (uint8_t)strlen(m.{name});")
+            enc.append(f"{ind}w.u8({name}Len);")
+            enc.append(f"{ind}w.bytes(m.{name}, {name}Len);")
+            dec.append(f"{ind}uint8_t {name}Len = r.u8();")
+            dec.append(f"{ind}if ({name}Len > sizeof(m.{name}) - 1) return \"bad_binary\";")
+            dec.append(f"{ind}r.bytes(m.{name}, {name}Len);")
+            dec.append(f"{ind}m.{name}[{name}Len] = 0;")
+        elif t in PRIMS:
+            meth = PRIMS[t][1]
+            if "count" in f:
+                enc.append(f"{ind}w.u8(m.{name}_n);")
+                enc.append(f"{ind}for (uint8_t i = 0; i < m.{name}_n; i++) w.{meth}(m.{name}[i]);")
+                dec.append(f"{ind}m.{name}_n = r.u8();")
+                dec.append(f"{ind}if (m.{name}_n > {f['count']}) return \"bad_binary\";")
+                if f.get("min"):
+                    dec.append(f"{ind}if (m.{name}_n < {f['min']}) return \"{err_missing(f)}\";")
+                dec.append(f"{ind}for (uint8_t i = 0; i < m.{name}_n; i++) m.{name}[i] = r.{meth}();")
+            else:
+                enc.append(f"{ind}w.{meth}(m.{name});")
+                dec.append(f"{ind}m.{name} = r.{meth}();")
+        else:
+            enc.append(f"{ind}encodeFields(w, m.{name});")
+            dec.append(f"{ind}{{")
+            dec.append(f"{ind}  const char *err = decodeFields(r, m.{name});")
+            dec.append(f"{ind}  if (err) return err;")
+            dec.append(f"{ind}}}")
+        if f.get("optional"):
+            enc.append("  }")
+            dec.append("  }")
+    enc.append("}")
+    dec.append("  return nullptr;")
+    dec.append("}")
+    out = "\n".join(dec) + "\n\n" + "\n".join(enc)
+    if obj["kind"] != "type":
+        out += f"""
+
+// Whole frame with id; returns an error code or nullptr
+inline const char *decodeBin(const uint8_t *data, size_t len, {st} &m) {{
+  BinReader r(data, len);
+  if (r.u8() != {st}::ID) return "bad_binary";
+  const char *err = decodeFields(r, m);
+  if (err) return err;
+  return r.done() ? nullptr : "bad_binary";
+}}
+
+// Returns the frame length, 0 if cap is too small ({st}::BIN_MAX always fits)
+inline size_t encodeBin(const {st} &m, uint8_t *out, size_t cap) {{
+  BinWriter w(out, cap);
+  w.u8({st}::ID);
+  encodeFields(w, m);
+  return w.ok() ? w.size() : 0;
+}}"""
+    return out
+
+
+def cpp_common(s):
+    parts = []
+    parts.append(f"static const uint8_t VERSION = {s.version};")
+    for k, v in s.constants.items():
+        parts.append(f"static const uint8_t {k} = {v};")
+    parts.append("")
+    parts.append("enum MsgId : uint8_t {")
+    for m in s.commands + s.replies:
+        parts.append(f"  {s.enum(m)} = 0x{m['id']:02x},")
+    parts.append("};")
+    parts.append("")
+    for obj in s.types + s.commands + s.replies:
+        parts.append(cpp_struct(s, obj))
+        parts.append("")
+    parts.append("// ========= Binary =========")
+    parts.append(BIN_RUNTIME)
+    for obj in s.types + s.commands + s.replies:
+        parts.append(cpp_bin_codec(s, obj))
+        parts.append("")
+    return "\n".join(parts)
+
+
+# ========= C++ firmware JSON (ArduinoJson) =========
+
+def fw_json_value_check(f, v, t, target, bad):
+    """Lines decoding JsonVariantConst v into target, returning bad on a type/range error."""
+    if t == "bool":
+        return [f"if (!{v}.is<bool>()) return \"{bad}\";", f"{target} = {v}.as<bool>();"]
+    if t == "f32":
+        return [f"if (!{v}.is<float>()) return \"{bad}\";", f"{target} = {v}.as<float>();"]
+    if t == "u32":
+        return [f"if (!{v}.is<uint32_t>()) return \"{bad}\";", f"{target} = {v}.as<uint32_t>();"]
+    if t == "i32":
+        return [f"if (!{v}.is<int32_t>()) return \"{bad}\";", f"{target} = {v}.as<int32_t>();"]
+    ctype, _, lo, hi = PRIMS[t]
+    return [f"if (!{v}.is<int32_t>() || {v}.as<int32_t>() < {lo} || {v}.as<int32_t>() > {hi}) return \"{bad}\";",
+            f"{target} = ({ctype}){v}.as<int32_t>();"]
+
+
+def fw_json_codec(s, obj):
+    st = s.struct(obj)
+    fields = obj.get("fields", [])
+    dec = [f"inline const char *decodeJson(JsonObjectConst o, {st} &m) {{"]
+    enc = [f"inline void encodeJson(const {st} &m, JsonObject o) {{"]
+    if obj["kind"] == "command":
+        enc.append(f"  o[\"cmd\"] = \"{obj['name']}\";")
+    if obj.get("tag"):
+        enc.append(f"  o[\"{obj['tag']}\"] = true;")
+    if not fields:
+        dec += ["  (void)o;", "  (void)m;"]
+        if obj["kind"] == "type" or not (obj["kind"] == "command" or obj.get("tag")):
+            enc += ["  (void)o;", "  (void)m;"]
+        else:
+            enc.append("  (void)m;")
+    for f in fields:
+        name, t = f["name"], f["type"]
+        # one scope per field: a JsonVariantConst is bound once, never reassigned
+        dec.append("  {")
+        dec.append(f"    JsonVariantConst v = o[\"{name}\"];")
+        if f.get("optional") or "default" in f:
+            dec.append("    if (!v.isNull()) {")
+        else:
+            dec.append(f"    if (v.isNull()) return \"{err_missing(f)}\";")
+            dec.append("    {")
+        body = []
+        if t == "str":
+            body += [f"if (!v.is<const char *>() || strlen(v.as<const char *>()) > sizeof(m.{name}) - 1) return \"{err_bad(f)}\";",
+                     f"strcpy(m.{name}, v.as<const char *>());"]
+        elif t in PRIMS and "count" in f:
+            body += [f"if (!v.is<JsonArrayConst>()) return \"{err_bad(f)}\";",
+                     f"m.{name}_n = 0;",
+                     "for (JsonVariantConst e : v.as<JsonArrayConst>()) {",
+                     f"  if (m.{name}_n == {f['count']}) break;  // extra values are ignored"]
+            body += ["  " + line for line in fw_json_value_check(f, "e", t, f"m.{name}[m.{name}_n++]", err_bad(f))]
+            body.append("}")
+            if f.get("min"):
+                body.append(f"if (m.{name}_n < {f['min']}) return \"{err_missing(f)}\";")
+        elif t in PRIMS:
+            body += fw_json_value_check(f, "v", t, f"m.{name}", err_bad(f))
+        else:
+            body += [f"if (!v.is<JsonObjectConst>()) return \"{err_bad(f)}\";",
+                     f"const char *err = decodeJson(v.as<JsonObjectConst>(), m.{name});",
+                     "if (err) return err;"]
+        if f.get("optional"):
+            body.append(f"m.has_{name} = true;")
+        dec += ["      " + line for line in body]
+        dec.append("    }")
+        dec.append("  }")
+
+        ind = "  "
+        if f.get("optional"):
+            enc.append(f"  if (m.has_{name}) {{")
+            ind = "    "
+        if t == "str":
+            enc.append(f"{ind}o[\"{name}\"] = (const char *)m.{name};")
+        elif t in PRIMS and "count" in f:
+            enc.append(f"{ind}JsonArray {name} = o[\"{name}\"].to<JsonArray>();")
+            enc.append(f"{ind}for (uint8_t i = 0; i < m.{name}_n; i++) {name}.add(m.{name}[i]);")
+        elif t in ("u8", "i8"):
+            enc.append(f"{ind}o[\"{name}\"] = (int)m.{name};")
+        elif t in PRIMS:
+            enc.append(f"{ind}o[\"{name}\"] = m.{name};")
+        else:
+            enc.append(f"{ind}encodeJson(m.{name}, o[\"{name}\"].to<JsonObject>());")
+        if f.get("optional"):
+            enc.append("  }")
+    dec.append("  return nullptr;")
+    dec.append("}")
+    enc.append("}")
+    return "\n".join(dec) + "\n\n" + "\n".join(enc)
+
+
+def gen_firmware(s):
+    out = [f"""// Generated by protocol/gen_protocol.py from protocol/roboarm_protocol.json - do not edit.
+#pragma once
+// Protocol codecs: message structs, JSON (ArduinoJson) and binary decoders/encoders.
+// Decoders fill a caller-owned struct straight from the parsed document or the
+// binary frame and return an error code (the same ones sendError reports) or nullptr.
+
+#include <ArduinoJson.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace proto {{
+"""]
+    out.append(cpp_common(s))
+    out.append("// ========= JSON =========")
+    for obj in s.types + s.commands + s.replies:
+        out.append(fw_json_codec(s, obj))
+        out.append("")
+    out.append("}  // namespace proto")
+    return "\n".join(out) + "\n"
+
+
+# ========= C++ client JSON (roboarm/json.h) =========
+
+def cl_json_value_check(t, v, target, bad):
+    if t == "bool":
+        return [f"if (!{v}.isBool()) return \"{bad}\";", f"{target} = {v}.boolean;"]
+    if t == "f32":
+        return [f"if (!{v}.isNumber()) return \"{bad}\";", f"{target} = (float){v}.number;"]
+    ctype, _, lo, hi = PRIMS[t]
+    if lo is None:
+        lo, hi = ("0", "4294967295.0") if t == "u32" else ("-2147483648.0", "2147483647.0")
+    return [f"if (!{v}.isInteger() || {v}.number < {lo} || {v}.number > {hi}) return \"{bad}\";",
+            f"{target} = ({ctype}){v}.number;"]
+
+
+def cl_json_codec(s, obj):
+    st = s.struct(obj)
+    fields = obj.get("fields", [])
+    dec = [f"inline const char *decodeJson(const json::Value &o, {st} &m) {{"]
+    enc = [f"inline void encodeJsonFields(json::Writer &w, const {st} &m) {{"]
+    if obj["kind"] == "command":
+        enc.append(f"  w.key(\"cmd\").value(\"{obj['name']}\");")
+    if obj.get("tag"):
+        enc.append(f"  w.key(\"{obj['tag']}\").value(true);")
+    if not fields:
+        dec += ["  (void)o;", "  (void)m;"]
+        enc.append("  (void)m;")
+        if obj["kind"] == "type":
+            enc.append("  (void)w;")
+    else:
+        dec.append("  const json::Value *v;")
+    for f in fields:
+        name, t = f["name"], f["type"]
+        dec.append(f"  v = o.get(\"{name}\");")
+        if f.get("optional") or "default" in f:
+            dec.append("  if (v && !v->isNull()) {")
+        else:
+            dec.append(f"  if (!v || v->isNull()) return \"{err_missing(f)}\";")
+            dec.append("  {")
+        body = []
+        if t == "str":
+            body += [f"if (!v->isString() || v->string.size() > sizeof(m.{name}) - 1) return \"{err_bad(f)}\";",
+                     f"memcpy(m.{name}, v->string.c_str(), v->string.size() + 1);"]
+        elif t in PRIMS and "count" in f:
+            body += [f"if (!v->isArray()) return \"{err_bad(f)}\";",
+                     f"m.{name}_n = 0;",
+                     "for (const json::Value &e : v->items) {",
+                     f"  if (m.{name}_n == {f['count']}) break;"]
+            body += ["  " + line for line in cl_json_value_check(t, "e", f"m.{name}[m.{name}_n++]", err_bad(f))]
+            body.append("}")
+            if f.get("min"):
+                body.append(f"if (m.{name}_n < {f['min']}) return \"{err_missing(f)}\";")
+        elif t in PRIMS:
+            body += cl_json_value_check(t, "(*v)", f"m.{name}", err_bad(f))
+        else:
+            body += [f"if (!v->isObject()) return \"{err_bad(f)}\";",
+                     f"const char *err = decodeJson(*v, m.{name});",
+                     "if (err) return err;"]
+        if f.get("optional"):
+            body.append(f"m.has_{name} = true;")
+        dec += ["    " + line for line in body]
+        dec.append("  }")
+
+        ind = "  "
+        if f.get("optional"):
+            enc.append(f"  if (m.has_{name}) {{")
+            ind = "    "
+        if t == "str":
+            enc.append(f"{ind}w.key(\"{name}\").value((const char *)m.{name});")
+        elif t in PRIMS and "count" in f:
+            enc.append(f"{ind}w.key(\"{name}\").beginArray();")
+            enc.append(f"{ind}for (uint8_t i = 0; i < m.{name}_n; i++) w.value(m.{name}[i]);")
+            enc.append(f"{ind}w.endArray();")
+        elif t in PRIMS:
+            enc.append(f"{ind}w.key(\"{name}\").value(m.{name});")
+        else:
+            enc.append(f"{ind}w.key(\"{name}\").beginObject();")
+            enc.append(f"{ind}encodeJsonFields(w, m.{name});")
+            enc.append(f"{ind}w.endObject();")
+        if f.get("optional"):
+            enc.append("  }")
+    dec.append("  return nullptr;")
+    dec.append("}")
+    enc.append("}")
+    out = "\n".join(dec) + "\n\n" + "\n".join(enc)
+    if obj["kind"] != "type":
+        out += f"""
+
+inline std::string encodeJson(const {st} &m) {{
+  json::Writer w;
+  w.beginObject();
+  encodeJsonFields(w, m);
+  w.endObject();
+  return w.str();
+}}"""
+    return out
+
+
+def gen_client(s):
+    out = [f"""// Generated by protocol/gen_protocol.py from protocol/roboarm_protocol.json - do not edit.
+#pragma once
+// RoboArm protocol codec for C++ clients (header-only, C++17, no dependencies).
+// Same structs and binary format as the firmware (roboarm/src/protocol_gen.h);
+// JSON goes through the minimal reader/writer in roboarm/json.h.
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "roboarm/json.h"
+
+namespace roboarm {{
+namespace proto {{
+"""]
+    out.append(cpp_common(s))
+    out.append("// ========= JSON =========")
+    for obj in s.types + s.commands + s.replies:
+        out.append(cl_json_codec(s, obj))
+        out.append("")
+    # Reply classification: tagged replies by tag, the rest by their first required field
+    lines = ["// Which reply a parsed JSON message is (0 = none of the schema's replies)",
+             "inline uint8_t replyId(const json::Value &o) {"]
+    for r in s.replies:
+        if r.get("tag"):
+            lines.append(f"  if (o.get(\"{r['tag']}\")) return {s.enum(r)};")
+    for r in s.replies:
+        if not r.get("tag"):
+            first = next(f for f in r["fields"] if not f.get("optional"))
+            lines.append(f"  if (o.get(\"{first['name']}\")) return {s.enum(r)};")
+    lines.append("  return 0;")
+    lines.append("}")
+    out.append("\n".join(lines))
+    out.append("")
+    out.append("}  // namespace proto")
+    out.append("}  // namespace roboarm")
+    return "\n".join(out) + "\n"
+
+
+# ========= Python =========
+
+PY_RUNTIME = '''
+
+class ProtocolError(ValueError):
+    """Invalid message; code is the error string the firmware would send."""
+
+    def __init__(self, code):
+        super().__init__(code)
+        self.code = code
+
+
+_INT_RANGE = {
+    "u8": (0, 255), "i8": (-128, 127), "u16": (0, 65535), "i16": (-32768, 32767),
+    "u32": (0, 2**32 - 1), "i32": (-2**31, 2**31 - 1),
+}
+_PACK = {"bool": "?", "u8": "B", "i8": "b", "u16": "H", "i16": "h", "u32": "I", "i32": "i", "f32": "f"}
+_BY_ID = {m["id"]: (kind, name) for kind, table in (("command", COMMANDS), ("reply", REPLIES))
+          for name, m in table.items()}
+
+
+def _const(v):
+    return CONSTANTS[v] if isinstance(v, str) else v
+
+
+def _prim(t, value, bad):
+    if t == "bool":
+        if not isinstance(value, bool):
+            raise ProtocolError(bad)
+        return value
+    if isinstance(value, bool) or not isinstance(value, (int, float)):
+        raise ProtocolError(bad)
+    if t == "f32":
+        return float(value)
+    if isinstance(value, float) and not value.is_integer():
+        raise ProtocolError(bad)
+    lo, hi = _INT_RANGE[t]
+    if not lo <= value <= hi:
+        raise ProtocolError(bad)
+    return int(value)
+
+
+def _check(fields, msg):
+    """Validates msg like the firmware JSON decoder; returns a normalized copy."""
+    out = {}
+    for f in fields:
+        name, t = f["name"], f["type"]
+        missing = f.get("error", "missing_" + name)
+        bad = f.get("error", "bad_" + name)
+        if msg.get(name) is None:
+            if f.get("optional"):
+                continue
+            if "default" in f:
+                out[name] = f["default"]
+                continue
+            raise ProtocolError(missing)
+        value = msg[name]
+        if t == "str":
+            if not isinstance(value, str) or len(value.encode()) > _const(f["max"]):
+                raise ProtocolError(bad)
+        elif "count" in f:
+            if not isinstance(value, (list, tuple)):
+                raise ProtocolError(bad)
+            value = [_prim(t, v, bad) for v in value[:_const(f["count"])]]
+            if len(value) < f.get("min", 0):
+                raise ProtocolError(missing)
+        elif t in _PACK:
+            value = _prim(t, value, bad)
+        else:
+            if not isinstance(value, dict):
+                raise ProtocolError(bad)
+            value = _check(TYPES[t]["fields"], value)
+        out[name] = value
+    return out
+
+
+def build(name, **fields):
+    """Command dict ready for json.dumps; None values are left out."""
+    spec = COMMANDS[name]
+    msg = _check(spec.get("fields", []), {k: v for k, v in fields.items() if v is not None})
+    return {"cmd": name, **msg}
+
+
+def encode_json(name, **fields):
+    return json.dumps(build(name, **fields), separators=(",", ":"))
+
+
+def _encode_fields(fields, msg, out):
+    opts = [f for f in fields if f.get("optional")]
+    mask = 0
+    for i, f in enumerate(opts):
+        if msg.get(f["name"]) is not None:
+            mask |= 1 << i
+    out += mask.to_bytes((len(opts) + 7) // 8, "little")
+    for f in fields:
+        value = msg.get(f["name"])
+        if f.get("optional") and value is None:
+            continue
+        t = f["type"]
+        if t == "str":
+            data = value.encode()
+            out += struct.pack("<B", len(data)) + data
+        elif "count" in f:
+            out += struct.pack("<B%d%s" % (len(value), _PACK[t]), len(value), *value)
+        elif t in _PACK:
+            out += struct.pack("<" + _PACK[t], value)
+        else:
+            _encode_fields(TYPES[t]["fields"], value, out)
+
+
+def encode_bin(name, msg, reply=False):
+    """Binary frame of a command (or reply) dict, validated first."""
+    spec = (REPLIES if reply else COMMANDS)[name]
+    msg = _check(spec.get("fields", []), {k: v for k, v in msg.items() if v is not None})
+    out = bytearray([spec["id"]])
+    _encode_fields(spec.get("fields", []), msg, out)
+    return bytes(out)
+
+
+def _decode_fields(fields, data, pos):
+    opts = [f for f in fields if f.get("optional")]
+    nmask = (len(opts) + 7) // 8
+    mask = int.from_bytes(data[pos:pos + nmask], "little")
+    pos += nmask
+    out = {}
+    for f in fields:
+        if f.get("optional") and not mask & (1 << opts.index(f)):
+            continue
+        t = f["type"]
+        if t == "str":
+            n = data[pos]
+            out[f["name"]] = data[pos + 1:pos + 1 + n].decode()
+            pos += 1 + n
+        elif "count" in f:
+            n = data[pos]
+            fmt = "<%d%s" % (n, _PACK[t])
+            out[f["name"]] = list(struct.unpack_from(fmt, data, pos + 1))
+            pos += 1 + struct.calcsize(fmt)
+        elif t in _PACK:
+            fmt = "<" + _PACK[t]
+            out[f["name"]] = struct.unpack_from(fmt, data, pos)[0]
+            pos += struct.calcsize(fmt)
+        else:
+            out[f["name"]], pos = _decode_fields(TYPES[t]["fields"], data, pos)
+    return out, pos
+
+
+def decode_bin(data):
+    """(kind, name, dict) of a binary frame; kind is "command" or "reply"."""
+    try:
+        kind, name = _BY_ID[data[0]]
+        spec = (COMMANDS if kind == "command" else REPLIES)[name]
+        msg, pos = _decode_fields(spec.get("fields", []), data, 1)
+    except (KeyError, IndexError, struct.error, UnicodeDecodeError):
+        raise ProtocolError("bad_binary")
+    if pos != len(data):
+        raise ProtocolError("bad_binary")
+    return kind, name, msg
+
+
+def reply_name(msg):
+    """Name of the schema reply a JSON reply dict is, or None."""
+    for name, spec in REPLIES.items():
+        if spec.get("tag") and spec["tag"] in msg:
+            return name
+    for name, spec in REPLIES.items():
+        if not spec.get("tag"):
+            first = next(f for f in spec["fields"] if not f.get("optional"))
+            if first["name"] in msg:
+                return name
+    return None
+'''
+
+
+def py_builder(name, spec):
+    fields = spec.get("fields", [])
+    required = [f["name"] for f in fields if not f.get("optional") and "default" not in f]
+    others = [f["name"] for f in fields if f["name"] not in required]
+    params = required + [f"{n}=None" for n in others]
+    args = ", ".join(f"{n}={n}" for n in required + others)
+    doc = spec.get("doc", "")
+    return (f"def {name}({', '.join(params)}):\n"
+            f"    \"\"\"{doc}\"\"\"\n"
+            f"    return build(\"{name}\"{', ' + args if args else ''})\n")
+
+
+def gen_python(s):
+    def table(objs):
+        return {o["name"]: {k: v for k, v in o.items() if k not in ("name", "kind")} for o in objs}
+
+    out = [f'''# Generated by protocol/gen_protocol.py from protocol/roboarm_protocol.json - do not edit.
+"""Protokół RoboArm: buildery poleceń JSON i kodek binarny (ten sam schemat co firmware).
+
+    import roboarm_protocol as proto
+    ws.send(json.dumps(proto.frame([10, 0, 0, 0, 0], ms=200)))
+    ws.send(proto.encode_bin("rt_frame", {{"deg": [10, 0, 0, 0, 0]}}))  # ramka BIN
+"""
+
+import json
+import struct
+
+VERSION = {s.version}
+CONSTANTS = {pprint.pformat(s.constants, sort_dicts=False)}
+TYPES = {pprint.pformat(table(s.types), sort_dicts=False, width=100)}
+COMMANDS = {pprint.pformat(table(s.commands), sort_dicts=False, width=100)}
+REPLIES = {pprint.pformat(table(s.replies), sort_dicts=False, width=100)}''']
+    out.append(PY_RUNTIME)
+    for c in s.commands:
+        out.append("")
+        out.append(py_builder(c["name"], table([c])[c["name"]]))
+    return "\n".join(out)
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    p.add_argument("--check", action="store_true", help="tylko sprawdź, czy wygenerowane pliki są aktualne")
+    args = p.parse_args()
+
+    with open(SCHEMA) as f:
+        s = Schema(json.load(f))
+    outputs = {OUT_FIRMWARE: gen_firmware(s), OUT_CLIENT: gen_client(s), OUT_PYTHON: gen_python(s)}
+
+    stale = []
+    for path, text in outputs.items():
+        old = open(path).read() if os.path.exists(path) else None
+        if old == text:
+            continue
+        stale.append(os.path.relpath(path, ROOT))
+        if not args.check:
+            os.makedirs(os.path.dirname(path), exist_ok=True)
+            with open(path, "w") as f:
+                f.write(text)
+    for path in stale:
+        print(("nieaktualny: " if args.check else "zapisano: ") + path)
+    return 1 if args.check and stale else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,138 @@
+#pragma once
+// Input filters for streamed and rt_frame joint targets (joystick, mocap).
+//
+// Each incoming sample goes through a per-joint filter before it becomes a
+// move target, so sensor jitter does not turn into servo jitter and extra I2C
+// writes. Samples arrive at an irregular rate, so every filter takes the time
+// since the previous sample.
+//   ONE_EURO  - low-pass whose cutoff rises with speed: smooth at rest, little
+//               lag on fast moves (Casiez et al., CHI 2012)
+//   CRITICAL  - critically damped second-order follower, no overshoot
+//   MA        - moving average of the last n samples
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+enum FilterType : uint8_t { FILTER_NONE = 0, FILTER_ONE_EURO, FILTER_CRITICAL, FILTER_MA };
+
+static const uint8_t FILTER_MA_MAX = 16;
+static const float FILTER_DCUTOFF_HZ = 1.0f;  // One-Euro: cutoff of the speed estimate
+
+inline const char *filterName(FilterType type) {
+  switch (type) {
+    case FILTER_ONE_EURO: return "one_euro";
+    case FILTER_CRITICAL: return "critical";
+    case FILTER_MA: return "ma";
+    default: return "none";
+  }
+}
+
+inline bool filterFromName(const char *name, FilterType &type) {
+  if (strcmp(name, "none") == 0) type = FILTER_NONE;
+  else if (strcmp(name, "one_euro") == 0) type = FILTER_ONE_EURO;
+  else if (strcmp(name, "critical") == 0) type = FILTER_CRITICAL;
+  else if (strcmp(name, "ma") == 0) type = FILTER_MA;
+  else return false;
+  return true;
+}
+
+class InputFilter {
+ public:
+  void setNone() { type_ = FILTER_NONE; }
+
+  void setOneEuro(float minCutoffHz, float beta) {
+    type_ = FILTER_ONE_EURO;
+    minCutoffHz_ = minCutoffHz;
+    beta_ = beta;
+  }
+
+  void setCritical(float freqHz) {
+    type_ = FILTER_CRITICAL;
+    freqHz_ = freqHz;
+  }
+
+  void setMovingAverage(uint8_t n) {
+    type_ = FILTER_MA;
+    n_ = n < 1 ? 1 : (n > FILTER_MA_MAX ? FILTER_MA_MAX : n);
+  }
+
+  // Start from value without a transient
+  void reset(float value) {
+    x_ = value;
+    dx_ = 0.0f;
+    v_ = 0.0f;
+    for (uint8_t i = 0; i < FILTER_MA_MAX; i++) ring_[i] = value;
+    sum_ = value * n_;
+    head_ = 0;
+  }
+
+  float apply(float x, float dtS) {
+    switch (type_) {
+      case FILTER_ONE_EURO: {
+        float dx = (x - x_) / dtS;
+        dx_ += alpha(FILTER_DCUTOFF_HZ, dtS) * (dx - dx_);
+        float cutoff = minCutoffHz_ + beta_ * fabsf(dx_);
+        x_ += alpha(cutoff, dtS) * (x - x_);
+        return x_;
+      }
+      case FILTER_CRITICAL: {
+        // Exact step response over dt with the input held: e(t) = (e0 + (v0 + w e0) t) e^-wt
+        float w = 2.0f * (float)M_PI * freqHz_;
+        float e0 = x_ - x;
+        float k = v_ + w * e0;
+        float decay = expf(-w * dtS);
+        x_ = x + (e0 + k * dtS) * decay;
+        v_ = (v_ - w * k * dtS) * decay;
+        return x_;
+      }
+      case FILTER_MA: {
+        head_ = (head_ + 1) % n_;
+        sum_ += x - ring_[head_];
+        ring_[head_] = x;
+        x_ = sum_ / n_;
+        return x_;
+      }
+      default:
+        x_ = x;
+        return x;
+    }
+  }
+
+  // Delay of a ramp through the filter, at samples sampleMs apart
+  // (One-Euro: at rest, the lag shrinks as the joint speeds up)
+  float latencyMs(float sampleMs) const {
+    switch (type_) {
+      case FILTER_ONE_EURO: return 1000.0f / (2.0f * (float)M_PI * minCutoffHz_);
+      case FILTER_CRITICAL: return 2.0f * 1000.0f / (2.0f * (float)M_PI * freqHz_);
+      case FILTER_MA: return (n_ - 1) * 0.5f * sampleMs;
+      default: return 0.0f;
+    }
+  }
+
+  bool enabled() const { return type_ != FILTER_NONE; }
+  FilterType type() const { return type_; }
+  float minCutoffHz() const { return minCutoffHz_; }
+  float beta() const { return beta_; }
+  float freqHz() const { return freqHz_; }
+  uint8_t length() const { return n_; }
+
+ private:
+  static float alpha(float cutoffHz, float dtS) {
+    float tau = 1.0f / (2.0f * (float)M_PI * cutoffHz);
+    return 1.0f / (1.0f + tau / dtS);
+  }
+
+  FilterType type_ = FILTER_NONE;
+  float minCutoffHz_ = 1.0f;
+  float beta_ = 0.0f;
+  float freqHz_ = 5.0f;
+  uint8_t n_ = 4;
+
+  float x_ = 0.0f;   // output
+  float dx_ = 0.0f;  // One-Euro speed estimate
+  float v_ = 0.0f;   // CRITICAL velocity
+  float ring_[FILTER_MA_MAX] = {};
+  float sum_ = 0.0f;
+  uint8_t head_ = 0;
+};
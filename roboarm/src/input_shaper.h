@@ -0,0 +1,164 @@
+#pragma once
+// Input shapers (ZV, ZVD, EI) for suppressing arm vibration.
+//
+// The interpolated joint angle is sampled on a fixed clock into a short history
+// and the servo gets a weighted sum of delayed copies of it (an FIR with 2-3
+// taps). The impulse times/amplitudes cancel the residual vibration of a
+// lightly damped mode at freqHz/damping. Fixed point: samples in centidegrees,
+// coefficients in Q15.
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+enum ShaperType : uint8_t { SHAPER_NONE = 0, SHAPER_ZV, SHAPER_ZVD, SHAPER_EI };
+
+static const uint32_t SHAPER_SAMPLE_MS = 2;
+static const uint16_t SHAPER_HISTORY = 256;  // power of two; 512 ms -> lowest freq ~2 Hz
+static const uint8_t SHAPER_MAX_TAPS = 3;
+static const float SHAPER_EI_VTOL = 0.05f;   // EI: tolerated residual vibration (5%)
+
+struct ShaperTaps {
+  uint8_t count;
+  uint16_t delay[SHAPER_MAX_TAPS];  // in samples
+  int32_t coeff[SHAPER_MAX_TAPS];   // Q15, sums to 32768
+};
+
+inline const char *shaperName(ShaperType type) {
+  switch (type) {
+    case SHAPER_ZV: return "zv";
+    case SHAPER_ZVD: return "zvd";
+    case SHAPER_EI: return "ei";
+    default: return "none";
+  }
+}
+
+inline bool shaperFromName(const char *name, ShaperType &type) {
+  if (strcmp(name, "none") == 0) type = SHAPER_NONE;
+  else if (strcmp(name, "zv") == 0) type = SHAPER_ZV;
+  else if (strcmp(name, "zvd") == 0) type = SHAPER_ZVD;
+  else if (strcmp(name, "ei") == 0) type = SHAPER_EI;
+  else return false;
+  return true;
+}
+
+// Impulse sequence for a mode at freqHz with damping ratio (0..<1).
+// Returns false if the shaper does not fit the history buffer.
+inline bool computeShaperTaps(ShaperType type, float freqHz, float damping, ShaperTaps &out) {
+  memset(&out, 0, sizeof(out));
+  if (type == SHAPER_NONE) {
+    out.count = 1;
+    out.coeff[0] = 32768;
+    return true;
+  }
+  if (freqHz <= 0.0f || damping < 0.0f || damping >= 1.0f) return false;
+
+  float df = sqrtf(1.0f - damping * damping);
+  float K = expf(-damping * (float)M_PI / df);
+  float td = 1.0f / (freqHz * df);  // damped period [s]
+
+  float a[SHAPER_MAX_TAPS];
+  float t[SHAPER_MAX_TAPS] = {0.0f, 0.5f * td, td};
+  switch (type) {
+    case SHAPER_ZV:
+      out.count = 2;
+      a[0] = 1.0f;
+      a[1] = K;
+      break;
+    case SHAPER_ZVD:
+      out.count = 3;
+      a[0] = 1.0f;
+      a[1] = 2.0f * K;
+      a[2] = K * K;
+      break;
+    case SHAPER_EI:
+      out.count = 3;
+      a[0] = 0.25f * (1.0f + SHAPER_EI_VTOL);
+      a[1] = 0.5f * (1.0f - SHAPER_EI_VTOL) * K;
+      a[2] = a[0] * K * K;
+      break;
+    default:
+      return false;
+  }
+
+  float sum = 0.0f;
+  for (uint8_t i = 0; i < out.count; i++) sum += a[i];
+
+  int32_t total = 0;
+  for (uint8_t i = 0; i < out.count; i++) {
+    float samples = t[i] * 1000.0f / SHAPER_SAMPLE_MS;
+    if (samples + 0.5f >= SHAPER_HISTORY) return false;
+    out.delay[i] = (uint16_t)(samples + 0.5f);
+    out.coeff[i] = (int32_t)(a[i] / sum * 32768.0f + 0.5f);
+    total += out.coeff[i];
+  }
+  out.coeff[0] += 32768 - total;  // rounding remainder, keeps DC gain exactly 1
+  return true;
+}
+
+class InputShaper {
+ public:
+  InputShaper() { configure(SHAPER_NONE, 0.0f, 0.0f); }
+
+  bool configure(ShaperType type, float freqHz, float damping) {
+    ShaperTaps taps;
+    if (!computeShaperTaps(type, freqHz, damping, taps)) return false;
+    taps_ = taps;
+    type_ = type;
+    freqHz_ = freqHz;
+    damping_ = damping;
+    return true;
+  }
+
+  // Fill the history so the output starts at value without a jump
+  void reset(int16_t value) {
+    for (uint16_t i = 0; i < SHAPER_HISTORY; i++) hist_[i] = value;
+  }
+
+  void push(int16_t sample) {
+    head_ = (head_ + 1) & (SHAPER_HISTORY - 1);
+    hist_[head_] = sample;
+  }
+
+  int16_t output() const {
+    int32_t acc = 0;
+    for (uint8_t i = 0; i < taps_.count; i++) {
+      acc += taps_.coeff[i] * hist_[(head_ - taps_.delay[i]) & (SHAPER_HISTORY - 1)];
+    }
+    return (int16_t)((acc + (acc >= 0 ? 16384 : -16384)) / 32768);
+  }
+
+  bool enabled() const { return type_ != SHAPER_NONE; }
+  ShaperType type() const { return type_; }
+  float freqHz() const { return freqHz_; }
+  float damping() const { return damping_; }
+  const ShaperTaps &taps() const { return taps_; }
+  uint32_t delayMs() const { return taps_.delay[taps_.count - 1] * SHAPER_SAMPLE_MS; }
+
+ private:
+  int16_t hist_[SHAPER_HISTORY] = {};
+  uint16_t head_ = 0;
+  ShaperTaps taps_;
+  ShaperType type_ = SHAPER_NONE;
+  float freqHz_ = 0.0f;
+  float damping_ = 0.0f;
+};
+
+// Joint as a second-order mode driven by the commanded angle: the reference
+// for how much a command profile rings (used by the ringing test).
+struct ResonanceModel {
+  float pos = 0.0f;
+  float vel = 0.0f;
+
+  void reset(float value) {
+    pos = value;
+    vel = 0.0f;
+  }
+
+  void step(float cmd, float dtS, float freqHz, float damping) {
+    float w = 2.0f * (float)M_PI * freqHz;
+    float acc = w * w * (cmd - pos) - 2.0f * damping * w * vel;
+    vel += acc * dtS;  // semi-implicit Euler, stable for w*dt < 2
+    pos += vel * dtS;
+  }
+};
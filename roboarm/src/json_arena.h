@@ -0,0 +1,79 @@
+#pragma once
+// Fixed-size arena for an ArduinoJson document (static memory mode).
+//
+// A bump allocator over a caller-owned buffer. ArduinoJson frees everything a
+// document holds on clear() and at the start of deserializeJson(), so once no
+// block is live the arena rewinds to the start. A message that does not fit
+// fails with NoMemory instead of growing the heap.
+
+#include <ArduinoJson.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+class JsonArena : public ArduinoJson::Allocator {
+ public:
+  JsonArena(uint8_t *buf, size_t size) : buf_(buf), size_(size) {}
+
+  void *allocate(size_t n) override {
+    size_t need = HEADER + align(n);
+    if (top_ + need > size_) {
+      failures_++;
+      return nullptr;
+    }
+    uint8_t *block = buf_ + top_;
+    memcpy(block, &n, sizeof(n));
+    last_ = top_;
+    top_ += need;
+    live_++;
+    if (top_ > highWater_) highWater_ = top_;
+    return block + HEADER;
+  }
+
+  void deallocate(void *p) override {
+    if (!p) return;
+    if (live_ && --live_ == 0) top_ = 0;
+  }
+
+  void *reallocate(void *p, size_t n) override {
+    if (!p) return allocate(n);
+    uint8_t *block = (uint8_t *)p - HEADER;
+    size_t old;
+    memcpy(&old, block, sizeof(old));
+    if ((size_t)(block - buf_) == last_) {
+      // Last block: grow or shrink in place
+      size_t need = HEADER + align(n);
+      if (last_ + need > size_) {
+        failures_++;
+        return nullptr;
+      }
+      memcpy(block, &n, sizeof(n));
+      top_ = last_ + need;
+      if (top_ > highWater_) highWater_ = top_;
+      return p;
+    }
+    if (n <= old) return p; // shrinking an inner block keeps its space
+    void *q = allocate(n);
+    if (!q) return nullptr;
+    memcpy(q, p, old);
+    deallocate(p);
+    return q;
+  }
+
+  size_t size() const { return size_; }
+  size_t used() const { return top_; }
+  size_t highWater() const { return highWater_; }
+  uint32_t failures() const { return failures_; }
+
+ private:
+  static const size_t HEADER = 8; // block size, keeps payloads 8-byte aligned
+  static size_t align(size_t n) { return (n + 7) & ~(size_t)7; }
+
+  uint8_t *buf_;
+  size_t size_;
+  size_t top_ = 0;
+  size_t last_ = 0;
+  size_t highWater_ = 0;
+  uint32_t live_ = 0;
+  uint32_t failures_ = 0;
+};
@@ -5,11 +5,37 @@
 #include <WiFi.h>
 #include <WebSocketsServer.h>
 #include <Adafruit_NeoPixel.h>
+#include <esp_wifi.h>
+#include <driver/i2c.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+#include "input_filter.h"
+#include "input_shaper.h"
+#include "json_arena.h"
+#include "protocol_gen.h"
 
 // ========= Hardware config =========
 static const uint8_t I2C_SDA_PIN = 21;
 static const uint8_t I2C_SCL_PIN = 22;
-static const uint8_t PCA9685_ADDR = 0x40;
+static const i2c_port_t I2C_PORT = I2C_NUM_0;  // the port Wire uses
+static const uint32_t I2C_TIMEOUT_MS = 10;
+
+// Bus clock: starts at Fast-mode and is stepped up to the fastest level the
+// wiring takes, and back down when a window of bursts has too many errors.
+// Long cables or weak pull-ups: cap with I2C_MAX_LEVEL (or the "i2c" command).
+static const uint32_t I2C_CLOCKS[] = {100000, 400000, 1000000};  // Sm, Fm, Fm+
+static const uint8_t I2C_LEVELS = sizeof(I2C_CLOCKS) / sizeof(I2C_CLOCKS[0]);
+static const uint8_t I2C_START_LEVEL = 1;
+static const uint8_t I2C_MAX_LEVEL = 2;
+static const uint16_t I2C_WINDOW = 100;       // bursts per health window
+static const uint8_t I2C_ERR_THRESHOLD = 3;   // errors in one window -> fall back
+static const uint8_t I2C_PROBE_WINDOWS = 3;   // clean windows before trying the next level
+
+// PCA9685 boards on the bus (address set with the A0..A5 jumpers)
+static const uint8_t PCA9685_ADDR[] = {0x40};
+static const uint8_t NUM_BOARDS = sizeof(PCA9685_ADDR) / sizeof(PCA9685_ADDR[0]);
 
 // WiFi hotspot config
 const char* AP_SSID = "ESP32_RoboArm";
@@ -18,16 +44,40 @@ IPAddress AP_IP(192, 168, 4, 1);
 IPAddress AP_GATEWAY(192, 168, 4, 1);
 IPAddress AP_SUBNET(255, 255, 255, 0);
 
+// AP channel: fixed, or picked at boot by scanning for the least congested of 1/6/11
+static const uint8_t AP_DEFAULT_CHANNEL = 1;
+static const bool AP_AUTO_CHANNEL = true;
+
+// WiFi link telemetry sampling period
+static const uint32_t WIFI_SAMPLE_MS = 2000;
+// Unsolicited status push (pose, LED, link summary) to every client
+static const uint32_t STATUS_PUSH_MS = 2000;
+
 // WebSocket server
 static const uint16_t WS_PORT = 81;
 
 // RGB LED (adresowalna - NeoPixel)
 static const uint8_t RGB_LED_PIN = 17;
-static const uint8_t RGB_LED_COUNT = 1;  // jedna dioda, można zwiększyć
 
-// 5 DOF: 3x MG996R (ch 0..2), 2x MG90S (ch 3..4)
+// 5 DOF per arm: 3x MG996R (ch 0..2), 2x MG90S (ch 3..4)
 static const uint8_t NUM_SERVOS = 5;
-static const uint8_t SERVO_CH[NUM_SERVOS] = {0, 1, 2, 3, 4};
+static_assert(NUM_SERVOS == proto::SERVOS, "protocol/roboarm_protocol.json: SERVOS");
+
+// Logical arm -> PCA9685 channels. A second arm on its own board at 0x41:
+//   PCA9685_ADDR = {0x40, 0x41}, ARM_CFG += {1, {0, 1, 2, 3, 4}, 15, 1}
+// or sharing the first board: ARM_CFG += {0, {5, 6, 7, 8, 9}, 14, 1}
+struct ArmConfig {
+  uint8_t board;           // index into PCA9685_ADDR
+  uint8_t ch[NUM_SERVOS];  // channel of each joint
+  uint8_t ledCh;           // channel of the LED
+  uint8_t pixel;           // RGB LED index on the NeoPixel chain
+};
+
+static const ArmConfig ARM_CFG[] = {
+    {0, {0, 1, 2, 3, 4}, 15, 0},
+};
+static const uint8_t NUM_ARMS = sizeof(ARM_CFG) / sizeof(ARM_CFG[0]);
+static const uint8_t RGB_LED_COUNT = NUM_ARMS;  // jedna dioda na ramię
 
 // All servos = 1.0–2.0 ms at 50 Hz, center 1.5 ms.
 // Angle convention: -90..+90 deg.
@@ -39,7 +89,7 @@ struct ServoConfig {
 };
 
 // Defaults (values correspond to current PWM 123-590 range)
-ServoConfig servoCfg[NUM_SERVOS] = {
+static const ServoConfig DEFAULT_SERVO_CFG[NUM_SERVOS] = {
     {620, 2520, 0, false}, // ch 0 (MG996R)
     {620, 2520, 0, false}, // ch 1 (MG996R)
     {620, 2520, 0, false}, // ch 2 (MG996R)
@@ -47,370 +97,2242 @@ ServoConfig servoCfg[NUM_SERVOS] = {
     {601, 2881, 0, false}, // ch 4 (MG90S)
 };
 
-// Servo frequency
-static float SERVO_HZ = 50.0f;
+// Servo frequency, per board at runtime ("freq"). Analog servos need 40-60 Hz;
+// digital servos take a high-rate mode, so a new command waits 3-5 ms for the
+// next pulse instead of up to 20 ms.
+static const float SERVO_HZ = 50.0f;
+static const float SERVO_HZ_FAST_MIN = 200.0f;
+static const float SERVO_HZ_FAST_MAX = 330.0f;
+static const uint32_t PCA9685_OSC_HZ = 27000000;
 
-// ========= Internals =========
-Adafruit_PWMServoDriver pca = Adafruit_PWMServoDriver(PCA9685_ADDR);
-WebSocketsServer webSocket = WebSocketsServer(WS_PORT);
-Adafruit_NeoPixel rgbLed(RGB_LED_COUNT, RGB_LED_PIN, NEO_GRB + NEO_KHZ800);
+// Pulse safety clamp
+static const uint16_t SERVO_MIN_US = 500;
+static const uint16_t SERVO_MAX_US = 3000;
+
+// Motion tick: 15 ms at 50 Hz, follows the PWM period of the fastest board
+static const uint32_t UPDATE_DT_MS = 15;
+static const uint32_t UPDATE_DT_MIN_MS = 3;
+
+// ========= Servo lag compensation =========
+// Servo response model: dead time, then first-order lag, then slew limit.
+// A ramp command is followed dead_ms + tau_ms late once the servo is not slew limited.
+struct ServoLagModel {
+  uint16_t deadMs;
+  uint16_t tauMs;
+  uint16_t maxDps;  // 0 = no slew limit
+};
 
-// Current/start/target angles in degrees (-90..+90)
-float currDeg[NUM_SERVOS] = {0, 0, 0, 0, 0};
-float startDeg[NUM_SERVOS] = {0, 0, 0, 0, 0};
-float targetDeg[NUM_SERVOS] = {0, 0, 0, 0, 0};
+static const ServoLagModel DEFAULT_LAG_MODEL[NUM_SERVOS] = {
+    {20, 80, 350}, // ch 0 (MG996R, ~0.17 s/60 deg)
+    {20, 80, 350}, // ch 1 (MG996R)
+    {20, 80, 350}, // ch 2 (MG996R)
+    {20, 50, 600}, // ch 3 (MG90S, ~0.10 s/60 deg)
+    {20, 50, 600}, // ch 4 (MG90S)
+};
 
-uint8_t currLed = 0, startLed = 0, targetLed = 0;
+enum LagCompMode : uint8_t {
+  LAGCOMP_OFF = 0,
+  LAGCOMP_LEAD,      // joints commanded ahead of the trajectory by their lag
+  LAGCOMP_LED_DELAY, // LED/RGB timeline delayed by the lag of the slowest joint
+};
 
-// RGB LED state
-uint8_t currR = 0, currG = 0, currB = 0;
-uint8_t startR = 0, startG = 0, startB = 0;
-uint8_t targetR = 0, targetG = 0, targetB = 0;
+static const uint8_t LAG_DEAD_SAMPLES = 64;   // dead time up to 128 ms
 
-bool moving = false;
-uint32_t moveStartMs = 0;
-uint32_t moveDurMs = 0;
+// LED/RGB history for LAGCOMP_LED_DELAY
+struct LedSample {
+  uint8_t led, r, g, b;
+};
+static const uint8_t LED_HISTORY = 128;       // up to 256 ms of delay
+
+// ========= Joint angles =========
+// Buffered trajectories, scripts and the motion state hold joint angles as
+// int16 centidegrees (-9000..+9000 = -90..+90 deg) and interpolate in integer
+// maths. Float degrees exist only at the edges: parsed commands, input
+// filters, replies and the ringing test model.
+static const int16_t CDEG_MAX = 9000;
+
+// Clamped to the joint range, which keeps every difference within int16
+int16_t degToCdeg(float deg) {
+  return (int16_t)lroundf(constrain(deg, -90.0f, 90.0f) * 100.0f);
+}
 
-static const uint32_t UPDATE_DT_MS = 15;
-uint32_t lastUpdateMs = 0;
+float cdegToDeg(int32_t cdeg) { return cdeg / 100.0f; }
+
+void toCdeg(const float *deg, int16_t *cdeg) {
+  for (uint8_t i = 0; i < NUM_SERVOS; i++) cdeg[i] = degToCdeg(deg[i]);
+}
+
+// Share of dur elapsed after dt, Q16 (65536 = all of it)
+uint32_t fractionQ16(uint32_t dt, uint32_t dur) {
+  if (dt >= dur) return 65536;
+  while (dur > 0xFFFF) {
+    dt >>= 1;
+    dur >>= 1;
+  }
+  return (dt << 16) / dur;
+}
+
+// a + (b - a) * q, rounded; |b - a| up to 2 * CDEG_MAX
+int32_t lerpQ16(int32_t a, int32_t b, uint32_t q) {
+  return a + (((b - a) * (int32_t)q + 0x8000) >> 16);
+}
 
 // ========= Advanced control modes =========
-// Trajectory buffer
+// Trajectory buffer, 18 bytes a point
 struct TrajectoryPoint {
-  float deg[NUM_SERVOS];
-  uint32_t duration_ms;
+  int16_t cdeg[NUM_SERVOS];
+  uint16_t duration_ms;
+  uint16_t blend_ms;  // next point starts this much early (blend zone), 0 = stop here
   uint8_t led_val;
   uint8_t r, g, b;
 };
 
+static const uint32_t POINT_MAX_MS = 0xFFFF;
+
+// A blend zone takes at most this share of either segment, so zones never overlap
+static const float BLEND_MAX_FRACTION = 0.5f;
+
 static const uint8_t MAX_TRAJECTORY_POINTS = 20;
-TrajectoryPoint trajectoryBuffer[MAX_TRAJECTORY_POINTS];
-uint8_t trajectoryCount = 0;
-uint8_t trajectoryIndex = 0;
-bool trajectoryMode = false;
 
-// Stream mode
-bool streamMode = false;
-uint32_t streamFreq = 20; // Hz
-uint32_t lastStreamUpdateMs = 0;
+// Sparse keyframes: a trajectory given as one track per channel (joint, LED,
+// R, G, B) carrying only the values that change, each key timed from the
+// previous key of its own track. Every track interpolates between its own
+// keys; channels without keys hold. Keys sit in the buffer grouped by track.
+enum KeyChannel : uint8_t {
+  KEY_LED = NUM_SERVOS,  // 0..NUM_SERVOS-1: joints
+  KEY_R,
+  KEY_G,
+  KEY_B,
+  KEY_CHANNELS
+};
+
+static const char *const KEY_CHANNEL_NAMES[KEY_CHANNELS] = {"j0", "j1", "j2", "j3", "j4", "led", "r", "g", "b"};
+static_assert(NUM_SERVOS == 5, "KEY_CHANNEL_NAMES: one name per joint");
+
+struct Keyframe {
+  uint16_t ms;    // from the previous key of the track (or the start), 0 = jump
+  int16_t value;  // centidegrees for joints, 0..255 for LED/RGB
+};
+
+struct KeyTrack {
+  uint8_t first, count;  // run of the track's keys in keyBuffer
+  uint8_t next;          // key being approached, == count once the track is done
+  int16_t from;          // value at the start of the current segment
+  uint32_t segStartMs;
+};
+
+static const uint8_t MAX_KEYFRAMES = 64;
+
+// Stream/rt_frame input filters restart after a pause this long
+static const uint32_t FILTER_GAP_MS = 500;
+
+// Joint mapping in PCA9685 ticks of its board, Q16 fixed point: mid at 0 deg,
+// +perCdeg per centidegree, clamped to lo..hi. Covers trim, direction and the
+// pulse safety clamp.
+struct JointTicks {
+  int32_t midQ16;
+  int32_t perCdegQ16;
+  uint16_t lo, hi;
+};
+
+// Lag model per output sample (recomputeLagSteps() after lagModel changes)
+struct LagStep {
+  int32_t alphaQ16;   // share of the remaining error covered, 1 - exp(-dt/tau)
+  int32_t maxStepQ8;  // slew limit, centidegrees Q8
+};
+
+// ========= Arm state =========
+// Everything that moves with one arm. All arms are stepped from the same
+// millis() sample and share the output sample clock, so moves started
+// together stay in lockstep.
+struct Arm {
+  ServoConfig servoCfg[NUM_SERVOS];
+  JointTicks ticks[NUM_SERVOS];  // recomputeTicks() after servoCfg or PWM rate changes
+  ServoLagModel lagModel[NUM_SERVOS];
+  LagStep lagStep[NUM_SERVOS];
+
+  // Current/start/target angles in centidegrees (-9000..+9000)
+  int16_t currCdeg[NUM_SERVOS] = {};
+  int16_t startCdeg[NUM_SERVOS] = {};
+  int16_t targetCdeg[NUM_SERVOS] = {};
+
+  uint8_t currLed = 0, startLed = 0, targetLed = 0;
+
+  // RGB LED state
+  uint8_t currR = 0, currG = 0, currB = 0;
+  uint8_t startR = 0, startG = 0, startB = 0;
+  uint8_t targetR = 0, targetG = 0, targetB = 0;
+
+  bool moving = false;
+  uint32_t moveStartMs = 0;
+  uint32_t moveDurMs = 0;
+
+  // Blend zone: the rest of the previous move, added on top of the current
+  // one and fading out linearly over blendDurMs (0 = no blend)
+  int16_t blendOffset[NUM_SERVOS] = {};  // centidegrees
+  uint32_t blendStartMs = 0;
+  uint32_t blendDurMs = 0;
+
+  // Per-joint shapers applied after interpolation (see input_shaper.h)
+  InputShaper shaper[NUM_SERVOS];
+  uint32_t outputSettleUntilMs = 0; // outputs keep changing until shaped/delayed tails have played out
+
+  LagCompMode lagMode = LAGCOMP_OFF;
+  // Commanded angle after lead compensation (== currCdeg unless LAGCOMP_LEAD)
+  int16_t cmdCdeg[NUM_SERVOS] = {};
+  // Estimated physical angle (model driven by the output actually sent),
+  // centidegrees Q8
+  int16_t lagDeadHist[NUM_SERVOS][LAG_DEAD_SAMPLES];
+  uint8_t lagDeadHead = 0;
+  int32_t estQ8[NUM_SERVOS] = {};
+
+  LedSample ledHist[LED_HISTORY];
+  uint8_t ledHistHead = 0;
+
+  TrajectoryPoint trajectoryBuffer[MAX_TRAJECTORY_POINTS];
+  uint8_t trajectoryCount = 0;
+  uint8_t trajectoryIndex = 0;
+  bool trajectoryMode = false;
+
+  // Keyframe playback: runs as one move from moveStartMs over moveDurMs (the
+  // longest track), with the last key of every track as the move target
+  Keyframe keyBuffer[MAX_KEYFRAMES];
+  KeyTrack keyTrack[KEY_CHANNELS];
+  bool keyMode = false;
+
+  // Stream mode
+  bool streamMode = false;
+  uint32_t streamFreq = 20; // Hz
+  uint32_t lastStreamUpdateMs = 0;
+
+  // Per-joint filters on stream/rt_frame targets (see input_filter.h)
+  InputFilter inFilter[NUM_SERVOS];
+  bool inputActive = false;
+  uint32_t lastInputMs = 0;
+  float inputIntervalMs = 0.0f;  // smoothed spacing of filtered samples
+};
+
+// ========= Internals =========
+Adafruit_PWMServoDriver *pca[NUM_BOARDS];
+WebSocketsServer webSocket = WebSocketsServer(WS_PORT);
+Adafruit_NeoPixel rgbLed(RGB_LED_COUNT, RGB_LED_PIN, NEO_GRB + NEO_KHZ800);
+
+Arm arms[NUM_ARMS];
+
+uint32_t lastUpdateMs = 0;
+uint32_t updateDtMs = UPDATE_DT_MS;
+uint32_t lastSampleMs = 0;       // fixed SHAPER_SAMPLE_MS clock of the output stage
+
+// PCA9685 output shadow: channel values are collected here and flushed once per
+// tick, each board's changed span as a single auto-increment I2C write.
+static const uint8_t PCA9685_LED0_ON_L = 0x06;
+struct BoardOutput {
+  uint16_t off[16];
+  uint16_t dirty;   // bit per channel changed since the last flush
+  bool busy;        // burst queued or on the bus (set by the loop, cleared by the I2C task)
+  uint16_t failed;  // channels of a failed burst, to resend (set by the I2C task)
+  float hz;         // requested PWM frequency
+  float ticksPerUs; // from the prescale actually programmed
+};
+BoardOutput boardOut[NUM_BOARDS] = {};
+
+// Bursts go through a queue to the I2C task, which runs them on the ESP-IDF
+// driver while the loop carries on
+static const uint8_t I2C_BURST_MAX = 1 + 16 * 4;
+struct I2cBurst {
+  uint8_t board;
+  uint8_t len;
+  uint16_t mask;    // channels carried
+  uint8_t data[I2C_BURST_MAX];
+};
+
+struct I2cStats {
+  uint32_t queued;    // bursts handed to the I2C task
+  uint32_t bytes;
+  uint32_t retries;   // flushes that resent channels of a failed burst
+  uint32_t deferred;  // flushes held back because the board's previous burst was still in flight
+  // Written by the I2C task
+  uint32_t done;      // completed
+  uint32_t errors;    // failed, any reason
+  uint32_t nacks;     // no ACK from the board (ESP_FAIL)
+  uint32_t timeouts;  // bus busy / clock stretched past I2C_TIMEOUT_MS
+  uint32_t lastUs, maxUs;
+  uint64_t totalUs;   // transfer time of completed bursts
+  uint32_t clockHz;
+  uint32_t fallbacks, upshifts;
+};
+
+// Adaptive clock state, owned by the I2C task
+struct I2cClock {
+  uint8_t level;
+  uint8_t ceiling;        // highest level still allowed (lowered on fallback)
+  uint16_t windowBursts;
+  uint8_t windowErrors;
+  uint8_t cleanWindows;
+};
+
+QueueHandle_t i2cQueue = nullptr;
+TaskHandle_t loopTask = nullptr;
+I2cStats i2cStats = {};
+I2cClock i2cClock = {};
+uint8_t i2cMaxLevel = I2C_MAX_LEVEL;  // set by the "i2c" command
+bool i2cReprobe = false;              // "i2c" command: forget earlier fallbacks
+
+// Ringing test: step one joint, hold, and run both the raw and the shaped
+// command through a resonance model of that joint
+struct RingingTest {
+  bool active;
+  bool holding;
+  uint8_t arm;
+  uint8_t ch;
+  uint8_t clientNum;
+  float freqHz;
+  float damping;
+  float startDeg;
+  float targetDeg;
+  uint32_t moveMs;
+  uint32_t holdMs;
+  uint32_t moveEndMs;
+  ResonanceModel raw, shaped;
+  float rawResidual, shapedResidual;   // peak |pos - target| once each command settled
+  uint32_t rawSettleMs, shapedSettleMs; // last time outside the band, from move end
+};
+
+static const float RINGING_SETTLE_DEG = 0.5f;
+RingingTest ringTest = {};
+
+// Scripts: composite commands run on the ESP32, one per arm slot. Steps run
+// back to back from loop() until one has to wait (move done, delay, event),
+// and the script resumes there on a later iteration, so a multi-step sequence
+// needs no network round trip between steps and never blocks loop().
+enum ScriptOp : uint8_t {
+  OP_FRAME,       // start a move (home = frame to 0 deg)
+  OP_RGB,
+  OP_LED,
+  OP_WAIT_MOVE,   // until the arm stops (trajectory included)
+  OP_DELAY,
+  OP_WAIT_EVENT,  // until {"cmd":"event"} or another script signals the name
+  OP_SIGNAL,
+  OP_REPEAT       // jump back to step `to`, `count` more times
+};
+
+static const uint8_t SCRIPT_MAX_STEPS = 48;
+static const uint8_t SCRIPT_NAME_LEN = 16;
+
+struct ScriptStep {
+  ScriptOp op;
+  uint8_t arm;
+  uint8_t led, r, g, b;
+  uint8_t to;
+  uint16_t left;       // repeat: jumps still to do (own counter, so repeats nest)
+  uint32_t ms;         // frame duration, delay, repeat count
+  int16_t cdeg[NUM_SERVOS];
+  char event[SCRIPT_NAME_LEN];
+};
+
+struct Script {
+  bool running;
+  bool waiting;        // current step has started waiting
+  bool eventHit;
+  uint8_t clientNum;
+  uint8_t count, pc;
+  uint32_t startMs;
+  uint32_t waitUntilMs;
+  char id[SCRIPT_NAME_LEN];
+  ScriptStep steps[SCRIPT_MAX_STEPS];
+};
+
+Script scripts[NUM_ARMS];
+
+// ========= Memory budget =========
+// ROBOARM_STATIC_MEMORY=1 (env esp32dev_static): the JSON documents live in
+// fixed arenas and malloc is wrapped (-Wl,--wrap=malloc), so every heap
+// allocation after setup() is counted. Everything else is sized at compile
+// time in both modes: trajectories, scripts, output queue, reply buffer.
+#ifndef ROBOARM_STATIC_MEMORY
+#define ROBOARM_STATIC_MEMORY 0
+#endif
+
+static const size_t TX_BUF_BYTES = 4096; // longest reply (stats) with room to spare
 
 // Reusable JSON documents (ArduinoJson 7+: use JsonDocument)
+#if ROBOARM_STATIC_MEMORY
+static const size_t JSON_RX_ARENA_BYTES = 16384; // 48-step script / 20-point trajectory
+static const size_t JSON_TX_ARENA_BYTES = 8192;
+alignas(8) uint8_t rxArenaBuf[JSON_RX_ARENA_BYTES];
+alignas(8) uint8_t txArenaBuf[JSON_TX_ARENA_BYTES];
+JsonArena rxArena(rxArenaBuf, sizeof(rxArenaBuf));
+JsonArena txArena(txArenaBuf, sizeof(txArenaBuf));
+JsonDocument rxDoc(&rxArena);
+JsonDocument txDoc(&txArena);
+#else
 JsonDocument rxDoc;
 JsonDocument txDoc;
+#endif
+
+// Serialized reply, with room in front for the WebSocket header: the library
+// then sends it in place instead of copying it into a heap buffer
+uint8_t txFrame[WEBSOCKETS_MAX_HEADER_SIZE + TX_BUF_BYTES];
+
+// Who runs on the loop task when an allocation happens
+enum MemPhase : uint8_t { MEM_APP = 0, MEM_WS };
+
+struct MemBudget {
+  bool armed;            // end of setup(): allocations from here on are counted
+  uint8_t phase;         // MemPhase
+  bool logged;           // first app allocation reported on Serial
+  uint32_t appAllocs;    // loop task, our code (should stay 0)
+  uint32_t appBytes;
+  uint32_t wsAllocs;     // loop task, inside webSocket.loop() (library rx buffers)
+  uint32_t wsBytes;
+  uint32_t otherAllocs;  // other tasks (WiFi, lwIP, I2C)
+  uint32_t lastSize;
+  uintptr_t lastCaller;  // return address of the last app allocation (addr2line)
+  uint32_t txHighWater;
+  uint32_t txOverflows;
+};
+
+MemBudget mem = {};
+
+// Per-client traffic counters (slot = WebSocket client number)
+struct ClientStats {
+  bool connected;
+  uint32_t connectedMs;
+  uint32_t lastActivityMs;
+  uint32_t rxMsgs, rxBytes;
+  uint32_t txMsgs, txBytes;
+  uint32_t parseErrors;
+  uint32_t unknownCmds;
+  uint32_t droppedFrames;
+  uint32_t txFailures;
+};
+
+ClientStats clientStats[WEBSOCKETS_SERVER_CLIENT_MAX];
+
+// Soft AP link telemetry. ESP-IDF does not expose per-station retry counters
+// or channel busy time, so congestion is estimated from the boot scan and
+// delivery failures are counted per client (ClientStats::txFailures).
+struct WifiStation {
+  uint8_t mac[6];
+  int8_t rssi;
+  int8_t rssiMin;   // worst RSSI seen since association
+};
+
+struct WifiTelemetry {
+  uint8_t channel;
+  uint8_t stationCount;
+  WifiStation stations[ESP_WIFI_MAX_CONN_NUM];
+  uint8_t scanAps;      // APs found within +-4 channels of ours at boot
+  uint16_t scanScore;   // weighted interference score of our channel (lower = quieter)
+  uint32_t samples;
+  uint32_t sampleUs;    // duration of last sample
+  uint32_t lastSampleMs;
+};
+
+WifiTelemetry wifiTel = {};
+uint32_t lastStatusPushMs = 0;
+
+// Load shedding: a loop() iteration longer than the motion tick is an overrun.
+// Each overrun raises the shed level, and non-critical work backs off in this order:
+//   1: Serial message log dropped, WiFi telemetry and unsolicited reports deferred
+//   2: additionally, the NeoPixel refresh is decimated to every SHED_LED_DECIMATION-th tick
+// Servo output is never shed. The level drops one step per SHED_RECOVER_MS without an overrun.
+static const uint8_t SHED_MAX_LEVEL = 2;
+static const uint32_t SHED_RECOVER_MS = 1000;
+static const uint32_t SHED_MAX_DEFER_MS = 10000;  // deferred work still runs at least this often
+static const uint8_t SHED_LED_DECIMATION = 4;
+
+struct LoadStats {
+  uint8_t level;
+  uint32_t lastOverrunMs;
+  uint32_t loops;
+  uint32_t overruns;
+  uint32_t lastLoopUs, maxLoopUs;
+  uint32_t maxTickLateMs;      // worst delay of a motion tick past updateDtMs
+  uint32_t escalations;        // level raised
+  uint32_t logsDropped;
+  uint32_t telemetryDeferred;
+  uint32_t reportsDeferred;
+  uint32_t ledSkipped;
+  uint8_t ledTick;
+  bool telemetryHeld, reportHeld, pushHeld;  // count each deferral once
+};
+
+LoadStats load = {};
+
+// Command classes. "stop" is immediate: it runs inside the WebSocket callback,
+// ahead of everything queued. Motion commands (frames, trajectories, streams,
+// scripts, LED) run on arrival. Configuration and reports (status, stats,
+// config, shaper, ...) are deferred until the motion tick and the outputs of
+// the loop pass are done; under load shedding one per pass.
+// Replies stay in command order per client (the C++ client matches them FIFO):
+// once a client has something queued, its later commands queue behind it,
+// except rt_frame and stream samples, which have no reply and must not wait.
+// A stop behind queued commands takes effect at once; only its reply waits.
+// Queued motion for a stopped arm is answered "preempted" instead of run.
+enum CmdClass : uint8_t { CMD_IMMEDIATE = 0, CMD_MOTION, CMD_BACKGROUND };
+enum QueuedState : uint8_t { QUEUED_RUN = 0, QUEUED_PREEMPTED, QUEUED_REPLY };
+
+static const uint8_t CMD_QUEUE_SLOTS = 8;
+static const uint16_t CMD_QUEUE_BYTES = 512;  // longer commands are not queued: see queueCommand
+static const uint8_t CMD_ANY_ARM = 0xFF;  // QueuedCmd::arm: moves several arms
+static const uint8_t CMD_NO_ARM = 0xFE;   // moves none (reports, LED, ping, ...)
+
+struct QueuedCmd {
+  uint8_t clientNum;
+  uint8_t cls;          // CmdClass
+  uint8_t state;        // QueuedState
+  uint8_t arm;          // arm the command moves, or CMD_ANY_ARM / CMD_NO_ARM
+  bool binary;
+  uint16_t len;
+  uint32_t queuedMs;
+  const char *err;      // QUEUED_REPLY: the answer to send (nullptr = ok)
+  uint8_t payload[CMD_QUEUE_BYTES];  // text is NUL-terminated
+};
+
+struct CmdQueue {
+  QueuedCmd slots[CMD_QUEUE_SLOTS];
+  uint8_t head, count;
+  uint8_t perClient[WEBSOCKETS_SERVER_CLIENT_MAX];
+  uint8_t maxDepth;
+  uint32_t immediate;   // stop commands
+  uint32_t direct;      // run on arrival
+  uint32_t deferred;    // background commands queued
+  uint32_t ordered;     // motion commands queued behind their client's earlier ones
+  uint32_t preempted;
+  uint32_t overflows;   // queue full or command too long: the client's queue ran in place
+  uint32_t maxWaitMs;
+};
+
+CmdQueue cmdQueue = {};
+QueuedCmd queuedNow;  // the command being run, out of the queue
+
+// Idle power management: with no motion, no stream and no client traffic for
+// IDLE_ENTER_MS the CPU drops to IDLE_CPU_MHZ (the lowest clock WiFi runs at) and
+// loop() blocks for up to IDLE_POLL_MS per iteration instead of spinning. WiFi
+// association events and finished I2C bursts end the wait early; TCP traffic
+// is seen at the next poll, so a command that arrives while idle reaches the
+// servos within IDLE_POLL_MS + the measured wake_to_output_us.
+static const uint32_t IDLE_ENTER_MS = 2000;
+static const uint32_t IDLE_POLL_MS = 10;
+static const uint32_t IDLE_CPU_MHZ = 80;
+
+struct PowerStats {
+  bool idle;
+  bool wakePending;          // woke this iteration, first output not yet sent
+  uint32_t fullMhz;
+  uint32_t lastBusyMs;
+  uint32_t entries;
+  uint64_t blockedUs;        // time blocked in idle waits (power proxy)
+  uint32_t wokeUs;           // when the last idle wait returned
+  uint32_t lastRampUs, maxRampUs;
+  uint32_t wakes, wakesWithOutput;
+  uint32_t lastWakeOutUs, maxWakeOutUs;  // wait return -> first servo burst queued
+};
+
+PowerStats power = {};
+bool motionActive = false;   // an arm is moving or its output is still settling
 
 // ========= Helpers =========
-uint16_t usToTick(uint16_t us, float freqHz) {
-  float period_us = 1000000.0f / freqHz;
-  float tick = (us * 4096.0f) / period_us;
+uint16_t usToTick(float us, float ticksPerUs) {
+  float tick = us * ticksPerUs;
   if (tick < 0) tick = 0;
   if (tick > 4095) tick = 4095;
   return (uint16_t)(tick + 0.5f);
 }
 
-uint16_t angleToUs(uint8_t idx, float deg) {
-  const ServoConfig &cfg = servoCfg[idx];
-  // Clamp to -90..+90
-  float d = deg;
-  if (d < -90.0f) d = -90.0f;
-  if (d > +90.0f) d = +90.0f;
+uint8_t armId(const Arm &a) {
+  return (uint8_t)(&a - arms);
+}
 
-  // Map -90..+90 to 0..1
-  float t = (d + 90.0f) / 180.0f; // -90->0, 0->0.5, +90->1
+// Queue a channel value for the next flushOutputs()
+void setChannel(uint8_t board, uint8_t ch, uint16_t off) {
+  BoardOutput &b = boardOut[board];
+  if (b.off[ch] == off) return;
+  b.off[ch] = off;
+  b.dirty |= (uint16_t)(1u << ch);
+}
 
-  if (cfg.invert) t = 1.0f - t;
+// One I2C transaction per board: LEDn_ON/OFF registers from the first to the
+// last changed channel (unchanged ones in between are rewritten as they are).
+// Needs MODE1.AI, which the Adafruit driver sets in setPWMFreq().
+// Only queues the bursts; a board whose previous burst is still in flight keeps
+// its changes for the next flush, so the newest values always win.
+void flushOutputs() {
+  for (uint8_t k = 0; k < NUM_BOARDS; k++) {
+    BoardOutput &b = boardOut[k];
+    uint16_t failed = __atomic_exchange_n(&b.failed, 0, __ATOMIC_ACQ_REL);
+    if (failed) {
+      b.dirty |= failed;
+      i2cStats.retries++;
+    }
+    if (!b.dirty) continue;
+    if (__atomic_load_n(&b.busy, __ATOMIC_ACQUIRE)) {
+      i2cStats.deferred++;
+      continue;
+    }
+    uint8_t first = __builtin_ctz(b.dirty);
+    uint8_t last = 31 - __builtin_clz(b.dirty);
+
+    I2cBurst burst;
+    burst.board = k;
+    burst.mask = (uint16_t)(((1u << (last + 1)) - 1) & ~((1u << first) - 1));
+    uint8_t n = 0;
+    burst.data[n++] = PCA9685_LED0_ON_L + 4 * first;
+    for (uint8_t ch = first; ch <= last; ch++) {
+      burst.data[n++] = 0;  // ON = 0
+      burst.data[n++] = 0;
+      burst.data[n++] = b.off[ch] & 0xFF;
+      burst.data[n++] = b.off[ch] >> 8;
+    }
+    burst.len = n;
 
-  float usf = cfg.min_us + t * (cfg.max_us - cfg.min_us);
-  int32_t us = (int32_t)(usf + 0.5f) + cfg.offset_us;
+    __atomic_store_n(&b.busy, true, __ATOMIC_RELEASE);
+    if (xQueueSend(i2cQueue, &burst, 0) != pdTRUE) {
+      __atomic_store_n(&b.busy, false, __ATOMIC_RELEASE);
+      i2cStats.deferred++;
+      continue;
+    }
+    b.dirty = 0;
+    i2cStats.queued++;
+    if (power.wakePending) {
+      power.wakePending = false;
+      power.wakesWithOutput++;
+      power.lastWakeOutUs = micros() - power.wokeUs;
+      power.maxWakeOutUs = max(power.maxWakeOutUs, power.lastWakeOutUs);
+    }
+    i2cStats.bytes += n;
+  }
+}
 
-  // Safety clamp
-  if (us < 800) us = 800;
-  if (us > 2200) us = 2200;
+// Bus clock change, I2C task only (between bursts, so nothing is on the bus)
+void setBusLevel(uint8_t level) {
+  i2cClock.level = level;
+  Wire.setClock(I2C_CLOCKS[level]);
+  i2cStats.clockHz = I2C_CLOCKS[level];
+}
 
-  return (uint16_t)us;
+// Clock cap from the "i2c" command
+void applyBusCap() {
+  I2cClock &c = i2cClock;
+  uint8_t cap = __atomic_load_n(&i2cMaxLevel, __ATOMIC_ACQUIRE);
+  if (__atomic_exchange_n(&i2cReprobe, false, __ATOMIC_ACQ_REL)) c.ceiling = cap;
+  if (c.ceiling > cap) c.ceiling = cap;
+  if (c.level > c.ceiling) setBusLevel(c.ceiling);
 }
 
-void writeServoDeg(uint8_t idx, float deg) {
-  uint8_t ch = SERVO_CH[idx];
-  
+// Per-burst bus health: fall back a level when a window has too many errors,
+// probe the next level after a few clean windows
+void updateBusHealth(bool ok) {
+  I2cClock &c = i2cClock;
+  c.windowBursts++;
+  if (!ok) c.windowErrors++;
+  if (c.windowErrors >= I2C_ERR_THRESHOLD) {
+    if (c.level > 0) {
+      c.ceiling = c.level - 1;
+      setBusLevel(c.level - 1);
+      i2cStats.fallbacks++;
+    }
+    c.windowBursts = 0;
+    c.windowErrors = 0;
+    c.cleanWindows = 0;
+    return;
+  }
+  if (c.windowBursts >= I2C_WINDOW) {
+    c.cleanWindows = (c.windowErrors == 0) ? c.cleanWindows + 1 : 0;
+    c.windowBursts = 0;
+    c.windowErrors = 0;
+    if (c.level < c.ceiling && c.cleanWindows >= I2C_PROBE_WINDOWS) {
+      setBusLevel(c.level + 1);
+      i2cStats.upshifts++;
+      c.cleanWindows = 0;
+    }
+  }
+}
+
+// Completion callback, runs in the I2C task
+void onBurstDone(const I2cBurst &burst, esp_err_t err, uint32_t us) {
+  BoardOutput &b = boardOut[burst.board];
+  if (err == ESP_OK) {
+    i2cStats.done++;
+    i2cStats.lastUs = us;
+    i2cStats.maxUs = max(i2cStats.maxUs, us);
+    i2cStats.totalUs += us;
+  } else {
+    i2cStats.errors++;
+    if (err == ESP_FAIL) i2cStats.nacks++;
+    else if (err == ESP_ERR_TIMEOUT) i2cStats.timeouts++;
+    __atomic_fetch_or(&b.failed, burst.mask, __ATOMIC_ACQ_REL);
+  }
+  updateBusHealth(err == ESP_OK);
+  __atomic_store_n(&b.busy, false, __ATOMIC_RELEASE);
+  xTaskNotifyGive(loopTask);
+}
+
+// I2C task: one command link per burst on the driver Wire has installed (the
+// driver serialises it with Wire transactions). Waits for the bus on a
+// semaphore, not by spinning, so the loop keeps the CPU meanwhile.
+void i2cTask(void *) {
+  static uint8_t link[I2C_LINK_RECOMMENDED_SIZE(1)];
+  I2cBurst burst;
+  for (;;) {
+    applyBusCap();
+    if (xQueueReceive(i2cQueue, &burst, pdMS_TO_TICKS(100)) != pdTRUE) continue;
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create_static(link, sizeof(link));
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, (uint8_t)(PCA9685_ADDR[burst.board] << 1) | I2C_MASTER_WRITE, true);
+    i2c_master_write(cmd, burst.data, burst.len, true);
+    i2c_master_stop(cmd);
+    uint32_t t0 = micros();
+    esp_err_t err = i2c_master_cmd_begin(I2C_PORT, cmd, pdMS_TO_TICKS(I2C_TIMEOUT_MS));
+    uint32_t us = micros() - t0;
+    i2c_cmd_link_delete_static(cmd);
+    onBurstDone(burst, err, us);
+  }
+}
+
+void recomputeTicks(Arm &a) {
+  const BoardOutput &b = boardOut[ARM_CFG[armId(a)].board];
+  for (uint8_t i = 0; i < NUM_SERVOS; i++) {
+    const ServoConfig &cfg = a.servoCfg[i];
+    float usLo = (float)cfg.min_us + cfg.offset_us;  // at -90 deg
+    float usHi = (float)cfg.max_us + cfg.offset_us;  // at +90 deg
+    if (cfg.invert) {
+      float t = usLo;
+      usLo = usHi;
+      usHi = t;
+    }
+    JointTicks &jt = a.ticks[i];
+    jt.midQ16 = lroundf((usLo + usHi) / 2.0f * b.ticksPerUs * 65536.0f);
+    jt.perCdegQ16 = lroundf((usHi - usLo) / (2.0f * CDEG_MAX) * b.ticksPerUs * 65536.0f);
+    jt.lo = usToTick(SERVO_MIN_US, b.ticksPerUs);
+    jt.hi = usToTick(SERVO_MAX_US, b.ticksPerUs);
+  }
+}
+
+void writeServoCdeg(const Arm &a, uint8_t idx, int16_t cdeg) {
+  const ArmConfig &ac = ARM_CFG[armId(a)];
+  const JointTicks &jt = a.ticks[idx];
+
   // Clamp to -90..+90
-  float d = deg;
-  if (d < -90.0f) d = -90.0f;
-  if (d > +90.0f) d = +90.0f;
+  int32_t c = constrain((int32_t)cdeg, -(int32_t)CDEG_MAX, (int32_t)CDEG_MAX);
 
-  // Map -90..+90 to 0..1
-  float t = (d + 90.0f) / 180.0f; // -90->0, 0->0.5, +90->1
-  
-  // Apply servo config invert if needed
-  const ServoConfig &cfg = servoCfg[idx];
-  if (cfg.invert) t = 1.0f - t;
-  
-  // Convert angle to microseconds using ServoConfig
-  float usf = cfg.min_us + t * (cfg.max_us - cfg.min_us);
-  int32_t us = (int32_t)(usf + 0.5f) + cfg.offset_us;
+  // Centidegrees straight to PCA9685 ticks, safety clamp included
+  int32_t pulse = (jt.midQ16 + jt.perCdegQ16 * c + 0x8000) >> 16;
+  if (pulse < jt.lo) pulse = jt.lo;
+  if (pulse > jt.hi) pulse = jt.hi;
   
-  // Safety clamp
-  if (us < 500) us = 500;
-  if (us > 3000) us = 3000;
-  
-  // Convert microseconds to PWM value for PCA9685
-  uint16_t pulse = usToTick((uint16_t)us, SERVO_HZ);
-  
-  pca.setPWM(ch, 0, pulse);
+  setChannel(ac.board, ac.ch[idx], (uint16_t)pulse);
 }
 
-void applyAllOutputs() {
+void writeLed(const Arm &a, uint8_t val) {
+  const ArmConfig &ac = ARM_CFG[armId(a)];
+  uint16_t pwm_val = (uint16_t)((val * 4095) / 255); // Convert 0-255 to 0-4095
+  setChannel(ac.board, ac.ledCh, pwm_val);
+}
+
+// Angle actually sent to a joint: the (lead compensated) command, shaped if enabled
+int16_t outputCdeg(const Arm &a, uint8_t idx) {
+  if (!a.shaper[idx].enabled()) return a.cmdCdeg[idx];
+  return a.shaper[idx].output();
+}
+
+uint32_t lagMs(const Arm &a, uint8_t idx) {
+  return a.lagModel[idx].deadMs + a.lagModel[idx].tauMs;
+}
+
+uint32_t ledDelayMs(const Arm &a) {
+  if (a.lagMode != LAGCOMP_LED_DELAY) return 0;
+  uint32_t d = 0;
+  for (uint8_t i = 0; i < NUM_SERVOS; i++) d = max(d, lagMs(a, i));
+  return min<uint32_t>(d, (LED_HISTORY - 1) * SHAPER_SAMPLE_MS);
+}
+
+// Value of keyframe track c at time `at` (not before the track's current
+// segment), without advancing the track
+int16_t keyValue(const Arm &a, uint8_t c, uint32_t at) {
+  const KeyTrack &t = a.keyTrack[c];
+  int16_t from = t.from;
+  uint32_t dt = at - t.segStartMs;
+  for (uint8_t k = t.next; k < t.count; k++) {
+    const Keyframe &key = a.keyBuffer[t.first + k];
+    if (dt < key.ms) return lerpQ16(from, key.value, fractionQ16(dt, key.ms));
+    dt -= key.ms;
+    from = key.value;
+  }
+  return from;
+}
+
+// Remaining part of the previous move at time `at` (blend zone)
+int16_t blendCdeg(const Arm &a, uint8_t idx, uint32_t at) {
+  uint32_t dt = at - a.blendStartMs;
+  if (a.blendDurMs == 0 || dt >= a.blendDurMs) return 0;
+  return lerpQ16(a.blendOffset[idx], 0, fractionQ16(dt, a.blendDurMs));
+}
+
+// Desired angle at time `at`, continuing into the next buffered trajectory point
+int16_t referenceCdeg(const Arm &a, uint8_t idx, uint32_t at) {
+  if (!a.moving) return a.currCdeg[idx];
+  uint32_t dt = at - a.moveStartMs;
+  if (a.keyMode && dt < a.moveDurMs) return keyValue(a, idx, at);
+  if (dt < a.moveDurMs) {
+    return lerpQ16(a.startCdeg[idx], a.targetCdeg[idx], fractionQ16(dt, a.moveDurMs)) + blendCdeg(a, idx, at);
+  }
+  if (a.trajectoryMode && a.trajectoryIndex < a.trajectoryCount) {
+    const TrajectoryPoint &next = a.trajectoryBuffer[a.trajectoryIndex];
+    uint32_t u = fractionQ16(dt - a.moveDurMs, max<uint32_t>(1, next.duration_ms));
+    return lerpQ16(a.targetCdeg[idx], next.cdeg[idx], u);
+  }
+  return a.targetCdeg[idx];
+}
+
+void updateCommand(Arm &a, uint32_t now) {
   for (uint8_t i = 0; i < NUM_SERVOS; i++) {
-    writeServoDeg(i, currDeg[i]);
+    a.cmdCdeg[i] = (a.lagMode == LAGCOMP_LEAD) ? referenceCdeg(a, i, now + lagMs(a, i)) : a.currCdeg[i];
   }
-  // Use PCA9685 channel 15 for LED
-  uint16_t pwm_val = (uint16_t)((currLed * 4095) / 255); // Convert 0-255 to 0-4095
-  pca.setPWM(15, 0, pwm_val);
-  
-  // Update RGB LED
-  rgbLed.setPixelColor(0, rgbLed.Color(currR, currG, currB));
-  rgbLed.show();
 }
 
-void startMove(const float *deg, uint32_t durationMs, uint8_t ledVal, uint8_t r = 255, uint8_t g = 255, uint8_t b = 255) {
+void resetLedHistory(Arm &a) {
+  for (uint8_t k = 0; k < LED_HISTORY; k++) a.ledHist[k] = {a.currLed, a.currR, a.currG, a.currB};
+}
+
+const LedSample &delayedLed(const Arm &a) {
+  uint8_t back = (uint8_t)(ledDelayMs(a) / SHAPER_SAMPLE_MS);
+  return a.ledHist[(uint8_t)(a.ledHistHead + LED_HISTORY - back) % LED_HISTORY];
+}
+
+void recomputeLagSteps(Arm &a) {
   for (uint8_t i = 0; i < NUM_SERVOS; i++) {
-    startDeg[i] = currDeg[i];
-    targetDeg[i] = deg[i];
+    const ServoLagModel &m = a.lagModel[i];
+    float alpha = (m.tauMs > 0) ? 1.0f - expf(-(float)SHAPER_SAMPLE_MS / m.tauMs) : 1.0f;
+    a.lagStep[i].alphaQ16 = lroundf(alpha * 65536.0f);
+    a.lagStep[i].maxStepQ8 = (m.maxDps > 0) ? lroundf(m.maxDps * SHAPER_SAMPLE_MS / 1000.0f * 100.0f * 256.0f) : INT32_MAX;
   }
-  startLed = currLed;
-  targetLed = ledVal;
+}
+
+void stepLagEstimate(Arm &a) {
+  a.lagDeadHead = (a.lagDeadHead + 1) % LAG_DEAD_SAMPLES;
+  for (uint8_t i = 0; i < NUM_SERVOS; i++) {
+    const ServoLagModel &m = a.lagModel[i];
+    const LagStep &ls = a.lagStep[i];
+    a.lagDeadHist[i][a.lagDeadHead] = outputCdeg(a, i);
+    uint8_t back = min<uint32_t>(m.deadMs / SHAPER_SAMPLE_MS, LAG_DEAD_SAMPLES - 1);
+    int32_t u = a.lagDeadHist[i][(a.lagDeadHead + LAG_DEAD_SAMPLES - back) % LAG_DEAD_SAMPLES] * 256;
+
+    int32_t step = (int32_t)(((int64_t)(u - a.estQ8[i]) * ls.alphaQ16 + 0x8000) >> 16);
+    a.estQ8[i] += constrain(step, -ls.maxStepQ8, ls.maxStepQ8);
+  }
+}
+
+void resetLagEstimate(Arm &a) {
+  for (uint8_t i = 0; i < NUM_SERVOS; i++) {
+    int16_t out = outputCdeg(a, i);
+    a.estQ8[i] = out * 256;
+    for (uint8_t k = 0; k < LAG_DEAD_SAMPLES; k++) a.lagDeadHist[i][k] = out;
+  }
+}
+
+uint32_t shaperMaxDelayMs(const Arm &a) {
+  uint32_t d = 0;
+  for (uint8_t i = 0; i < NUM_SERVOS; i++) {
+    if (a.shaper[i].enabled()) d = max(d, a.shaper[i].delayMs());
+  }
+  return d;
+}
+
+void stepRingingModel(uint32_t now) {
+  RingingTest &rt = ringTest;
+  if (!rt.active) return;
+  const Arm &a = arms[rt.arm];
+  const float dt = SHAPER_SAMPLE_MS / 1000.0f;
+  rt.raw.step(cdegToDeg(a.currCdeg[rt.ch]), dt, rt.freqHz, rt.damping);
+  rt.shaped.step(cdegToDeg(outputCdeg(a, rt.ch)), dt, rt.freqHz, rt.damping);
+  if (!rt.holding) return;
+
+  uint32_t t = now - rt.moveEndMs;
+  float e = fabsf(rt.raw.pos - rt.targetDeg);
+  if (e > rt.rawResidual) rt.rawResidual = e;
+  if (e > RINGING_SETTLE_DEG) rt.rawSettleMs = t;
+
+  // The shaped command itself is still moving for the shaper delay
+  e = fabsf(rt.shaped.pos - rt.targetDeg);
+  if (t >= a.shaper[rt.ch].delayMs() && e > rt.shapedResidual) rt.shapedResidual = e;
+  if (e > RINGING_SETTLE_DEG) rt.shapedSettleMs = t;
+}
+
+// Output stage on its fixed sample clock (shared by all arms): shapers, LED
+// delay line, lag estimate
+void sampleOutputs(uint32_t now) {
+  uint8_t n = 0;
+  while (now - lastSampleMs >= SHAPER_SAMPLE_MS && n < 8) {
+    lastSampleMs += SHAPER_SAMPLE_MS;
+    for (Arm &a : arms) {
+      for (uint8_t i = 0; i < NUM_SERVOS; i++) {
+        if (a.shaper[i].enabled()) a.shaper[i].push(a.cmdCdeg[i]);
+      }
+      a.ledHistHead = (a.ledHistHead + 1) % LED_HISTORY;
+      a.ledHist[a.ledHistHead] = {a.currLed, a.currR, a.currG, a.currB};
+      stepLagEstimate(a);
+    }
+    stepRingingModel(now);
+    n++;
+  }
+  // Too far behind (blocked loop): resync instead of replaying old samples
+  if (now - lastSampleMs >= SHAPER_SAMPLE_MS) lastSampleMs = now;
+}
+
+uint32_t outputTailMs(const Arm &a) {
+  return max(shaperMaxDelayMs(a), ledDelayMs(a));
+}
+
+void applyArmOutputs(const Arm &a) {
+  for (uint8_t i = 0; i < NUM_SERVOS; i++) {
+    writeServoCdeg(a, i, outputCdeg(a, i));
+  }
+  // LED timeline, delayed to the estimated arm position in LAGCOMP_LED_DELAY
+  LedSample out = {a.currLed, a.currR, a.currG, a.currB};
+  if (a.lagMode == LAGCOMP_LED_DELAY) out = delayedLed(a);
+
+  writeLed(a, out.led);
+  rgbLed.setPixelColor(ARM_CFG[armId(a)].pixel, rgbLed.Color(out.r, out.g, out.b));
+}
+
+// All arms in one go: one I2C burst per board and one NeoPixel refresh.
+// Under load shedding the refresh may be skipped unless forceLed (end of a move):
+// the pixel colours are already set, so the next refresh catches up.
+void applyAllOutputs(bool forceLed = true) {
+  for (const Arm &a : arms) applyArmOutputs(a);
+  flushOutputs();
+  if (!forceLed && load.level >= 2 && ++load.ledTick % SHED_LED_DECIMATION != 0) {
+    load.ledSkipped++;
+    return;
+  }
+  rgbLed.show();
+}
+
+void startMoveAt(Arm &a, uint32_t startMs, const int16_t *cdeg, uint32_t durationMs, uint8_t ledVal, uint8_t r, uint8_t g, uint8_t b) {
+  memcpy(a.startCdeg, a.currCdeg, sizeof(a.startCdeg));
+  memcpy(a.targetCdeg, cdeg, sizeof(a.targetCdeg));
+  a.startLed = a.currLed;
+  a.targetLed = ledVal;
   
-  startR = currR;
-  startG = currG;
-  startB = currB;
-  targetR = r;
-  targetG = g;
-  targetB = b;
+  a.startR = a.currR;
+  a.startG = a.currG;
+  a.startB = a.currB;
+  a.targetR = r;
+  a.targetG = g;
+  a.targetB = b;
   
-  moveStartMs = millis();
-  moveDurMs = max<uint32_t>(1, durationMs);
-  moving = true;
+  a.moveStartMs = startMs;
+  a.moveDurMs = max<uint32_t>(1, durationMs);
+  a.moving = true;
+  a.blendDurMs = 0;
 }
 
-void updateMotion() {
-  uint32_t now = millis();
-  
+void startMove(Arm &a, const int16_t *cdeg, uint32_t durationMs, uint8_t ledVal, uint8_t r = 255, uint8_t g = 255, uint8_t b = 255) {
+  startMoveAt(a, millis(), cdeg, durationMs, ledVal, r, g, b);
+}
+
+// Stream/rt_frame targets through the joint input filters. After a pause the
+// filters restart at the new sample instead of gliding in from stale state.
+void filterInput(Arm &a, float *d, uint32_t now) {
+  uint32_t gap = now - a.lastInputMs;
+  bool restart = !a.inputActive || gap > FILTER_GAP_MS;
+  if (!restart) {
+    a.inputIntervalMs = (a.inputIntervalMs > 0.0f) ? a.inputIntervalMs + 0.1f * (gap - a.inputIntervalMs) : gap;
+  }
+  a.inputActive = true;
+  a.lastInputMs = now;
+
+  float dtS = max<uint32_t>(gap, 1) / 1000.0f;
+  for (uint8_t i = 0; i < NUM_SERVOS; i++) {
+    InputFilter &f = a.inFilter[i];
+    if (!f.enabled()) continue;
+    if (restart) f.reset(d[i]);
+    else d[i] = f.apply(d[i], dtS);
+  }
+}
+
+// Sample spacing for filter latency: measured, or the stream rate before any input
+float inputIntervalMs(const Arm &a) {
+  if (a.inputIntervalMs > 0.0f) return a.inputIntervalMs;
+  return 1000.0f / a.streamFreq;
+}
+
+// Start the next trajectory point inside the blend zone of the current move:
+// the new segment runs from the current target, and what is left of the
+// current move fades out on top of it, so the arm cuts the corner without a stop
+void startBlend(Arm &a, uint32_t now, const TrajectoryPoint &point) {
+  uint32_t t = fractionQ16(now - a.moveStartMs, a.moveDurMs);
+  int16_t corner[NUM_SERVOS];
+  int16_t offset[NUM_SERVOS];
+  for (uint8_t i = 0; i < NUM_SERVOS; i++) {
+    corner[i] = a.targetCdeg[i];
+    offset[i] = lerpQ16(a.startCdeg[i] - a.targetCdeg[i], 0, t);
+  }
+  uint32_t remainMs = a.moveStartMs + a.moveDurMs - now;
+  startMoveAt(a, now, point.cdeg, point.duration_ms, point.led_val, point.r, point.g, point.b);
+  memcpy(a.startCdeg, corner, sizeof(corner));
+  memcpy(a.blendOffset, offset, sizeof(offset));
+  a.blendStartMs = now;
+  a.blendDurMs = max<uint32_t>(1, remainMs);
+}
+
+// Ends keyframe playback where the arm is now: the move target becomes the
+// current pose, so the next step finishes the move without a jump
+void cancelKeyframes(Arm &a) {
+  if (!a.keyMode) return;
+  a.keyMode = false;
+  memcpy(a.targetCdeg, a.currCdeg, sizeof(a.targetCdeg));
+  a.targetLed = a.currLed;
+  a.targetR = a.currR;
+  a.targetG = a.currG;
+  a.targetB = a.currB;
+  a.moveDurMs = max<uint32_t>(1, millis() - a.moveStartMs);
+}
+
+// Motion commands that replace what the arm is doing (frame, rt_frame, home,
+// sync_frame, stream samples, script frames) drop its buffered trajectory and
+// keyframes; the move in progress is superseded by the new one
+void cancelTrajectory(Arm &a) {
+  a.trajectoryMode = false;
+  a.trajectoryCount = 0;
+  a.trajectoryIndex = 0;
+  cancelKeyframes(a);
+}
+
+// First free buffer index for n points appended to the running trajectory
+// ("queue": true), -1 if they do not fit. Finished points are dropped; the one
+// in progress stays, stepArm still reads its blend time. Without a running
+// trajectory the points start one once the current move (or keyframe
+// playback) ends.
+int trajectoryAppendIndex(Arm &a, uint8_t n) {
+  if (!a.trajectoryMode) {
+    a.trajectoryCount = 0;
+    a.trajectoryIndex = 0;
+    return n <= MAX_TRAJECTORY_POINTS ? 0 : -1;
+  }
+  uint8_t done = a.trajectoryIndex > 0 ? a.trajectoryIndex - 1 : 0;
+  memmove(a.trajectoryBuffer, a.trajectoryBuffer + done, (a.trajectoryCount - done) * sizeof(TrajectoryPoint));
+  a.trajectoryCount -= done;
+  a.trajectoryIndex -= done;
+  return a.trajectoryCount + n <= MAX_TRAJECTORY_POINTS ? a.trajectoryCount : -1;
+}
+
+// Checks every point of a trajectory command before the arm is touched.
+// Returns an error code or nullptr.
+const char *checkTrajectoryPoints(JsonArray points) {
+  for (JsonObject point : points) {
+    if ((point["ms"] | 200u) > POINT_MAX_MS) return "point_ms_range";
+    if ((point["blend_mm"] | 0.0f) > 0.0f && point["pos"].as<JsonArray>().size() < 3) return "blend_mm_needs_pos";
+  }
+  return nullptr;
+}
+
+// Turns the per-point blend radii of a trajectory command into overlap times.
+// "blend" is in degrees of the largest joint step; "blend_mm" is measured on the
+// task-space "pos" [x,y,z] (mm) the client sends with each point, since the
+// firmware has no kinematics. A zone covers radius/length of each neighbouring
+// segment, capped at BLEND_MAX_FRACTION. Call after the points are loaded into
+// buf (the trajectory buffer, or its free tail when appending); the segment
+// into point 0 starts at `from`; the points passed checkTrajectoryPoints.
+// Returns the time the blends save.
+uint32_t planBlendZones(TrajectoryPoint *buf, JsonArray points, const int16_t *from) {
+  uint32_t savedMs = 0;
+  uint8_t count = (uint8_t)points.size();
+  float len[MAX_TRAJECTORY_POINTS];  // length of the segment ending at point k, <0 = unknown
+  bool anyMm = false;
+  for (uint8_t k = 0; k < count; k++) {
+    JsonObject point = points[k];
+    buf[k].blend_ms = 0;
+    if ((point["blend_mm"] | 0.0f) > 0.0f) anyMm = true;
+    const int16_t *prev = k > 0 ? buf[k - 1].cdeg : from;
+    int32_t d = 0;
+    for (uint8_t i = 0; i < NUM_SERVOS; i++) d = max<int32_t>(d, abs(buf[k].cdeg[i] - prev[i]));
+    len[k] = cdegToDeg(d);
+  }
+  if (anyMm) {
+    // Task-space lengths; the start of the first segment has no position
+    for (uint8_t k = count; k-- > 0;) {
+      JsonArray p = points[k]["pos"].as<JsonArray>();
+      JsonArray q = k > 0 ? points[k - 1]["pos"].as<JsonArray>() : JsonArray();
+      if (p.size() < 3 || q.size() < 3) {
+        len[k] = -1.0f;
+        continue;
+      }
+      float dx = p[0].as<float>() - q[0].as<float>();
+      float dy = p[1].as<float>() - q[1].as<float>();
+      float dz = p[2].as<float>() - q[2].as<float>();
+      len[k] = sqrtf(dx * dx + dy * dy + dz * dz);
+    }
+  }
+
+  for (uint8_t k = 0; k + 1 < count; k++) {
+    JsonObject point = points[k];
+    float r = anyMm ? (point["blend_mm"] | 0.0f) : (point["blend"] | 0.0f);
+    if (r <= 0.0f || len[k] < 0.0f || len[k + 1] < 0.0f) continue;
+    float fin = len[k] > r / BLEND_MAX_FRACTION ? r / len[k] : BLEND_MAX_FRACTION;
+    float fout = len[k + 1] > r / BLEND_MAX_FRACTION ? r / len[k + 1] : BLEND_MAX_FRACTION;
+    uint32_t ms = (uint32_t)min(fin * buf[k].duration_ms, fout * buf[k + 1].duration_ms);
+    buf[k].blend_ms = ms;
+    savedMs += ms;
+  }
+  return savedMs;
+}
+
+int16_t keyChannelValue(const Arm &a, uint8_t c) {
+  switch (c) {
+    case KEY_LED: return a.currLed;
+    case KEY_R: return a.currR;
+    case KEY_G: return a.currG;
+    case KEY_B: return a.currB;
+    default: return a.currCdeg[c];
+  }
+}
+
+void setKeyChannel(Arm &a, uint8_t c, int16_t v, bool target) {
+  switch (c) {
+    case KEY_LED: (target ? a.targetLed : a.currLed) = (uint8_t)v; break;
+    case KEY_R: (target ? a.targetR : a.currR) = (uint8_t)v; break;
+    case KEY_G: (target ? a.targetG : a.currG) = (uint8_t)v; break;
+    case KEY_B: (target ? a.targetB : a.currB) = (uint8_t)v; break;
+    default: (target ? a.targetCdeg : a.currCdeg)[c] = v; break;
+  }
+}
+
+// {"tracks": {"j4": [[ms, deg], ...], "led": [[ms, 0..255], ...]}} replaces
+// whatever the arm is doing with keyframe playback. The message is checked in
+// full first, so an invalid one leaves the arm alone. keys/durationMs get the
+// key count and the length of the longest track. Returns an error code or nullptr.
+const char *startKeyframes(Arm &a, JsonObject tracks, uint32_t now, uint8_t &keys, uint32_t &durationMs) {
+  size_t named = tracks.size();
+  size_t found = 0, total = 0;
+  for (uint8_t c = 0; c < KEY_CHANNELS; c++) {
+    JsonArray track = tracks[KEY_CHANNEL_NAMES[c]].as<JsonArray>();
+    if (track.isNull()) continue;
+    found++;
+    total += track.size();
+    for (JsonVariant key : track) {
+      JsonArray k = key.as<JsonArray>();
+      if (k.size() != 2 || !k[0].is<uint32_t>() || !k[1].is<float>()) return "bad_key";
+      if (k[0].as<uint32_t>() > POINT_MAX_MS) return "point_ms_range";
+    }
+  }
+  if (named == 0) return "missing_tracks";
+  if (found != named) return "bad_track";
+  if (total > MAX_KEYFRAMES) return "too_many_keys";
+
+  cancelTrajectory(a);
+  keys = 0;
+  durationMs = 0;
+  for (uint8_t c = 0; c < KEY_CHANNELS; c++) {
+    JsonArray track = tracks[KEY_CHANNEL_NAMES[c]].as<JsonArray>();
+    KeyTrack &t = a.keyTrack[c];
+    t.first = keys;
+    t.count = (uint8_t)track.size();
+    t.next = 0;
+    t.from = keyChannelValue(a, c);
+    t.segStartMs = now;
+    uint32_t ms = 0;
+    int16_t last = t.from;
+    for (JsonVariant key : track) {
+      Keyframe &k = a.keyBuffer[keys++];
+      k.ms = key[0].as<uint16_t>();
+      k.value = c < NUM_SERVOS ? degToCdeg(key[1].as<float>()) : (int16_t)constrain(key[1].as<int>(), 0, 255);
+      ms += k.ms;
+      last = k.value;
+    }
+    setKeyChannel(a, c, last, true);
+    durationMs = max(durationMs, ms);
+  }
+  a.moveStartMs = now;
+  a.moveDurMs = max<uint32_t>(1, durationMs);
+  a.moving = true;
+  a.blendDurMs = 0;
+  a.keyMode = true;
+  return nullptr;
+}
+
+// Advances every keyframe track to `now` and sets the channels that have keys
+void stepKeyframes(Arm &a, uint32_t now) {
+  for (uint8_t c = 0; c < KEY_CHANNELS; c++) {
+    KeyTrack &t = a.keyTrack[c];
+    if (t.count == 0) continue;
+    while (t.next < t.count && now - t.segStartMs >= a.keyBuffer[t.first + t.next].ms) {
+      const Keyframe &key = a.keyBuffer[t.first + t.next];
+      t.segStartMs += key.ms;
+      t.from = key.value;
+      t.next++;
+    }
+    setKeyChannel(a, c, keyValue(a, c, now), false);
+  }
+}
+
+// Advance one arm to `now`. Returns true when its move has just finished and
+// the final pose has to be written without waiting for the next tick.
+bool stepArm(Arm &a, uint32_t now) {
   // Handle trajectory mode
-  if (trajectoryMode && trajectoryCount > 0) {
-    if (!moving && trajectoryIndex < trajectoryCount) {
+  if (a.trajectoryMode && a.trajectoryCount > 0 && a.trajectoryIndex < a.trajectoryCount) {
+    // The move in progress is the previous point when the index is past 0
+    uint32_t blendMs = a.trajectoryIndex > 0 ? a.trajectoryBuffer[a.trajectoryIndex - 1].blend_ms : 0;
+    bool blend = a.moving && blendMs > 0 && now - a.moveStartMs + blendMs >= a.moveDurMs;
+    if (!a.moving || blend) {
       // Start next trajectory point
-      const TrajectoryPoint &point = trajectoryBuffer[trajectoryIndex];
-      startMove(point.deg, point.duration_ms, point.led_val, point.r, point.g, point.b);
-      trajectoryIndex++;
+      const TrajectoryPoint &point = a.trajectoryBuffer[a.trajectoryIndex];
+      if (blend) startBlend(a, now, point);
+      else startMoveAt(a, now, point.cdeg, point.duration_ms, point.led_val, point.r, point.g, point.b);
+      a.trajectoryIndex++;
       
       // Check if trajectory is complete
-      if (trajectoryIndex >= trajectoryCount) {
-        trajectoryMode = false;
-        trajectoryCount = 0;
-        trajectoryIndex = 0;
+      if (a.trajectoryIndex >= a.trajectoryCount) {
+        a.trajectoryMode = false;
+        a.trajectoryCount = 0;
+        a.trajectoryIndex = 0;
       }
     }
   }
   
-  if (!moving) return;
-
-  float t = (float)(now - moveStartMs) / (float)moveDurMs;
-  if (t >= 1.0f) {
-    for (uint8_t i = 0; i < NUM_SERVOS; i++) currDeg[i] = targetDeg[i];
-    currLed = targetLed;
-    currR = targetR;
-    currG = targetG;
-    currB = targetB;
-    moving = false;
-    applyAllOutputs();
-    return;
+  if (!a.moving) {
+    updateCommand(a, now);
+    return false;
+  }
+
+  // Keyframe playback ends through the normal end of the move below
+  if (a.keyMode && now - a.moveStartMs < a.moveDurMs) {
+    stepKeyframes(a, now);
+    updateCommand(a, now);
+    return false;
+  }
+  a.keyMode = false;
+
+  uint32_t t = fractionQ16(now - a.moveStartMs, a.moveDurMs);
+  if (t >= 65536) {
+    updateCommand(a, now); // lead may already be into the next trajectory point
+    memcpy(a.currCdeg, a.targetCdeg, sizeof(a.currCdeg));
+    a.currLed = a.targetLed;
+    a.currR = a.targetR;
+    a.currG = a.targetG;
+    a.currB = a.targetB;
+    a.moving = false;
+    a.blendDurMs = 0;
+    uint32_t tailMs = outputTailMs(a);
+    if (tailMs > 0) a.outputSettleUntilMs = now + tailMs + updateDtMs;
+    return true;
   }
 
-  // Linear interpolation
+  // Linear interpolation (plus the fading rest of the previous move in a blend zone)
   for (uint8_t i = 0; i < NUM_SERVOS; i++) {
-    currDeg[i] = startDeg[i] + (targetDeg[i] - startDeg[i]) * t;
+    a.currCdeg[i] = lerpQ16(a.startCdeg[i], a.targetCdeg[i], t) + blendCdeg(a, i, now);
   }
-  currLed = (uint8_t)(startLed + (int)(targetLed - startLed) * t);
+  a.currLed = (uint8_t)lerpQ16(a.startLed, a.targetLed, t);
   
   // RGB interpolation
-  currR = (uint8_t)(startR + (int)(targetR - startR) * t);
-  currG = (uint8_t)(startG + (int)(targetG - startG) * t);
-  currB = (uint8_t)(startB + (int)(targetB - startB) * t);
+  a.currR = (uint8_t)lerpQ16(a.startR, a.targetR, t);
+  a.currG = (uint8_t)lerpQ16(a.startG, a.targetG, t);
+  a.currB = (uint8_t)lerpQ16(a.startB, a.targetB, t);
+
+  updateCommand(a, now);
+  return false;
+}
+
+void updateMotion() {
+  uint32_t now = millis();
 
-  if (now - lastUpdateMs >= UPDATE_DT_MS) {
+  // Same clock for every arm
+  bool finished = false;
+  bool active = false;
+  for (Arm &a : arms) {
+    if (stepArm(a, now)) finished = true;
+  }
+  sampleOutputs(now);
+
+  for (const Arm &a : arms) {
+    // Shaped joints and the delayed LED keep changing after the reference has stopped
+    if (a.moving || (int32_t)(a.outputSettleUntilMs - now) > 0) active = true;
+  }
+  if (finished || (active && now - lastUpdateMs >= updateDtMs)) {
+    // Tick lateness only counts between ticks of one motion
+    if (motionActive && !finished) load.maxTickLateMs = max(load.maxTickLateMs, now - lastUpdateMs - updateDtMs);
     lastUpdateMs = now;
-    applyAllOutputs();
+    applyAllOutputs(finished);
+  } else if (ulTaskNotifyTake(pdTRUE, 0) > 0) {
+    flushOutputs(); // a burst finished: send what was held back or failed without waiting a tick
   }
+  motionActive = active;
 }
 
-void setLed(uint8_t val) {
-  targetLed = val;
-  currLed = val;
-  // Use PCA9685 channel 15 for LED (like in test.cpp)
-  uint16_t pwm_val = (uint16_t)((val * 4095) / 255); // Convert 0-255 to 0-4095
-  pca.setPWM(15, 0, pwm_val);
+void setLed(Arm &a, uint8_t val) {
+  a.targetLed = val;
+  a.currLed = val;
+  resetLedHistory(a); // direct commands are not delayed
+  writeLed(a, val);
+  flushOutputs();
 }
 
-void setRgbLed(uint8_t r, uint8_t g, uint8_t b) {
-  targetR = r;
-  targetG = g;
-  targetB = b;
-  currR = r;
-  currG = g;
-  currB = b;
-  rgbLed.setPixelColor(0, rgbLed.Color(r, g, b));
+void setRgbLed(Arm &a, uint8_t r, uint8_t g, uint8_t b) {
+  a.targetR = r;
+  a.targetG = g;
+  a.targetB = b;
+  a.currR = r;
+  a.currG = g;
+  a.currB = b;
+  resetLedHistory(a);
+  rgbLed.setPixelColor(ARM_CFG[armId(a)].pixel, rgbLed.Color(r, g, b));
   rgbLed.show();
 }
 
-void setPwmFreq(float hz) {
-  pca.setPWMFreq(hz);
+void setPwmFreq(uint8_t board, float hz) {
+  pca[board]->setPWMFreq(hz);
   delay(10);
+
+  // Tick tables follow the prescale the chip really runs at (27 MHz / 4096 / (prescale + 1))
+  BoardOutput &b = boardOut[board];
+  b.hz = hz;
+  b.ticksPerUs = PCA9685_OSC_HZ / ((pca[board]->readPrescale() + 1) * 1000000.0f);
+  for (Arm &a : arms) {
+    if (ARM_CFG[armId(a)].board == board) recomputeTicks(a);
+  }
+
+  float fastest = 0.0f;
+  for (uint8_t k = 0; k < NUM_BOARDS; k++) fastest = max(fastest, boardOut[k].hz);
+  updateDtMs = (fastest > 0.0f) ? constrain((uint32_t)(1000.0f / fastest), UPDATE_DT_MIN_MS, UPDATE_DT_MS) : UPDATE_DT_MS;
+}
+
+float boardPwmHz(uint8_t board) {
+  return boardOut[board].ticksPerUs * 1000000.0f / 4096.0f;
 }
 
 // ========= WebSocket helpers =========
+void resetClientStats(uint8_t clientNum) {
+  ClientStats &cs = clientStats[clientNum];
+  bool connected = cs.connected;
+  uint32_t connectedMs = cs.connectedMs;
+  memset(&cs, 0, sizeof(cs));
+  cs.connected = connected;
+  cs.connectedMs = connectedMs;
+  cs.lastActivityMs = millis();
+}
+
+// Serializes txDoc into txFrame; 0 if it does not fit
+size_t serializeTxDoc() {
+  char *out = (char *)txFrame + WEBSOCKETS_MAX_HEADER_SIZE;
+  size_t len = serializeJson(txDoc, out, TX_BUF_BYTES);
+  if (len + 1 >= TX_BUF_BYTES) {
+    mem.txOverflows++;
+    return 0;
+  }
+  mem.txHighWater = max<uint32_t>(mem.txHighWater, len);
+  return len;
+}
+
+// Serialize txDoc and send it to one client, counting the traffic
+void sendTxDoc(uint8_t clientNum) {
+  size_t len = serializeTxDoc();
+  if (len == 0) {
+    txDoc.clear();
+    txDoc["ok"] = false;
+    txDoc["err"] = "reply_too_large";
+    len = serializeTxDoc();
+  }
+  if (webSocket.sendTXT(clientNum, txFrame, len, true)) {
+    clientStats[clientNum].txMsgs++;
+    clientStats[clientNum].txBytes += len;
+  } else {
+    clientStats[clientNum].txFailures++;
+  }
+}
+
+// Binary reply (protocol_gen.h), counted like text replies
+template <typename M>
+void sendBin(uint8_t clientNum, const M &m) {
+  uint8_t buf[WEBSOCKETS_MAX_HEADER_SIZE + M::BIN_MAX];
+  size_t len = proto::encodeBin(m, buf + WEBSOCKETS_MAX_HEADER_SIZE, M::BIN_MAX);
+  if (len && webSocket.sendBIN(clientNum, buf, len, true)) {
+    clientStats[clientNum].txMsgs++;
+    clientStats[clientNum].txBytes += len;
+  } else {
+    clientStats[clientNum].txFailures++;
+  }
+}
+
+void sendBinAck(uint8_t clientNum, const char *err) {
+  proto::AckReply m;
+  m.ok = err == nullptr;
+  if (err) {
+    m.has_err = true;
+    snprintf(m.err, sizeof(m.err), "%s", err);
+  }
+  sendBin(clientNum, m);
+}
+
+// ========= WiFi telemetry =========
+// Interference of a channel: every AP within 4 channels contributes its signal
+// strength above the noise floor, scaled by how much the channels overlap.
+uint16_t channelScore(uint8_t ch, int n, uint8_t *apsNear) {
+  uint32_t score = 0;
+  uint8_t aps = 0;
+  for (int i = 0; i < n; i++) {
+    int dist = abs((int)WiFi.channel(i) - (int)ch);
+    if (dist > 4) continue;
+    int strength = WiFi.RSSI(i) + 100; // -100 dBm -> 0
+    if (strength < 0) strength = 0;
+    score += (uint32_t)strength * (5 - dist);
+    aps++;
+  }
+  if (apsNear) *apsNear = aps;
+  return (uint16_t)min<uint32_t>(score, 65535);
+}
+
+uint8_t pickApChannel() {
+  if (!AP_AUTO_CHANNEL) return AP_DEFAULT_CHANNEL;
+
+  WiFi.mode(WIFI_STA);
+  WiFi.disconnect();
+  int n = WiFi.scanNetworks(false, true);
+  if (n < 0) n = 0;
+
+  static const uint8_t CANDIDATES[] = {1, 6, 11};
+  uint8_t best = AP_DEFAULT_CHANNEL;
+  uint16_t bestScore = 0xFFFF;
+  for (uint8_t c : CANDIDATES) {
+    uint8_t aps = 0;
+    uint16_t score = channelScore(c, n, &aps);
+    Serial.printf("Channel %u: %u APs nearby, score %u\n", c, aps, score);
+    if (score < bestScore) {
+      bestScore = score;
+      best = c;
+      wifiTel.scanAps = aps;
+      wifiTel.scanScore = score;
+    }
+  }
+  WiFi.scanDelete();
+  return best;
+}
+
+void sampleWifiTelemetry() {
+  uint32_t t0 = micros();
+
+  uint8_t primary = 0;
+  wifi_second_chan_t second;
+  if (esp_wifi_get_channel(&primary, &second) == ESP_OK) wifiTel.channel = primary;
+
+  wifi_sta_list_t list;
+  if (esp_wifi_ap_get_sta_list(&list) == ESP_OK) {
+    WifiStation prev[ESP_WIFI_MAX_CONN_NUM];
+    uint8_t prevCount = wifiTel.stationCount;
+    memcpy(prev, wifiTel.stations, sizeof(prev));
+
+    wifiTel.stationCount = (uint8_t)min<int>(list.num, ESP_WIFI_MAX_CONN_NUM);
+    for (uint8_t i = 0; i < wifiTel.stationCount; i++) {
+      WifiStation &st = wifiTel.stations[i];
+      memcpy(st.mac, list.sta[i].mac, 6);
+      st.rssi = list.sta[i].rssi;
+      st.rssiMin = st.rssi;
+      for (uint8_t j = 0; j < prevCount; j++) {
+        if (memcmp(prev[j].mac, st.mac, 6) == 0) {
+          st.rssiMin = min(prev[j].rssiMin, st.rssi);
+          break;
+        }
+      }
+    }
+  }
+
+  wifiTel.samples++;
+  wifiTel.sampleUs = micros() - t0;
+}
+
+// Work that can wait while the loop is overrunning (shed level >= 1), for at
+// most SHED_MAX_DEFER_MS past dueMs. Counts each deferral once.
+bool shedDefer(uint32_t dueMs, bool &held, uint32_t &counter) {
+  if (load.level > 0 && millis() - dueMs < SHED_MAX_DEFER_MS) {
+    if (!held) counter++;
+    held = true;
+    return true;
+  }
+  held = false;
+  return false;
+}
+
+void updateWifiTelemetry() {
+  uint32_t now = millis();
+  if (now - wifiTel.lastSampleMs < WIFI_SAMPLE_MS) return;
+  if (shedDefer(wifiTel.lastSampleMs + WIFI_SAMPLE_MS, load.telemetryHeld, load.telemetryDeferred)) return;
+  wifiTel.lastSampleMs = now;
+  sampleWifiTelemetry();
+}
+
+// Compact link summary for status messages
+void fillWifiSummary(proto::WifiSummary &m) {
+  m.ch = wifiTel.channel;
+  m.sta = wifiTel.stationCount;
+  if (wifiTel.stationCount > 0) {
+    int8_t worst = 0;
+    for (uint8_t i = 0; i < wifiTel.stationCount; i++) {
+      worst = min(worst, wifiTel.stations[i].rssi);
+    }
+    m.has_rssi_min = true;
+    m.rssi_min = worst;
+  }
+}
+
+void addWifiSummary(JsonObject wifi) {
+  proto::WifiSummary m;
+  fillWifiSummary(m);
+  proto::encodeJson(m, wifi);
+}
+
 void sendOk(uint8_t clientNum) {
   txDoc.clear();
   txDoc["ok"] = true;
-  String response;
-  serializeJson(txDoc, response);
-  webSocket.sendTXT(clientNum, response);
+  sendTxDoc(clientNum);
 }
 
 void sendError(uint8_t clientNum, const char *msg) {
   txDoc.clear();
   txDoc["ok"] = false;
   txDoc["err"] = msg;
-  String response;
-  serializeJson(txDoc, response);
-  webSocket.sendTXT(clientNum, response);
+  sendTxDoc(clientNum);
+}
+
+void fillStatus(const Arm &a, proto::StatusReply &m) {
+  m.arm = armId(a);
+  m.moving = a.moving;
+  m.angles_n = NUM_SERVOS;
+  m.est_deg_n = NUM_SERVOS;
+  for (uint8_t i = 0; i < NUM_SERVOS; i++) {
+    m.angles[i] = cdegToDeg(a.currCdeg[i]);
+    m.est_deg[i] = roundf(a.estQ8[i] / 2560.0f) / 10.0f;
+  }
+  m.led = a.currLed;
+  m.rgb.has_r = m.rgb.has_g = m.rgb.has_b = true;
+  m.rgb.r = a.currR;
+  m.rgb.g = a.currG;
+  m.rgb.b = a.currB;
+  m.trajectory_mode = a.trajectoryMode || a.keyMode;
+  m.trajectory_points = a.trajectoryCount;
+  m.trajectory_index = a.trajectoryIndex;
+  m.stream_mode = a.streamMode;
+  m.stream_freq = a.streamFreq;
+  const Script &sc = scripts[armId(a)];
+  if (sc.running) {
+    m.has_script = m.has_script_step = true;
+    snprintf(m.script, sizeof(m.script), "%s", sc.id);
+    m.script_step = sc.pc;
+  }
+  fillWifiSummary(m.wifi);
+}
+
+void sendStatus(uint8_t clientNum, const Arm &a) {
+  proto::StatusReply m;
+  fillStatus(a, m);
+  txDoc.clear();
+  proto::encodeJson(m, txDoc.to<JsonObject>());
+  sendTxDoc(clientNum);
+}
+
+void broadcastStatus(const Arm &a) {
+  txDoc.clear();
+  txDoc["status"] = true;
+  txDoc["push"] = true;
+  txDoc["arm"] = armId(a);
+  txDoc["moving"] = a.moving;
+  JsonArray angles = txDoc["angles"].to<JsonArray>();
+  for (uint8_t i = 0; i < NUM_SERVOS; i++) {
+    angles.add(cdegToDeg(a.currCdeg[i]));
+  }
+  txDoc["led"] = a.currLed;
+  txDoc["rgb"]["r"] = a.currR;
+  txDoc["rgb"]["g"] = a.currG;
+  txDoc["rgb"]["b"] = a.currB;
+  addWifiSummary(txDoc["wifi"].to<JsonObject>());
+  size_t len = serializeTxDoc();
+  if (len == 0) return;
+  webSocket.broadcastTXT(txFrame, len, true);
+  for (uint8_t i = 0; i < WEBSOCKETS_SERVER_CLIENT_MAX; i++) {
+    if (!clientStats[i].connected) continue;
+    clientStats[i].txMsgs++;
+    clientStats[i].txBytes += len;
+  }
+}
+
+// One status push per arm every STATUS_PUSH_MS while a client is connected
+void updateStatusPush() {
+  uint32_t now = millis();
+  if (now - lastStatusPushMs < STATUS_PUSH_MS) return;
+  if (shedDefer(lastStatusPushMs + STATUS_PUSH_MS, load.pushHeld, load.reportsDeferred)) return;
+  lastStatusPushMs = now;
+  if (webSocket.connectedClients() == 0) return;
+  for (uint8_t k = 0; k < NUM_ARMS; k++) broadcastStatus(arms[k]);
+}
+
+// IPAddress::toString() without the String
+void formatIp(const IPAddress &ip, char *out, size_t n) {
+  snprintf(out, n, "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+}
+
+void addMemoryRegion(JsonArray map, const char *name, size_t bytes) {
+  JsonObject r = map.add<JsonObject>();
+  r["name"] = name;
+  r["bytes"] = bytes;
+}
+
+void addMemoryStats(JsonObject m) {
+  m["static"] = (bool)ROBOARM_STATIC_MEMORY;
+  m["armed"] = mem.armed;
+  m["free_heap"] = ESP.getFreeHeap();
+  m["min_free_heap"] = ESP.getMinFreeHeap();
+  m["max_alloc_heap"] = ESP.getMaxAllocHeap();
+  m["tx_buf"] = TX_BUF_BYTES;
+  m["tx_high_water"] = mem.txHighWater;
+  m["tx_overflows"] = mem.txOverflows;
+#if ROBOARM_STATIC_MEMORY
+  JsonObject ar = m["json_rx"].to<JsonObject>();
+  ar["size"] = rxArena.size();
+  ar["high_water"] = rxArena.highWater();
+  ar["failures"] = rxArena.failures();
+  JsonObject at = m["json_tx"].to<JsonObject>();
+  at["size"] = txArena.size();
+  at["high_water"] = txArena.highWater(); // before this reply
+  at["failures"] = txArena.failures();
+  JsonObject al = m["allocs"].to<JsonObject>();
+  al["app"] = mem.appAllocs;
+  al["app_bytes"] = mem.appBytes;
+  al["ws"] = mem.wsAllocs;
+  al["ws_bytes"] = mem.wsBytes;
+  al["other_tasks"] = mem.otherAllocs;
+  if (mem.appAllocs) {
+    char caller[20];
+    snprintf(caller, sizeof(caller), "0x%08lx", (unsigned long)mem.lastCaller);
+    al["last_size"] = mem.lastSize;
+    al["last_caller"] = caller;
+  }
+#endif
+  // Statically sized state (memory map in ZAAWANSOWANE_TRYBY.md)
+  JsonArray map = m["map"].to<JsonArray>();
+  addMemoryRegion(map, "arms", sizeof(arms));
+  addMemoryRegion(map, "scripts", sizeof(scripts));
+  addMemoryRegion(map, "client_stats", sizeof(clientStats));
+  addMemoryRegion(map, "board_out", sizeof(boardOut));
+  addMemoryRegion(map, "i2c_queue", 2 * NUM_BOARDS * sizeof(I2cBurst));
+  addMemoryRegion(map, "tx_frame", sizeof(txFrame));
+  addMemoryRegion(map, "cmd_queue", sizeof(cmdQueue) + sizeof(queuedNow));
+#if ROBOARM_STATIC_MEMORY
+  addMemoryRegion(map, "json_rx_arena", sizeof(rxArenaBuf));
+  addMemoryRegion(map, "json_tx_arena", sizeof(txArenaBuf));
+#endif
+}
+
+void sendStats(uint8_t clientNum) {
+  uint32_t now = millis();
+  txDoc.clear();
+  txDoc["stats"] = true;
+  txDoc["uptime_ms"] = now;
+  JsonArray clients = txDoc["clients"].to<JsonArray>();
+  for (uint8_t i = 0; i < WEBSOCKETS_SERVER_CLIENT_MAX; i++) {
+    const ClientStats &cs = clientStats[i];
+    if (!cs.connected) continue;
+    JsonObject c = clients.add<JsonObject>();
+    c["id"] = i;
+    c["self"] = (i == clientNum);
+    c["connected_ms"] = now - cs.connectedMs;
+    c["idle_ms"] = now - cs.lastActivityMs;
+    c["rx_msgs"] = cs.rxMsgs;
+    c["rx_bytes"] = cs.rxBytes;
+    c["tx_msgs"] = cs.txMsgs;
+    c["tx_bytes"] = cs.txBytes;
+    c["parse_errors"] = cs.parseErrors;
+    c["unknown_cmds"] = cs.unknownCmds;
+    c["dropped_frames"] = cs.droppedFrames;
+    c["tx_failures"] = cs.txFailures;
+    char ip[16];
+    formatIp(webSocket.remoteIP(i), ip, sizeof(ip));
+    c["ip"] = ip;
+  }
+
+  JsonObject i2c = txDoc["i2c"].to<JsonObject>();
+  i2c["clock_hz"] = i2cStats.clockHz;
+  i2c["bursts"] = i2cStats.queued;
+  i2c["bytes"] = i2cStats.bytes;
+  i2c["done"] = i2cStats.done;
+  i2c["errors"] = i2cStats.errors;
+  i2c["nacks"] = i2cStats.nacks;
+  i2c["timeouts"] = i2cStats.timeouts;
+  i2c["retries"] = i2cStats.retries;
+  i2c["deferred"] = i2cStats.deferred;
+  i2c["last_us"] = i2cStats.lastUs;
+  i2c["max_us"] = i2cStats.maxUs;
+  i2c["avg_us"] = i2cStats.done ? (uint32_t)(i2cStats.totalUs / i2cStats.done) : 0;
+  i2c["fallbacks"] = i2cStats.fallbacks;
+  i2c["upshifts"] = i2cStats.upshifts;
+  uint8_t inFlight = 0;
+  for (uint8_t k = 0; k < NUM_BOARDS; k++) {
+    if (__atomic_load_n(&boardOut[k].busy, __ATOMIC_ACQUIRE)) inFlight++;
+  }
+  i2c["in_flight"] = inFlight;
+
+  JsonObject lo = txDoc["load"].to<JsonObject>();
+  lo["level"] = load.level;
+  lo["budget_us"] = updateDtMs * 1000;
+  lo["loops"] = load.loops;
+  lo["overruns"] = load.overruns;
+  lo["last_loop_us"] = load.lastLoopUs;
+  lo["max_loop_us"] = load.maxLoopUs;
+  lo["max_tick_late_ms"] = load.maxTickLateMs;
+  lo["escalations"] = load.escalations;
+  JsonObject shed = lo["shed"].to<JsonObject>();
+  shed["logs_dropped"] = load.logsDropped;
+  shed["telemetry_deferred"] = load.telemetryDeferred;
+  shed["reports_deferred"] = load.reportsDeferred;
+  shed["led_skipped"] = load.ledSkipped;
+
+  JsonObject cq = txDoc["queue"].to<JsonObject>();
+  cq["depth"] = cmdQueue.count;
+  cq["max_depth"] = cmdQueue.maxDepth;
+  cq["slots"] = CMD_QUEUE_SLOTS;
+  cq["immediate"] = cmdQueue.immediate;
+  cq["direct"] = cmdQueue.direct;
+  cq["deferred"] = cmdQueue.deferred;
+  cq["ordered"] = cmdQueue.ordered;
+  cq["preempted"] = cmdQueue.preempted;
+  cq["overflows"] = cmdQueue.overflows;
+  cq["max_wait_ms"] = cmdQueue.maxWaitMs;
+
+  JsonObject pw = txDoc["power"].to<JsonObject>();
+  pw["idle"] = power.idle;
+  pw["cpu_mhz"] = getCpuFrequencyMhz();
+  pw["idle_entries"] = power.entries;
+  pw["idle_ms"] = (uint32_t)(power.blockedUs / 1000);
+  pw["idle_pct"] = now ? roundf(power.blockedUs / (now * 10.0f)) : 0;
+  pw["poll_ms"] = IDLE_POLL_MS;
+  pw["wakes"] = power.wakes;
+  pw["ramp_us"] = power.lastRampUs;
+  pw["max_ramp_us"] = power.maxRampUs;
+  pw["wakes_with_output"] = power.wakesWithOutput;
+  pw["wake_to_output_us"] = power.lastWakeOutUs;
+  pw["max_wake_to_output_us"] = power.maxWakeOutUs;
+
+  addMemoryStats(txDoc["memory"].to<JsonObject>());
+
+  JsonObject wifi = txDoc["wifi"].to<JsonObject>();
+  wifi["ch"] = wifiTel.channel;
+  wifi["scan_aps"] = wifiTel.scanAps;
+  wifi["scan_score"] = wifiTel.scanScore;
+  wifi["samples"] = wifiTel.samples;
+  wifi["sample_us"] = wifiTel.sampleUs;
+  JsonArray stations = wifi["stations"].to<JsonArray>();
+  for (uint8_t i = 0; i < wifiTel.stationCount; i++) {
+    const WifiStation &st = wifiTel.stations[i];
+    char mac[18];
+    snprintf(mac, sizeof(mac), "%02x:%02x:%02x:%02x:%02x:%02x",
+             st.mac[0], st.mac[1], st.mac[2], st.mac[3], st.mac[4], st.mac[5]);
+    JsonObject s = stations.add<JsonObject>();
+    s["mac"] = mac;
+    s["rssi"] = st.rssi;
+    s["rssi_min"] = st.rssiMin;
+  }
+  sendTxDoc(clientNum);
+}
+
+void addShaperConfig(JsonObject o, const Arm &a, uint8_t ch) {
+  const InputShaper &sh = a.shaper[ch];
+  o["ch"] = ch;
+  o["type"] = shaperName(sh.type());
+  if (!sh.enabled()) return;
+  o["freq"] = sh.freqHz();
+  o["damping"] = sh.damping();
+  o["delay_ms"] = sh.delayMs();
+  JsonArray taps = o["taps"].to<JsonArray>();
+  for (uint8_t k = 0; k < sh.taps().count; k++) {
+    JsonObject tap = taps.add<JsonObject>();
+    tap["t_ms"] = sh.taps().delay[k] * SHAPER_SAMPLE_MS;
+    tap["a"] = sh.taps().coeff[k] / 32768.0f;
+  }
+}
+
+void addFilterConfig(JsonObject o, const Arm &a, uint8_t ch) {
+  const InputFilter &f = a.inFilter[ch];
+  o["ch"] = ch;
+  o["type"] = filterName(f.type());
+  switch (f.type()) {
+    case FILTER_ONE_EURO:
+      o["min_cutoff"] = f.minCutoffHz();
+      o["beta"] = f.beta();
+      break;
+    case FILTER_CRITICAL:
+      o["freq"] = f.freqHz();
+      break;
+    case FILTER_MA:
+      o["n"] = f.length();
+      break;
+    default:
+      return;
+  }
+  o["latency_ms"] = roundf(f.latencyMs(inputIntervalMs(a)) * 10.0f) / 10.0f;
+}
+
+// Finish the ringing test: report to the requesting client and step back
+void updateRingingTest() {
+  RingingTest &rt = ringTest;
+  if (!rt.active) return;
+  Arm &a = arms[rt.arm];
+  uint32_t now = millis();
+  if (!rt.holding) {
+    if (a.moving) return;
+    rt.holding = true;
+    rt.moveEndMs = now;
+    return;
+  }
+  if (now - rt.moveEndMs < rt.holdMs) return;
+  if (shedDefer(rt.moveEndMs + rt.holdMs, load.reportHeld, load.reportsDeferred)) return;
+  rt.active = false;
+
+  if (clientStats[rt.clientNum].connected) {
+    txDoc.clear();
+    txDoc["ringing"] = true;
+    txDoc["arm"] = rt.arm;
+    txDoc["ch"] = rt.ch;
+    txDoc["step_deg"] = rt.targetDeg - rt.startDeg;
+    txDoc["move_ms"] = rt.moveMs;
+    txDoc["model_freq"] = rt.freqHz;
+    txDoc["model_damping"] = rt.damping;
+    txDoc["shaper"] = shaperName(a.shaper[rt.ch].type());
+    txDoc["raw"]["residual_deg"] = rt.rawResidual;
+    txDoc["raw"]["settle_ms"] = rt.rawSettleMs;
+    txDoc["shaped"]["residual_deg"] = rt.shapedResidual;
+    txDoc["shaped"]["settle_ms"] = rt.shapedSettleMs;
+    sendTxDoc(rt.clientNum);
+  }
+
+  int16_t d[NUM_SERVOS];
+  memcpy(d, a.currCdeg, sizeof(d));
+  d[rt.ch] = degToCdeg(rt.startDeg);
+  startMove(a, d, rt.moveMs, a.currLed, a.currR, a.currG, a.currB);
+}
+
+bool anyStreaming() {
+  for (const Arm &a : arms) {
+    if (a.streamMode) return true;
+  }
+  return false;
+}
+
+// ========= Scripts =========
+bool anyScriptRunning() {
+  for (const Script &sc : scripts) {
+    if (sc.running) return true;
+  }
+  return false;
+}
+
+// Wakes every script waiting for name, returns how many
+uint8_t scriptEvent(const char *name) {
+  uint8_t woken = 0;
+  for (Script &sc : scripts) {
+    if (!sc.running || sc.steps[sc.pc].op != OP_WAIT_EVENT) continue;
+    if (strcmp(sc.steps[sc.pc].event, name) == 0) {
+      sc.eventHit = true;
+      woken++;
+    }
+  }
+  return woken;
+}
+
+// Frame-like fields of one step; missing angles/LED/RGB hold the arm's current values
+void parseStepTarget(JsonObject o, const Arm &a, ScriptStep &st) {
+  JsonArray deg = o["deg"].as<JsonArray>();
+  for (uint8_t i = 0; i < NUM_SERVOS; i++) {
+    st.cdeg[i] = (i < deg.size()) ? degToCdeg(deg[i].as<float>()) : a.currCdeg[i];
+  }
+  st.led = o["led"] | a.currLed;
+  st.r = o["rgb"]["r"] | a.currR;
+  st.g = o["rgb"]["g"] | a.currG;
+  st.b = o["rgb"]["b"] | a.currB;
+}
+
+// Appends the steps of one JSON step to sc ("trajectory" expands to
+// frame + wait_move per point). Returns an error code or nullptr.
+const char *parseScriptStep(JsonObject o, uint8_t defaultArm, Script &sc) {
+  const char *op = o["op"] | "";
+  int armIdx = o["arm"] | (int)defaultArm;
+  if (armIdx < 0 || armIdx >= (int)NUM_ARMS) return "bad_arm";
+  const Arm &a = arms[armIdx];
+
+  JsonArray points = o["points"].as<JsonArray>();
+  size_t need = strcmp(op, "trajectory") == 0 ? 2 * points.size() : 1;
+  if (sc.count + need > SCRIPT_MAX_STEPS) return "script_too_long";
+  ScriptStep &st = sc.steps[sc.count];
+  memset(&st, 0, sizeof(st));
+  st.arm = (uint8_t)armIdx;
+
+  if (strcmp(op, "frame") == 0 || strcmp(op, "home") == 0) {
+    st.op = OP_FRAME;
+    parseStepTarget(o, a, st);
+    if (op[0] == 'h') {
+      for (uint8_t i = 0; i < NUM_SERVOS; i++) st.cdeg[i] = 0;
+    } else if (o["deg"].as<JsonArray>().size() == 0) {
+      return "missing_deg";
+    }
+    st.ms = o["ms"] | 800;
+  } else if (strcmp(op, "trajectory") == 0) {
+    if (points.size() == 0) return "missing_points";
+    for (JsonObject point : points) {
+      ScriptStep &move = sc.steps[sc.count++];
+      memset(&move, 0, sizeof(move));
+      move.op = OP_FRAME;
+      move.arm = (uint8_t)armIdx;
+      parseStepTarget(point, a, move);
+      move.ms = point["ms"] | 200;
+      ScriptStep &wait = sc.steps[sc.count++];
+      memset(&wait, 0, sizeof(wait));
+      wait.op = OP_WAIT_MOVE;
+      wait.arm = (uint8_t)armIdx;
+    }
+    return nullptr;
+  } else if (strcmp(op, "rgb") == 0) {
+    st.op = OP_RGB;
+    st.r = o["r"] | 0;
+    st.g = o["g"] | 0;
+    st.b = o["b"] | 0;
+  } else if (strcmp(op, "led") == 0) {
+    int v = o["val"] | -1;
+    if (v < 0 || v > 255) return "led_range_0_255";
+    st.op = OP_LED;
+    st.led = (uint8_t)v;
+  } else if (strcmp(op, "wait_move") == 0) {
+    st.op = OP_WAIT_MOVE;
+  } else if (strcmp(op, "delay") == 0) {
+    st.op = OP_DELAY;
+    st.ms = o["ms"] | 0;
+  } else if (strcmp(op, "wait_event") == 0 || strcmp(op, "signal") == 0) {
+    const char *name = o["name"] | "";
+    if (!name[0] || strlen(name) >= SCRIPT_NAME_LEN) return "bad_event_name";
+    st.op = op[0] == 'w' ? OP_WAIT_EVENT : OP_SIGNAL;
+    strcpy(st.event, name);
+  } else if (strcmp(op, "repeat") == 0) {
+    int to = o["to"] | 0;
+    int count = o["count"] | 1;
+    if (to < 0 || to >= sc.count || count < 1 || count > 65535) return "bad_repeat";
+    st.op = OP_REPEAT;
+    st.to = (uint8_t)to;
+    st.ms = (uint32_t)count;
+    st.left = (uint16_t)count;
+  } else {
+    return "bad_op";
+  }
+  sc.count++;
+  return nullptr;
+}
+
+void finishScript(Script &sc, uint8_t armIdx, const char *result) {
+  sc.running = false;
+  if (!clientStats[sc.clientNum].connected) return;
+  txDoc.clear();
+  txDoc["script"] = sc.id;
+  txDoc["arm"] = armIdx;
+  txDoc["result"] = result;
+  txDoc["step"] = sc.pc;
+  txDoc["ms"] = millis() - sc.startMs;
+  sendTxDoc(sc.clientNum);
+}
+
+// Runs steps until one has to wait. Returns false once the script has ended.
+bool runScript(Script &sc, uint32_t now) {
+  // Bounded per call: a repeat without any waiting step cannot starve loop()
+  for (uint8_t budget = SCRIPT_MAX_STEPS; budget > 0; budget--) {
+    if (sc.pc >= sc.count) return false;
+    ScriptStep &st = sc.steps[sc.pc];
+    Arm &a = arms[st.arm];
+    switch (st.op) {
+      case OP_FRAME:
+        cancelTrajectory(a);
+        startMoveAt(a, now, st.cdeg, st.ms, st.led, st.r, st.g, st.b);
+        break;
+      case OP_RGB:
+        setRgbLed(a, st.r, st.g, st.b);
+        break;
+      case OP_LED:
+        setLed(a, st.led);
+        break;
+      case OP_WAIT_MOVE:
+        if (a.moving || a.trajectoryMode) return true;
+        break;
+      case OP_DELAY:
+        if (!sc.waiting) {
+          sc.waiting = true;
+          sc.waitUntilMs = now + st.ms;
+        }
+        if ((int32_t)(now - sc.waitUntilMs) < 0) return true;
+        break;
+      case OP_WAIT_EVENT:
+        if (!sc.eventHit) return true;
+        break;
+      case OP_SIGNAL:
+        scriptEvent(st.event);
+        break;
+      case OP_REPEAT:
+        if (st.left > 0) {
+          st.left--;
+          sc.pc = st.to;
+          continue;
+        }
+        st.left = (uint16_t)st.ms; // reloaded for an enclosing repeat
+        break;
+    }
+    sc.pc++;
+    sc.waiting = false;
+    sc.eventHit = false;
+  }
+  return true;
+}
+
+void updateScripts() {
+  uint32_t now = millis();
+  for (uint8_t k = 0; k < NUM_ARMS; k++) {
+    Script &sc = scripts[k];
+    if (sc.running && !runScript(sc, now)) finishScript(sc, k, "done");
+  }
+}
+
+// ========= Decoded commands =========
+// Commands from protocol/roboarm_protocol.json, shared by the JSON and the
+// binary path. Fields the message leaves out keep the arm's current value.
+uint8_t orCurrent(bool has, uint8_t v, uint8_t current) { return has ? v : current; }
+
+void runHome(Arm &arm, const proto::HomeCmd &m) {
+  int16_t d[NUM_SERVOS] = {}; // center (1.5 ms)
+  const proto::Color &c = m.rgb; // home turns the RGB LED off unless given
+  cancelTrajectory(arm);
+  startMove(arm, d, m.ms, orCurrent(m.has_led, m.led, arm.currLed),
+            c.has_r ? c.r : 0, c.has_g ? c.g : 0, c.has_b ? c.b : 0);
 }
 
-void sendStatus(uint8_t clientNum) {
-  txDoc.clear();
-  txDoc["status"] = true;
-  txDoc["moving"] = moving;
-  JsonArray angles = txDoc["angles"].to<JsonArray>();
-  for (uint8_t i = 0; i < NUM_SERVOS; i++) {
-    angles.add(currDeg[i]);
-  }
-  txDoc["led"] = currLed;
-  txDoc["rgb"]["r"] = currR;
-  txDoc["rgb"]["g"] = currG;
-  txDoc["rgb"]["b"] = currB;
-  txDoc["trajectory_mode"] = trajectoryMode;
-  txDoc["trajectory_points"] = trajectoryCount;
-  txDoc["trajectory_index"] = trajectoryIndex;
-  txDoc["stream_mode"] = streamMode;
-  txDoc["stream_freq"] = streamFreq;
-  String response;
-  serializeJson(txDoc, response);
-  webSocket.sendTXT(clientNum, response);
-}
-
-void broadcastStatus() {
-  txDoc.clear();
-  txDoc["status"] = true;
-  txDoc["moving"] = moving;
-  JsonArray angles = txDoc["angles"].to<JsonArray>();
+// FrameCmd and RtFrameCmd; "deg" expects -90..+90, missing values = hold
+template <typename M>
+void runFrame(Arm &arm, const M &m, bool realtime) {
+  float d[NUM_SERVOS];
   for (uint8_t i = 0; i < NUM_SERVOS; i++) {
-    angles.add(currDeg[i]);
+    d[i] = i < m.deg_n ? m.deg[i] : cdegToDeg(arm.currCdeg[i]);
   }
-  txDoc["led"] = currLed;
-  txDoc["rgb"]["r"] = currR;
-  txDoc["rgb"]["g"] = currG;
-  txDoc["rgb"]["b"] = currB;
-  String response;
-  serializeJson(txDoc, response);
-  webSocket.broadcastTXT(response);
+  if (realtime) filterInput(arm, d, millis());
+  int16_t cd[NUM_SERVOS];
+  toCdeg(d, cd);
+  const proto::Color &c = m.rgb;
+  cancelTrajectory(arm);
+  startMove(arm, cd, m.ms, orCurrent(m.has_led, m.led, arm.currLed), orCurrent(c.has_r, c.r, arm.currR),
+            orCurrent(c.has_g, c.g, arm.currG), orCurrent(c.has_b, c.b, arm.currB));
 }
 
-void handleJsonMessage(uint8_t clientNum, const char *payload) {
-  rxDoc.clear();
-  DeserializationError err = deserializeJson(rxDoc, payload);
-  if (err) {
-    sendError(clientNum, "bad_json");
-    return;
+// Frame with "queue": true - a trajectory point behind the running trajectory
+// (or the current move) instead of a replacement; missing values keep the
+// angle of the point before it
+const char *queueFrame(Arm &arm, const proto::FrameCmd &m) {
+  if (m.ms > POINT_MAX_MS) return "point_ms_range";
+  int base = trajectoryAppendIndex(arm, 1);
+  if (base < 0) return "queue_full";
+  const int16_t *prev = base > 0 ? arm.trajectoryBuffer[base - 1].cdeg : (arm.moving ? arm.targetCdeg : arm.currCdeg);
+  TrajectoryPoint &tp = arm.trajectoryBuffer[base];
+  for (uint8_t i = 0; i < NUM_SERVOS; i++) tp.cdeg[i] = i < m.deg_n ? degToCdeg(m.deg[i]) : prev[i];
+  tp.duration_ms = m.ms;
+  tp.blend_ms = 0;
+  const proto::Color &c = m.rgb;
+  tp.led_val = orCurrent(m.has_led, m.led, arm.currLed);
+  tp.r = orCurrent(c.has_r, c.r, arm.currR);
+  tp.g = orCurrent(c.has_g, c.g, arm.currG);
+  tp.b = orCurrent(c.has_b, c.b, arm.currB);
+  arm.trajectoryCount = base + 1;
+  arm.trajectoryMode = true;
+  return nullptr;
+}
+
+// Binary frames: [id][fields], ids and layout in protocol_gen.h. Replies are
+// binary too (pong, ack, status); rt_frame stays fire-and-forget.
+void runBinaryCommand(uint8_t clientNum, const uint8_t *payload, size_t length) {
+  const char *err = nullptr;
+  switch (proto::messageId(payload, length)) {
+    case proto::CMD_PING: {
+      proto::PingCmd m;
+      err = proto::decodeBin(payload, length, m);
+      if (!err) {
+        sendBin(clientNum, proto::PongReply());
+        return;
+      }
+      break;
+    }
+    case proto::CMD_HOME: {
+      proto::HomeCmd m;
+      err = proto::decodeBin(payload, length, m);
+      if (!err && m.arm >= NUM_ARMS) err = "bad_arm";
+      if (!err) runHome(arms[m.arm], m);
+      break;
+    }
+    case proto::CMD_LED: {
+      proto::LedCmd m;
+      err = proto::decodeBin(payload, length, m);
+      if (!err && m.arm >= NUM_ARMS) err = "bad_arm";
+      if (!err) setLed(arms[m.arm], m.val);
+      break;
+    }
+    case proto::CMD_RGB: {
+      proto::RgbCmd m;
+      err = proto::decodeBin(payload, length, m);
+      if (!err && m.arm >= NUM_ARMS) err = "bad_arm";
+      if (!err) setRgbLed(arms[m.arm], m.r, m.g, m.b);
+      break;
+    }
+    case proto::CMD_FRAME: {
+      proto::FrameCmd m;
+      err = proto::decodeBin(payload, length, m);
+      if (!err && m.arm >= NUM_ARMS) err = "bad_arm";
+      if (!err) runFrame(arms[m.arm], m, false);
+      break;
+    }
+    case proto::CMD_RT_FRAME: {
+      proto::RtFrameCmd m;
+      err = proto::decodeBin(payload, length, m);
+      if (!err && m.arm >= NUM_ARMS) err = "bad_arm";
+      if (err) clientStats[clientNum].droppedFrames++;
+      else runFrame(arms[m.arm], m, true);
+      return; // no response
+    }
+    case proto::CMD_STATUS: {
+      proto::StatusCmd m;
+      err = proto::decodeBin(payload, length, m);
+      if (!err && m.arm >= NUM_ARMS) err = "bad_arm";
+      if (!err) {
+        proto::StatusReply reply;
+        fillStatus(arms[m.arm], reply);
+        sendBin(clientNum, reply);
+        return;
+      }
+      break;
+    }
+    default:
+      clientStats[clientNum].unknownCmds++;
+      err = "unknown_cmd";
+      break;
   }
+  if (err && strcmp(err, "bad_binary") == 0) clientStats[clientNum].parseErrors++;
+  sendBinAck(clientNum, err);
+}
 
-  // Check if this is stream data (array of angles in stream mode)
-  if (streamMode && rxDoc.is<JsonArray>()) {
+// One parsed JSON message in rxDoc
+void runJsonCommand(uint8_t clientNum) {
+  // Check if this is stream data (array of angles in stream mode). Arms in
+  // stream mode take NUM_SERVOS values each, in arm order.
+  if (rxDoc.is<JsonArray>() && anyStreaming()) {
     JsonArray arr = rxDoc.as<JsonArray>();
-    if (arr.size() >= NUM_SERVOS) {
-      uint32_t now = millis();
-      uint32_t interval = 1000 / streamFreq;
+    uint32_t now = millis();
+    uint8_t used = 0;
+    for (Arm &a : arms) {
+      if (!a.streamMode) continue;
+      if (arr.size() < (size_t)(used + NUM_SERVOS)) {
+        clientStats[clientNum].droppedFrames++;
+        break;
+      }
+      uint32_t interval = 1000 / a.streamFreq;
       
       // Throttle stream updates based on frequency
-      if (now - lastStreamUpdateMs >= interval) {
+      if (now - a.lastStreamUpdateMs >= interval) {
         float d[NUM_SERVOS];
         for (uint8_t i = 0; i < NUM_SERVOS; i++) {
-          d[i] = (i < arr.size()) ? (float)arr[i].as<float>() : currDeg[i];
+          d[i] = arr[used + i].as<float>();
         }
         
+        filterInput(a, d, now);
+        int16_t cd[NUM_SERVOS];
+        toCdeg(d, cd);
+        
         // Very short duration for stream mode
         uint32_t ms = max<uint32_t>(10, interval / 2);
-        startMove(d, ms, currLed, currR, currG, currB);
-        lastStreamUpdateMs = now;
+        cancelTrajectory(a);
+        startMoveAt(a, now, cd, ms, a.currLed, a.currR, a.currG, a.currB);
+        a.lastStreamUpdateMs = now;
+      } else {
+        clientStats[clientNum].droppedFrames++;
       }
+      used += NUM_SERVOS;
     }
     return; // No response in stream mode
   }
 
   const char *cmd = rxDoc["cmd"] | "";
 
+  // Commands act on arm 0 unless "arm" says otherwise
+  int armIdx = rxDoc["arm"] | 0;
+  if (armIdx < 0 || armIdx >= (int)NUM_ARMS) {
+    sendError(clientNum, "bad_arm");
+    return;
+  }
+  Arm &arm = arms[armIdx];
+
   if (strcmp(cmd, "ping") == 0) {
     txDoc.clear();
     txDoc["pong"] = true;
-    String response;
-    serializeJson(txDoc, response);
-    webSocket.sendTXT(clientNum, response);
+    sendTxDoc(clientNum);
     return;
   }
 
+  JsonObjectConst msg = rxDoc.as<JsonObjectConst>();
+
   if (strcmp(cmd, "home") == 0) {
-    float d[NUM_SERVOS];
-    for (uint8_t i = 0; i < NUM_SERVOS; i++) d[i] = 0.0f; // center (1.5 ms)
-    uint32_t ms = rxDoc["ms"] | 800;
-    uint8_t ledVal = rxDoc["led"] | currLed;
-    uint8_t r = rxDoc["rgb"]["r"] | 0;
-    uint8_t g = rxDoc["rgb"]["g"] | 0;
-    uint8_t b = rxDoc["rgb"]["b"] | 0;
-    startMove(d, ms, ledVal, r, g, b);
+    proto::HomeCmd m;
+    const char *e = proto::decodeJson(msg, m);
+    if (e) {
+      sendError(clientNum, e);
+      return;
+    }
+    runHome(arm, m);
     sendOk(clientNum);
     return;
   }
 
   if (strcmp(cmd, "led") == 0) {
-    int v = rxDoc["val"] | -1;
-    if (v < 0 || v > 255) {
-      sendError(clientNum, "led_range_0_255");
+    proto::LedCmd m;
+    const char *e = proto::decodeJson(msg, m);
+    if (e) {
+      sendError(clientNum, e);
       return;
     }
-    setLed((uint8_t)v);
+    setLed(arm, m.val);
     sendOk(clientNum);
     return;
   }
 
   if (strcmp(cmd, "rgb") == 0) {
-    int r = rxDoc["r"] | -1;
-    int g = rxDoc["g"] | -1;
-    int b = rxDoc["b"] | -1;
-    if (r < 0 || r > 255 || g < 0 || g > 255 || b < 0 || b > 255) {
-      sendError(clientNum, "rgb_range_0_255");
+    proto::RgbCmd m;
+    const char *e = proto::decodeJson(msg, m);
+    if (e) {
+      sendError(clientNum, e);
       return;
     }
-    setRgbLed((uint8_t)r, (uint8_t)g, (uint8_t)b);
+    setRgbLed(arm, m.r, m.g, m.b);
     sendOk(clientNum);
     return;
   }
 
   if (strcmp(cmd, "freq") == 0) {
-    // Keep 50 Hz for servos. Range check anyway.
+    // 40-60 Hz for analog servos, 200-330 Hz only with digital servos on the board.
+    // "board" defaults to the board of the addressed arm.
+    int board = rxDoc["board"] | ARM_CFG[armIdx].board;
+    if (board < 0 || board >= (int)NUM_BOARDS) {
+      sendError(clientNum, "bad_board");
+      return;
+    }
     float hz = rxDoc["hz"] | 50.0f;
-    if (hz < 40.0f || hz > 60.0f) {
-      sendError(clientNum, "freq_out_of_range_40_60");
+    bool standard = hz >= 40.0f && hz <= 60.0f;
+    bool fast = hz >= SERVO_HZ_FAST_MIN && hz <= SERVO_HZ_FAST_MAX;
+    if (!standard && !fast) {
+      sendError(clientNum, "freq_out_of_range_40_60_or_200_330");
       return;
     }
-    setPwmFreq(hz);
-    sendOk(clientNum);
+    setPwmFreq(board, hz);
+    applyAllOutputs(); // same pulse widths on the new period
+    txDoc.clear();
+    txDoc["ok"] = true;
+    txDoc["board"] = board;
+    txDoc["hz"] = boardPwmHz(board);
+    txDoc["tick_ms"] = updateDtMs;
+    sendTxDoc(clientNum);
     return;
   }
 
@@ -421,66 +2343,74 @@ void handleJsonMessage(uint8_t clientNum, const char *payload) {
       return;
     }
     if (!rxDoc["min_us"].isNull())
-      servoCfg[ch].min_us = rxDoc["min_us"].as<uint16_t>();
+      arm.servoCfg[ch].min_us = rxDoc["min_us"].as<uint16_t>();
     if (!rxDoc["max_us"].isNull())
-      servoCfg[ch].max_us = rxDoc["max_us"].as<uint16_t>();
+      arm.servoCfg[ch].max_us = rxDoc["max_us"].as<uint16_t>();
     if (!rxDoc["offset_us"].isNull())
-      servoCfg[ch].offset_us = rxDoc["offset_us"].as<int16_t>();
+      arm.servoCfg[ch].offset_us = rxDoc["offset_us"].as<int16_t>();
     if (!rxDoc["invert"].isNull())
-      servoCfg[ch].invert = rxDoc["invert"].as<bool>();
+      arm.servoCfg[ch].invert = rxDoc["invert"].as<bool>();
+    recomputeTicks(arm);
     sendOk(clientNum);
     return;
   }
 
   if (strcmp(cmd, "frame") == 0) {
-    // "deg" expects -90..+90 for each joint. Missing values = hold.
-    JsonArray arr = rxDoc["deg"].as<JsonArray>();
-    if (arr.isNull() || arr.size() == 0) {
-      sendError(clientNum, "missing_deg");
+    proto::FrameCmd m;
+    const char *e = proto::decodeJson(msg, m);
+    if (e) {
+      sendError(clientNum, e);
       return;
     }
-    float d[NUM_SERVOS];
-    for (uint8_t i = 0; i < NUM_SERVOS; i++) {
-      d[i] = (i < arr.size()) ? (float)arr[i].as<float>() : currDeg[i];
+    // Replaces the current move and trajectory, or with "queue": true goes behind them
+    if (rxDoc["queue"] | false) {
+      e = queueFrame(arm, m);
+      if (e) {
+        sendError(clientNum, e);
+        return;
+      }
+    } else {
+      runFrame(arm, m, false);
     }
-    uint32_t ms = rxDoc["ms"] | 100;
-    int ledVal = rxDoc["led"] | currLed;
-    if (ledVal < 0) ledVal = currLed;
-    
-    uint8_t r = rxDoc["rgb"]["r"] | currR;
-    uint8_t g = rxDoc["rgb"]["g"] | currG;
-    uint8_t b = rxDoc["rgb"]["b"] | currB;
-    
-    startMove(d, ms, (uint8_t)ledVal, r, g, b);
     sendOk(clientNum);
     return;
   }
 
   if (strcmp(cmd, "rt_frame") == 0) {
     // Real-time frame - fire and forget, no response for minimal latency
-    JsonArray arr = rxDoc["deg"].as<JsonArray>();
-    if (arr.isNull() || arr.size() == 0) {
+    proto::RtFrameCmd m;
+    if (proto::decodeJson(msg, m)) {
       // Silent fail for real-time mode
+      clientStats[clientNum].droppedFrames++;
       return;
     }
-    float d[NUM_SERVOS];
-    for (uint8_t i = 0; i < NUM_SERVOS; i++) {
-      d[i] = (i < arr.size()) ? (float)arr[i].as<float>() : currDeg[i];
-    }
-    uint32_t ms = rxDoc["ms"] | 50; // Default 50ms for fast updates
-    int ledVal = rxDoc["led"] | currLed;
-    if (ledVal < 0) ledVal = currLed;
-    
-    uint8_t r = rxDoc["rgb"]["r"] | currR;
-    uint8_t g = rxDoc["rgb"]["g"] | currG;
-    uint8_t b = rxDoc["rgb"]["b"] | currB;
-    
-    startMove(d, ms, (uint8_t)ledVal, r, g, b);
-    // No response - fire and forget for minimum latency
+    runFrame(arm, m, true);
     return;
   }
 
   if (strcmp(cmd, "trajectory") == 0) {
+    // Sparse keyframes instead of points: only the channels that change
+    JsonObject tracks = rxDoc["tracks"].as<JsonObject>();
+    if (!tracks.isNull()) {
+      if (rxDoc["queue"] | false) {
+        sendError(clientNum, "tracks_cannot_queue");
+        return;
+      }
+      uint8_t keys;
+      uint32_t ms;
+      const char *err = startKeyframes(arm, tracks, millis(), keys, ms);
+      if (err) {
+        sendError(clientNum, err);
+        return;
+      }
+      txDoc.clear();
+      txDoc["ok"] = true;
+      txDoc["keys"] = keys;
+      txDoc["ms"] = ms;
+      sendTxDoc(clientNum);
+      return;
+    }
+
     // Buffer trajectory points for smooth execution
     JsonArray points = rxDoc["points"].as<JsonArray>();
     if (points.isNull() || points.size() == 0) {
@@ -492,44 +2422,68 @@ void handleJsonMessage(uint8_t clientNum, const char *payload) {
       sendError(clientNum, "too_many_points");
       return;
     }
+    const char *err = checkTrajectoryPoints(points);
+    if (err) {
+      sendError(clientNum, err);
+      return;
+    }
     
-    // Stop current trajectory
-    trajectoryMode = false;
-    trajectoryCount = 0;
-    trajectoryIndex = 0;
+    // Replace the buffered trajectory (the move in progress finishes first),
+    // or with "queue": true append to it
+    int base = 0;
+    if (rxDoc["queue"] | false) {
+      base = trajectoryAppendIndex(arm, points.size());
+      if (base < 0) {
+        sendError(clientNum, "queue_full");
+        return;
+      }
+    } else {
+      cancelTrajectory(arm);
+    }
+    int16_t from[NUM_SERVOS];
+    memcpy(from, base > 0 ? arm.trajectoryBuffer[base - 1].cdeg : (arm.moving ? arm.targetCdeg : arm.currCdeg),
+           sizeof(from));
     
     // Load new trajectory
     for (uint8_t p = 0; p < points.size() && p < MAX_TRAJECTORY_POINTS; p++) {
       JsonObject point = points[p];
       JsonArray deg = point["deg"];
       
-      TrajectoryPoint &tp = trajectoryBuffer[p];
+      TrajectoryPoint &tp = arm.trajectoryBuffer[base + p];
       for (uint8_t i = 0; i < NUM_SERVOS; i++) {
-        tp.deg[i] = (i < deg.size()) ? (float)deg[i].as<float>() : currDeg[i];
+        tp.cdeg[i] = (i < deg.size()) ? degToCdeg(deg[i].as<float>()) : arm.currCdeg[i];
       }
       tp.duration_ms = point["ms"] | 200;
-      tp.led_val = point["led"] | currLed;
-      tp.r = point["rgb"]["r"] | currR;
-      tp.g = point["rgb"]["g"] | currG;
-      tp.b = point["rgb"]["b"] | currB;
+      tp.led_val = point["led"] | arm.currLed;
+      tp.r = point["rgb"]["r"] | arm.currR;
+      tp.g = point["rgb"]["g"] | arm.currG;
+      tp.b = point["rgb"]["b"] | arm.currB;
     }
+
+    // Optional blend zones ("blend" deg / "blend_mm" per point)
+    uint32_t savedMs = planBlendZones(arm.trajectoryBuffer + base, points, from);
     
-    trajectoryCount = points.size();
-    trajectoryIndex = 0;
-    trajectoryMode = true;
+    arm.trajectoryCount = base + points.size();
+    arm.trajectoryMode = true;
     
-    sendOk(clientNum);
+    if (savedMs == 0) {
+      sendOk(clientNum);
+      return;
+    }
+    txDoc.clear();
+    txDoc["ok"] = true;
+    txDoc["blend_saved_ms"] = savedMs;
+    sendTxDoc(clientNum);
     return;
   }
 
   if (strcmp(cmd, "stream_start") == 0) {
     // Start stream mode
-    streamFreq = rxDoc["freq"] | 20;
-    if (streamFreq < 1) streamFreq = 1;
-    if (streamFreq > 100) streamFreq = 100;
+    uint32_t freq = rxDoc["freq"] | 20;
+    arm.streamFreq = constrain(freq, (uint32_t)1, (uint32_t)100);
     
-    streamMode = true;
-    lastStreamUpdateMs = millis();
+    arm.streamMode = true;
+    arm.lastStreamUpdateMs = millis();
     
     sendOk(clientNum);
     return;
@@ -537,58 +2491,719 @@ void handleJsonMessage(uint8_t clientNum, const char *payload) {
 
   if (strcmp(cmd, "stream_stop") == 0) {
     // Stop stream mode
-    streamMode = false;
+    arm.streamMode = false;
+    sendOk(clientNum);
+    return;
+  }
+
+  if (strcmp(cmd, "sync_frame") == 0) {
+    // {"cmd":"sync_frame","ms":300,"frames":[{"arm":0,"deg":[...]},{"arm":1,"deg":[...],"led":255}]}
+    // All listed arms start on the same timestamp and arrive together
+    JsonArray frames = rxDoc["frames"].as<JsonArray>();
+    if (frames.isNull() || frames.size() == 0) {
+      sendError(clientNum, "missing_frames");
+      return;
+    }
+    for (JsonObject f : frames) {
+      int id = f["arm"] | -1;
+      if (id < 0 || id >= (int)NUM_ARMS) {
+        sendError(clientNum, "bad_arm");
+        return;
+      }
+      if (f["deg"].as<JsonArray>().isNull()) {
+        sendError(clientNum, "missing_deg");
+        return;
+      }
+    }
+    uint32_t ms = rxDoc["ms"] | 100;
+    uint32_t now = millis();
+    for (JsonObject f : frames) {
+      Arm &a = arms[f["arm"].as<uint8_t>()];
+      JsonArray arr = f["deg"].as<JsonArray>();
+      int16_t d[NUM_SERVOS];
+      for (uint8_t i = 0; i < NUM_SERVOS; i++) {
+        d[i] = (i < arr.size()) ? degToCdeg(arr[i].as<float>()) : a.currCdeg[i];
+      }
+      uint8_t ledVal = f["led"] | a.currLed;
+      uint8_t r = f["rgb"]["r"] | a.currR;
+      uint8_t g = f["rgb"]["g"] | a.currG;
+      uint8_t b = f["rgb"]["b"] | a.currB;
+      cancelTrajectory(a);
+      startMoveAt(a, now, d, ms, ledVal, r, g, b);
+    }
     sendOk(clientNum);
     return;
   }
 
   if (strcmp(cmd, "status") == 0) {
-    sendStatus(clientNum);
+    sendStatus(clientNum, arm);
+    return;
+  }
+
+  if (strcmp(cmd, "shaper") == 0) {
+    // {"cmd":"shaper","ch":1,"type":"zvd","freq":8.5,"damping":0.1}
+    // Without "ch" applies to all joints, without "type" only reports the config
+    int ch = rxDoc["ch"] | -1;
+    if (ch >= (int)NUM_SERVOS || (!rxDoc["ch"].isNull() && ch < 0)) {
+      sendError(clientNum, "bad_ch");
+      return;
+    }
+    uint8_t first = ch < 0 ? 0 : ch;
+    uint8_t last = ch < 0 ? NUM_SERVOS - 1 : ch;
+
+    const char *typeName = rxDoc["type"].as<const char *>();
+    if (typeName) {
+      ShaperType type;
+      if (!shaperFromName(typeName, type)) {
+        sendError(clientNum, "bad_shaper_type");
+        return;
+      }
+      float freq = rxDoc["freq"] | 0.0f;
+      float damping = rxDoc["damping"] | 0.05f;
+      if (type != SHAPER_NONE && (freq < 2.0f || freq > 50.0f || damping < 0.0f || damping > 0.5f)) {
+        sendError(clientNum, "shaper_range_freq_2_50_damping_0_0.5");
+        return;
+      }
+      // Low freq with high damping can span more than the shaper history
+      ShaperTaps taps;
+      if (!computeShaperTaps(type, freq, damping, taps)) {
+        sendError(clientNum, "shaper_too_long");
+        return;
+      }
+      for (uint8_t i = first; i <= last; i++) {
+        arm.shaper[i].configure(type, freq, damping);
+        arm.shaper[i].reset(arm.cmdCdeg[i]);
+      }
+    }
+
+    txDoc.clear();
+    txDoc["ok"] = true;
+    txDoc["arm"] = armIdx;
+    JsonArray list = txDoc["shapers"].to<JsonArray>();
+    for (uint8_t i = first; i <= last; i++) addShaperConfig(list.add<JsonObject>(), arm, i);
+    sendTxDoc(clientNum);
+    return;
+  }
+
+  if (strcmp(cmd, "filter") == 0) {
+    // {"cmd":"filter","ch":0,"type":"one_euro","min_cutoff":1.0,"beta":0.05}
+    // {"cmd":"filter","type":"critical","freq":4} / {"cmd":"filter","type":"ma","n":4}
+    // Stream and rt_frame input only. Without "ch" applies to all joints, without "type" reports.
+    int ch = rxDoc["ch"] | -1;
+    if (ch >= (int)NUM_SERVOS || (!rxDoc["ch"].isNull() && ch < 0)) {
+      sendError(clientNum, "bad_ch");
+      return;
+    }
+    uint8_t first = ch < 0 ? 0 : ch;
+    uint8_t last = ch < 0 ? NUM_SERVOS - 1 : ch;
+
+    const char *typeName = rxDoc["type"].as<const char *>();
+    if (typeName) {
+      FilterType type;
+      if (!filterFromName(typeName, type)) {
+        sendError(clientNum, "bad_filter_type");
+        return;
+      }
+      float minCutoff = rxDoc["min_cutoff"] | 1.0f;
+      float beta = rxDoc["beta"] | 0.0f;
+      float freq = rxDoc["freq"] | 5.0f;
+      int n = rxDoc["n"] | 4;
+      if ((type == FILTER_ONE_EURO && (minCutoff < 0.05f || minCutoff > 30.0f || beta < 0.0f || beta > 10.0f)) ||
+          (type == FILTER_CRITICAL && (freq < 0.2f || freq > 30.0f)) ||
+          (type == FILTER_MA && (n < 1 || n > FILTER_MA_MAX))) {
+        sendError(clientNum, "filter_range");
+        return;
+      }
+      for (uint8_t i = first; i <= last; i++) {
+        InputFilter &f = arm.inFilter[i];
+        if (type == FILTER_ONE_EURO) f.setOneEuro(minCutoff, beta);
+        else if (type == FILTER_CRITICAL) f.setCritical(freq);
+        else if (type == FILTER_MA) f.setMovingAverage((uint8_t)n);
+        else f.setNone();
+      }
+      arm.inputActive = false; // restart at the next sample
+    }
+
+    txDoc.clear();
+    txDoc["ok"] = true;
+    txDoc["arm"] = armIdx;
+    txDoc["interval_ms"] = roundf(inputIntervalMs(arm) * 10.0f) / 10.0f;
+    JsonArray list = txDoc["filters"].to<JsonArray>();
+    for (uint8_t i = first; i <= last; i++) addFilterConfig(list.add<JsonObject>(), arm, i);
+    sendTxDoc(clientNum);
+    return;
+  }
+
+  if (strcmp(cmd, "lag") == 0) {
+    // {"cmd":"lag","ch":0,"dead_ms":20,"tau_ms":80,"max_dps":350} - servo lag model
+    // {"cmd":"lag","mode":"off"|"lead"|"led_delay"} - compensation mode
+    int ch = rxDoc["ch"] | -1;
+    if (ch >= (int)NUM_SERVOS || (!rxDoc["ch"].isNull() && ch < 0)) {
+      sendError(clientNum, "bad_ch");
+      return;
+    }
+    if (ch >= 0) {
+      ServoLagModel m = arm.lagModel[ch];
+      m.deadMs = rxDoc["dead_ms"] | m.deadMs;
+      m.tauMs = rxDoc["tau_ms"] | m.tauMs;
+      m.maxDps = rxDoc["max_dps"] | m.maxDps;
+      if (m.deadMs > (LAG_DEAD_SAMPLES - 1) * SHAPER_SAMPLE_MS || m.tauMs > 1000) {
+        sendError(clientNum, "lag_range_dead_126_tau_1000");
+        return;
+      }
+      arm.lagModel[ch] = m;
+      recomputeLagSteps(arm);
+    }
+
+    const char *modeName = rxDoc["mode"].as<const char *>();
+    if (modeName) {
+      if (strcmp(modeName, "off") == 0) arm.lagMode = LAGCOMP_OFF;
+      else if (strcmp(modeName, "lead") == 0) arm.lagMode = LAGCOMP_LEAD;
+      else if (strcmp(modeName, "led_delay") == 0) arm.lagMode = LAGCOMP_LED_DELAY;
+      else {
+        sendError(clientNum, "bad_lag_mode");
+        return;
+      }
+    }
+
+    static const char *const MODE_NAMES[] = {"off", "lead", "led_delay"};
+    txDoc.clear();
+    txDoc["ok"] = true;
+    txDoc["arm"] = armIdx;
+    txDoc["mode"] = MODE_NAMES[arm.lagMode];
+    txDoc["led_delay_ms"] = ledDelayMs(arm);
+    JsonArray models = txDoc["models"].to<JsonArray>();
+    for (uint8_t i = 0; i < NUM_SERVOS; i++) {
+      JsonObject o = models.add<JsonObject>();
+      o["dead_ms"] = arm.lagModel[i].deadMs;
+      o["tau_ms"] = arm.lagModel[i].tauMs;
+      o["max_dps"] = arm.lagModel[i].maxDps;
+      o["lag_ms"] = lagMs(arm, i);
+    }
+    sendTxDoc(clientNum);
+    return;
+  }
+
+  if (strcmp(cmd, "ringing_test") == 0) {
+    // Step "ch" by "amp" deg in "ms", hold "hold_ms" with the LED on, step back.
+    // The result is sent as {"ringing": true, ...} after the hold.
+    int ch = rxDoc["ch"] | -1;
+    if (ch < 0 || ch >= (int)NUM_SERVOS) {
+      sendError(clientNum, "bad_ch");
+      return;
+    }
+    if (arm.moving || arm.trajectoryMode || ringTest.active) {
+      sendError(clientNum, "busy");
+      return;
+    }
+    const InputShaper &sh = arm.shaper[ch];
+    float freq = rxDoc["freq"] | sh.freqHz();
+    float damping = rxDoc["damping"] | (sh.enabled() ? sh.damping() : 0.05f);
+    if (rxDoc["freq"].isNull() && !sh.enabled()) {
+      sendError(clientNum, "missing_model_freq");
+      return;
+    }
+    if (freq < 2.0f || freq > 50.0f || damping < 0.0f || damping > 0.5f) {
+      sendError(clientNum, "shaper_range_freq_2_50_damping_0_0.5");
+      return;
+    }
+
+    RingingTest &rt = ringTest;
+    rt = RingingTest();
+    rt.arm = armIdx;
+    rt.ch = ch;
+    rt.clientNum = clientNum;
+    rt.freqHz = freq;
+    rt.damping = damping;
+    rt.startDeg = cdegToDeg(arm.currCdeg[ch]);
+    rt.targetDeg = constrain(rt.startDeg + (float)(rxDoc["amp"] | 20.0f), -90.0f, 90.0f);
+    rt.moveMs = constrain((uint32_t)(rxDoc["ms"] | 150), (uint32_t)10, (uint32_t)5000);
+    rt.holdMs = constrain((uint32_t)(rxDoc["hold_ms"] | 800), sh.delayMs() + 100, (uint32_t)5000);
+    rt.raw.reset(cdegToDeg(outputCdeg(arm, ch)));
+    rt.shaped.reset(cdegToDeg(outputCdeg(arm, ch)));
+    rt.active = true;
+
+    int16_t d[NUM_SERVOS];
+    memcpy(d, arm.currCdeg, sizeof(d));
+    d[ch] = degToCdeg(rt.targetDeg);
+    uint8_t ledVal = rxDoc["led"] | 255;
+    startMove(arm, d, rt.moveMs, ledVal, arm.currR, arm.currG, arm.currB);
+    sendOk(clientNum);
+    return;
+  }
+
+  if (strcmp(cmd, "i2c") == 0) {
+    // {"cmd":"i2c","max_hz":400000} - cap the adaptive bus clock (100000/400000/1000000).
+    // Also clears earlier fallbacks, so the bus is probed up to the cap again.
+    if (!rxDoc["max_hz"].isNull()) {
+      uint32_t maxHz = rxDoc["max_hz"].as<uint32_t>();
+      int level = -1;
+      for (uint8_t i = 0; i < I2C_LEVELS; i++) {
+        if (I2C_CLOCKS[i] == maxHz) level = i;
+      }
+      if (level < 0) {
+        sendError(clientNum, "bad_i2c_clock");
+        return;
+      }
+      __atomic_store_n(&i2cMaxLevel, (uint8_t)level, __ATOMIC_RELEASE);
+      __atomic_store_n(&i2cReprobe, true, __ATOMIC_RELEASE);
+    }
+    txDoc.clear();
+    txDoc["ok"] = true;
+    txDoc["clock_hz"] = i2cStats.clockHz;
+    txDoc["max_hz"] = I2C_CLOCKS[i2cMaxLevel];
+    sendTxDoc(clientNum);
+    return;
+  }
+
+  if (strcmp(cmd, "script") == 0) {
+    // Composite command run on the ESP32 (see Script); replaces the arm's running script
+    JsonArray steps = rxDoc["steps"].as<JsonArray>();
+    if (steps.isNull() || steps.size() == 0) {
+      sendError(clientNum, "missing_steps");
+      return;
+    }
+    const char *id = rxDoc["id"] | "script";
+    if (strlen(id) >= SCRIPT_NAME_LEN) {
+      sendError(clientNum, "bad_script_id");
+      return;
+    }
+    static Script next; // parsed aside, so a bad script leaves the running one alone
+    memset(&next, 0, sizeof(next));
+    for (JsonObject step : steps) {
+      const char *err = parseScriptStep(step, (uint8_t)armIdx, next);
+      if (err) {
+        sendError(clientNum, err);
+        return;
+      }
+    }
+    Script &sc = scripts[armIdx];
+    if (sc.running) finishScript(sc, (uint8_t)armIdx, "replaced");
+    memcpy(&sc, &next, sizeof(sc));
+    strcpy(sc.id, id);
+    sc.clientNum = clientNum;
+    sc.startMs = millis();
+    sc.running = true;
+    txDoc.clear();
+    txDoc["ok"] = true;
+    txDoc["script"] = sc.id;
+    txDoc["steps"] = sc.count;
+    sendTxDoc(clientNum);
+    return;
+  }
+
+  if (strcmp(cmd, "script_stop") == 0) {
+    Script &sc = scripts[armIdx];
+    txDoc.clear();
+    txDoc["ok"] = true;
+    txDoc["stopped"] = sc.running;
+    if (sc.running) txDoc["step"] = sc.pc;
+    sc.running = false; // the move in progress finishes on its own
+    sendTxDoc(clientNum);
+    return;
+  }
+
+  if (strcmp(cmd, "event") == 0) {
+    const char *name = rxDoc["name"] | "";
+    txDoc.clear();
+    txDoc["ok"] = true;
+    txDoc["woken"] = scriptEvent(name);
+    sendTxDoc(clientNum);
+    return;
+  }
+
+  if (strcmp(cmd, "stats") == 0) {
+    // Optional "reset": true clears counters of the requesting client after reporting
+    sendStats(clientNum);
+    if (rxDoc["reset"] | false) resetClientStats(clientNum);
     return;
   }
 
+  clientStats[clientNum].unknownCmds++;
   sendError(clientNum, "unknown_cmd");
 }
 
+// ========= Command queue =========
+CmdClass jsonCommandClass(const char *cmd) {
+  static const char *const BACKGROUND[] = {"status", "stats", "config", "freq", "shaper", "filter", "lag", "i2c"};
+  if (strcmp(cmd, "stop") == 0) return CMD_IMMEDIATE;
+  for (const char *name : BACKGROUND) {
+    if (strcmp(cmd, name) == 0) return CMD_BACKGROUND;
+  }
+  return CMD_MOTION;
+}
+
+// Arm a queued JSON command would move, for preemption by "stop"
+uint8_t jsonCommandArm(const char *cmd) {
+  static const char *const MOVES[] = {"home", "frame", "trajectory", "stream_start", "script", "ringing_test"};
+  if (strcmp(cmd, "sync_frame") == 0) return CMD_ANY_ARM;
+  for (const char *name : MOVES) {
+    if (strcmp(cmd, name) == 0) return rxDoc["arm"] | 0;
+  }
+  return CMD_NO_ARM;
+}
+
+QueuedCmd &queuedAt(uint8_t i) { return cmdQueue.slots[(cmdQueue.head + i) % CMD_QUEUE_SLOTS]; }
+
+// Appends a command, or only the answer to one (QUEUED_REPLY). Returns false
+// when the queue is full or the command does not fit a slot.
+bool queueCommand(uint8_t clientNum, CmdClass cls, uint8_t arm, bool binary, const uint8_t *payload, size_t length,
+                  QueuedState state = QUEUED_RUN, const char *err = nullptr) {
+  CmdQueue &q = cmdQueue;
+  if (q.count >= CMD_QUEUE_SLOTS || length >= CMD_QUEUE_BYTES) return false;
+  QueuedCmd &c = queuedAt(q.count);
+  c.clientNum = clientNum;
+  c.cls = cls;
+  c.state = state;
+  c.arm = arm;
+  c.binary = binary;
+  c.len = length;
+  c.queuedMs = millis();
+  c.err = err;
+  if (length) memcpy(c.payload, payload, length);
+  c.payload[length] = 0;
+  q.count++;
+  q.perClient[clientNum]++;
+  q.maxDepth = max(q.maxDepth, q.count);
+  if (state == QUEUED_RUN) {
+    if (cls == CMD_BACKGROUND) q.deferred++;
+    else q.ordered++;
+  }
+  return true;
+}
+
+// Moves entry i out of the queue into out (header and payload only)
+void takeQueued(uint8_t i, QueuedCmd &out) {
+  CmdQueue &q = cmdQueue;
+  QueuedCmd &c = queuedAt(i);
+  memcpy(&out, &c, offsetof(QueuedCmd, payload) + c.len + 1);
+  q.perClient[c.clientNum]--;
+  if (i == 0) {
+    q.head = (q.head + 1) % CMD_QUEUE_SLOTS;
+  } else {
+    for (uint8_t k = i; k + 1 < q.count; k++) {
+      const QueuedCmd &next = queuedAt(k + 1);
+      memcpy(&queuedAt(k), &next, offsetof(QueuedCmd, payload) + next.len + 1);
+    }
+  }
+  q.count--;
+}
+
+void runQueued(const QueuedCmd &c) {
+  cmdQueue.maxWaitMs = max(cmdQueue.maxWaitMs, millis() - c.queuedMs);
+  if (c.state == QUEUED_RUN) {
+    if (c.binary) {
+      runBinaryCommand(c.clientNum, c.payload, c.len);
+    } else {
+      rxDoc.clear();
+      deserializeJson(rxDoc, (const char *)c.payload); // parsed fine on arrival
+      runJsonCommand(c.clientNum);
+    }
+    return;
+  }
+  const char *err = c.state == QUEUED_PREEMPTED ? "preempted" : c.err;
+  if (c.binary) sendBinAck(c.clientNum, err);
+  else if (err) sendError(c.clientNum, err);
+  else sendOk(c.clientNum);
+}
+
+// Runs everything a client has queued, in order. Used when its next command
+// cannot be queued, so that one can run right away without overtaking.
+void drainClient(uint8_t clientNum) {
+  cmdQueue.overflows++;
+  for (uint8_t i = 0; i < cmdQueue.count;) {
+    if (queuedAt(i).clientNum != clientNum) {
+      i++;
+      continue;
+    }
+    takeQueued(i, queuedNow);
+    runQueued(queuedNow);
+  }
+}
+
+// Commands of a client that went away are dropped, motion ones included: a
+// client that queues a move and disconnects in the same webSocket.loop() pass
+// gets no reply and nothing is logged. This is on purpose - there is nobody
+// to answer, and a move the client can no longer watch or stop must not run
+void dropClientCommands(uint8_t clientNum) {
+  for (uint8_t i = 0; i < cmdQueue.count;) {
+    if (queuedAt(i).clientNum == clientNum) takeQueued(i, queuedNow);
+    else i++;
+  }
+}
+
+// Queued commands, after the motion tick and outputs of this loop pass
+void runCommandQueue() {
+  uint8_t budget = load.level > 0 ? 1 : CMD_QUEUE_SLOTS;
+  while (cmdQueue.count > 0 && budget-- > 0) {
+    takeQueued(0, queuedNow);
+    runQueued(queuedNow);
+  }
+}
+
+// Answers now, or behind the client's queued commands
+void replyInOrder(uint8_t clientNum, bool binary, const char *err) {
+  if (cmdQueue.perClient[clientNum] > 0) {
+    if (queueCommand(clientNum, CMD_IMMEDIATE, CMD_NO_ARM, binary, nullptr, 0, QUEUED_REPLY, err)) return;
+    drainClient(clientNum);
+  }
+  if (binary) sendBinAck(clientNum, err);
+  else if (err) sendError(clientNum, err);
+  else sendOk(clientNum);
+}
+
+// The arm holds where it is (its shaped output settles there); trajectory,
+// stream, script and ringing test end, the LED goes to `led` and queued moves
+// for the arm are preempted
+void stopArm(uint8_t k, uint8_t led) {
+  Arm &a = arms[k];
+  cancelTrajectory(a);
+  a.streamMode = false;
+  if (scripts[k].running) finishScript(scripts[k], k, "stopped");
+  if (ringTest.active && ringTest.arm == k) ringTest.active = false;
+  if (a.moving) {
+    a.moving = false;
+    a.blendDurMs = 0;
+    a.outputSettleUntilMs = millis() + outputTailMs(a) + updateDtMs;
+  }
+  setLed(a, led);
+
+  for (uint8_t i = 0; i < cmdQueue.count; i++) {
+    QueuedCmd &c = queuedAt(i);
+    if (c.state != QUEUED_RUN || (c.arm != k && c.arm != CMD_ANY_ARM)) continue;
+    c.state = QUEUED_PREEMPTED;
+    cmdQueue.preempted++;
+  }
+}
+
+// {"cmd":"stop"} / {"cmd":"stop","arm":1} / {"cmd":"stop","all":true}, optional "led" (default 0)
+void runStop(uint8_t clientNum) {
+  cmdQueue.immediate++;
+  int armIdx = rxDoc["arm"] | 0;
+  uint8_t led = rxDoc["led"] | 0;
+  const char *err = nullptr;
+  if (rxDoc["all"] | false) {
+    for (uint8_t k = 0; k < NUM_ARMS; k++) stopArm(k, led);
+  } else if (armIdx < 0 || armIdx >= (int)NUM_ARMS) {
+    err = "bad_arm";
+  } else {
+    stopArm((uint8_t)armIdx, led);
+  }
+  replyInOrder(clientNum, false, err);
+}
+
+void handleJsonMessage(uint8_t clientNum, const char *payload, size_t length) {
+  rxDoc.clear();
+  if (deserializeJson(rxDoc, payload)) {
+    clientStats[clientNum].parseErrors++;
+    replyInOrder(clientNum, false, "bad_json");
+    return;
+  }
+  // Stream samples and rt_frame have no reply: never queued
+  const char *cmd = rxDoc["cmd"] | "";
+  if ((rxDoc.is<JsonArray>() && anyStreaming()) || strcmp(cmd, "rt_frame") == 0) {
+    cmdQueue.direct++;
+    runJsonCommand(clientNum);
+    return;
+  }
+  CmdClass cls = jsonCommandClass(cmd);
+  if (cls == CMD_IMMEDIATE) {
+    runStop(clientNum);
+    return;
+  }
+  if (cls == CMD_BACKGROUND || cmdQueue.perClient[clientNum] > 0) {
+    if (queueCommand(clientNum, cls, jsonCommandArm(cmd), false, (const uint8_t *)payload, length)) return;
+    drainClient(clientNum);
+    rxDoc.clear();
+    deserializeJson(rxDoc, payload);
+  }
+  cmdQueue.direct++;
+  runJsonCommand(clientNum);
+}
+
+void handleBinaryMessage(uint8_t clientNum, const uint8_t *payload, size_t length) {
+  uint8_t id = proto::messageId(payload, length);
+  CmdClass cls = id == proto::CMD_STATUS ? CMD_BACKGROUND : CMD_MOTION;
+  if (id != proto::CMD_RT_FRAME && (cls == CMD_BACKGROUND || cmdQueue.perClient[clientNum] > 0)) {
+    uint8_t arm = (id == proto::CMD_HOME || id == proto::CMD_FRAME) ? CMD_ANY_ARM : CMD_NO_ARM;
+    if (queueCommand(clientNum, cls, arm, true, payload, length)) return;
+    drainClient(clientNum);
+  }
+  cmdQueue.direct++;
+  runBinaryCommand(clientNum, payload, length);
+}
+
 void onWebSocketEvent(uint8_t num, WStype_t type, uint8_t * payload, size_t length) {
+  if (num >= WEBSOCKETS_SERVER_CLIENT_MAX) return;
+  mem.phase = MEM_APP; // our handlers, called from inside webSocket.loop()
+  ClientStats &cs = clientStats[num];
+  if (type != WStype_DISCONNECTED) cs.lastActivityMs = millis();
+
   switch(type) {
     case WStype_DISCONNECTED:
-      Serial.printf("Client[%u] disconnected\n", num);
+      Serial.printf("Client[%u] disconnected (rx %u msgs, tx %u msgs, %u errors)\n", num,
+                    (unsigned)cs.rxMsgs, (unsigned)cs.txMsgs,
+                    (unsigned)(cs.parseErrors + cs.unknownCmds));
+      cs.connected = false;
+      dropClientCommands(num);
       break;
       
     case WStype_CONNECTED: {
+      memset(&cs, 0, sizeof(cs));
+      cs.connected = true;
+      cs.connectedMs = millis();
+      cs.lastActivityMs = cs.connectedMs;
+
       IPAddress ip = webSocket.remoteIP(num);
       Serial.printf("Client[%u] connected from %d.%d.%d.%d\n", num, ip[0], ip[1], ip[2], ip[3]);
       
       // Send welcome message
       txDoc.clear();
       txDoc["ready"] = true;
+      txDoc["client_id"] = num;
       txDoc["servos"] = NUM_SERVOS;
-      txDoc["wifi_ip"] = WiFi.softAPIP().toString();
+      txDoc["arms"] = NUM_ARMS;
+      txDoc["proto"] = proto::VERSION; // binary frames, see protocol_gen.h
+      char apIp[16];
+      formatIp(WiFi.softAPIP(), apIp, sizeof(apIp));
+      txDoc["wifi_ip"] = apIp;
       JsonArray modes = txDoc["modes"].to<JsonArray>();
       modes.add("frame");        // Standard frame with response
       modes.add("rt_frame");     // Real-time frame (fire-and-forget)
       modes.add("trajectory");   // Buffered trajectory
       modes.add("stream_start"); // Stream mode
       modes.add("stream_stop");  // Stop stream
-      String welcome;
-      serializeJson(txDoc, welcome);
-      webSocket.sendTXT(num, welcome);
+      modes.add("stats");        // Per-client traffic counters
+      modes.add("shaper");       // Input shaping per joint
+      modes.add("ringing_test"); // Step response ringing measurement
+      modes.add("lag");          // Servo lag model and compensation
+      modes.add("sync_frame");   // Synchronized frame for several arms
+      modes.add("i2c");          // I2C bus clock cap
+      modes.add("filter");       // Stream/rt_frame input filters
+      modes.add("script");       // Composite commands run on the ESP32
+      modes.add("stop");         // Immediate stop, ahead of queued commands
+      sendTxDoc(num);
       break;
     }
     
     case WStype_TEXT:
-      Serial.printf("Client[%u] sent: %s\n", num, payload);
-      handleJsonMessage(num, (char*)payload);
+      cs.rxMsgs++;
+      cs.rxBytes += length;
+#if ROBOARM_STATIC_MEMORY
+      // Print::printf goes to the heap past 64 characters
+      if (load.level == 0) Serial.printf("Client[%u] sent: %.40s\n", num, payload);
+#else
+      if (load.level == 0) Serial.printf("Client[%u] sent: %s\n", num, payload);
+#endif
+      else load.logsDropped++;
+      handleJsonMessage(num, (char*)payload, length);
       break;
       
     case WStype_BIN:
-      Serial.printf("Client[%u] sent binary data (%u bytes)\n", num, length);
+      cs.rxMsgs++;
+      cs.rxBytes += length;
+      if (load.level == 0) Serial.printf("Client[%u] sent binary data (%u bytes)\n", num, (unsigned)length);
+      else load.logsDropped++;
+      handleBinaryMessage(num, payload, length);
       break;
       
     default:
       break;
   }
+  mem.phase = MEM_WS;
+}
+
+// ========= Allocator hooks =========
+#if ROBOARM_STATIC_MEMORY
+extern "C" {
+void *__real_malloc(size_t n);
+void *__real_calloc(size_t count, size_t n);
+void *__real_realloc(void *p, size_t n);
+}
+
+// Other tasks (WiFi, lwIP) allocate all the time and are only tallied
+void noteHeapAlloc(size_t n, void *caller) {
+  static thread_local bool inHook = false; // the host's task lookup may allocate
+  if (!mem.armed || inHook) return;
+  inHook = true;
+  bool onLoop = xTaskGetCurrentTaskHandle() == loopTask;
+  inHook = false;
+  if (!onLoop) {
+    __atomic_fetch_add(&mem.otherAllocs, 1, __ATOMIC_RELAXED);
+  } else if (mem.phase == MEM_WS) {
+    mem.wsAllocs++;
+    mem.wsBytes += n;
+  } else {
+    mem.appAllocs++;
+    mem.appBytes += n;
+    mem.lastSize = n;
+    mem.lastCaller = (uintptr_t)caller;
+  }
+}
+
+extern "C" void *__wrap_malloc(size_t n) {
+  noteHeapAlloc(n, __builtin_return_address(0));
+  return __real_malloc(n);
+}
+
+extern "C" void *__wrap_calloc(size_t count, size_t n) {
+  noteHeapAlloc(count * n, __builtin_return_address(0));
+  return __real_calloc(count, n);
+}
+
+extern "C" void *__wrap_realloc(void *p, size_t n) {
+  if (n) noteHeapAlloc(n, __builtin_return_address(0));
+  return __real_realloc(p, n);
+}
+#endif
+
+// ========= Idle power management =========
+void onWifiEvent(arduino_event_id_t event) {
+  (void)event;
+  xTaskNotifyGive(loopTask); // a station (dis)associated: end the idle wait now
+}
+
+// Blocks while idle until a notification or IDLE_POLL_MS
+void idleWait() {
+  if (!power.idle) return;
+  uint32_t t0 = micros();
+  bool notified = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(IDLE_POLL_MS)) > 0;
+  power.wokeUs = micros();
+  power.blockedUs += power.wokeUs - t0;
+  if (notified) flushOutputs(); // the notification may have been a finished burst with failed channels
+}
+
+bool loopBusy() {
+  if (motionActive || ringTest.active || anyStreaming() || anyScriptRunning() || cmdQueue.count > 0) return true;
+  for (uint8_t k = 0; k < NUM_BOARDS; k++) {
+    if (boardOut[k].dirty || __atomic_load_n(&boardOut[k].busy, __ATOMIC_ACQUIRE)) return true;
+  }
+  return false;
+}
+
+// Runs right after the network is serviced, so a move started by a command
+// that arrived while idle is already interpolated and sent at full clock
+void updateIdle() {
+  uint32_t now = millis();
+  if (loopBusy()) power.lastBusyMs = now;
+  for (uint8_t i = 0; i < WEBSOCKETS_SERVER_CLIENT_MAX; i++) {
+    const ClientStats &cs = clientStats[i];
+    if (cs.connected && (int32_t)(cs.lastActivityMs - power.lastBusyMs) > 0) power.lastBusyMs = cs.lastActivityMs;
+  }
+  bool busy = now - power.lastBusyMs < IDLE_ENTER_MS;
+  if (power.idle && busy) {
+    uint32_t t0 = micros();
+    setCpuFrequencyMhz(power.fullMhz);
+    power.lastRampUs = micros() - t0;
+    power.maxRampUs = max(power.maxRampUs, power.lastRampUs);
+    power.idle = false;
+    power.wakes++;
+    power.wakePending = true;
+  } else if (!power.idle && !busy) {
+    setCpuFrequencyMhz(IDLE_CPU_MHZ);
+    power.idle = true;
+    power.entries++;
+  }
 }
 
 void setup() {
@@ -597,34 +3212,58 @@ void setup() {
   Serial.println("Starting ESP32 RoboArm with WiFi and WebSocket...");
 
   // Initialize I2C and PCA9685
-  Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
-  Serial.printf("I2C uruchomiony: SDA=%d, SCL=%d\n", I2C_SDA_PIN, I2C_SCL_PIN);
-
-  // Initialize PCA9685
-  pca.begin();
-  pca.setOscillatorFrequency(27000000);
-  pca.setPWMFreq(SERVO_HZ); // 50 Hz
-  delay(10);
-
-  // Initialize LED on PCA9685 channel 15
-  setLed(0);
+  Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN, I2C_CLOCKS[I2C_START_LEVEL]);
+  i2cClock.level = I2C_START_LEVEL;
+  i2cClock.ceiling = I2C_MAX_LEVEL;
+  i2cStats.clockHz = I2C_CLOCKS[I2C_START_LEVEL];
+  Serial.printf("I2C uruchomiony: SDA=%d, SCL=%d, %u Hz\n", I2C_SDA_PIN, I2C_SCL_PIN,
+                (unsigned)I2C_CLOCKS[I2C_START_LEVEL]);
+
+  // Output bursts: queue + I2C task on the loop's core, above the loop's priority
+  loopTask = xTaskGetCurrentTaskHandle();
+  i2cQueue = xQueueCreate(2 * NUM_BOARDS, sizeof(I2cBurst));
+  xTaskCreatePinnedToCore(i2cTask, "i2c_out", 3072, nullptr, 2, nullptr, 1);
+
+  // Initialize PCA9685 boards
+  for (uint8_t k = 0; k < NUM_BOARDS; k++) {
+    pca[k] = new Adafruit_PWMServoDriver(PCA9685_ADDR[k]);
+    pca[k]->begin();
+    pca[k]->setOscillatorFrequency(PCA9685_OSC_HZ);
+    setPwmFreq(k, SERVO_HZ); // 50 Hz
+    Serial.printf("PCA9685 #%u at 0x%02x\n", k, PCA9685_ADDR[k]);
+  }
 
   // Initialize RGB LED
   rgbLed.begin();
   rgbLed.setBrightness(50); // Not too bright
-  setRgbLed(0, 0, 0); // Start with LED off
+
+  for (Arm &a : arms) {
+    memcpy(a.servoCfg, DEFAULT_SERVO_CFG, sizeof(a.servoCfg));
+    memcpy(a.lagModel, DEFAULT_LAG_MODEL, sizeof(a.lagModel));
+    recomputeLagSteps(a);
+    recomputeTicks(a);
+    setLed(a, 0);           // LED channel (15) off
+    setRgbLed(a, 0, 0, 0);  // Start with LED off
+    resetLagEstimate(a);
+  }
 
   // Initialize servos at center (0 deg -> 1.5 ms)
   applyAllOutputs();
 
-  // Setup WiFi Access Point
+  // Setup WiFi Access Point (optionally on the quietest channel)
+  uint8_t apChannel = pickApChannel();
   WiFi.mode(WIFI_AP);
   WiFi.softAPConfig(AP_IP, AP_GATEWAY, AP_SUBNET);
-  WiFi.softAP(AP_SSID, AP_PASS);
+  WiFi.softAP(AP_SSID, AP_PASS, apChannel);
+  sampleWifiTelemetry();
+  WiFi.onEvent(onWifiEvent, ARDUINO_EVENT_WIFI_AP_STACONNECTED);
+  power.fullMhz = getCpuFrequencyMhz();
+  power.lastBusyMs = millis();
   
   Serial.println("WiFi AP started");
   Serial.print("AP SSID: ");
   Serial.println(AP_SSID);
+  Serial.printf("AP channel: %u\n", wifiTel.channel);
   Serial.print("AP IP: ");
   Serial.println(WiFi.softAPIP());
 
@@ -635,14 +3274,53 @@ void setup() {
   Serial.println(WS_PORT);
 
   // Welcome RGB animation
-  setRgbLed(0, 255, 0); // Green = ready
+  for (Arm &a : arms) setRgbLed(a, 0, 255, 0); // Green = ready
   delay(500);
-  setRgbLed(0, 0, 0); // Off
+  for (Arm &a : arms) setRgbLed(a, 0, 0, 0); // Off
   
   Serial.println("Setup complete - ready for WebSocket connections");
+  mem.armed = true;
+}
+
+void updateLoadShedding(uint32_t loopUs) {
+  uint32_t now = millis();
+  load.loops++;
+  load.lastLoopUs = loopUs;
+  load.maxLoopUs = max(load.maxLoopUs, loopUs);
+  if (loopUs > updateDtMs * 1000) {
+    load.overruns++;
+    load.lastOverrunMs = now;
+    if (load.level < SHED_MAX_LEVEL) {
+      load.level++;
+      load.escalations++;
+    }
+  } else if (load.level > 0 && now - load.lastOverrunMs >= SHED_RECOVER_MS) {
+    load.level--;
+    load.lastOverrunMs = now; // one step per recovery period
+  }
 }
 
 void loop() {
+  idleWait();
+  uint32_t t0 = micros();
+  mem.phase = MEM_WS;
   webSocket.loop();
+  mem.phase = MEM_APP;
+  updateIdle();
   updateMotion();
+  updateScripts();
+  updateRingingTest();
+  runCommandQueue();
+  updateWifiTelemetry();
+  updateStatusPush();
+  // Output caused by the wake: the first motion tick lands within one tick of it
+  if (power.wakePending && micros() - power.wokeUs > 2 * updateDtMs * 1000) power.wakePending = false;
+  updateLoadShedding(micros() - t0);
+#if ROBOARM_STATIC_MEMORY
+  if (mem.appAllocs && !mem.logged) {
+    mem.logged = true;
+    Serial.printf("Heap alloc after setup: %u B at 0x%08lx\n", (unsigned)mem.lastSize,
+                  (unsigned long)mem.lastCaller);
+  }
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+"""
+Porównanie czasu: obraz -> ścieżki w Pythonie (ImageProcessor, tryb automatyczny)
+i w C++ (host/imagepath, roboarm_imagepath) na tym samym obrazie.
+
+    python test-esp/bench_imagepath.py                 # syntetyczny obraz 4000x3000
+    python test-esp/bench_imagepath.py obraz.png --repeat 3 --threads 1
+
+Python: szarość -> GaussianBlur 5x5 -> Canny 50/150 -> process_edges_with_interpolation.
+C++: czas potoku podany przez program (--repeat, najlepszy przebieg) oraz czas całego
+wywołania (wczytanie obrazu, zapis JSON), tak jak woła go symulator.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+import cv2 as cv
+import numpy as np
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+sys.path.insert(0, ROOT)
+from light_painting_simulator import ImageProcessor  # noqa: E402
+
+
+def synthetic_image(width, height, shapes=400, seed=1):
+    """Losowe wypełnione elipsy i prostokąty w kolorze na ciemnym tle"""
+    rng = np.random.default_rng(seed)
+    img = np.full((height, width, 3), 20, np.uint8)
+    for _ in range(shapes):
+        color = tuple(int(c) for c in rng.integers(60, 256, 3))
+        x, y = int(rng.integers(0, width)), int(rng.integers(0, height))
+        a, b = int(rng.integers(10, width // 12)), int(rng.integers(10, height // 12))
+        if rng.random() < 0.5:
+            cv.ellipse(img, (x, y), (a, b), float(rng.integers(0, 180)), 0, 360, color, -1)
+        else:
+            cv.rectangle(img, (x, y), (x + a, y + b), color, -1)
+    return img
+
+
+def bench_python(image, repeat):
+    proc = ImageProcessor()
+    proc.current_image = image
+    best, paths = None, []
+    for _ in range(repeat):
+        t0 = time.perf_counter()
+        gray = cv.cvtColor(image, cv.COLOR_BGR2GRAY)
+        blurred = cv.GaussianBlur(gray, (5, 5), 0)
+        edges = cv.Canny(blurred, 50, 150)
+        paths, _ = proc.process_edges_with_interpolation(edges, target_point_density=3.0)
+        dt = time.perf_counter() - t0
+        best = dt if best is None else min(best, dt)
+    return best, len(paths), sum(len(p) for p in paths)
+
+
+def bench_native(tool, image_path, repeat, threads):
+    # Czas całego wywołania (jeden przebieg) i najlepszy czas potoku z --repeat
+    t0 = time.perf_counter()
+    subprocess.run([tool, image_path, "--pixels", "--threads", str(threads)],
+                   capture_output=True, check=True)
+    call = time.perf_counter() - t0
+    out = subprocess.run([tool, image_path, "--pixels", "--threads", str(threads), "--repeat", str(repeat)],
+                         capture_output=True, text=True, check=True)
+    m = re.search(r"(\d+) paths, (\d+) points in ([\d.]+) ms", out.stderr)
+    if not m:
+        raise RuntimeError(f"nieoczekiwany wynik roboarm_imagepath: {out.stderr.strip()}")
+    return call, float(m.group(3)) / 1000.0, int(m.group(1)), int(m.group(2))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Python vs C++: obraz -> ścieżki")
+    parser.add_argument("image", nargs="?", help="obraz (domyślnie syntetyczny)")
+    parser.add_argument("--size", default="4000x3000", help="rozmiar obrazu syntetycznego")
+    parser.add_argument("--repeat", type=int, default=3)
+    parser.add_argument("--threads", type=int, default=1, help="wątki C++ (0 = wszystkie rdzenie)")
+    parser.add_argument("--tool", default=os.environ.get("ROBOARM_IMAGEPATH", os.path.join(
+        ROOT, "host", "build", "imagepath", "roboarm_imagepath")))
+    args = parser.parse_args()
+
+    if args.image:
+        image = cv.imread(args.image)
+        if image is None:
+            sys.exit(f"Nie można wczytać {args.image}")
+    else:
+        w, h = (int(v) for v in args.size.lower().split("x"))
+        image = synthetic_image(w, h)
+    print(f"Obraz {image.shape[1]}x{image.shape[0]}, najlepszy z {args.repeat} przebiegów")
+
+    py, py_paths, py_points = bench_python(image, args.repeat)
+    print(f"Python: {py * 1000:8.1f} ms  ({py_paths} ścieżek, {py_points} punktów)")
+
+    if not os.path.exists(args.tool):
+        sys.exit(f"Brak {args.tool} - zbuduj host/ (cmake) albo ustaw ROBOARM_IMAGEPATH")
+    with tempfile.NamedTemporaryFile(suffix=".ppm", delete=False) as f:
+        ppm = f.name
+    try:
+        cv.imwrite(ppm, image)
+        call, pipeline, paths, points = bench_native(args.tool, ppm, args.repeat, args.threads)
+    finally:
+        os.unlink(ppm)
+    print(f"C++:    {pipeline * 1000:8.1f} ms  ({paths} ścieżek, {points} punktów, wątki: {args.threads})")
+    print(f"C++ z wywołaniem programu: {call * 1000:.1f} ms")
+    print(f"Przyspieszenie: x{py / pipeline:.1f} (potok), x{py / call:.1f} (z wywołaniem)")
+
+
+if __name__ == "__main__":
+    main()
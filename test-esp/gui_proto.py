@@ -1,6 +1,7 @@
 import tkinter as tk
 from tkinter import ttk, messagebox
 import json
+import os
 import asyncio
 import threading
 import time
@@ -26,8 +27,8 @@ COMMANDS = {
     "stream_stop": {},
 }
 
-HOST = "192.168.4.1"
-PORT = 81
+HOST = os.environ.get("ROBOARM_HOST", "192.168.4.1")
+PORT = int(os.environ.get("ROBOARM_PORT", "81"))
 
 class WebSocketClient:
     def __init__(self, host, port, output_callback, connection_callback):
@@ -446,7 +447,7 @@ class App(tk.Tk):
         help_texts = {
             "ms": "Czas wykonania ruchu",
             "val": "Jasność LED",
-            "hz": "40-60 Hz dla serw",
+            "hz": "40-60 Hz (analogowe), 200-330 Hz (cyfrowe)",
             "ch": "Numer serwa",
             "min_us": "Minimalna szerokość impulsu",
             "max_us": "Maksymalna szerokość impulsu",
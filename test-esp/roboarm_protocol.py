@@ -0,0 +1,289 @@
+# Generated by protocol/gen_protocol.py from protocol/roboarm_protocol.json - do not edit.
+"""Protokół RoboArm: buildery poleceń JSON i kodek binarny (ten sam schemat co firmware).
+
+    import roboarm_protocol as proto
+    ws.send(json.dumps(proto.frame([10, 0, 0, 0, 0], ms=200)))
+    ws.send(proto.encode_bin("rt_frame", {"deg": [10, 0, 0, 0, 0]}))  # ramka BIN
+"""
+
+import json
+import struct
+
+VERSION = 1
+CONSTANTS = {'SERVOS': 5, 'ERR_LEN': 31, 'NAME_LEN': 15}
+TYPES = {'color': {'doc': 'RGB LED colour; missing components keep their current value',
+           'fields': [{'name': 'r', 'type': 'u8', 'optional': True},
+                      {'name': 'g', 'type': 'u8', 'optional': True},
+                      {'name': 'b', 'type': 'u8', 'optional': True}]},
+ 'wifi_summary': {'doc': 'Compact soft AP link summary',
+                  'fields': [{'name': 'ch', 'type': 'u8'},
+                             {'name': 'sta', 'type': 'u8'},
+                             {'name': 'rssi_min', 'type': 'i8', 'optional': True}]}}
+COMMANDS = {'ping': {'id': 1, 'doc': 'Round trip check, answered with pong'},
+ 'home': {'id': 2,
+          'doc': 'Move all joints to 0 deg',
+          'fields': [{'name': 'arm', 'type': 'u8', 'default': 0},
+                     {'name': 'ms', 'type': 'u32', 'default': 800},
+                     {'name': 'led', 'type': 'u8', 'optional': True},
+                     {'name': 'rgb', 'type': 'color', 'optional': True}]},
+ 'led': {'id': 3,
+         'doc': 'Set the LED channel directly',
+         'fields': [{'name': 'arm', 'type': 'u8', 'default': 0},
+                    {'name': 'val', 'type': 'u8', 'error': 'led_range_0_255'}]},
+ 'rgb': {'id': 4,
+         'doc': 'Set the RGB LED directly',
+         'fields': [{'name': 'arm', 'type': 'u8', 'default': 0},
+                    {'name': 'r', 'type': 'u8', 'error': 'rgb_range_0_255'},
+                    {'name': 'g', 'type': 'u8', 'error': 'rgb_range_0_255'},
+                    {'name': 'b', 'type': 'u8', 'error': 'rgb_range_0_255'}]},
+ 'frame': {'id': 5,
+           'doc': 'Move to deg (-90..+90, missing joints hold) in ms, acknowledged',
+           'fields': [{'name': 'arm', 'type': 'u8', 'default': 0},
+                      {'name': 'deg',
+                       'type': 'f32',
+                       'count': 'SERVOS',
+                       'min': 1,
+                       'error': 'missing_deg'},
+                      {'name': 'ms', 'type': 'u32', 'default': 100},
+                      {'name': 'led', 'type': 'u8', 'optional': True},
+                      {'name': 'rgb', 'type': 'color', 'optional': True}]},
+ 'rt_frame': {'id': 6,
+              'doc': 'Like frame, fire-and-forget (no reply), through the input filters',
+              'fields': [{'name': 'arm', 'type': 'u8', 'default': 0},
+                         {'name': 'deg',
+                          'type': 'f32',
+                          'count': 'SERVOS',
+                          'min': 1,
+                          'error': 'missing_deg'},
+                         {'name': 'ms', 'type': 'u32', 'default': 50},
+                         {'name': 'led', 'type': 'u8', 'optional': True},
+                         {'name': 'rgb', 'type': 'color', 'optional': True}]},
+ 'status': {'id': 7,
+            'doc': 'Request a status report',
+            'fields': [{'name': 'arm', 'type': 'u8', 'default': 0}]}}
+REPLIES = {'pong': {'id': 129, 'tag': 'pong', 'doc': 'Answer to ping'},
+ 'ack': {'id': 130,
+         'doc': 'Result of a command without its own reply',
+         'fields': [{'name': 'ok', 'type': 'bool'},
+                    {'name': 'err', 'type': 'str', 'max': 'ERR_LEN', 'optional': True}]},
+ 'status': {'id': 131,
+            'tag': 'status',
+            'doc': 'Arm state',
+            'fields': [{'name': 'arm', 'type': 'u8'},
+                       {'name': 'moving', 'type': 'bool'},
+                       {'name': 'angles', 'type': 'f32', 'count': 'SERVOS'},
+                       {'name': 'led', 'type': 'u8'},
+                       {'name': 'rgb', 'type': 'color'},
+                       {'name': 'trajectory_mode', 'type': 'bool'},
+                       {'name': 'trajectory_points', 'type': 'u8'},
+                       {'name': 'trajectory_index', 'type': 'u8'},
+                       {'name': 'stream_mode', 'type': 'bool'},
+                       {'name': 'stream_freq', 'type': 'u32'},
+                       {'name': 'est_deg', 'type': 'f32', 'count': 'SERVOS'},
+                       {'name': 'script', 'type': 'str', 'max': 'NAME_LEN', 'optional': True},
+                       {'name': 'script_step', 'type': 'u8', 'optional': True},
+                       {'name': 'wifi', 'type': 'wifi_summary'}]}}
+
+
+class ProtocolError(ValueError):
+    """Invalid message; code is the error string the firmware would send."""
+
+    def __init__(self, code):
+        super().__init__(code)
+        self.code = code
+
+
+_INT_RANGE = {
+    "u8": (0, 255), "i8": (-128, 127), "u16": (0, 65535), "i16": (-32768, 32767),
+    "u32": (0, 2**32 - 1), "i32": (-2**31, 2**31 - 1),
+}
+_PACK = {"bool": "?", "u8": "B", "i8": "b", "u16": "H", "i16": "h", "u32": "I", "i32": "i", "f32": "f"}
+_BY_ID = {m["id"]: (kind, name) for kind, table in (("command", COMMANDS), ("reply", REPLIES))
+          for name, m in table.items()}
+
+
+def _const(v):
+    return CONSTANTS[v] if isinstance(v, str) else v
+
+
+def _prim(t, value, bad):
+    if t == "bool":
+        if not isinstance(value, bool):
+            raise ProtocolError(bad)
+        return value
+    if isinstance(value, bool) or not isinstance(value, (int, float)):
+        raise ProtocolError(bad)
+    if t == "f32":
+        return float(value)
+    if isinstance(value, float) and not value.is_integer():
+        raise ProtocolError(bad)
+    lo, hi = _INT_RANGE[t]
+    if not lo <= value <= hi:
+        raise ProtocolError(bad)
+    return int(value)
+
+
+def _check(fields, msg):
+    """Validates msg like the firmware JSON decoder; returns a normalized copy."""
+    out = {}
+    for f in fields:
+        name, t = f["name"], f["type"]
+        missing = f.get("error", "missing_" + name)
+        bad = f.get("error", "bad_" + name)
+        if msg.get(name) is None:
+            if f.get("optional"):
+                continue
+            if "default" in f:
+                out[name] = f["default"]
+                continue
+            raise ProtocolError(missing)
+        value = msg[name]
+        if t == "str":
+            if not isinstance(value, str) or len(value.encode()) > _const(f["max"]):
+                raise ProtocolError(bad)
+        elif "count" in f:
+            if not isinstance(value, (list, tuple)):
+                raise ProtocolError(bad)
+            value = [_prim(t, v, bad) for v in value[:_const(f["count"])]]
+            if len(value) < f.get("min", 0):
+                raise ProtocolError(missing)
+        elif t in _PACK:
+            value = _prim(t, value, bad)
+        else:
+            if not isinstance(value, dict):
+                raise ProtocolError(bad)
+            value = _check(TYPES[t]["fields"], value)
+        out[name] = value
+    return out
+
+
+def build(name, **fields):
+    """Command dict ready for json.dumps; None values are left out."""
+    spec = COMMANDS[name]
+    msg = _check(spec.get("fields", []), {k: v for k, v in fields.items() if v is not None})
+    return {"cmd": name, **msg}
+
+
+def encode_json(name, **fields):
+    return json.dumps(build(name, **fields), separators=(",", ":"))
+
+
+def _encode_fields(fields, msg, out):
+    opts = [f for f in fields if f.get("optional")]
+    mask = 0
+    for i, f in enumerate(opts):
+        if msg.get(f["name"]) is not None:
+            mask |= 1 << i
+    out += mask.to_bytes((len(opts) + 7) // 8, "little")
+    for f in fields:
+        value = msg.get(f["name"])
+        if f.get("optional") and value is None:
+            continue
+        t = f["type"]
+        if t == "str":
+            data = value.encode()
+            out += struct.pack("<B", len(data)) + data
+        elif "count" in f:
+            out += struct.pack("<B%d%s" % (len(value), _PACK[t]), len(value), *value)
+        elif t in _PACK:
+            out += struct.pack("<" + _PACK[t], value)
+        else:
+            _encode_fields(TYPES[t]["fields"], value, out)
+
+
+def encode_bin(name, msg, reply=False):
+    """Binary frame of a command (or reply) dict, validated first."""
+    spec = (REPLIES if reply else COMMANDS)[name]
+    msg = _check(spec.get("fields", []), {k: v for k, v in msg.items() if v is not None})
+    out = bytearray([spec["id"]])
+    _encode_fields(spec.get("fields", []), msg, out)
+    return bytes(out)
+
+
+def _decode_fields(fields, data, pos):
+    opts = [f for f in fields if f.get("optional")]
+    nmask = (len(opts) + 7) // 8
+    mask = int.from_bytes(data[pos:pos + nmask], "little")
+    pos += nmask
+    out = {}
+    for f in fields:
+        if f.get("optional") and not mask & (1 << opts.index(f)):
+            continue
+        t = f["type"]
+        if t == "str":
+            n = data[pos]
+            out[f["name"]] = data[pos + 1:pos + 1 + n].decode()
+            pos += 1 + n
+        elif "count" in f:
+            n = data[pos]
+            fmt = "<%d%s" % (n, _PACK[t])
+            out[f["name"]] = list(struct.unpack_from(fmt, data, pos + 1))
+            pos += 1 + struct.calcsize(fmt)
+        elif t in _PACK:
+            fmt = "<" + _PACK[t]
+            out[f["name"]] = struct.unpack_from(fmt, data, pos)[0]
+            pos += struct.calcsize(fmt)
+        else:
+            out[f["name"]], pos = _decode_fields(TYPES[t]["fields"], data, pos)
+    return out, pos
+
+
+def decode_bin(data):
+    """(kind, name, dict) of a binary frame; kind is "command" or "reply"."""
+    try:
+        kind, name = _BY_ID[data[0]]
+        spec = (COMMANDS if kind == "command" else REPLIES)[name]
+        msg, pos = _decode_fields(spec.get("fields", []), data, 1)
+    except (KeyError, IndexError, struct.error, UnicodeDecodeError):
+        raise ProtocolError("bad_binary")
+    if pos != len(data):
+        raise ProtocolError("bad_binary")
+    return kind, name, msg
+
+
+def reply_name(msg):
+    """Name of the schema reply a JSON reply dict is, or None."""
+    for name, spec in REPLIES.items():
+        if spec.get("tag") and spec["tag"] in msg:
+            return name
+    for name, spec in REPLIES.items():
+        if not spec.get("tag"):
+            first = next(f for f in spec["fields"] if not f.get("optional"))
+            if first["name"] in msg:
+                return name
+    return None
+
+
+def ping():
+    """Round trip check, answered with pong"""
+    return build("ping")
+
+
+def home(arm=None, ms=None, led=None, rgb=None):
+    """Move all joints to 0 deg"""
+    return build("home", arm=arm, ms=ms, led=led, rgb=rgb)
+
+
+def led(val, arm=None):
+    """Set the LED channel directly"""
+    return build("led", val=val, arm=arm)
+
+
+def rgb(r, g, b, arm=None):
+    """Set the RGB LED directly"""
+    return build("rgb", r=r, g=g, b=b, arm=arm)
+
+
+def frame(deg, arm=None, ms=None, led=None, rgb=None):
+    """Move to deg (-90..+90, missing joints hold) in ms, acknowledged"""
+    return build("frame", deg=deg, arm=arm, ms=ms, led=led, rgb=rgb)
+
+
+def rt_frame(deg, arm=None, ms=None, led=None, rgb=None):
+    """Like frame, fire-and-forget (no reply), through the input filters"""
+    return build("rt_frame", deg=deg, arm=arm, ms=ms, led=led, rgb=rgb)
+
+
+def status(arm=None):
+    """Request a status report"""
+    return build("status", arm=arm)
@@ -7,12 +7,14 @@ Testuje wszystkie tryby sterowania:
 - rt_frame: real-time (fire-and-forget)  
 - trajectory: buforowanie sekwencji na ESP32
 - stream: tryb strumieniowy z kompaktowymi danymi
-- freq: ustawienie częstotliwości PWM serw (40-60 Hz)
+- freq: ustawienie częstotliwości PWM serw (40-60 Hz, 200-330 Hz dla serw cyfrowych)
 - config: konfiguracja parametrów serw (min_us, max_us, offset_us, invert)
+- --binary: te same polecenia w ramkach binarnych (roboarm_protocol.py)
 """
 
 import argparse
 import json
+import os
 import sys
 import time
 import asyncio
@@ -21,6 +23,8 @@ from typing import List
 import websockets
 from websockets.exceptions import ConnectionClosed
 
+import roboarm_protocol as rp
+
 
 async def test_stream_mode(websocket):
     """Testuje tryb stream - wysyła kilka pozycji w trybie strumieniowym."""
@@ -120,6 +124,36 @@ async def run_sequence(websocket):
     await test_stream_mode(websocket)
 
 
+async def run_binary_sequence(websocket):
+    """Polecenia w ramkach binarnych; odpowiedzi dekodowane tym samym schematem."""
+    seq = [
+        ("ping", {}),
+        ("home", {"ms": 800, "rgb": {"g": 255}}),
+        ("frame", {"deg": [10, -20, 15, -5, 30], "ms": 1000, "led": 200}),
+        ("status", {}),
+        ("rt_frame", {"deg": [20, -10, 0, 15, -25], "ms": 100}),
+        ("led", {"val": 8}),
+    ]
+    for name, msg in seq:
+        data = rp.encode_bin(name, msg)
+        print(f"---\nWysyłam (bin {len(data)} B):", name, msg)
+        await websocket.send(data)
+        if name == "rt_frame":
+            print("<- (brak odpowiedzi - fire-and-forget)")
+            await asyncio.sleep(0.2)
+            continue
+        try:
+            reply = await asyncio.wait_for(websocket.recv(), timeout=3.0)
+        except asyncio.TimeoutError:
+            print("Brak odpowiedzi (timeout)")
+            continue
+        if isinstance(reply, bytes):
+            print("<-", rp.decode_bin(reply))
+        else:
+            print("<-", reply)
+        await asyncio.sleep(0.5)
+
+
 async def connect_websocket(host: str, port: int):
     """Nawiązuje połączenie WebSocket z ESP32."""
     uri = f"ws://{host}:{port}"
@@ -134,9 +168,10 @@ async def connect_websocket(host: str, port: int):
 
 async def main():
     p = argparse.ArgumentParser(description="Testowy klient WebSocket JSON dla robota ESP32")
-    p.add_argument("--host", default="192.168.4.1", help="adres IP ESP32 (domyślnie 192.168.4.1)")
-    p.add_argument("--port", type=int, default=81, help="port WebSocket (domyślnie 81)")
+    p.add_argument("--host", default=os.environ.get("ROBOARM_HOST", "192.168.4.1"), help="adres IP ESP32 (domyślnie 192.168.4.1)")
+    p.add_argument("--port", type=int, default=int(os.environ.get("ROBOARM_PORT", "81")), help="port WebSocket (domyślnie 81)")
     p.add_argument("--dry", action="store_true", help="nie łącz się, tylko pokaż sekwencję")
+    p.add_argument("--binary", action="store_true", help="wyślij polecenia w ramkach binarnych")
     args = p.parse_args()
 
     seq_preview = [
@@ -172,7 +207,10 @@ async def main():
         welcome = await websocket.recv()
         print("Wiadomość powitalna:", welcome)
         
-        await run_sequence(websocket)
+        if args.binary:
+            await run_binary_sequence(websocket)
+        else:
+            await run_sequence(websocket)
         
         # # Nasłuchuj na dodatkowe wiadomości przez krótki czas
         # print("\nNasłuchiwanie na dodatkowe wiadomości (5 sekund)...")
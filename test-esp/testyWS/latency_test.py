@@ -6,6 +6,7 @@ Mierzy round-trip time dla różnych typów poleceń.
 
 import argparse
 import asyncio
+import os
 import json
 import time
 import statistics
@@ -203,8 +204,8 @@ class LatencyTester:
 
 async def main():
     parser = argparse.ArgumentParser(description="Test opóźnień WebSocket ESP32")
-    parser.add_argument("--host", default="192.168.4.1", help="IP ESP32")
-    parser.add_argument("--port", type=int, default=81, help="Port WebSocket")
+    parser.add_argument("--host", default=os.environ.get("ROBOARM_HOST", "192.168.4.1"), help="IP ESP32")
+    parser.add_argument("--port", type=int, default=int(os.environ.get("ROBOARM_PORT", "81")), help="Port WebSocket")
     parser.add_argument("--ping-count", type=int, default=100, help="Liczba ping testów")
     parser.add_argument("--frame-count", type=int, default=50, help="Liczba frame testów")
     parser.add_argument("--frequency", type=float, help="Test konkretnej częstotliwości (Hz)")
@@ -5,13 +5,15 @@ Prosty przykład użycia każdego trybu.
 """
 
 import asyncio
+import os
 import json
 import math
 import websockets
 
 async def test_all_modes():
     # Połącz z ESP32
-    uri = "ws://192.168.4.1:81"
+    # ROBOARM_HOST/ROBOARM_PORT pozwalają testować emulator firmware (host/emulator)
+    uri = f"ws://{os.environ.get('ROBOARM_HOST', '192.168.4.1')}:{os.environ.get('ROBOARM_PORT', '81')}"
     
     try:
         async with websockets.connect(uri) as websocket:
@@ -5,13 +5,14 @@ Sprawdza czy można uzyskać kontrolę o wysokiej częstotliwości.
 """
 
 import asyncio
+import os
 import json
 import time
 import math
 import websockets
 
 class RealTimeController:
-    def __init__(self, host="192.168.4.1", port=81):
+    def __init__(self, host=os.environ.get("ROBOARM_HOST", "192.168.4.1"), port=int(os.environ.get("ROBOARM_PORT", "81"))):
         self.host = host
         self.port = port
         self.websocket = None